@@ -1,3 +1,8 @@
+// Set for meshes in the quantized vertex format: positions arrive as unorm16
+// within the mesh bounds (the instance model matrix carries the mapping back),
+// normals as snorm16 octahedral coordinates and colors as unorm8.
+override QUANTIZED: bool = false;
+
 struct Uniforms {
     view_proj: mat4x4<f32>,
 }
@@ -20,13 +25,38 @@ struct VertexOutput {
     @builtin(position) clip_position: vec4<f32>,
     @location(0) color: vec4<f32>,
     @location(1) world_normal: vec3<f32>,
+    // Object id for the screen space outline, 0 is the background
+    @location(2) @interpolate(flat) object_id: u32,
 }
 
 @group(0) @binding(0)
 var<uniform> uniforms: Uniforms;
 
+fn octahedral_decode(e: vec2<f32>) -> vec3<f32> {
+    var n = vec3<f32>(e, 1.0 - abs(e.x) - abs(e.y));
+    let t = max(-n.z, 0.0);
+    n.x += select(t, -t, n.x >= 0.0);
+    n.y += select(t, -t, n.y >= 0.0);
+    return normalize(n);
+}
+
+// Distinct per instance: the translation tells instances apart across draws,
+// the instance index within a draw
+fn object_id(instance: Instance, instance_index: u32) -> u32 {
+    let t = bitcast<vec3<u32>>(instance.model_matrix_t.xyz);
+    var h = t.x ^ (t.y * 0x85EBCA6Bu) ^ (t.z * 0xC2B2AE35u) ^ (instance_index * 0x9E3779B1u);
+    h ^= h >> 16u;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15u;
+    return h | 1u;
+}
+
 @vertex
-fn vs_main(input: VertexInput, instance: Instance) -> VertexOutput {
+fn vs_main(
+    input: VertexInput,
+    instance: Instance,
+    @builtin(instance_index) instance_index: u32,
+) -> VertexOutput {
     let model_matrix = mat4x4<f32>(
         instance.model_matrix_x,
         instance.model_matrix_y,
@@ -34,18 +64,28 @@ fn vs_main(input: VertexInput, instance: Instance) -> VertexOutput {
         instance.model_matrix_t,
     );
 
+    var normal = input.normal;
+    if (QUANTIZED) {
+        normal = octahedral_decode(input.normal.xy);
+    }
+
     var output: VertexOutput;
     output.clip_position = uniforms.view_proj * model_matrix * vec4<f32>(input.position, 1.0);
     output.color = instance.color;
-    output.world_normal = normalize((model_matrix * vec4<f32>(input.normal, 0.0)).xyz);
+    output.world_normal = normalize((model_matrix * vec4<f32>(normal, 0.0)).xyz);
+    output.object_id = object_id(instance, instance_index);
     return output;
 }
 
+fn shade(input: VertexOutput) -> vec4<f32> {
+    let ambient_color = vec4<f32>(vec3<f32>(0.5), 1.0);
+    return vec4<f32>(ambient_color * input.color);
+}
+
 // Fragment shader for solid render pass
 @fragment
 fn fs_main(input: VertexOutput) -> @location(0) vec4<f32> {
-    let ambient_color = vec4<f32>(vec3<f32>(0.5), 1.0);
-    return vec4<f32>(ambient_color * input.color);
+    return shade(input);
 }
 
 // Fragment shader for outline render pass
@@ -53,3 +93,172 @@ fn fs_main(input: VertexOutput) -> @location(0) vec4<f32> {
 fn edges_fs_main(input: VertexOutput) -> @location(0) vec4<f32> {
     return input.color;
 }
+
+// Wireframe edge mode: the solid draw pulls its own vertices and shades the
+// outline sides marked in the mesh edge flags
+struct WireframeOutput {
+    @builtin(position) clip_position: vec4<f32>,
+    @location(0) color: vec4<f32>,
+    @location(1) world_normal: vec3<f32>,
+    @location(2) barycentric: vec3<f32>,
+    // Bit k set when the side from corner k to corner k + 1 is an outline
+    @location(3) @interpolate(flat) edge_mask: u32,
+}
+
+// Raw words of the mesh vertex buffer, `Vertex` or `QuantizedVertex`
+@group(1) @binding(0)
+var<storage, read> vertex_words: array<u32>;
+@group(1) @binding(1)
+var<storage, read> index_words: array<u32>;
+// One byte of side flags per triangle
+@group(1) @binding(2)
+var<storage, read> edge_flags: array<u32>;
+
+fn pull_position(v: u32) -> vec3<f32> {
+    if (QUANTIZED) {
+        let xy = unpack2x16unorm(vertex_words[v * 4u]);
+        let zw = unpack2x16unorm(vertex_words[v * 4u + 1u]);
+        return vec3<f32>(xy, zw.x);
+    }
+    return vec3<f32>(
+        bitcast<f32>(vertex_words[v * 9u]),
+        bitcast<f32>(vertex_words[v * 9u + 1u]),
+        bitcast<f32>(vertex_words[v * 9u + 2u]),
+    );
+}
+
+fn pull_normal(v: u32) -> vec3<f32> {
+    if (QUANTIZED) {
+        return octahedral_decode(unpack2x16snorm(vertex_words[v * 4u + 2u]));
+    }
+    return vec3<f32>(
+        bitcast<f32>(vertex_words[v * 9u + 6u]),
+        bitcast<f32>(vertex_words[v * 9u + 7u]),
+        bitcast<f32>(vertex_words[v * 9u + 8u]),
+    );
+}
+
+@vertex
+fn vs_wireframe(
+    @builtin(vertex_index) vertex_index: u32,
+    instance: Instance,
+) -> WireframeOutput {
+    let model_matrix = mat4x4<f32>(
+        instance.model_matrix_x,
+        instance.model_matrix_y,
+        instance.model_matrix_z,
+        instance.model_matrix_t,
+    );
+    let v = index_words[vertex_index];
+    let triangle = vertex_index / 3u;
+    let corner = vertex_index % 3u;
+
+    var output: WireframeOutput;
+    output.clip_position = uniforms.view_proj * model_matrix * vec4<f32>(pull_position(v), 1.0);
+    output.color = instance.color;
+    output.world_normal = normalize((model_matrix * vec4<f32>(pull_normal(v), 0.0)).xyz);
+    output.barycentric = vec3<f32>(
+        f32(corner == 0u),
+        f32(corner == 1u),
+        f32(corner == 2u),
+    );
+    output.edge_mask = (edge_flags[triangle / 4u] >> ((triangle % 4u) * 8u)) & 7u;
+    return output;
+}
+
+@fragment
+fn wireframe_fs_main(input: WireframeOutput) -> @location(0) vec4<f32> {
+    let ambient_color = vec4<f32>(vec3<f32>(0.5), 1.0);
+    // Distance in pixels to each side, measured by the barycentric of the
+    // opposite corner
+    let side_distance = input.barycentric / fwidth(input.barycentric);
+    var nearest = 1.0e6;
+    if ((input.edge_mask & 1u) != 0u) {
+        nearest = min(nearest, side_distance.z);
+    }
+    if ((input.edge_mask & 2u) != 0u) {
+        nearest = min(nearest, side_distance.x);
+    }
+    if ((input.edge_mask & 4u) != 0u) {
+        nearest = min(nearest, side_distance.y);
+    }
+    // One pixel wide, matching the line list edges
+    let edge = 1.0 - smoothstep(0.5, 1.5, nearest);
+    return mix(ambient_color * input.color, input.color, edge);
+}
+
+// Screen space edge mode: the solid pass also writes normals and object ids,
+// then a full screen pass runs Sobel filters over depth and normals and
+// compares object ids
+struct GBufferOutput {
+    @location(0) color: vec4<f32>,
+    @location(1) normal: vec4<f32>,
+    @location(2) object_id: u32,
+}
+
+@fragment
+fn gbuffer_fs_main(input: VertexOutput) -> GBufferOutput {
+    var output: GBufferOutput;
+    output.color = shade(input);
+    output.normal = vec4<f32>(input.world_normal, 0.0);
+    output.object_id = input.object_id;
+    return output;
+}
+
+// Relative change of view depth across a pixel that counts as an edge
+override OUTLINE_DEPTH_THRESHOLD: f32 = 0.1;
+// Sobel magnitude of the normals that counts as an edge
+override OUTLINE_NORMAL_THRESHOLD: f32 = 1.0;
+
+@group(1) @binding(3)
+var outline_depth: texture_depth_2d;
+@group(1) @binding(4)
+var outline_normal: texture_2d<f32>;
+@group(1) @binding(5)
+var outline_object_id: texture_2d<u32>;
+
+@vertex
+fn vs_fullscreen(@builtin(vertex_index) vertex_index: u32) -> @builtin(position) vec4<f32> {
+    let uv = vec2<f32>(f32((vertex_index << 1u) & 2u), f32(vertex_index & 2u));
+    return vec4<f32>(uv * 2.0 - 1.0, 0.0, 1.0);
+}
+
+// Proportional to view depth for a perspective projection with a far plane
+// well beyond the near plane
+fn view_depth(coord: vec2<i32>) -> f32 {
+    let depth = textureLoad(outline_depth, coord, 0);
+    return 1.0 / max(1.0 - depth, 1.0e-7);
+}
+
+@fragment
+fn outline_fs_main(@builtin(position) position: vec4<f32>) -> @location(0) vec4<f32> {
+    let size = vec2<i32>(textureDimensions(outline_depth));
+    let center = vec2<i32>(position.xy);
+    let center_id = textureLoad(outline_object_id, center, 0).x;
+
+    // Sobel weights of the 3x3 neighborhood, x and y
+    var depth_gradient = vec2<f32>(0.0);
+    var normal_gradient_x = vec3<f32>(0.0);
+    var normal_gradient_y = vec3<f32>(0.0);
+    var id_edge = false;
+    for (var y = -1; y <= 1; y++) {
+        for (var x = -1; x <= 1; x++) {
+            let coord = clamp(center + vec2<i32>(x, y), vec2<i32>(0), size - 1);
+            let weight = vec2<f32>(
+                f32(x) * select(1.0, 2.0, y == 0),
+                f32(y) * select(1.0, 2.0, x == 0),
+            );
+            depth_gradient += weight * view_depth(coord);
+            let normal = textureLoad(outline_normal, coord, 0).xyz;
+            normal_gradient_x += weight.x * normal;
+            normal_gradient_y += weight.y * normal;
+            id_edge = id_edge || textureLoad(outline_object_id, coord, 0).x != center_id;
+        }
+    }
+
+    let depth_edge = length(depth_gradient) > OUTLINE_DEPTH_THRESHOLD * view_depth(center);
+    let normal_edge = center_id != 0u &&
+        length(normal_gradient_x) + length(normal_gradient_y) > OUTLINE_NORMAL_THRESHOLD;
+    let edge = f32(id_edge || depth_edge || normal_edge);
+    return vec4<f32>(vec3<f32>(edge), 0.0);
+}
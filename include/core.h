@@ -1,12 +1,17 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <fcntl.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -15,6 +20,7 @@
 #define VEC_MAX_WRITE 64
 #define EPSILON 1e-9
 #define DEFAULT_ARRAY_CAPACITY 64
+#define MAX_WORKER_THREADS 64
 #define DEG2RAD M_PI / 180.0f
 #define RAD2DEG 180.0f / M_PI
 
@@ -90,6 +96,9 @@
         arr->capacity = 0;                                             \
     }                                                                  \
                                                                        \
+    /* Empty the array but keep its storage for the next fill */       \
+    static inline void name##_clear(name* arr) { arr->count = 0; }     \
+                                                                       \
     static inline void name##_free(name* arr) {                        \
         if (arr->items) {                                              \
             RAIJIN_FREE(arr->items);                                   \
@@ -182,6 +191,26 @@ typedef enum LogLevel {
 } LogLevel;
 
 DEFINE_DYNAMIC_ARRAY(char, CharArray)
+DEFINE_DYNAMIC_ARRAY(u32, U32Array)
+DEFINE_DYNAMIC_ARRAY(f64, F64Array)
+
+// A shader source compiled into the binary, see `embed_shaders` in nob.c
+typedef struct EmbeddedShader {
+    const char* name;
+    const char* source;
+    usize size;
+} EmbeddedShader;
+
+#ifdef RAIJIN_EMBED_SHADERS
+#include "raijin_shaders.h"
+#endif
+
+typedef struct MappedFile {
+    const u8* data;
+    usize size;
+} MappedFile;
+
+typedef void (*ParallelTask)(void* ctx, u32 index, u32 count);
 
 /* Function Prototypes */
 
@@ -192,6 +221,29 @@ WGPUBuffer create_buffer(
     const char* label
 );
 ReturnStatus load_shader(const char* path, CharArray* buffer);
+ReturnStatus load_shader_source(const char* name, CharArray* buffer);
+u64 hash_bytes(const void* data, usize size, u64 seed);
+int compare_f64(const void* a, const void* b);
+f64 percentile(const F64Array* sorted, f64 p);
+ReturnStatus MappedFile_open(MappedFile* file, const char* path);
+void MappedFile_close(MappedFile* file);
+u32 cpu_count(void);
+void parallel_for(ParallelTask task, void* ctx, u32 count);
+
+/** Monotonic clock, in seconds */
+static inline f64 now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+}
+
+static inline u64 mix_u64(u64 x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    return x ^ (x >> 33);
+}
 
 /* Functions */
 
@@ -272,4 +324,197 @@ ReturnStatus load_shader(const char* path, CharArray* buffer) {
     return RETURN_SUCCESS;
 }
 
+/** Source of a shader by file name
+ *
+ * `RAIJIN_SHADER_DIR` in the environment loads it from that directory, for
+ * editing shaders without rebuilding.  Otherwise the copy embedded at build
+ * time is used, or the assets directory when shaders are not embedded.
+ *
+ * @param[in] name          Shader file name, e.g. "default_shader.wgsl"
+ * @param[in,out] buffer    Buffer to append the source to
+ * @returns                 Return status
+ */
+ReturnStatus load_shader_source(const char* name, CharArray* buffer) {
+    char path[4096];
+    const char* dir = getenv("RAIJIN_SHADER_DIR");
+    if (dir != NULL && dir[0] != '\0') {
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        return load_shader(path, buffer);
+    }
+#ifdef RAIJIN_EMBED_SHADERS
+    for (usize i = 0; i < ARRAY_COUNT(EMBEDDED_SHADERS); ++i) {
+        if (strcmp(EMBEDDED_SHADERS[i].name, name) == 0) {
+            CharArray_push_many(
+                buffer, EMBEDDED_SHADERS[i].source, EMBEDDED_SHADERS[i].size
+            );
+            return RETURN_SUCCESS;
+        }
+    }
+    LOG_ERROR("No embedded shader named %s", name);
+    return RETURN_FAILURE;
+#else
+    snprintf(path, sizeof(path), RAIJIN_ASSETS_DIR "/shaders/%s", name);
+    return load_shader(path, buffer);
+#endif
+}
+
+/** 64 bit non-cryptographic hash of a byte range
+ *
+ * @param[in] data      Bytes to hash
+ * @param[in] size      Number of bytes
+ * @param[in] seed      Initial value, allows chaining several ranges
+ * @returns             Hash value
+ */
+u64 hash_bytes(const void* data, usize size, u64 seed) {
+    const u8* p = (const u8*)data;
+    u64 h = seed ^ ((u64)size * 0x9E3779B97F4A7C15ull);
+    // Four independent lanes keep the multipliers busy on large inputs
+    u64 lanes[4] = {h, h + 1, h + 2, h + 3};
+    while (size >= 32) {
+        for (u32 i = 0; i < 4; ++i) {
+            u64 v;
+            memcpy(&v, p + i * 8, sizeof(v));
+            lanes[i] = (lanes[i] ^ v) * 0x9E3779B97F4A7C15ull;
+            lanes[i] ^= lanes[i] >> 31;
+        }
+        p += 32;
+        size -= 32;
+    }
+    h = mix_u64(lanes[0] ^ mix_u64(lanes[1] ^ mix_u64(lanes[2] ^ lanes[3])));
+    while (size >= 8) {
+        u64 v;
+        memcpy(&v, p, sizeof(v));
+        h = mix_u64(h ^ v);
+        p += 8;
+        size -= 8;
+    }
+    u64 tail = 0;
+    memcpy(&tail, p, size);
+    return mix_u64(h ^ tail);
+}
+
+/** Ascending `qsort` comparator for f64 values */
+int compare_f64(const void* a, const void* b) {
+    f64 x = *(const f64*)a;
+    f64 y = *(const f64*)b;
+    return (x > y) - (x < y);
+}
+
+/** Linearly interpolated percentile of sorted values
+ *
+ * @param[in] sorted    Values in ascending order
+ * @param[in] p         Percentile, in [0, 1]
+ * @returns             Percentile, 0 when there are no values
+ */
+f64 percentile(const F64Array* sorted, f64 p) {
+    if (sorted->count == 0) return 0.0;
+    f64 rank = p * (f64)(sorted->count - 1);
+    usize lower = (usize)rank;
+    usize upper = lower + 1 < sorted->count ? lower + 1 : lower;
+    f64 t = rank - (f64)lower;
+    return sorted->items[lower] * (1.0 - t) + sorted->items[upper] * t;
+}
+
+/** Map a file read-only into memory
+ *
+ * @param[out] file     Mapping of the whole file
+ * @param[in] path      File path
+ * @returns             Return status
+ */
+ReturnStatus MappedFile_open(MappedFile* file, const char* path) {
+    file->data = NULL;
+    file->size = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open file: %s", path);
+        return RETURN_FAILURE;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        LOG_ERROR("Failed to stat file: %s", path);
+        close(fd);
+        return RETURN_FAILURE;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return RETURN_SUCCESS;
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    // Fault the whole file in up front instead of one page at a time
+    flags |= MAP_POPULATE;
+#endif
+    void* data = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Failed to map file: %s", path);
+        return RETURN_FAILURE;
+    }
+    // Readers stream front to back, let the kernel read ahead aggressively
+    posix_madvise(data, st.st_size, POSIX_MADV_SEQUENTIAL);
+    file->data = data;
+    file->size = st.st_size;
+    return RETURN_SUCCESS;
+}
+
+void MappedFile_close(MappedFile* file) {
+    if (file->data != NULL) {
+        munmap((void*)file->data, file->size);
+    }
+    file->data = NULL;
+    file->size = 0;
+}
+
+/** Number of online CPUs, at least 1 */
+u32 cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (u32)n : 1;
+}
+
+typedef struct ParallelWorker {
+    ParallelTask task;
+    void* ctx;
+    u32 index;
+    u32 count;
+} ParallelWorker;
+
+static void* parallel_worker_main(void* arg) {
+    ParallelWorker* worker = (ParallelWorker*)arg;
+    worker->task(worker->ctx, worker->index, worker->count);
+    return NULL;
+}
+
+/** Run `task` for every index in [0, count) on its own thread
+ *
+ * Index 0 runs on the calling thread.  Returns once all tasks finished.  If a
+ * thread cannot be spawned its task runs inline instead.
+ *
+ * @param[in] task      Task function
+ * @param[in] ctx       Context passed to every task
+ * @param[in] count     Number of tasks, clamped to MAX_WORKER_THREADS
+ */
+void parallel_for(ParallelTask task, void* ctx, u32 count) {
+    if (count == 0) return;
+    if (count > MAX_WORKER_THREADS) count = MAX_WORKER_THREADS;
+    if (count == 1) {
+        task(ctx, 0, 1);
+        return;
+    }
+    pthread_t threads[MAX_WORKER_THREADS];
+    bool spawned[MAX_WORKER_THREADS] = {0};
+    ParallelWorker workers[MAX_WORKER_THREADS];
+    for (u32 i = 1; i < count; ++i) {
+        workers[i] = (ParallelWorker){task, ctx, i, count};
+        spawned[i] = pthread_create(
+                         &threads[i], NULL, parallel_worker_main, &workers[i]
+                     ) == 0;
+        if (!spawned[i]) task(ctx, i, count);
+    }
+    task(ctx, 0, count);
+    for (u32 i = 1; i < count; ++i) {
+        if (spawned[i]) pthread_join(threads[i], NULL);
+    }
+}
+
 #endif /* TYPES_H */
@@ -0,0 +1,245 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include "core.h"
+#include "webgpu.h"
+#include "wgpu.h"
+
+// Frame pacing: the present mode, how many frames the CPU may queue ahead
+// of the GPU, and an optional frame rate cap.
+//
+// Frames in flight are counted with `wgpuQueueOnSubmittedWorkDone` after
+// each frame's submission.  Once the limit is reached the renderer blocks
+// on the oldest frame's submission index rather than on the whole queue.
+//
+// The limiter sleeps until shortly before the next frame is due, then
+// spins the rest of the way, since sleeps routinely overshoot by a
+// millisecond or more.
+//
+// Every setting can be overridden per deployment from the environment:
+//   RAIJIN_PRESENT_MODE     fifo, fifo_relaxed, mailbox or immediate
+//   RAIJIN_FRAMES_IN_FLIGHT 1 to FRAME_PACER_MAX_FRAMES_IN_FLIGHT
+//   RAIJIN_MAX_FPS          frame rate cap, 0 for none
+
+#define FRAME_PACER_MAX_FRAMES_IN_FLIGHT 4
+#define FRAME_PACER_DEFAULT_FRAMES_IN_FLIGHT 2
+// Time before a deadline the limiter stops sleeping and spins
+#define FRAME_PACER_SPIN_SECONDS 0.002
+
+/* Types */
+
+typedef struct FramePacingConfig {
+    // Preferred mode, the closest supported one is used.  Undefined is Fifo.
+    WGPUPresentMode present_mode;
+    // 0 for FRAME_PACER_DEFAULT_FRAMES_IN_FLIGHT
+    u32 max_frames_in_flight;
+    // 0 for no cap
+    f64 max_fps;
+} FramePacingConfig;
+
+typedef struct FramePacer {
+    WGPUDevice device;
+    u32 max_frames_in_flight;
+    f64 frame_interval;
+    // Submission index of each frame in flight, by frame number
+    WGPUSubmissionIndex submissions[FRAME_PACER_MAX_FRAMES_IN_FLIGHT];
+    u64 submitted;
+    // Frames the GPU finished, advanced by the work done callbacks
+    u64 completed;
+    f64 next_frame_time;
+} FramePacer;
+
+/* Function Prototypes */
+
+const char* PresentMode_name(WGPUPresentMode mode);
+WGPUPresentMode select_present_mode(
+    const WGPUSurfaceCapabilities* caps, WGPUPresentMode preferred
+);
+void FramePacingConfig_from_env(FramePacingConfig* config);
+void FramePacer_init(
+    FramePacer* pacer, WGPUDevice device, const FramePacingConfig* config
+);
+void FramePacer_wait(FramePacer* pacer);
+void FramePacer_limit(FramePacer* pacer);
+void FramePacer_submitted(
+    FramePacer* pacer, WGPUQueue queue, WGPUSubmissionIndex submission
+);
+void FramePacer_drain(FramePacer* pacer);
+
+static void frame_done_callback(
+    WGPUQueueWorkDoneStatus status, void* userdata1, void* userdata2
+);
+
+/* Functions */
+
+const char* PresentMode_name(WGPUPresentMode mode) {
+    switch (mode) {
+        case WGPUPresentMode_Fifo: return "fifo";
+        case WGPUPresentMode_FifoRelaxed: return "fifo_relaxed";
+        case WGPUPresentMode_Immediate: return "immediate";
+        case WGPUPresentMode_Mailbox: return "mailbox";
+        default: return "undefined";
+    }
+}
+
+/** Closest present mode to `preferred` the surface supports
+ *
+ * Mailbox and Immediate fall back to each other, as both avoid waiting for
+ * vblank, then to Fifo.  FifoRelaxed falls back to Fifo, which every
+ * surface supports.
+ *
+ * @param[in] caps          Surface capabilities for the adapter
+ * @param[in] preferred     Requested mode
+ * @returns                 Supported present mode
+ */
+WGPUPresentMode select_present_mode(
+    const WGPUSurfaceCapabilities* caps, WGPUPresentMode preferred
+) {
+    WGPUPresentMode order[3] = {
+        preferred, WGPUPresentMode_Fifo, WGPUPresentMode_Fifo
+    };
+    if (preferred == WGPUPresentMode_Mailbox) {
+        order[1] = WGPUPresentMode_Immediate;
+    } else if (preferred == WGPUPresentMode_Immediate) {
+        order[1] = WGPUPresentMode_Mailbox;
+    }
+    for (u32 i = 0; i < ARRAY_COUNT(order); ++i) {
+        for (usize j = 0; j < caps->presentModeCount; ++j) {
+            if (caps->presentModes[j] == order[i]) return order[i];
+        }
+    }
+    return WGPUPresentMode_Fifo;
+}
+
+/** Override settings with the RAIJIN_* variables that are set */
+void FramePacingConfig_from_env(FramePacingConfig* config) {
+    const char* mode = getenv("RAIJIN_PRESENT_MODE");
+    if (mode != NULL && mode[0] != '\0') {
+        WGPUPresentMode modes[] = {
+            WGPUPresentMode_Fifo,
+            WGPUPresentMode_FifoRelaxed,
+            WGPUPresentMode_Immediate,
+            WGPUPresentMode_Mailbox,
+        };
+        bool found = false;
+        for (u32 i = 0; i < ARRAY_COUNT(modes) && !found; ++i) {
+            found = strcmp(mode, PresentMode_name(modes[i])) == 0;
+            if (found) config->present_mode = modes[i];
+        }
+        if (!found) LOG_WARN("Unknown RAIJIN_PRESENT_MODE: %s", mode);
+    }
+    const char* frames = getenv("RAIJIN_FRAMES_IN_FLIGHT");
+    if (frames != NULL && frames[0] != '\0') {
+        config->max_frames_in_flight = (u32)strtoul(frames, NULL, 10);
+    }
+    const char* fps = getenv("RAIJIN_MAX_FPS");
+    if (fps != NULL && fps[0] != '\0') config->max_fps = strtod(fps, NULL);
+}
+
+/** Start pacing frames submitted to a device
+ *
+ * @param[out] pacer    Frame pacer
+ * @param[in] device    Device frames are submitted to
+ * @param[in] config    Frames in flight and frame rate cap
+ */
+void FramePacer_init(
+    FramePacer* pacer, WGPUDevice device, const FramePacingConfig* config
+) {
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->device = device;
+    u32 frames = config->max_frames_in_flight;
+    if (frames == 0) frames = FRAME_PACER_DEFAULT_FRAMES_IN_FLIGHT;
+    if (frames > FRAME_PACER_MAX_FRAMES_IN_FLIGHT) {
+        frames = FRAME_PACER_MAX_FRAMES_IN_FLIGHT;
+    }
+    pacer->max_frames_in_flight = frames;
+    pacer->frame_interval = config->max_fps > 0.0 ? 1.0 / config->max_fps : 0.0;
+}
+
+/** Block until fewer than `max_frames_in_flight` frames are on the GPU */
+void FramePacer_wait(FramePacer* pacer) {
+    if (pacer->device == NULL || pacer->submitted == 0) return;
+    wgpuDevicePoll(pacer->device, false, NULL);
+    while (pacer->completed < pacer->submitted &&
+           pacer->submitted - pacer->completed >=
+               pacer->max_frames_in_flight) {
+        u64 oldest = pacer->completed;
+        WGPUSubmissionIndex submission =
+            pacer->submissions[oldest % FRAME_PACER_MAX_FRAMES_IN_FLIGHT];
+        wgpuDevicePoll(pacer->device, true, &submission);
+        // The submission finished even if its callback has yet to run
+        if (pacer->completed == oldest) pacer->completed = oldest + 1;
+    }
+}
+
+/** Hold the frame until the frame rate cap allows the next one */
+void FramePacer_limit(FramePacer* pacer) {
+    if (pacer->frame_interval <= 0.0) return;
+    f64 now = now_seconds();
+    // A frame late by more than an interval restarts the cadence rather
+    // than rushing the next frames to catch up
+    if (now - pacer->next_frame_time > pacer->frame_interval) {
+        pacer->next_frame_time = now + pacer->frame_interval;
+        return;
+    }
+    f64 remaining = pacer->next_frame_time - now;
+    if (remaining > FRAME_PACER_SPIN_SECONDS) {
+        f64 sleep = remaining - FRAME_PACER_SPIN_SECONDS;
+        struct timespec duration = {
+            .tv_sec = (time_t)sleep,
+            .tv_nsec = (long)((sleep - (f64)(time_t)sleep) * 1e9),
+        };
+        nanosleep(&duration, NULL);
+    }
+    while (now_seconds() < pacer->next_frame_time) {
+    }
+    pacer->next_frame_time += pacer->frame_interval;
+}
+
+/** Count a frame whose last submission was just made
+ *
+ * @param[in,out] pacer     Frame pacer
+ * @param[in] queue         Queue the frame was submitted to
+ * @param[in] submission    Index of the frame's last submission
+ */
+void FramePacer_submitted(
+    FramePacer* pacer, WGPUQueue queue, WGPUSubmissionIndex submission
+) {
+    u64 frame = pacer->submitted++;
+    pacer->submissions[frame % FRAME_PACER_MAX_FRAMES_IN_FLIGHT] = submission;
+    WGPUQueueWorkDoneCallbackInfo work_done_cb_info = {
+        .mode = WGPUCallbackMode_AllowProcessEvents,
+        .callback = frame_done_callback,
+        .userdata1 = pacer,
+        .userdata2 = (void*)(uintptr_t)(frame + 1),
+    };
+    wgpuQueueOnSubmittedWorkDone(queue, work_done_cb_info);
+}
+
+/** Wait for every frame in flight, so no callback outlives the pacer */
+void FramePacer_drain(FramePacer* pacer) {
+    if (pacer->device == NULL) return;
+    // Always poll, `FramePacer_wait` may have counted a frame complete
+    // before its callback ran
+    if (pacer->submitted > 0) wgpuDevicePoll(pacer->device, true, NULL);
+    pacer->completed = pacer->submitted;
+    pacer->device = NULL;
+}
+
+static void frame_done_callback(
+    WGPUQueueWorkDoneStatus status, void* userdata1, void* userdata2
+) {
+    FramePacer* pacer = (FramePacer*)userdata1;
+    u64 completed = (u64)(uintptr_t)userdata2;
+    if (status != WGPUQueueWorkDoneStatus_Success) {
+        LOG_WARN("Frame %llu did not complete", (unsigned long long)completed);
+    }
+    // Frames complete in order, a callback run late must not move back, and
+    // one left over from before the pacer was reset must not move past
+    // `submitted`
+    if (completed > pacer->completed && completed <= pacer->submitted) {
+        pacer->completed = completed;
+    }
+}
+
+#endif /* FRAME_PACING_H */
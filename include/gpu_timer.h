@@ -0,0 +1,347 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "core.h"
+#include "webgpu.h"
+#include "wgpu.h"
+
+// GPU time of every pass, measured with timestamp queries written at the
+// beginning and end of each pass.
+//
+// Each frame in flight owns a range of the query set and a readback buffer.
+// The frame's timestamps are resolved and copied out in its own submission,
+// then mapped without blocking and collected by a later frame.  A frame
+// whose slot is still being read back goes untimed rather than stalling.
+//
+// Only available when the device has the TimestampQuery feature, otherwise
+// every function is a no-op and no times are reported.
+
+// Frames whose timestamps may be in flight at once
+#define GPU_TIMER_FRAMES 4
+// Passes timed per frame, later passes go untimed.  16 passes of two 8 byte
+// timestamps keep each frame's resolve offset at the required 256 bytes.
+#define GPU_TIMER_MAX_PASSES 16
+#define GPU_TIMER_QUERIES_PER_FRAME (GPU_TIMER_MAX_PASSES * 2)
+
+/* Types */
+
+typedef enum {
+    GPU_TIMER_SLOT_IDLE,
+    // Timestamps submitted, waiting for the buffer to map
+    GPU_TIMER_SLOT_PENDING,
+    GPU_TIMER_SLOT_MAPPED,
+    GPU_TIMER_SLOT_FAILED,
+} GpuTimerSlotState;
+
+typedef struct GpuPassTime {
+    const char* label;
+    f64 ms;
+} GpuPassTime;
+
+// GPU time of the passes of one frame
+typedef struct GpuFrameTimes {
+    u64 frame_index;
+    u32 pass_count;
+    GpuPassTime passes[GPU_TIMER_MAX_PASSES];
+    // Sum of the passes, gaps between passes excluded
+    f64 total_ms;
+} GpuFrameTimes;
+
+typedef struct GpuTimerSlot {
+    WGPUBuffer buffer;
+    GpuTimerSlotState state;
+    u64 frame_index;
+    u32 pass_count;
+    const char* labels[GPU_TIMER_MAX_PASSES];
+} GpuTimerSlot;
+
+typedef struct GpuTimer {
+    // NULL when timing is unavailable
+    WGPUDevice device;
+    WGPUQuerySet query_set;
+    WGPUBuffer resolve_buffer;
+    GpuTimerSlot slots[GPU_TIMER_FRAMES];
+    // Slot of the frame being encoded, NULL if it goes untimed
+    GpuTimerSlot* recording;
+    // Timestamp writes handed to the passes of the frame being encoded
+    WGPURenderPassTimestampWrites render_writes[GPU_TIMER_MAX_PASSES];
+    WGPUComputePassTimestampWrites compute_writes[GPU_TIMER_MAX_PASSES];
+    u64 frame_count;
+    // Most recent frame read back, valid once `has_latest` is set
+    GpuFrameTimes latest;
+    bool has_latest;
+} GpuTimer;
+
+/* Function Prototypes */
+
+ReturnStatus GpuTimer_init(GpuTimer* timer, WGPUDevice device);
+void GpuTimer_destroy(GpuTimer* timer);
+void GpuTimer_begin_frame(GpuTimer* timer);
+const WGPURenderPassTimestampWrites* GpuTimer_render_pass(
+    GpuTimer* timer, const char* label
+);
+const WGPUComputePassTimestampWrites* GpuTimer_compute_pass(
+    GpuTimer* timer, const char* label
+);
+void GpuTimer_resolve(GpuTimer* timer, WGPUCommandEncoder encoder);
+void GpuTimer_submitted(GpuTimer* timer);
+void GpuTimer_poll(GpuTimer* timer, bool wait);
+const GpuFrameTimes* GpuTimer_latest(const GpuTimer* timer);
+
+static bool GpuTimer_next_pass(
+    GpuTimer* timer, const char* label, u32* begin_index
+);
+static void gpu_timer_map_callback(
+    WGPUMapAsyncStatus status,
+    WGPUStringView msg,
+    void* userdata1,
+    void* userdata2
+);
+
+/* Functions */
+
+/** Create the query set and buffers if the device supports timestamps
+ *
+ * @param[out] timer    GPU timer
+ * @param[in] device    Device, may lack the TimestampQuery feature
+ * @returns             Return status, success when timing is unavailable
+ */
+ReturnStatus GpuTimer_init(GpuTimer* timer, WGPUDevice device) {
+    memset(timer, 0, sizeof(*timer));
+    if (!wgpuDeviceHasFeature(device, WGPUFeatureName_TimestampQuery)) {
+        LOG_INFO("Timestamp queries unsupported, GPU timing disabled");
+        return RETURN_SUCCESS;
+    }
+    WGPUQuerySetDescriptor query_set_desc = {
+        .label = {"GPU Timer Query Set", WGPU_STRLEN},
+        .type = WGPUQueryType_Timestamp,
+        .count = GPU_TIMER_FRAMES * GPU_TIMER_QUERIES_PER_FRAME,
+    };
+    timer->query_set = wgpuDeviceCreateQuerySet(device, &query_set_desc);
+    timer->resolve_buffer = create_buffer(
+        device,
+        GPU_TIMER_FRAMES * GPU_TIMER_QUERIES_PER_FRAME * sizeof(u64),
+        WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+        "GPU Timer Resolve Buffer"
+    );
+    bool created = timer->query_set != NULL && timer->resolve_buffer != NULL;
+    for (u32 i = 0; i < GPU_TIMER_FRAMES && created; ++i) {
+        timer->slots[i].buffer = create_buffer(
+            device,
+            GPU_TIMER_QUERIES_PER_FRAME * sizeof(u64),
+            WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+            "GPU Timer Readback Buffer"
+        );
+        created = timer->slots[i].buffer != NULL;
+    }
+    if (!created) {
+        LOG_ERROR("Failed to create GPU timer");
+        GpuTimer_destroy(timer);
+        return RETURN_FAILURE;
+    }
+    timer->device = device;
+    return RETURN_SUCCESS;
+}
+
+void GpuTimer_destroy(GpuTimer* timer) {
+    // No map callback may outlive its slot
+    GpuTimer_poll(timer, true);
+    for (u32 i = 0; i < GPU_TIMER_FRAMES; ++i) {
+        if (timer->slots[i].buffer != NULL) {
+            wgpuBufferRelease(timer->slots[i].buffer);
+        }
+    }
+    if (timer->resolve_buffer != NULL) {
+        wgpuBufferRelease(timer->resolve_buffer);
+    }
+    if (timer->query_set != NULL) wgpuQuerySetRelease(timer->query_set);
+    memset(timer, 0, sizeof(*timer));
+}
+
+/** Collect finished frames and start timing the next one */
+void GpuTimer_begin_frame(GpuTimer* timer) {
+    timer->recording = NULL;
+    if (timer->device == NULL) return;
+    GpuTimer_poll(timer, false);
+    GpuTimerSlot* slot = &timer->slots[timer->frame_count % GPU_TIMER_FRAMES];
+    if (slot->state != GPU_TIMER_SLOT_IDLE) return;
+    slot->pass_count = 0;
+    timer->recording = slot;
+}
+
+/** Timestamp writes for the next render pass of the frame
+ *
+ * @param[in,out] timer GPU timer
+ * @param[in] label     Pass name reported with its time, must outlive it
+ * @returns             `timestampWrites` of the pass, NULL if untimed
+ */
+const WGPURenderPassTimestampWrites* GpuTimer_render_pass(
+    GpuTimer* timer, const char* label
+) {
+    u32 begin_index = 0;
+    if (!GpuTimer_next_pass(timer, label, &begin_index)) return NULL;
+    WGPURenderPassTimestampWrites* writes =
+        &timer->render_writes[timer->recording->pass_count - 1];
+    writes->querySet = timer->query_set;
+    writes->beginningOfPassWriteIndex = begin_index;
+    writes->endOfPassWriteIndex = begin_index + 1;
+    return writes;
+}
+
+/** Timestamp writes for the next compute pass of the frame
+ *
+ * @param[in,out] timer GPU timer
+ * @param[in] label     Pass name reported with its time, must outlive it
+ * @returns             `timestampWrites` of the pass, NULL if untimed
+ */
+const WGPUComputePassTimestampWrites* GpuTimer_compute_pass(
+    GpuTimer* timer, const char* label
+) {
+    u32 begin_index = 0;
+    if (!GpuTimer_next_pass(timer, label, &begin_index)) return NULL;
+    WGPUComputePassTimestampWrites* writes =
+        &timer->compute_writes[timer->recording->pass_count - 1];
+    writes->querySet = timer->query_set;
+    writes->beginningOfPassWriteIndex = begin_index;
+    writes->endOfPassWriteIndex = begin_index + 1;
+    return writes;
+}
+
+/** Resolve the frame's timestamps and copy them to its readback buffer
+ *
+ * Called after the frame's last pass, before finishing the encoder.
+ */
+void GpuTimer_resolve(GpuTimer* timer, WGPUCommandEncoder encoder) {
+    GpuTimerSlot* slot = timer->recording;
+    if (slot == NULL || slot->pass_count == 0) return;
+    u32 first_query = (u32)(slot - timer->slots) * GPU_TIMER_QUERIES_PER_FRAME;
+    u32 query_count = slot->pass_count * 2;
+    wgpuCommandEncoderResolveQuerySet(
+        encoder,
+        timer->query_set,
+        first_query,
+        query_count,
+        timer->resolve_buffer,
+        first_query * sizeof(u64)
+    );
+    wgpuCommandEncoderCopyBufferToBuffer(
+        encoder,
+        timer->resolve_buffer,
+        first_query * sizeof(u64),
+        slot->buffer,
+        0,
+        query_count * sizeof(u64)
+    );
+}
+
+/** Start reading back the frame's timestamps once it was submitted */
+void GpuTimer_submitted(GpuTimer* timer) {
+    if (timer->device == NULL) return;
+    GpuTimerSlot* slot = timer->recording;
+    u64 frame_index = timer->frame_count++;
+    timer->recording = NULL;
+    if (slot == NULL || slot->pass_count == 0) return;
+    slot->frame_index = frame_index;
+    slot->state = GPU_TIMER_SLOT_PENDING;
+    WGPUBufferMapCallbackInfo map_cb_info = {
+        .mode = WGPUCallbackMode_AllowProcessEvents,
+        .callback = gpu_timer_map_callback,
+        .userdata1 = slot,
+    };
+    wgpuBufferMapAsync(
+        slot->buffer,
+        WGPUMapMode_Read,
+        0,
+        slot->pass_count * 2 * sizeof(u64),
+        map_cb_info
+    );
+}
+
+/** Turn mapped timestamps into pass times
+ *
+ * @param[in,out] timer GPU timer
+ * @param[in] wait      Block until every frame in flight was read back
+ */
+void GpuTimer_poll(GpuTimer* timer, bool wait) {
+    if (timer->device == NULL) return;
+    wgpuDevicePoll(timer->device, false, NULL);
+    for (u32 i = 0; i < GPU_TIMER_FRAMES; ++i) {
+        GpuTimerSlot* slot = &timer->slots[i];
+        while (wait && slot->state == GPU_TIMER_SLOT_PENDING) {
+            wgpuDevicePoll(timer->device, true, NULL);
+        }
+        if (slot->state == GPU_TIMER_SLOT_MAPPED) {
+            const u64* ticks = wgpuBufferGetConstMappedRange(
+                slot->buffer, 0, slot->pass_count * 2 * sizeof(u64)
+            );
+            // Slots map out of order, only newer frames replace the latest
+            bool newer = !timer->has_latest ||
+                         slot->frame_index > timer->latest.frame_index;
+            if (ticks != NULL && newer) {
+                GpuFrameTimes* times = &timer->latest;
+                times->frame_index = slot->frame_index;
+                times->pass_count = slot->pass_count;
+                times->total_ms = 0.0;
+                for (u32 p = 0; p < slot->pass_count; ++p) {
+                    // Timestamps are in nanoseconds.  Some drivers reorder
+                    // them across a pass, such a pass reads as zero.
+                    u64 begin = ticks[p * 2];
+                    u64 end = ticks[p * 2 + 1];
+                    f64 ms = end > begin ? (f64)(end - begin) * 1e-6 : 0.0;
+                    times->passes[p].label = slot->labels[p];
+                    times->passes[p].ms = ms;
+                    times->total_ms += ms;
+                }
+                timer->has_latest = true;
+            }
+            wgpuBufferUnmap(slot->buffer);
+            slot->state = GPU_TIMER_SLOT_IDLE;
+        } else if (slot->state == GPU_TIMER_SLOT_FAILED) {
+            slot->state = GPU_TIMER_SLOT_IDLE;
+        }
+    }
+}
+
+/** GPU time of the most recent frame read back
+ *
+ * Lags a few frames behind the frame being rendered.
+ *
+ * @param[in] timer GPU timer
+ * @returns         Pass times, NULL if unavailable or none read back yet
+ */
+const GpuFrameTimes* GpuTimer_latest(const GpuTimer* timer) {
+    return timer->has_latest ? &timer->latest : NULL;
+}
+
+// Claims the query pair of the next pass
+static bool GpuTimer_next_pass(
+    GpuTimer* timer, const char* label, u32* begin_index
+) {
+    GpuTimerSlot* slot = timer->recording;
+    if (slot == NULL || slot->pass_count == GPU_TIMER_MAX_PASSES) {
+        return false;
+    }
+    *begin_index = (u32)(slot - timer->slots) * GPU_TIMER_QUERIES_PER_FRAME +
+                   slot->pass_count * 2;
+    slot->labels[slot->pass_count++] = label;
+    return true;
+}
+
+static void gpu_timer_map_callback(
+    WGPUMapAsyncStatus status,
+    WGPUStringView msg,
+    void* userdata1,
+    void* userdata2
+) {
+    GpuTimerSlot* slot = (GpuTimerSlot*)userdata1;
+    if (status == WGPUMapAsyncStatus_Success) {
+        slot->state = GPU_TIMER_SLOT_MAPPED;
+    } else {
+        LOG_WARN(
+            "Failed to map GPU timestamps: %.*s", (int)msg.length, msg.data
+        );
+        slot->state = GPU_TIMER_SLOT_FAILED;
+    }
+}
+
+#endif /* GPU_TIMER_H */
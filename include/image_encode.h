@@ -0,0 +1,686 @@
+#ifndef IMAGE_ENCODE_H
+#define IMAGE_ENCODE_H
+
+#include <zlib.h>
+
+#include "core.h"
+#include "readback.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Output stage for headless frames.  `ImageEncoder_frame_callback` plugs
+// into `Renderer_set_frame_callback`: it only copies the frame out of the
+// mapped readback buffer, dropping the row padding, and queues it.  Worker
+// threads convert RGBA8 to RGB and encode, so the render loop never waits on
+// an encoder unless the queue is full.
+//
+// Per frame formats write <directory>/frame_<index>.<ext>, or one
+// frame_<index>_view<view>.<ext> per view of a multi-view frame.  Y4M writes
+// every image to one <directory>/frames.y4m stream, appended in the order
+// they were submitted whichever worker encoded them.
+//
+// PNG compresses with zlib at Z_BEST_SPEED, link with -lz.
+
+#define IMAGE_ENCODER_QUEUE_SIZE 64
+#define IMAGE_ENCODER_Y4M_FPS 30
+
+/* Types */
+
+typedef enum {
+    // Packed RGB, no header
+    IMAGE_FORMAT_RAW,
+    IMAGE_FORMAT_QOI,
+    IMAGE_FORMAT_PNG,
+    // YUV 4:2:0 stream, BT.601 studio range
+    IMAGE_FORMAT_Y4M,
+} ImageFormat;
+
+DEFINE_DYNAMIC_ARRAY(u8, U8Array)
+
+typedef struct EncodeJob {
+    // Tightly packed RGBA8, owned by the job
+    u8* rgba;
+    u64 index;
+    u32 view;
+    u32 view_count;
+    // Submission order, the Y4M stream is written in this order
+    u64 sequence;
+    u32 width;
+    u32 height;
+} EncodeJob;
+
+typedef struct ImageEncoder {
+    ImageFormat format;
+    char directory[4096];
+    pthread_t workers[MAX_WORKER_THREADS];
+    u32 worker_count;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    EncodeJob queue[IMAGE_ENCODER_QUEUE_SIZE];
+    u32 head;
+    u32 count;
+    bool stopping;
+    u64 submitted;
+    // IMAGE_FORMAT_Y4M: the stream, and the next sequence to append to it
+    FILE* stream;
+    u64 next_sequence;
+    pthread_cond_t sequence_written;
+    u64 encoded;
+    u64 failed;
+} ImageEncoder;
+
+/* Function Prototypes */
+
+bool ImageFormat_parse(const char* name, ImageFormat* format);
+ReturnStatus ImageEncoder_init(
+    ImageEncoder* encoder,
+    ImageFormat format,
+    const char* directory,
+    u32 worker_count
+);
+ReturnStatus ImageEncoder_submit(
+    ImageEncoder* encoder,
+    const u8* pixels,
+    u32 width,
+    u32 height,
+    u32 bytes_per_row,
+    u64 index,
+    u32 view,
+    u32 view_count
+);
+void ImageEncoder_frame_callback(const HeadlessFrame* frame, void* userdata);
+ReturnStatus ImageEncoder_finish(ImageEncoder* encoder);
+void rgba_to_rgb(const u8* src, u8* dst, usize pixel_count);
+void encode_qoi(const u8* rgb, u32 width, u32 height, U8Array* out);
+ReturnStatus encode_png(const u8* rgb, u32 width, u32 height, U8Array* out);
+void encode_y4m_frame(const u8* rgb, u32 width, u32 height, U8Array* out);
+
+static const char* image_format_extension(ImageFormat format);
+static void U8Array_push_u32_be(U8Array* out, u32 value);
+static void png_chunk(
+    U8Array* out, const char type[4], const u8* data, u32 size
+);
+static inline u8 clamp_u8(i32 value);
+static ReturnStatus ImageEncoder_encode(
+    const ImageEncoder* encoder, const EncodeJob* job, u8* rgb, U8Array* out
+);
+static ReturnStatus ImageEncoder_write(
+    ImageEncoder* encoder, const EncodeJob* job, const U8Array* data
+);
+static void* ImageEncoder_worker_main(void* arg);
+
+/* Functions */
+
+static const char* image_format_extension(ImageFormat format) {
+    switch (format) {
+        case IMAGE_FORMAT_RAW: return "rgb";
+        case IMAGE_FORMAT_QOI: return "qoi";
+        case IMAGE_FORMAT_PNG: return "png";
+        case IMAGE_FORMAT_Y4M: return "y4m";
+    }
+    return "bin";
+}
+
+/** Format named "raw", "qoi", "png" or "y4m"
+ *
+ * @param[in] name      Format name
+ * @param[out] format   Format, left unchanged for an unknown name
+ * @returns             Whether the name is known
+ */
+bool ImageFormat_parse(const char* name, ImageFormat* format) {
+    static const struct {
+        const char* name;
+        ImageFormat format;
+    } formats[] = {
+        {"raw", IMAGE_FORMAT_RAW},
+        {"qoi", IMAGE_FORMAT_QOI},
+        {"png", IMAGE_FORMAT_PNG},
+        {"y4m", IMAGE_FORMAT_Y4M},
+    };
+    for (u32 i = 0; i < ARRAY_COUNT(formats); ++i) {
+        if (strcmp(name, formats[i].name) == 0) {
+            *format = formats[i].format;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Start the encoder workers
+ *
+ * @param[out] encoder      Image encoder
+ * @param[in] format        Output format
+ * @param[in] directory     Existing output directory
+ * @param[in] worker_count  Encoding threads, 0 for one per CPU
+ * @returns                 Return status
+ */
+ReturnStatus ImageEncoder_init(
+    ImageEncoder* encoder,
+    ImageFormat format,
+    const char* directory,
+    u32 worker_count
+) {
+    memset(encoder, 0, sizeof(*encoder));
+    encoder->format = format;
+    snprintf(encoder->directory, sizeof(encoder->directory), "%s", directory);
+    if (format == IMAGE_FORMAT_Y4M) {
+        char path[4160];
+        snprintf(path, sizeof(path), "%s/frames.y4m", directory);
+        encoder->stream = fopen(path, "wb");
+        if (!encoder->stream) {
+            LOG_ERROR("Failed to open file: %s", path);
+            return RETURN_FAILURE;
+        }
+    }
+    pthread_mutex_init(&encoder->lock, NULL);
+    pthread_cond_init(&encoder->not_empty, NULL);
+    pthread_cond_init(&encoder->not_full, NULL);
+    pthread_cond_init(&encoder->sequence_written, NULL);
+
+    if (worker_count == 0) worker_count = cpu_count();
+    if (worker_count > MAX_WORKER_THREADS) worker_count = MAX_WORKER_THREADS;
+    for (u32 i = 0; i < worker_count; ++i) {
+        if (pthread_create(
+                &encoder->workers[encoder->worker_count],
+                NULL,
+                ImageEncoder_worker_main,
+                encoder
+            ) == 0) {
+            ++encoder->worker_count;
+        }
+    }
+    if (encoder->worker_count == 0) {
+        LOG_ERROR("Failed to start image encoder threads");
+        ImageEncoder_finish(encoder);
+        return RETURN_FAILURE;
+    }
+    return RETURN_SUCCESS;
+}
+
+/** Queue a frame for encoding
+ *
+ * Copies the pixels, so the caller may reuse them on return.  Blocks only
+ * while IMAGE_ENCODER_QUEUE_SIZE frames are already waiting.
+ *
+ * @param[in,out] encoder   Image encoder
+ * @param[in] pixels        RGBA8 pixels
+ * @param[in] width         Frame width
+ * @param[in] height        Frame height
+ * @param[in] bytes_per_row Row stride of `pixels`, padding is dropped
+ * @param[in] index         Frame number used in the file name
+ * @param[in] view          View of the frame these pixels show
+ * @param[in] view_count    Views of the frame, 1 for a single view
+ * @returns                 Return status
+ */
+ReturnStatus ImageEncoder_submit(
+    ImageEncoder* encoder,
+    const u8* pixels,
+    u32 width,
+    u32 height,
+    u32 bytes_per_row,
+    u64 index,
+    u32 view,
+    u32 view_count
+) {
+    usize row_size = (usize)width * 4;
+    u8* rgba = RAIJIN_REALLOC(NULL, row_size * height);
+    if (rgba == NULL) {
+        LOG_ERROR("Failed to allocate frame %llu", (unsigned long long)index);
+        return RETURN_FAILURE;
+    }
+    for (u32 y = 0; y < height; ++y) {
+        memcpy(
+            rgba + y * row_size, pixels + (usize)y * bytes_per_row, row_size
+        );
+    }
+
+    pthread_mutex_lock(&encoder->lock);
+    while (encoder->count == IMAGE_ENCODER_QUEUE_SIZE) {
+        pthread_cond_wait(&encoder->not_full, &encoder->lock);
+    }
+    u32 tail = (encoder->head + encoder->count) % IMAGE_ENCODER_QUEUE_SIZE;
+    encoder->queue[tail] = (EncodeJob){
+        .rgba = rgba,
+        .index = index,
+        .view = view,
+        .view_count = view_count,
+        .sequence = encoder->submitted++,
+        .width = width,
+        .height = height,
+    };
+    ++encoder->count;
+    pthread_cond_signal(&encoder->not_empty);
+    pthread_mutex_unlock(&encoder->lock);
+    return RETURN_SUCCESS;
+}
+
+/** `HeadlessFrameCallback` queueing every frame on the encoder in `userdata`
+ *
+ * Each layer of a multi-view frame is queued as its own image.
+ */
+void ImageEncoder_frame_callback(const HeadlessFrame* frame, void* userdata) {
+    if (frame->format != WGPUTextureFormat_RGBA8Unorm &&
+        frame->format != WGPUTextureFormat_RGBA8UnormSrgb) {
+        LOG_ERROR("Unsupported frame format: %d", frame->format);
+        return;
+    }
+    usize layer_size = (usize)frame->bytes_per_row * frame->height;
+    for (u32 layer = 0; layer < frame->layer_count; ++layer) {
+        ImageEncoder_submit(
+            (ImageEncoder*)userdata,
+            frame->pixels + layer * layer_size,
+            frame->width,
+            frame->height,
+            frame->bytes_per_row,
+            frame->index,
+            layer,
+            frame->layer_count
+        );
+    }
+}
+
+/** Encode every queued frame, then stop the workers
+ *
+ * @param[in,out] encoder   Image encoder
+ * @returns                 Return status, failure if any frame failed
+ */
+ReturnStatus ImageEncoder_finish(ImageEncoder* encoder) {
+    pthread_mutex_lock(&encoder->lock);
+    encoder->stopping = true;
+    pthread_cond_broadcast(&encoder->not_empty);
+    pthread_mutex_unlock(&encoder->lock);
+    for (u32 i = 0; i < encoder->worker_count; ++i) {
+        pthread_join(encoder->workers[i], NULL);
+    }
+    encoder->worker_count = 0;
+    if (encoder->stream != NULL && fclose(encoder->stream) != 0) {
+        ++encoder->failed;
+    }
+    encoder->stream = NULL;
+    pthread_cond_destroy(&encoder->sequence_written);
+    pthread_cond_destroy(&encoder->not_full);
+    pthread_cond_destroy(&encoder->not_empty);
+    pthread_mutex_destroy(&encoder->lock);
+    LOG_INFO(
+        "Encoded %llu frames, %llu failed",
+        (unsigned long long)encoder->encoded,
+        (unsigned long long)encoder->failed
+    );
+    return encoder->failed == 0 ? RETURN_SUCCESS : RETURN_FAILURE;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 4 pixels per shuffle.  Every store writes 16 bytes of which the next
+// store overwrites the last 4, so the loop stops 6 pixels short of the end
+__attribute__((target("ssse3"))) static usize rgba_to_rgb_ssse3(
+    const u8* src, u8* dst, usize pixel_count
+) {
+    const __m128i mask = _mm_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1
+    );
+    usize i = 0;
+    for (; i + 6 <= pixel_count; i += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        _mm_storeu_si128(
+            (__m128i*)(dst + i * 3), _mm_shuffle_epi8(pixels, mask)
+        );
+    }
+    return i;
+}
+#endif
+
+/** Drop the alpha channel of packed RGBA8 pixels
+ *
+ * @param[in] src           RGBA8 pixels
+ * @param[out] dst          RGB8 pixels, `pixel_count * 3` bytes
+ * @param[in] pixel_count   Number of pixels
+ */
+void rgba_to_rgb(const u8* src, u8* dst, usize pixel_count) {
+    usize i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("ssse3")) {
+        i = rgba_to_rgb_ssse3(src, dst, pixel_count);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= pixel_count; i += 16) {
+        uint8x16x4_t pixels = vld4q_u8(src + i * 4);
+        uint8x16x3_t rgb = {{pixels.val[0], pixels.val[1], pixels.val[2]}};
+        vst3q_u8(dst + i * 3, rgb);
+    }
+#endif
+    for (; i < pixel_count; ++i) {
+        dst[i * 3 + 0] = src[i * 4 + 0];
+        dst[i * 3 + 1] = src[i * 4 + 1];
+        dst[i * 3 + 2] = src[i * 4 + 2];
+    }
+}
+
+static void U8Array_push_u32_be(U8Array* out, u32 value) {
+    u8 bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+    U8Array_push_many(out, bytes, 4);
+}
+
+/** Encode RGB8 pixels as QOI
+ *
+ * @param[in] rgb       Packed RGB8 pixels
+ * @param[in] width     Image width
+ * @param[in] height    Image height
+ * @param[out] out      Appended with the file contents
+ */
+void encode_qoi(const u8* rgb, u32 width, u32 height, U8Array* out) {
+    U8Array_reserve(out, out->count + 14 + (usize)width * height * 4 + 8);
+    U8Array_push_many(out, (const u8*)"qoif", 4);
+    U8Array_push_u32_be(out, width);
+    U8Array_push_u32_be(out, height);
+    U8Array_push(out, 3);  // channels
+    U8Array_push(out, 0);  // sRGB with linear alpha
+
+    u8 index[64][3] = {{0}};
+    u8 prev[3] = {0, 0, 0};
+    u32 run = 0;
+    usize pixel_count = (usize)width * height;
+    for (usize i = 0; i < pixel_count; ++i) {
+        const u8* px = rgb + i * 3;
+        if (px[0] == prev[0] && px[1] == prev[1] && px[2] == prev[2]) {
+            if (++run == 62 || i + 1 == pixel_count) {
+                U8Array_push(out, 0xC0 | (run - 1));  // QOI_OP_RUN
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            U8Array_push(out, 0xC0 | (run - 1));
+            run = 0;
+        }
+        // Alpha is always 255
+        u32 slot = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+        if (index[slot][0] == px[0] && index[slot][1] == px[1] &&
+            index[slot][2] == px[2]) {
+            U8Array_push(out, slot);  // QOI_OP_INDEX
+        } else {
+            memcpy(index[slot], px, 3);
+            i8 dr = (i8)(px[0] - prev[0]);
+            i8 dg = (i8)(px[1] - prev[1]);
+            i8 db = (i8)(px[2] - prev[2]);
+            i8 dr_dg = (i8)(dr - dg);
+            i8 db_dg = (i8)(db - dg);
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 &&
+                db <= 1) {
+                // QOI_OP_DIFF
+                U8Array_push(
+                    out, 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)
+                );
+            } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+                       db_dg >= -8 && db_dg <= 7) {
+                // QOI_OP_LUMA
+                U8Array_push(out, 0x80 | (dg + 32));
+                U8Array_push(out, (dr_dg + 8) << 4 | (db_dg + 8));
+            } else {
+                U8Array_push(out, 0xFE);  // QOI_OP_RGB
+                U8Array_push_many(out, px, 3);
+            }
+        }
+        memcpy(prev, px, 3);
+    }
+    static const u8 end_marker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    U8Array_push_many(out, end_marker, 8);
+}
+
+static void png_chunk(
+    U8Array* out, const char type[4], const u8* data, u32 size
+) {
+    U8Array_push_u32_be(out, size);
+    usize start = out->count;
+    U8Array_push_many(out, (const u8*)type, 4);
+    if (size > 0) U8Array_push_many(out, data, size);
+    U8Array_push_u32_be(
+        out, (u32)crc32(0, out->items + start, (uInt)(size + 4))
+    );
+}
+
+/** Encode RGB8 pixels as PNG, favouring speed over size
+ *
+ * Every row uses the Up filter, then zlib's fastest level.
+ *
+ * @param[in] rgb       Packed RGB8 pixels
+ * @param[in] width     Image width
+ * @param[in] height    Image height
+ * @param[out] out      Appended with the file contents
+ * @returns             Return status
+ */
+ReturnStatus encode_png(const u8* rgb, u32 width, u32 height, U8Array* out) {
+    usize row_size = (usize)width * 3;
+    usize filtered_size = (row_size + 1) * height;
+    u8* filtered = RAIJIN_REALLOC(NULL, filtered_size);
+    uLongf compressed_size = compressBound(filtered_size);
+    u8* compressed = RAIJIN_REALLOC(NULL, compressed_size);
+    if (filtered == NULL || compressed == NULL) {
+        RAIJIN_FREE(filtered);
+        RAIJIN_FREE(compressed);
+        return RETURN_FAILURE;
+    }
+    for (u32 y = 0; y < height; ++y) {
+        const u8* row = rgb + y * row_size;
+        u8* dst = filtered + y * (row_size + 1);
+        if (y == 0) {
+            dst[0] = 0;  // None
+            memcpy(dst + 1, row, row_size);
+            continue;
+        }
+        dst[0] = 2;  // Up
+        const u8* above = row - row_size;
+        for (usize x = 0; x < row_size; ++x) dst[1 + x] = row[x] - above[x];
+    }
+    int status = compress2(
+        compressed, &compressed_size, filtered, filtered_size, Z_BEST_SPEED
+    );
+    RAIJIN_FREE(filtered);
+    if (status != Z_OK) {
+        RAIJIN_FREE(compressed);
+        return RETURN_FAILURE;
+    }
+
+    static const u8 signature[8] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+    };
+    U8Array_push_many(out, signature, 8);
+    u8 header[13] = {
+        width >> 24, width >> 16, width >> 8, width,
+        height >> 24, height >> 16, height >> 8, height,
+        8,  // bit depth
+        2,  // truecolor
+        0, 0, 0,
+    };
+    png_chunk(out, "IHDR", header, sizeof(header));
+    png_chunk(out, "IDAT", compressed, (u32)compressed_size);
+    png_chunk(out, "IEND", NULL, 0);
+    RAIJIN_FREE(compressed);
+    return RETURN_SUCCESS;
+}
+
+static inline u8 clamp_u8(i32 value) {
+    return value < 0 ? 0 : value > 255 ? 255 : (u8)value;
+}
+
+/** Encode RGB8 pixels as one Y4M frame, 4:2:0 BT.601 studio range
+ *
+ * @param[in] rgb       Packed RGB8 pixels
+ * @param[in] width     Image width
+ * @param[in] height    Image height
+ * @param[out] out      Appended with the FRAME header and the planes
+ */
+void encode_y4m_frame(const u8* rgb, u32 width, u32 height, U8Array* out) {
+    u32 chroma_width = (width + 1) / 2;
+    u32 chroma_height = (height + 1) / 2;
+    usize luma_size = (usize)width * height;
+    usize chroma_size = (usize)chroma_width * chroma_height;
+    U8Array_push_many(out, (const u8*)"FRAME\n", 6);
+    U8Array_reserve(out, out->count + luma_size + 2 * chroma_size);
+    u8* y_plane = out->items + out->count;
+    u8* u_plane = y_plane + luma_size;
+    u8* v_plane = u_plane + chroma_size;
+    out->count += luma_size + 2 * chroma_size;
+
+    // Fixed point, 8 fractional bits
+    for (usize i = 0; i < luma_size; ++i) {
+        const u8* px = rgb + i * 3;
+        y_plane[i] = clamp_u8(
+            ((66 * px[0] + 129 * px[1] + 25 * px[2] + 128) >> 8) + 16
+        );
+    }
+    // Chroma of the average of each 2x2 block
+    for (u32 cy = 0; cy < chroma_height; ++cy) {
+        for (u32 cx = 0; cx < chroma_width; ++cx) {
+            i32 sum[3] = {0, 0, 0};
+            u32 samples = 0;
+            for (u32 dy = 0; dy < 2; ++dy) {
+                for (u32 dx = 0; dx < 2; ++dx) {
+                    u32 x = cx * 2 + dx;
+                    u32 y = cy * 2 + dy;
+                    if (x >= width || y >= height) continue;
+                    const u8* px = rgb + ((usize)y * width + x) * 3;
+                    sum[0] += px[0];
+                    sum[1] += px[1];
+                    sum[2] += px[2];
+                    ++samples;
+                }
+            }
+            i32 r = sum[0] / (i32)samples;
+            i32 g = sum[1] / (i32)samples;
+            i32 b = sum[2] / (i32)samples;
+            usize i = (usize)cy * chroma_width + cx;
+            u_plane[i] =
+                clamp_u8(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v_plane[i] =
+                clamp_u8(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+// Encodes one job into `out`, the output file contents or stream bytes
+static ReturnStatus ImageEncoder_encode(
+    const ImageEncoder* encoder, const EncodeJob* job, u8* rgb, U8Array* out
+) {
+    rgba_to_rgb(job->rgba, rgb, (usize)job->width * job->height);
+    switch (encoder->format) {
+        case IMAGE_FORMAT_RAW: {
+            U8Array_push_many(out, rgb, job->width * job->height * 3);
+        } break;
+        case IMAGE_FORMAT_QOI: {
+            encode_qoi(rgb, job->width, job->height, out);
+        } break;
+        case IMAGE_FORMAT_PNG: {
+            return encode_png(rgb, job->width, job->height, out);
+        }
+        case IMAGE_FORMAT_Y4M: {
+            if (job->sequence == 0) {
+                char header[128];
+                int length = snprintf(
+                    header,
+                    sizeof(header),
+                    "YUV4MPEG2 W%u H%u F%d:1 Ip A1:1 C420jpeg "
+                    "XCOLORRANGE=LIMITED\n",
+                    job->width,
+                    job->height,
+                    IMAGE_ENCODER_Y4M_FPS
+                );
+                U8Array_push_many(out, (const u8*)header, length);
+            }
+            encode_y4m_frame(rgb, job->width, job->height, out);
+        } break;
+    }
+    return RETURN_SUCCESS;
+}
+
+// Writes a per frame file, or appends to the stream in submission order
+static ReturnStatus ImageEncoder_write(
+    ImageEncoder* encoder, const EncodeJob* job, const U8Array* data
+) {
+    if (encoder->format != IMAGE_FORMAT_Y4M) {
+        char view[32] = "";
+        if (job->view_count > 1) {
+            snprintf(view, sizeof(view), "_view%02u", job->view);
+        }
+        char path[4160];
+        snprintf(
+            path,
+            sizeof(path),
+            "%s/frame_%06llu%s.%s",
+            encoder->directory,
+            (unsigned long long)job->index,
+            view,
+            image_format_extension(encoder->format)
+        );
+        FILE* f = fopen(path, "wb");
+        if (!f) {
+            LOG_ERROR("Failed to open file: %s", path);
+            return RETURN_FAILURE;
+        }
+        bool ok = fwrite(data->items, 1, data->count, f) == data->count;
+        ok = fclose(f) == 0 && ok;
+        if (!ok) LOG_ERROR("Failed to write file: %s", path);
+        return ok ? RETURN_SUCCESS : RETURN_FAILURE;
+    }
+
+    pthread_mutex_lock(&encoder->lock);
+    while (encoder->next_sequence != job->sequence) {
+        pthread_cond_wait(&encoder->sequence_written, &encoder->lock);
+    }
+    // A failed frame still advances the sequence so later ones get written
+    bool ok = data->count > 0 &&
+              fwrite(data->items, 1, data->count, encoder->stream) ==
+                  data->count;
+    ++encoder->next_sequence;
+    pthread_cond_broadcast(&encoder->sequence_written);
+    pthread_mutex_unlock(&encoder->lock);
+    return ok ? RETURN_SUCCESS : RETURN_FAILURE;
+}
+
+static void* ImageEncoder_worker_main(void* arg) {
+    ImageEncoder* encoder = (ImageEncoder*)arg;
+    U8Array rgb = {0};
+    U8Array out = {0};
+    for (;;) {
+        pthread_mutex_lock(&encoder->lock);
+        while (encoder->count == 0 && !encoder->stopping) {
+            pthread_cond_wait(&encoder->not_empty, &encoder->lock);
+        }
+        if (encoder->count == 0) {
+            pthread_mutex_unlock(&encoder->lock);
+            break;
+        }
+        EncodeJob job = encoder->queue[encoder->head];
+        encoder->head = (encoder->head + 1) % IMAGE_ENCODER_QUEUE_SIZE;
+        --encoder->count;
+        pthread_cond_signal(&encoder->not_full);
+        pthread_mutex_unlock(&encoder->lock);
+
+        U8Array_reserve(&rgb, (usize)job.width * job.height * 3);
+        out.count = 0;
+        ReturnStatus status =
+            ImageEncoder_encode(encoder, &job, rgb.items, &out);
+        if (status != RETURN_SUCCESS) out.count = 0;
+        if (ImageEncoder_write(encoder, &job, &out) != RETURN_SUCCESS) {
+            status = RETURN_FAILURE;
+        }
+        RAIJIN_FREE(job.rgba);
+
+        pthread_mutex_lock(&encoder->lock);
+        if (status == RETURN_SUCCESS) {
+            ++encoder->encoded;
+        } else {
+            ++encoder->failed;
+        }
+        pthread_mutex_unlock(&encoder->lock);
+    }
+    U8Array_free(&rgb);
+    U8Array_free(&out);
+    return NULL;
+}
+
+#endif /* IMAGE_ENCODE_H */
@@ -1,6 +1,8 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <stddef.h>
+
 #include "cglm/cglm.h"
 #include "cglm/mat4.h"
 #include "cglm/vec3.h"
@@ -11,7 +13,7 @@
 
 /* Types */
 
-DEFINE_DYNAMIC_ARRAY(u16, IndexArray)
+DEFINE_DYNAMIC_ARRAY(u32, IndexArray)
 
 typedef struct Vertex {
     vec3 position;
@@ -20,6 +22,25 @@ typedef struct Vertex {
 } Vertex;
 DEFINE_DYNAMIC_ARRAY(Vertex, VertexArray)
 
+typedef enum {
+    // `Vertex` as is, 36 bytes
+    VERTEX_FORMAT_FLOAT32,
+    // `QuantizedVertex`, 16 bytes
+    VERTEX_FORMAT_QUANTIZED,
+    VERTEX_FORMAT_COUNT,
+} VertexFormat;
+
+// GPU-side vertex of VERTEX_FORMAT_QUANTIZED meshes, decoded in `vs_main`
+typedef struct QuantizedVertex {
+    // unorm16 position within the mesh bounds, the fourth value is padding
+    u16 position[4];
+    // snorm16 octahedral encoded normal
+    i16 normal[2];
+    // unorm8 RGBA color
+    u8 color[4];
+} QuantizedVertex;
+DEFINE_DYNAMIC_ARRAY(QuantizedVertex, QuantizedVertexArray)
+
 typedef struct Instance {
     mat4 model_matrix;
     vec4 color;
@@ -38,13 +59,32 @@ typedef struct Mesh {
     VertexArray vertices;
     IndexArray indices;
     IndexArray edge_indices;
+    // Outline sides of each triangle, one byte per triangle, see
+    // `Mesh_compute_edge_flags`
+    U32Array edge_flags;
+    // Element counts of the GPU buffers.  Meshes uploaded straight from a
+    // mesh cache file have no CPU-side arrays.
+    u32 vertex_count;
+    u32 index_count;
+    u32 edge_index_count;
+    // Layout of the vertex buffer, chosen before the buffers are created
+    VertexFormat vertex_format;
+    // Maps quantized positions back to mesh space, set on upload
+    mat4 dequantize;
+    // Mesh space bounds of the uploaded vertices, for culling
+    vec3 bounds[2];
     WGPUBuffer vertex_buffer;
     WGPUBuffer index_buffer;
     WGPUBuffer instance_buffer;
     u32 instance_capacity;
+    // Drawn with the instances of `instance_buffer`
     WGPUBuffer edge_index_buffer;
-    WGPUBuffer edge_instance_buffer;
-    u32 edge_instance_capacity;
+    WGPUBuffer edge_flag_buffer;
+    // Storage view of the vertex, index and edge flag buffers for
+    // EDGE_MODE_BARYCENTRIC, created on first use
+    WGPUBindGroup wireframe_bind_group;
+    // Bumped whenever a buffer is replaced, invalidating recorded draws
+    u32 buffer_generation;
 } Mesh;
 DEFINE_DYNAMIC_ARRAY(Mesh, MeshArray)
 
@@ -54,17 +94,31 @@ void Instance_set_position(Instance* instance, vec3 position);
 void Instance_from_position_rotation(
     Instance* instance, vec3 position, mat3 rotation, f32 scale, vec4 color
 );
-void Mesh_realloc_instance_buffer(
-    Mesh* mesh, const WGPUDevice device, u32 new_capacity
+void Instance_build_model_matrices(
+    Instance* instances,
+    vec3* positions,
+    mat3* rotations,
+    const f32* scales,
+    u32 count
 );
-void Mesh_realloc_edge_instance_buffer(
+void Mesh_realloc_instance_buffer(
     Mesh* mesh, const WGPUDevice device, u32 new_capacity
 );
 void Mesh_create_cube(Mesh* mesh);
+void Mesh_compute_bounds(const Mesh* mesh, vec3 min, vec3 max);
+void compute_vertex_bounds(
+    const Vertex* vertices, usize count, vec3 min, vec3 max
+);
+void quantize_vertices(
+    const Vertex* vertices,
+    usize count,
+    QuantizedVertexArray* out,
+    mat4 dequantize
+);
 
 /* Static Definitions */
 
-static const u16 CUBE_INDICES[36] = {
+static const u32 CUBE_INDICES[36] = {
     // clang-format off
         // Front
         0, 1, 3,
@@ -87,7 +141,7 @@ static const u16 CUBE_INDICES[36] = {
     // clang-format on
 };
 
-static const u16 CUBE_EDGE_INDICES[24] = {
+static const u32 CUBE_EDGE_INDICES[24] = {
     // clang-format off
         0, 1,
         1, 3,
@@ -149,7 +203,38 @@ static const Vertex CUBE_VERTICES[8] = {
     },
 };
 
-static WGPUVertexBufferLayout Vertex_desc(void) {
+static inline u32 VertexFormat_stride(VertexFormat format) {
+    return format == VERTEX_FORMAT_QUANTIZED ? sizeof(QuantizedVertex)
+                                             : sizeof(Vertex);
+}
+
+static WGPUVertexBufferLayout Vertex_desc(VertexFormat format) {
+    static WGPUVertexAttribute quantized_attribs[3] = {
+        {
+            .format = WGPUVertexFormat_Unorm16x4,
+            .offset = offsetof(QuantizedVertex, position),
+            .shaderLocation = 0,
+        },
+        {
+            .format = WGPUVertexFormat_Unorm8x4,
+            .offset = offsetof(QuantizedVertex, color),
+            .shaderLocation = 1,
+        },
+        {
+            .format = WGPUVertexFormat_Snorm16x2,
+            .offset = offsetof(QuantizedVertex, normal),
+            .shaderLocation = 2,
+        },
+    };
+    if (format == VERTEX_FORMAT_QUANTIZED) {
+        return (WGPUVertexBufferLayout){
+            .arrayStride = sizeof(QuantizedVertex),
+            .stepMode = WGPUVertexStepMode_Vertex,
+            .attributeCount = 3,
+            .attributes = quantized_attribs,
+        };
+    }
+
     static WGPUVertexAttribute attribs[3] = {
         {
             .format = WGPUVertexFormat_Float32x3,
@@ -229,6 +314,39 @@ void Instance_from_position_rotation(
     glm_vec4_copy(color, instance->color);
 }
 
+/** Model matrices translate * rotate * scale of many instances at once
+ *
+ * Writes the columns directly instead of composing full 4x4 products, the
+ * instance colors are left untouched.
+ *
+ * @param[out] instances  Instances whose model matrices are written
+ * @param[in] positions   Translation of each instance
+ * @param[in] rotations   Rotation of each instance
+ * @param[in] scales      Uniform scale of each instance
+ * @param[in] count       Number of instances
+ */
+void Instance_build_model_matrices(
+    Instance* instances,
+    vec3* positions,
+    mat3* rotations,
+    const f32* scales,
+    u32 count
+) {
+    for (u32 i = 0; i < count; ++i) {
+        mat4* model = &instances[i].model_matrix;
+        for (u32 c = 0; c < 3; ++c) {
+            (*model)[c][0] = rotations[i][c][0] * scales[i];
+            (*model)[c][1] = rotations[i][c][1] * scales[i];
+            (*model)[c][2] = rotations[i][c][2] * scales[i];
+            (*model)[c][3] = 0.0f;
+        }
+        (*model)[3][0] = positions[i][0];
+        (*model)[3][1] = positions[i][1];
+        (*model)[3][2] = positions[i][2];
+        (*model)[3][3] = 1.0f;
+    }
+}
+
 void Mesh_realloc_instance_buffer(
     Mesh* mesh, const WGPUDevice device, u32 new_capacity
 ) {
@@ -240,6 +358,8 @@ void Mesh_realloc_instance_buffer(
         }
         LOG_DEBUG("New instance capacity: %d", mesh->instance_capacity);
     }
+    if (mesh->instance_buffer != NULL) wgpuBufferRelease(mesh->instance_buffer);
+    ++mesh->buffer_generation;
     mesh->instance_buffer = create_buffer(
         device,
         mesh->instance_capacity * sizeof(Instance),
@@ -248,20 +368,6 @@ void Mesh_realloc_instance_buffer(
     );
 }
 
-void Mesh_realloc_edge_instance_buffer(
-    Mesh* mesh, const WGPUDevice device, u32 new_capacity
-) {
-    while (mesh->instance_capacity < new_capacity) {
-        mesh->instance_capacity *= 2;
-    }
-    mesh->instance_buffer = create_buffer(
-        device,
-        mesh->instance_capacity * sizeof(Instance),
-        WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst,
-        "Mesh Edge Instance Buffer"
-    );
-}
-
 void Mesh_create_cube(Mesh* mesh) {
     static const u32 n_vertices = ARRAY_COUNT(CUBE_VERTICES);
     static const u32 n_indices = ARRAY_COUNT(CUBE_INDICES);
@@ -274,4 +380,90 @@ void Mesh_create_cube(Mesh* mesh) {
     );
 }
 
+/** Axis aligned bounds of the mesh vertices, zero for an empty mesh */
+void Mesh_compute_bounds(const Mesh* mesh, vec3 min, vec3 max) {
+    compute_vertex_bounds(
+        mesh->vertices.items, mesh->vertices.count, min, max
+    );
+}
+
+/** Axis aligned bounds of vertex positions, zero for no vertices */
+void compute_vertex_bounds(
+    const Vertex* vertices, usize count, vec3 min, vec3 max
+) {
+    if (count == 0) {
+        glm_vec3_zero(min);
+        glm_vec3_zero(max);
+        return;
+    }
+    glm_vec3_copy((f32*)vertices[0].position, min);
+    glm_vec3_copy((f32*)vertices[0].position, max);
+    for (usize i = 1; i < count; ++i) {
+        glm_vec3_minv(min, (f32*)vertices[i].position, min);
+        glm_vec3_maxv(max, (f32*)vertices[i].position, max);
+    }
+}
+
+static inline i16 snorm16(f32 v) {
+    return (i16)roundf(glm_clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+static inline u8 unorm8(f32 v) {
+    return (u8)roundf(glm_clamp(v, 0.0f, 1.0f) * 255.0f);
+}
+
+/** Convert vertices to VERTEX_FORMAT_QUANTIZED
+ *
+ * Positions are stored relative to the bounds with a single scale on all
+ * axes so `dequantize` stays a uniform scale and normals transformed by the
+ * model matrix keep their direction.  Normals use the octahedral mapping.
+ *
+ * @param[in] vertices      Full precision vertices
+ * @param[in] count         Number of vertices
+ * @param[out] out          Receives the quantized vertices
+ * @param[out] dequantize   Maps decoded [0, 1] positions to mesh space
+ */
+void quantize_vertices(
+    const Vertex* vertices,
+    usize count,
+    QuantizedVertexArray* out,
+    mat4 dequantize
+) {
+    vec3 min, max;
+    compute_vertex_bounds(vertices, count, min, max);
+    vec3 size;
+    glm_vec3_sub(max, min, size);
+    f32 scale = glm_vec3_max(size);
+    if (scale <= 0.0f) scale = 1.0f;
+    glm_translate_make(dequantize, min);
+    glm_scale_uni(dequantize, scale);
+
+    QuantizedVertexArray_reserve(out, out->count + count);
+    for (usize i = 0; i < count; ++i) {
+        const Vertex* v = &vertices[i];
+        QuantizedVertex q = {0};
+        for (u32 k = 0; k < 3; ++k) {
+            f32 t = (v->position[k] - min[k]) / scale;
+            q.position[k] = (u16)roundf(glm_clamp(t, 0.0f, 1.0f) * 65535.0f);
+            q.color[k] = unorm8(v->color[k]);
+        }
+        q.color[3] = 255;
+
+        // Project onto the octahedron and fold the lower half over the upper
+        f32 l1 = fabsf(v->normal[0]) + fabsf(v->normal[1]) +
+                 fabsf(v->normal[2]);
+        f32 x = l1 > 0.0f ? v->normal[0] / l1 : 0.0f;
+        f32 y = l1 > 0.0f ? v->normal[1] / l1 : 0.0f;
+        if (l1 > 0.0f && v->normal[2] < 0.0f) {
+            f32 folded_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            f32 folded_y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = folded_x;
+            y = folded_y;
+        }
+        q.normal[0] = snorm16(x);
+        q.normal[1] = snorm16(y);
+        QuantizedVertexArray_push(out, q);
+    }
+}
+
 #endif /* MESH_H */
@@ -0,0 +1,632 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "cglm/vec3.h"
+#include "core.h"
+#include "mesh.h"
+#include "mesh_import.h"
+#include "renderer.h"
+
+// Precompiled mesh cache (.rjm).  A fixed header followed by sections that
+// can be handed to the GPU as they are:
+//
+//   RjmHeader | vertices | indices (all LODs) | edge indices | edge flags |
+//   LODs | meshlets
+//
+// Every section starts on an RJM_SECTION_ALIGNMENT boundary.  All values are
+// little endian.
+
+#define RJM_MAGIC 0x4D4A5252u /* "RRJM" */
+#define RJM_VERSION 2
+#define RJM_SECTION_ALIGNMENT 256
+#define RJM_MAX_LODS 8
+#define RJM_MIN_LOD_TRIANGLES 64
+// LOD levels tried, rejected ones included
+#define RJM_MAX_LOD_ATTEMPTS 16
+#define RJM_MESHLET_MAX_VERTICES 64
+#define RJM_MESHLET_MAX_TRIANGLES 124
+
+/* Types */
+
+typedef enum {
+    RJM_SECTION_VERTICES,
+    RJM_SECTION_INDICES,
+    RJM_SECTION_EDGE_INDICES,
+    RJM_SECTION_EDGE_FLAGS,
+    RJM_SECTION_LODS,
+    RJM_SECTION_MESHLETS,
+    RJM_SECTION_COUNT,
+} RjmSectionType;
+
+typedef struct RjmSection {
+    u64 offset;
+    u64 size;
+} RjmSection;
+
+typedef struct RjmHeader {
+    u32 magic;
+    u32 version;
+    // Layout checks, a cache written by a build with a different Vertex is
+    // rejected rather than misread
+    u32 vertex_stride;
+    u32 index_size;
+    u32 vertex_count;
+    // Index count of the full detail level, the first LOD
+    u32 index_count;
+    u32 edge_index_count;
+    u32 lod_count;
+    u32 meshlet_count;
+    u32 reserved;
+    f32 bounds_min[3];
+    f32 bounds_max[3];
+    // hash_bytes chained over the sections in order, padding excluded
+    u64 content_hash;
+    RjmSection sections[RJM_SECTION_COUNT];
+} RjmHeader;
+
+// Range of the index section holding one level of detail.  Every level
+// indexes the same vertex buffer.
+typedef struct RjmLod {
+    u32 first_index;
+    u32 index_count;
+    // Size of the clustering cell in mesh units, 0 for full detail
+    f32 error;
+    u32 reserved;
+} RjmLod;
+
+// Cluster of consecutive full detail triangles with a bounding sphere, for
+// per-cluster culling with indexed draws
+typedef struct RjmMeshlet {
+    u32 first_index;
+    u32 index_count;
+    f32 center[3];
+    f32 radius;
+} RjmMeshlet;
+DEFINE_DYNAMIC_ARRAY(RjmMeshlet, RjmMeshletArray)
+
+typedef struct RjmFile {
+    MappedFile file;
+    const RjmHeader* header;
+} RjmFile;
+
+/* Function Prototypes */
+
+u32 Mesh_build_lod(
+    const Mesh* mesh, u32 grid, const vec3 min, const vec3 max, IndexArray* out
+);
+void Mesh_build_meshlets(const Mesh* mesh, RjmMeshletArray* meshlets);
+ReturnStatus Mesh_write_rjm(const Mesh* mesh, const char* path);
+ReturnStatus RjmFile_open(RjmFile* rjm, const char* path, bool verify_hash);
+void RjmFile_close(RjmFile* rjm);
+const void* RjmFile_section(
+    const RjmFile* rjm, RjmSectionType section, u64* size
+);
+void Renderer_create_mesh_buffers_rjm(
+    Mesh* mesh, Renderer* renderer, const RjmFile* rjm
+);
+
+/* Functions */
+
+typedef struct LodCluster {
+    const Mesh* mesh;
+    vec3 min;
+    f32 inverse_cell;
+    u32 grid;
+} LodCluster;
+
+static inline u64 lod_cell(const LodCluster* lod, usize i) {
+    const f32* position = lod->mesh->vertices.items[i].position;
+    u64 cell = 0;
+    for (u32 k = 0; k < 3; ++k) {
+        f32 c = (position[k] - lod->min[k]) * lod->inverse_cell;
+        u64 q = c <= 0.0f ? 0 : (u64)c;
+        cell = cell * (lod->grid + 1) + (q < lod->grid ? q : lod->grid);
+    }
+    return cell;
+}
+
+static u32 lod_cell_hash(const void* user, usize i) {
+    return (u32)mix_u64(lod_cell((const LodCluster*)user, i));
+}
+
+static bool lod_cell_equal(const void* user, usize a, usize b) {
+    const LodCluster* lod = (const LodCluster*)user;
+    return lod_cell(lod, a) == lod_cell(lod, b);
+}
+
+/** Simplify a mesh by vertex clustering
+ *
+ * Vertices falling into the same cell of a `grid`^3 lattice over the bounds
+ * collapse onto the first of them; triangles that become degenerate are
+ * dropped.  The result indexes the original vertex buffer.
+ *
+ * @param[in] mesh      Full detail mesh
+ * @param[in] grid      Cells along each axis
+ * @param[in] min       Lower mesh bound
+ * @param[in] max       Upper mesh bound
+ * @param[out] out      Receives the simplified triangle indices
+ * @returns             Number of triangles written
+ */
+u32 Mesh_build_lod(
+    const Mesh* mesh, u32 grid, const vec3 min, const vec3 max, IndexArray* out
+) {
+    f32 extent = 0.0f;
+    for (u32 k = 0; k < 3; ++k) {
+        if (max[k] - min[k] > extent) extent = max[k] - min[k];
+    }
+    LodCluster lod = {
+        .mesh = mesh,
+        .min = {min[0], min[1], min[2]},
+        .inverse_cell = extent > 0.0f ? (f32)grid / extent : 0.0f,
+        .grid = grid,
+    };
+    WeldSource source = {
+        .count = mesh->vertices.count,
+        .user = &lod,
+        .hash = lod_cell_hash,
+        .equal = lod_cell_equal,
+    };
+    IndexArray cluster = {0};
+    U32Array first = {0};
+    weld(&source, cpu_count(), &cluster, &first);
+
+    u32 triangle_count = 0;
+    for (usize i = 0; i + 2 < mesh->indices.count; i += 3) {
+        u32 a = cluster.items[mesh->indices.items[i]];
+        u32 b = cluster.items[mesh->indices.items[i + 1]];
+        u32 c = cluster.items[mesh->indices.items[i + 2]];
+        if (a == b || b == c || a == c) continue;
+        u32 triangle[3] = {first.items[a], first.items[b], first.items[c]};
+        IndexArray_push_many(out, triangle, 3);
+        ++triangle_count;
+    }
+    IndexArray_free(&cluster);
+    U32Array_free(&first);
+    return triangle_count;
+}
+
+static void meshlet_finish(const Mesh* mesh, RjmMeshlet* meshlet) {
+    const u32* indices = mesh->indices.items + meshlet->first_index;
+    vec3 min, max;
+    glm_vec3_copy(mesh->vertices.items[indices[0]].position, min);
+    glm_vec3_copy(mesh->vertices.items[indices[0]].position, max);
+    for (u32 i = 1; i < meshlet->index_count; ++i) {
+        glm_vec3_minv(min, mesh->vertices.items[indices[i]].position, min);
+        glm_vec3_maxv(max, mesh->vertices.items[indices[i]].position, max);
+    }
+    vec3 center;
+    glm_vec3_center(min, max, center);
+    f32 radius2 = 0.0f;
+    for (u32 i = 0; i < meshlet->index_count; ++i) {
+        f32 d = glm_vec3_distance2(
+            center, mesh->vertices.items[indices[i]].position
+        );
+        if (d > radius2) radius2 = d;
+    }
+    glm_vec3_copy(center, meshlet->center);
+    meshlet->radius = sqrtf(radius2);
+}
+
+/** Split the full detail triangles into meshlets
+ *
+ * Triangles are taken in index order and a meshlet is closed once it would
+ * exceed RJM_MESHLET_MAX_VERTICES unique vertices or
+ * RJM_MESHLET_MAX_TRIANGLES triangles.
+ */
+void Mesh_build_meshlets(const Mesh* mesh, RjmMeshletArray* meshlets) {
+    u32 vertices[RJM_MESHLET_MAX_VERTICES];
+    u32 vertex_count = 0;
+    RjmMeshlet meshlet = {0};
+    for (usize i = 0; i + 2 < mesh->indices.count; i += 3) {
+        u32 added[3];
+        u32 added_count = 0;
+        for (u32 k = 0; k < 3; ++k) {
+            u32 v = mesh->indices.items[i + k];
+            bool found = false;
+            for (u32 j = 0; j < vertex_count && !found; ++j) {
+                found = vertices[j] == v;
+            }
+            for (u32 j = 0; j < added_count && !found; ++j) {
+                found = added[j] == v;
+            }
+            if (!found) added[added_count++] = v;
+        }
+        if (vertex_count + added_count > RJM_MESHLET_MAX_VERTICES ||
+            meshlet.index_count / 3 == RJM_MESHLET_MAX_TRIANGLES) {
+            meshlet_finish(mesh, &meshlet);
+            RjmMeshletArray_push(meshlets, meshlet);
+            meshlet = (RjmMeshlet){.first_index = (u32)i};
+            vertex_count = 0;
+            // Every vertex of the triangle is new to the next meshlet
+            added_count = 0;
+            for (u32 k = 0; k < 3; ++k) {
+                u32 v = mesh->indices.items[i + k];
+                bool found = false;
+                for (u32 j = 0; j < added_count && !found; ++j) {
+                    found = added[j] == v;
+                }
+                if (!found) added[added_count++] = v;
+            }
+        }
+        for (u32 j = 0; j < added_count; ++j) {
+            vertices[vertex_count++] = added[j];
+        }
+        meshlet.index_count += 3;
+    }
+    if (meshlet.index_count > 0) {
+        meshlet_finish(mesh, &meshlet);
+        RjmMeshletArray_push(meshlets, meshlet);
+    }
+}
+
+static inline u64 rjm_align(u64 offset) {
+    return (offset + RJM_SECTION_ALIGNMENT - 1) &
+           ~(u64)(RJM_SECTION_ALIGNMENT - 1);
+}
+
+/** Write a mesh to a .rjm cache file
+ *
+ * Builds the levels of detail and meshlets, then writes every section at its
+ * aligned offset.
+ *
+ * @param[in] mesh      Mesh with CPU-side vertex, index, edge and edge flag
+ *                      arrays
+ * @param[in] path      Output file path
+ * @returns             Return status
+ */
+ReturnStatus Mesh_write_rjm(const Mesh* mesh, const char* path) {
+    if (mesh->edge_flags.count != (mesh->indices.count / 3 + 3) / 4) {
+        LOG_ERROR("Mesh for %s has no edge flags", path);
+        return RETURN_FAILURE;
+    }
+    RjmHeader header = {
+        .magic = RJM_MAGIC,
+        .version = RJM_VERSION,
+        .vertex_stride = sizeof(Vertex),
+        .index_size = sizeof(u32),
+        .vertex_count = (u32)mesh->vertices.count,
+        .index_count = (u32)mesh->indices.count,
+        .edge_index_count = (u32)mesh->edge_indices.count,
+    };
+    vec3 min, max;
+    Mesh_compute_bounds(mesh, min, max);
+    glm_vec3_copy(min, header.bounds_min);
+    glm_vec3_copy(max, header.bounds_max);
+
+    // LOD 0 is the mesh itself, coarser levels are appended to the index
+    // section while they keep removing a meaningful share of triangles
+    IndexArray indices = {0};
+    RjmLod lods[RJM_MAX_LODS] = {{0, (u32)mesh->indices.count, 0.0f, 0}};
+    u32 lod_count = 1;
+    if (mesh->indices.count > 0) {
+        IndexArray_push_many(
+            &indices, mesh->indices.items, mesh->indices.count
+        );
+    }
+    vec3 size;
+    glm_vec3_sub(max, min, size);
+    f32 extent = glm_vec3_max(size);
+    u32 previous_triangles = (u32)mesh->indices.count / 3;
+    u32 grid = UINT32_MAX;
+    for (u32 attempt = 0; attempt < RJM_MAX_LOD_ATTEMPTS &&
+                          lod_count < RJM_MAX_LODS &&
+                          previous_triangles > RJM_MIN_LOD_TRIANGLES;
+         ++attempt) {
+        // Surface meshes fill about grid^2 cells; aim for a quarter of the
+        // vertices of the previous level.  A rejected level is retried on a
+        // coarser grid, so the grid shrinks every attempt.
+        f32 target = (f32)mesh->vertices.count / (f32)(1u << (2 * lod_count));
+        u32 level_grid = (u32)sqrtf(target);
+        grid = level_grid < grid ? level_grid : grid / 2;
+        if (grid < 2) break;
+        usize first_index = indices.count;
+        u32 triangles = Mesh_build_lod(mesh, grid, min, max, &indices);
+        if (triangles == 0 || triangles > previous_triangles * 4 / 5) {
+            indices.count = first_index;
+            if (triangles == 0) break;
+            continue;
+        }
+        lods[lod_count++] = (RjmLod){
+            .first_index = (u32)first_index,
+            .index_count = triangles * 3,
+            .error = extent / (f32)grid,
+        };
+        previous_triangles = triangles;
+    }
+    header.lod_count = lod_count;
+
+    RjmMeshletArray meshlets = {0};
+    Mesh_build_meshlets(mesh, &meshlets);
+    header.meshlet_count = (u32)meshlets.count;
+
+    const void* payloads[RJM_SECTION_COUNT] = {
+        mesh->vertices.items,
+        indices.items,
+        mesh->edge_indices.items,
+        mesh->edge_flags.items,
+        lods,
+        meshlets.items,
+    };
+    u64 sizes[RJM_SECTION_COUNT] = {
+        mesh->vertices.count * sizeof(Vertex),
+        indices.count * sizeof(u32),
+        mesh->edge_indices.count * sizeof(u32),
+        mesh->edge_flags.count * sizeof(u32),
+        lod_count * sizeof(RjmLod),
+        meshlets.count * sizeof(RjmMeshlet),
+    };
+    u64 offset = rjm_align(sizeof(RjmHeader));
+    for (u32 i = 0; i < RJM_SECTION_COUNT; ++i) {
+        header.sections[i] = (RjmSection){offset, sizes[i]};
+        offset = rjm_align(offset + sizes[i]);
+    }
+
+    header.content_hash = 0;
+    for (u32 i = 0; i < RJM_SECTION_COUNT; ++i) {
+        header.content_hash =
+            hash_bytes(payloads[i], sizes[i], header.content_hash);
+    }
+
+    static const u8 zeros[RJM_SECTION_ALIGNMENT] = {0};
+    ReturnStatus status = RETURN_SUCCESS;
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        LOG_ERROR("Failed to open file: %s", path);
+        status = RETURN_FAILURE;
+    }
+    if (status == RETURN_SUCCESS) {
+        u64 written = 0;
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        written += sizeof(header);
+        for (u32 i = 0; i < RJM_SECTION_COUNT && ok; ++i) {
+            u64 padding = header.sections[i].offset - written;
+            ok = fwrite(zeros, 1, padding, f) == padding;
+            if (ok && sizes[i] > 0) {
+                ok = fwrite(payloads[i], 1, sizes[i], f) == sizes[i];
+            }
+            written = header.sections[i].offset + sizes[i];
+        }
+        if (fclose(f) != 0 || !ok) {
+            LOG_ERROR("Failed to write file: %s", path);
+            status = RETURN_FAILURE;
+        }
+    }
+    if (status == RETURN_SUCCESS) {
+        LOG_INFO(
+            "Wrote %s: %u vertices, %u LODs, %u meshlets, %lu bytes",
+            path,
+            header.vertex_count,
+            header.lod_count,
+            header.meshlet_count,
+            (unsigned long)offset
+        );
+    }
+    IndexArray_free(&indices);
+    RjmMeshletArray_free(&meshlets);
+    return status;
+}
+
+// Header and section checks of `RjmFile_open`, stopping at the first failure
+// so nothing past it is read from an invalid mapping
+static ReturnStatus rjm_validate(
+    const MappedFile* file, const char* path, bool verify_hash
+) {
+    const RjmHeader* header = (const RjmHeader*)file->data;
+    if (file->size < sizeof(RjmHeader) || header->magic != RJM_MAGIC) {
+        LOG_ERROR("Not a mesh cache file: %s", path);
+        return RETURN_FAILURE;
+    }
+    if (header->version != RJM_VERSION ||
+        header->vertex_stride != sizeof(Vertex) ||
+        header->index_size != sizeof(u32)) {
+        LOG_ERROR(
+            "Mesh cache %s has version %u, expected %u", path, header->version,
+            RJM_VERSION
+        );
+        return RETURN_FAILURE;
+    }
+    const RjmSection* sections = header->sections;
+    for (u32 i = 0; i < RJM_SECTION_COUNT; ++i) {
+        if (sections[i].offset % RJM_SECTION_ALIGNMENT != 0 ||
+            sections[i].offset > file->size ||
+            sections[i].size > file->size - sections[i].offset) {
+            LOG_ERROR("Mesh cache %s is truncated", path);
+            return RETURN_FAILURE;
+        }
+    }
+    if (sections[RJM_SECTION_VERTICES].size !=
+            (u64)header->vertex_count * sizeof(Vertex) ||
+        sections[RJM_SECTION_INDICES].size <
+            (u64)header->index_count * sizeof(u32) ||
+        sections[RJM_SECTION_EDGE_INDICES].size !=
+            (u64)header->edge_index_count * sizeof(u32) ||
+        sections[RJM_SECTION_EDGE_FLAGS].size !=
+            (u64)(header->index_count / 3 + 3) / 4 * sizeof(u32)) {
+        LOG_ERROR("Mesh cache %s has inconsistent section sizes", path);
+        return RETURN_FAILURE;
+    }
+    if (header->lod_count == 0 || header->lod_count > RJM_MAX_LODS ||
+        sections[RJM_SECTION_LODS].size !=
+            (u64)header->lod_count * sizeof(RjmLod) ||
+        sections[RJM_SECTION_MESHLETS].size !=
+            (u64)header->meshlet_count * sizeof(RjmMeshlet)) {
+        LOG_ERROR("Mesh cache %s has inconsistent LOD or meshlet data", path);
+        return RETURN_FAILURE;
+    }
+    // Every LOD and meshlet must draw from inside the index section
+    const RjmLod* lods =
+        (const RjmLod*)(file->data + sections[RJM_SECTION_LODS].offset);
+    const RjmMeshlet* meshlets =
+        (const RjmMeshlet*)(file->data + sections[RJM_SECTION_MESHLETS].offset);
+    const u32* indices =
+        (const u32*)(file->data + sections[RJM_SECTION_INDICES].offset);
+    const u32* edge_indices =
+        (const u32*)(file->data + sections[RJM_SECTION_EDGE_INDICES].offset);
+    u64 section_indices = sections[RJM_SECTION_INDICES].size / sizeof(u32);
+    for (u32 i = 0; i < header->lod_count; ++i) {
+        if ((u64)lods[i].first_index + lods[i].index_count > section_indices) {
+            LOG_ERROR("Mesh cache %s has an out of range LOD", path);
+            return RETURN_FAILURE;
+        }
+    }
+    // Meshlets split LOD 0
+    for (u32 i = 0; i < header->meshlet_count; ++i) {
+        if ((u64)meshlets[i].first_index + meshlets[i].index_count >
+            header->index_count) {
+            LOG_ERROR("Mesh cache %s has an out of range meshlet", path);
+            return RETURN_FAILURE;
+        }
+    }
+    if (!verify_hash) return RETURN_SUCCESS;
+
+    u64 hash = 0;
+    for (u32 i = 0; i < RJM_SECTION_COUNT; ++i) {
+        hash = hash_bytes(
+            file->data + sections[i].offset, sections[i].size, hash
+        );
+    }
+    if (hash != header->content_hash) {
+        LOG_ERROR("Mesh cache %s failed its content hash check", path);
+        return RETURN_FAILURE;
+    }
+    // A matching hash only proves the file is intact, not that the writer
+    // kept every index, of every LOD, inside the vertex buffer
+    for (u64 i = 0; i < section_indices; ++i) {
+        if (indices[i] >= header->vertex_count) {
+            LOG_ERROR("Mesh cache %s has an out of range index", path);
+            return RETURN_FAILURE;
+        }
+    }
+    for (u32 i = 0; i < header->edge_index_count; ++i) {
+        if (edge_indices[i] >= header->vertex_count) {
+            LOG_ERROR("Mesh cache %s has an out of range edge index", path);
+            return RETURN_FAILURE;
+        }
+    }
+    return RETURN_SUCCESS;
+}
+
+/** Map a .rjm file and validate its header
+ *
+ * Nothing is parsed or copied; sections are accessed in place through
+ * `RjmFile_section`.  The content hash, and that every index and edge index
+ * names a vertex, are only checked on request since they read the whole
+ * file.
+ *
+ * @param[out] rjm          Mapped file
+ * @param[in] path          File path
+ * @param[in] verify_hash   Recompute and compare the content hash, and
+ *                          range check the indices
+ * @returns                 Return status
+ */
+ReturnStatus RjmFile_open(RjmFile* rjm, const char* path, bool verify_hash) {
+    rjm->header = NULL;
+    if (MappedFile_open(&rjm->file, path) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    if (rjm_validate(&rjm->file, path, verify_hash) != RETURN_SUCCESS) {
+        MappedFile_close(&rjm->file);
+        return RETURN_FAILURE;
+    }
+    rjm->header = (const RjmHeader*)rjm->file.data;
+    return RETURN_SUCCESS;
+}
+
+void RjmFile_close(RjmFile* rjm) {
+    MappedFile_close(&rjm->file);
+    rjm->header = NULL;
+}
+
+/** Pointer into the mapping where a section starts
+ *
+ * @param[in] rjm       Open mesh cache
+ * @param[in] section   Section to look up
+ * @param[out] size     Section size in bytes, may be NULL
+ * @returns             Start of the section
+ */
+const void* RjmFile_section(
+    const RjmFile* rjm, RjmSectionType section, u64* size
+) {
+    if (size != NULL) *size = rjm->header->sections[section].size;
+    return rjm->file.data + rjm->header->sections[section].offset;
+}
+
+/** Create the GPU buffers of a mesh straight from a mapped cache file
+ *
+ * Sections are written to the queue from the mapping without staging them in
+ * the mesh arrays, which stay empty.  The index buffer holds every LOD.  Only
+ * meshes in VERTEX_FORMAT_FLOAT32 upload their vertices without conversion.
+ *
+ * @param[out] mesh         Mesh whose buffers are created
+ * @param[in] renderer      Renderer
+ * @param[in] rjm           Open mesh cache
+ */
+void Renderer_create_mesh_buffers_rjm(
+    Mesh* mesh, Renderer* renderer, const RjmFile* rjm
+) {
+    const RjmHeader* header = rjm->header;
+    mesh->vertex_count = header->vertex_count;
+    mesh->index_count = header->index_count;
+    mesh->edge_index_count = header->edge_index_count;
+
+    u64 indices_size, edge_indices_size, edge_flags_size;
+    const void* vertices = RjmFile_section(rjm, RJM_SECTION_VERTICES, NULL);
+    const void* indices =
+        RjmFile_section(rjm, RJM_SECTION_INDICES, &indices_size);
+    const void* edge_indices =
+        RjmFile_section(rjm, RJM_SECTION_EDGE_INDICES, &edge_indices_size);
+    const void* edge_flags =
+        RjmFile_section(rjm, RJM_SECTION_EDGE_FLAGS, &edge_flags_size);
+
+    // Vertex buffer, quantized meshes are converted from the mapping
+    Renderer_create_vertex_buffer(
+        renderer, mesh, (const Vertex*)vertices, header->vertex_count
+    );
+
+    // Instance buffer
+    if (mesh->instance_buffer != NULL) wgpuBufferRelease(mesh->instance_buffer);
+    mesh->instance_buffer = create_buffer(
+        renderer->device,
+        mesh->instance_capacity * sizeof(Instance),
+        WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst,
+        "Mesh Instance Buffer"
+    );
+
+    // Index buffer
+    if (mesh->index_buffer != NULL) wgpuBufferRelease(mesh->index_buffer);
+    mesh->index_buffer = create_buffer(
+        renderer->device,
+        indices_size,
+        WGPUBufferUsage_Index | WGPUBufferUsage_Storage |
+            WGPUBufferUsage_CopyDst,
+        "Index Buffer"
+    );
+    wgpuQueueWriteBuffer(
+        renderer->queue, mesh->index_buffer, 0, indices, indices_size
+    );
+
+    // Edge index buffer
+    if (mesh->edge_index_buffer != NULL) {
+        wgpuBufferRelease(mesh->edge_index_buffer);
+    }
+    mesh->edge_index_buffer = create_buffer(
+        renderer->device,
+        edge_indices_size,
+        WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst,
+        "Edge Index Buffer"
+    );
+    wgpuQueueWriteBuffer(
+        renderer->queue,
+        mesh->edge_index_buffer,
+        0,
+        edge_indices,
+        edge_indices_size
+    );
+
+    // Edge flag buffer
+    Renderer_create_edge_flag_buffer(
+        renderer, mesh, edge_flags, edge_flags_size / sizeof(u32)
+    );
+}
+
+#endif /* MESH_CACHE_H */
@@ -0,0 +1,1970 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include "cglm/vec3.h"
+#include "core.h"
+#include "mesh.h"
+
+#define MESH_IMPORT_MIN_CHUNK_SIZE (1 << 20)
+#define MESH_IMPORT_DEFAULT_EDGE_ANGLE 30.0f
+#define PLY_MAX_ELEMENTS 8
+#define PLY_MAX_PROPERTIES 16
+
+/* Types */
+
+typedef enum {
+    MESH_FORMAT_UNKNOWN,
+    MESH_FORMAT_OBJ,
+    MESH_FORMAT_PLY,
+    MESH_FORMAT_STL,
+} MeshFormat;
+
+typedef struct MeshImportOptions {
+    // Worker threads, 0 uses every online CPU
+    u32 thread_count;
+    // Grid size used to weld vertices, 0 only welds bit-identical vertices
+    f32 weld_epsilon;
+    // Dihedral angle in degrees above which a shared edge becomes an outline
+    f32 edge_angle;
+    // Vertex color used when the file does not provide one
+    vec3 color;
+} MeshImportOptions;
+
+typedef struct Float3 {
+    f32 v[3];
+} Float3;
+DEFINE_DYNAMIC_ARRAY(Float3, Float3Array)
+
+// Face corner of an OBJ file.  Indices are zero based, absent normals are -1.
+typedef struct ObjCorner {
+    i32 position;
+    i32 normal;
+} ObjCorner;
+DEFINE_DYNAMIC_ARRAY(ObjCorner, ObjCornerArray)
+
+// Elements to deduplicate, identified by their index in the source
+typedef struct WeldSource {
+    usize count;
+    const void* user;
+    // Equal elements must hash equally
+    u32 (*hash)(const void* user, usize i);
+    bool (*equal)(const void* user, usize a, usize b);
+} WeldSource;
+
+typedef struct TextChunk {
+    const char* begin;
+    const char* end;
+} TextChunk;
+
+typedef enum {
+    PLY_TYPE_NONE,
+    PLY_TYPE_I8,
+    PLY_TYPE_U8,
+    PLY_TYPE_I16,
+    PLY_TYPE_U16,
+    PLY_TYPE_I32,
+    PLY_TYPE_U32,
+    PLY_TYPE_F32,
+    PLY_TYPE_F64,
+} PlyType;
+
+typedef enum {
+    PLY_FORMAT_ASCII,
+    PLY_FORMAT_BINARY_LE,
+    PLY_FORMAT_BINARY_BE,
+} PlyFormat;
+
+typedef enum {
+    PLY_TARGET_NONE = -1,
+    PLY_TARGET_X,
+    PLY_TARGET_Y,
+    PLY_TARGET_Z,
+    PLY_TARGET_NX,
+    PLY_TARGET_NY,
+    PLY_TARGET_NZ,
+    PLY_TARGET_RED,
+    PLY_TARGET_GREEN,
+    PLY_TARGET_BLUE,
+    PLY_TARGET_INDICES,
+} PlyTarget;
+
+typedef struct PlyProperty {
+    PlyType type;
+    // Count type of list properties, PLY_TYPE_NONE for scalars
+    PlyType count_type;
+    PlyTarget target;
+    u32 offset;
+} PlyProperty;
+
+typedef struct PlyElement {
+    char name[32];
+    usize count;
+    PlyProperty properties[PLY_MAX_PROPERTIES];
+    u32 property_count;
+    // Size of one binary record, only valid when `fixed_size`
+    u32 stride;
+    bool fixed_size;
+} PlyElement;
+
+typedef struct PlyHeader {
+    PlyFormat format;
+    PlyElement elements[PLY_MAX_ELEMENTS];
+    u32 element_count;
+    usize body_offset;
+} PlyHeader;
+
+/* Function Prototypes */
+
+MeshImportOptions MeshImportOptions_default(void);
+MeshFormat MeshFormat_from_path(const char* path);
+ReturnStatus Mesh_import(
+    Mesh* mesh, const char* path, const MeshImportOptions* options
+);
+ReturnStatus Mesh_import_obj(
+    Mesh* mesh, const MappedFile* file, const MeshImportOptions* options
+);
+ReturnStatus Mesh_import_ply(
+    Mesh* mesh, const MappedFile* file, const MeshImportOptions* options
+);
+ReturnStatus Mesh_import_stl(
+    Mesh* mesh, const MappedFile* file, const MeshImportOptions* options
+);
+void Mesh_weld_vertices(
+    Mesh* mesh, const VertexArray* soup, const MeshImportOptions* options
+);
+void Mesh_compute_normals(Mesh* mesh);
+void Mesh_compute_edges(Mesh* mesh, const MeshImportOptions* options);
+void Mesh_compute_edge_flags(Mesh* mesh, const MeshImportOptions* options);
+
+static void weld(
+    const WeldSource* source,
+    u32 thread_count,
+    IndexArray* indices,
+    U32Array* first
+);
+
+/* Text parsing */
+
+static const f64 POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static inline bool is_digit(char c) { return (u8)(c - '0') < 10; }
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char* skip_space(const char* p, const char* end) {
+    while (p < end && is_space(*p)) ++p;
+    return p;
+}
+
+static inline const char* next_line(const char* p, const char* end) {
+    const char* nl = memchr(p, '\n', end - p);
+    return nl ? nl + 1 : end;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define MESH_IMPORT_SWAR 1
+// SWAR digit parsing: checks and converts eight ASCII digits per 64 bit load
+static inline bool swar_is_eight_digits(u64 v) {
+    return ((v & 0xF0F0F0F0F0F0F0F0ull) |
+            (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+           0x3333333333333333ull;
+}
+
+static inline u32 swar_parse_eight_digits(u64 v) {
+    const u64 mask = 0x000000FF000000FFull;
+    const u64 mul1 = 100 + (1000000ull << 32);
+    const u64 mul2 = 1 + (10000ull << 32);
+    v -= 0x3030303030303030ull;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return (u32)v;
+}
+#endif
+
+static inline const char* parse_digits(
+    const char* p, const char* end, u64* mantissa, u32* digits, i32* exponent,
+    bool fraction
+) {
+#ifdef MESH_IMPORT_SWAR
+    while (end - p >= 8 && *digits + 8 <= 19) {
+        u64 chunk;
+        memcpy(&chunk, p, sizeof(chunk));
+        if (!swar_is_eight_digits(chunk)) break;
+        *mantissa = *mantissa * 100000000ull + swar_parse_eight_digits(chunk);
+        // Leading zeros do not count towards the 19 significant digits
+        if (*mantissa != 0) *digits += 8;
+        if (fraction) *exponent -= 8;
+        p += 8;
+    }
+#endif
+    while (p < end && is_digit(*p)) {
+        if (*digits < 19) {
+            *mantissa = *mantissa * 10 + (u64)(*p - '0');
+            if (*mantissa != 0) ++*digits;
+            if (fraction) --*exponent;
+        } else if (!fraction) {
+            ++*exponent;
+        }
+        ++p;
+    }
+    return p;
+}
+
+/** Parse a decimal floating point number
+ *
+ * Locale independent replacement for `strtof`.  Digits are converted eight at
+ * a time when the platform allows unaligned little endian loads.
+ *
+ * @param[in] p     Start of the number
+ * @param[in] end   End of the readable range
+ * @param[out] out  Parsed value
+ * @returns         One past the last consumed character, NULL on error
+ */
+static inline const char* parse_f32(const char* p, const char* end, f32* out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    u64 mantissa = 0;
+    u32 digits = 0;
+    i32 exponent = 0;
+    const char* start = p;
+    p = parse_digits(p, end, &mantissa, &digits, &exponent, false);
+    if (p < end && *p == '.') {
+        ++p;
+        p = parse_digits(p, end, &mantissa, &digits, &exponent, true);
+    }
+    if (p == start || (p == start + 1 && *start == '.')) return NULL;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool exp_negative = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exp_negative = *q == '-';
+            ++q;
+        }
+        if (q < end && is_digit(*q)) {
+            i32 e = 0;
+            while (q < end && is_digit(*q)) {
+                if (e < 100000) e = e * 10 + (*q - '0');
+                ++q;
+            }
+            exponent += exp_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    f64 value = (f64)mantissa;
+    if (exponent < 0 && exponent >= -22) {
+        value /= POW10[-exponent];
+    } else if (exponent > 0 && exponent <= 22) {
+        value *= POW10[exponent];
+    } else if (exponent != 0) {
+        value *= pow(10.0, exponent);
+    }
+    *out = (f32)(negative ? -value : value);
+    return p;
+}
+
+static inline const char* parse_i64(const char* p, const char* end, i64* out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p >= end || !is_digit(*p)) return NULL;
+    // Magnitude of INT64_MIN for negative numbers
+    u64 limit = (u64)INT64_MAX + (negative ? 1 : 0);
+    u64 value = 0;
+    while (p < end && is_digit(*p)) {
+        u64 digit = (u64)(*p - '0');
+        // Rejected rather than wrapped around
+        if (value > (limit - digit) / 10) return NULL;
+        value = value * 10 + digit;
+        ++p;
+    }
+    if (value > (u64)INT64_MAX) {
+        *out = INT64_MIN;
+    } else {
+        *out = negative ? -(i64)value : (i64)value;
+    }
+    return p;
+}
+
+/** Split text into roughly equal chunks that start and end on line breaks
+ *
+ * @returns     Number of chunks written, at most `max_chunks`
+ */
+static u32 split_lines(
+    const char* begin, const char* end, u32 max_chunks, TextChunk* chunks
+) {
+    usize size = end - begin;
+    usize chunk_size = size / (max_chunks > 0 ? max_chunks : 1);
+    if (chunk_size < MESH_IMPORT_MIN_CHUNK_SIZE) {
+        chunk_size = MESH_IMPORT_MIN_CHUNK_SIZE;
+    }
+    u32 count = 0;
+    const char* p = begin;
+    while (p < end && count < max_chunks) {
+        const char* chunk_end = end;
+        if (count + 1 < max_chunks && (usize)(end - p) > chunk_size) {
+            chunk_end = next_line(p + chunk_size, end);
+        }
+        chunks[count++] = (TextChunk){p, chunk_end};
+        p = chunk_end;
+    }
+    return count;
+}
+
+static inline u32 import_thread_count(const MeshImportOptions* options) {
+    u32 count = options->thread_count ? options->thread_count : cpu_count();
+    return count > MAX_WORKER_THREADS ? MAX_WORKER_THREADS : count;
+}
+
+// Workers for `work` items, small inputs are not worth a thread each
+static inline u32 task_count(u32 thread_count, usize work) {
+    usize count = work / 65536 + 1;
+    return count < thread_count ? (u32)count : thread_count;
+}
+
+static inline void face_normal(
+    const vec3 a, const vec3 b, const vec3 c, vec3 normal
+) {
+    vec3 ab, ac;
+    glm_vec3_sub((f32*)b, (f32*)a, ab);
+    glm_vec3_sub((f32*)c, (f32*)a, ac);
+    glm_vec3_cross(ab, ac, normal);
+    glm_vec3_normalize(normal);
+}
+
+/* Functions */
+
+MeshImportOptions MeshImportOptions_default(void) {
+    return (MeshImportOptions){
+        .thread_count = 0,
+        .weld_epsilon = 0.0f,
+        .edge_angle = MESH_IMPORT_DEFAULT_EDGE_ANGLE,
+        .color = {1.0f, 1.0f, 1.0f},
+    };
+}
+
+MeshFormat MeshFormat_from_path(const char* path) {
+    const char* ext = strrchr(path, '.');
+    if (ext == NULL) return MESH_FORMAT_UNKNOWN;
+    char lower[8] = {0};
+    for (u32 i = 0; i < sizeof(lower) - 1 && ext[i + 1] != '\0'; ++i) {
+        char c = ext[i + 1];
+        lower[i] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    }
+    if (strcmp(lower, "obj") == 0) return MESH_FORMAT_OBJ;
+    if (strcmp(lower, "ply") == 0) return MESH_FORMAT_PLY;
+    if (strcmp(lower, "stl") == 0) return MESH_FORMAT_STL;
+    return MESH_FORMAT_UNKNOWN;
+}
+
+/** Import a triangle mesh from an OBJ, PLY or binary STL file
+ *
+ * The file is memory mapped and parsed by `options->thread_count` workers.
+ * Vertices are welded, normals are generated when the file has none, and
+ * `edge_indices` receives boundary and crease edges for the outline pass.
+ * Previous contents of the mesh arrays are discarded.
+ *
+ * @param[in,out] mesh      Mesh whose vertex, index and edge arrays are filled
+ * @param[in] path          File path, the format is chosen by extension
+ * @param[in] options       Import options, NULL for defaults
+ * @returns                 Return status
+ */
+ReturnStatus Mesh_import(
+    Mesh* mesh, const char* path, const MeshImportOptions* options
+) {
+    MeshImportOptions defaults = MeshImportOptions_default();
+    if (options == NULL) options = &defaults;
+
+    MeshFormat format = MeshFormat_from_path(path);
+    if (format == MESH_FORMAT_UNKNOWN) {
+        LOG_ERROR("Unknown mesh format: %s", path);
+        return RETURN_FAILURE;
+    }
+    MappedFile file = {0};
+    if (MappedFile_open(&file, path) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+
+    VertexArray_free(&mesh->vertices);
+    IndexArray_free(&mesh->indices);
+    IndexArray_free(&mesh->edge_indices);
+    U32Array_free(&mesh->edge_flags);
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ReturnStatus status = RETURN_FAILURE;
+    switch (format) {
+        case MESH_FORMAT_OBJ: {
+            status = Mesh_import_obj(mesh, &file, options);
+        } break;
+        case MESH_FORMAT_PLY: {
+            status = Mesh_import_ply(mesh, &file, options);
+        } break;
+        case MESH_FORMAT_STL: {
+            status = Mesh_import_stl(mesh, &file, options);
+        } break;
+        case MESH_FORMAT_UNKNOWN:
+            break;
+    }
+    if (status == RETURN_SUCCESS) {
+        Mesh_compute_edges(mesh, options);
+        Mesh_compute_edge_flags(mesh, options);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    if (status == RETURN_SUCCESS) {
+        f64 seconds = (f64)(stop.tv_sec - start.tv_sec) +
+                      (f64)(stop.tv_nsec - start.tv_nsec) * 1e-9;
+        LOG_INFO(
+            "Imported %s: %zu vertices, %zu triangles, %zu edges in %.3fs "
+            "(%.1f MB/s)",
+            path,
+            mesh->vertices.count,
+            mesh->indices.count / 3,
+            mesh->edge_indices.count / 2,
+            seconds,
+            seconds > 0.0 ? (f64)file.size / seconds / 1e6 : 0.0
+        );
+    } else {
+        LOG_ERROR("Failed to import mesh: %s", path);
+        VertexArray_free(&mesh->vertices);
+        IndexArray_free(&mesh->indices);
+        IndexArray_free(&mesh->edge_indices);
+    }
+    MappedFile_close(&file);
+    return status;
+}
+
+/* OBJ */
+
+typedef struct ObjChunk {
+    TextChunk text;
+    VertexArray positions;
+    Float3Array normals;
+    ObjCornerArray corners;
+    // Corners holding indices relative to the end of this chunk's positions or
+    // normals, encoded as `corner * 2 + is_normal`.  OBJ allows negative
+    // indices; they are resolved once every chunk's counts are known.
+    U32Array relative;
+    usize position_base;
+    usize normal_base;
+    usize corner_base;
+    bool failed;
+} ObjChunk;
+
+typedef struct ObjImport {
+    ObjChunk chunks[MAX_WORKER_THREADS];
+    const MeshImportOptions* options;
+    VertexArray positions;
+    Float3Array normals;
+    ObjCornerArray corners;
+} ObjImport;
+
+static const char* obj_parse_corner(
+    const char* p, const char* end, ObjChunk* chunk, ObjCorner* corner
+) {
+    i64 v = 0, vn = 0;
+    p = parse_i64(p, end, &v);
+    if (p == NULL || v == 0) return NULL;
+    if (p < end && *p == '/') {
+        ++p;
+        i64 vt = 0;
+        if (p < end && *p != '/') p = parse_i64(p, end, &vt);
+        if (p == NULL) return NULL;
+        if (p < end && *p == '/') {
+            p = parse_i64(p + 1, end, &vn);
+            if (p == NULL) return NULL;
+        }
+    }
+    usize corner_index = chunk->corners.count;
+    if (v > 0) {
+        corner->position = (i32)(v - 1);
+    } else {
+        corner->position = (i32)((i64)chunk->positions.count + v);
+        U32Array_push(&chunk->relative, (u32)(corner_index * 2));
+    }
+    if (vn > 0) {
+        corner->normal = (i32)(vn - 1);
+    } else if (vn < 0) {
+        corner->normal = (i32)((i64)chunk->normals.count + vn);
+        U32Array_push(&chunk->relative, (u32)(corner_index * 2 + 1));
+    } else {
+        corner->normal = -1;
+    }
+    return p;
+}
+
+static void obj_parse_chunk(void* ctx, u32 index, u32 count) {
+    (void)count;
+    ObjImport* import = (ObjImport*)ctx;
+    ObjChunk* chunk = &import->chunks[index];
+    const char* end = chunk->text.end;
+    const char* p = chunk->text.begin;
+    Vertex vertex = {0};
+
+    while (p < end) {
+        const char* line_end = next_line(p, end);
+        p = skip_space(p, line_end);
+        if (line_end - p < 2) {
+            p = line_end;
+            continue;
+        }
+        if (p[0] == 'v' && is_space(p[1])) {
+            p += 2;
+            for (u32 i = 0; i < 3 && p != NULL; ++i) {
+                p = parse_f32(
+                    skip_space(p, line_end), line_end, &vertex.position[i]
+                );
+            }
+            if (p == NULL) {
+                chunk->failed = true;
+                return;
+            }
+            // Optional per-vertex color extension: `v x y z r g b`
+            vec3 extra = {0};
+            u32 extra_count = 0;
+            while (extra_count < 3) {
+                const char* q = skip_space(p, line_end);
+                q = parse_f32(q, line_end, &extra[extra_count]);
+                if (q == NULL) break;
+                p = q;
+                ++extra_count;
+            }
+            if (extra_count == 3) {
+                glm_vec3_copy(extra, vertex.color);
+            } else {
+                glm_vec3_copy((f32*)import->options->color, vertex.color);
+            }
+            VertexArray_push(&chunk->positions, vertex);
+        } else if (p[0] == 'v' && p[1] == 'n') {
+            p += 2;
+            Float3 normal = {0};
+            for (u32 i = 0; i < 3 && p != NULL; ++i) {
+                p = parse_f32(skip_space(p, line_end), line_end, &normal.v[i]);
+            }
+            if (p == NULL) {
+                chunk->failed = true;
+                return;
+            }
+            Float3Array_push(&chunk->normals, normal);
+        } else if (p[0] == 'f' && is_space(p[1])) {
+            p += 2;
+            ObjCorner first = {0}, previous = {0}, corner = {0};
+            u32 corner_count = 0;
+            for (;;) {
+                p = skip_space(p, line_end);
+                if (p >= line_end || *p == '\n' || *p == '#') break;
+                p = obj_parse_corner(p, line_end, chunk, &corner);
+                if (p == NULL) {
+                    chunk->failed = true;
+                    return;
+                }
+                // Fan triangulation of polygons
+                if (corner_count == 0) {
+                    first = corner;
+                } else if (corner_count >= 2) {
+                    ObjCornerArray_push(&chunk->corners, first);
+                    ObjCornerArray_push(&chunk->corners, previous);
+                    ObjCornerArray_push(&chunk->corners, corner);
+                }
+                previous = corner;
+                ++corner_count;
+            }
+        }
+        p = line_end;
+    }
+}
+
+// Resolves relative indices and copies the chunk into the combined arrays
+static void obj_gather_chunk(void* ctx, u32 index, u32 count) {
+    (void)count;
+    ObjImport* import = (ObjImport*)ctx;
+    ObjChunk* chunk = &import->chunks[index];
+    for (usize i = 0; i < chunk->relative.count; ++i) {
+        u32 entry = chunk->relative.items[i];
+        ObjCorner* corner = &chunk->corners.items[entry / 2];
+        if (entry & 1) {
+            corner->normal += (i32)chunk->normal_base;
+        } else {
+            corner->position += (i32)chunk->position_base;
+        }
+    }
+
+    usize position_count = import->positions.count;
+    usize normal_count = import->normals.count;
+    ObjCorner* out = import->corners.items + chunk->corner_base;
+    for (usize i = 0; i < chunk->corners.count; ++i) {
+        ObjCorner corner = chunk->corners.items[i];
+        if (corner.position < 0 || (usize)corner.position >= position_count ||
+            corner.normal < -1 ||
+            (corner.normal >= 0 && (usize)corner.normal >= normal_count)) {
+            chunk->failed = true;
+            return;
+        }
+        out[i] = corner;
+    }
+    if (chunk->positions.count > 0) {
+        memcpy(
+            import->positions.items + chunk->position_base,
+            chunk->positions.items,
+            chunk->positions.count * sizeof(Vertex)
+        );
+    }
+    if (chunk->normals.count > 0) {
+        memcpy(
+            import->normals.items + chunk->normal_base,
+            chunk->normals.items,
+            chunk->normals.count * sizeof(Float3)
+        );
+    }
+}
+
+// Not mixed on purpose: faces reference nearby positions, and keeping their
+// hashes close keeps the weld table accesses cache friendly
+static u32 obj_corner_hash(const void* user, usize i) {
+    const ObjCorner* corner = &((const ObjImport*)user)->corners.items[i];
+    return (u32)corner->position + (u32)corner->normal * 0x9E3779B1u;
+}
+
+static bool obj_corner_equal(const void* user, usize a, usize b) {
+    const ObjCorner* corners = ((const ObjImport*)user)->corners.items;
+    return corners[a].position == corners[b].position &&
+           corners[a].normal == corners[b].normal;
+}
+
+ReturnStatus Mesh_import_obj(
+    Mesh* mesh, const MappedFile* file, const MeshImportOptions* options
+) {
+    ObjImport* import = RAIJIN_REALLOC(NULL, sizeof(ObjImport));
+    RAIJIN_ASSERT(import != NULL && "Mesh_import_obj: Out of memory");
+    memset(import, 0, sizeof(*import));
+    import->options = options;
+
+    TextChunk text[MAX_WORKER_THREADS];
+    const char* begin = (const char*)file->data;
+    u32 chunk_count = split_lines(
+        begin, begin + file->size, import_thread_count(options), text
+    );
+    for (u32 i = 0; i < chunk_count; ++i) {
+        import->chunks[i].text = text[i];
+    }
+    parallel_for(obj_parse_chunk, import, chunk_count);
+
+    ReturnStatus status = RETURN_SUCCESS;
+    usize position_count = 0, normal_count = 0, corner_count = 0;
+    for (u32 i = 0; i < chunk_count; ++i) {
+        ObjChunk* chunk = &import->chunks[i];
+        if (chunk->failed) status = RETURN_FAILURE;
+        chunk->position_base = position_count;
+        chunk->normal_base = normal_count;
+        chunk->corner_base = corner_count;
+        position_count += chunk->positions.count;
+        normal_count += chunk->normals.count;
+        corner_count += chunk->corners.count;
+    }
+    if (status != RETURN_SUCCESS) {
+        LOG_ERROR("Malformed OBJ data");
+    }
+
+    if (status == RETURN_SUCCESS) {
+        VertexArray_reserve(&import->positions, position_count);
+        import->positions.count = position_count;
+        Float3Array_reserve(&import->normals, normal_count);
+        import->normals.count = normal_count;
+        ObjCornerArray_reserve(&import->corners, corner_count);
+        import->corners.count = corner_count;
+        parallel_for(obj_gather_chunk, import, chunk_count);
+        for (u32 i = 0; i < chunk_count; ++i) {
+            if (import->chunks[i].failed) status = RETURN_FAILURE;
+        }
+        if (status != RETURN_SUCCESS) {
+            LOG_ERROR("OBJ face references a missing vertex or normal");
+        }
+    }
+    for (u32 i = 0; i < chunk_count; ++i) {
+        VertexArray_free(&import->chunks[i].positions);
+        Float3Array_free(&import->chunks[i].normals);
+        ObjCornerArray_free(&import->chunks[i].corners);
+        U32Array_free(&import->chunks[i].relative);
+    }
+
+    // Corners sharing both a position and a normal become one vertex
+    if (status == RETURN_SUCCESS && corner_count > 0) {
+        WeldSource source = {
+            .count = corner_count,
+            .user = import,
+            .hash = obj_corner_hash,
+            .equal = obj_corner_equal,
+        };
+        U32Array first = {0};
+        weld(&source, import_thread_count(options), &mesh->indices, &first);
+        VertexArray_reserve(&mesh->vertices, first.count);
+        mesh->vertices.count = first.count;
+        for (usize i = 0; i < first.count; ++i) {
+            ObjCorner corner = import->corners.items[first.items[i]];
+            Vertex* vertex = &mesh->vertices.items[i];
+            *vertex = import->positions.items[corner.position];
+            if (corner.normal >= 0) {
+                memcpy(
+                    vertex->normal,
+                    import->normals.items[corner.normal].v,
+                    sizeof(vec3)
+                );
+            }
+        }
+        U32Array_free(&first);
+        if (normal_count == 0) Mesh_compute_normals(mesh);
+    }
+
+    VertexArray_free(&import->positions);
+    Float3Array_free(&import->normals);
+    ObjCornerArray_free(&import->corners);
+    RAIJIN_FREE(import);
+    return status;
+}
+
+/* PLY */
+
+static PlyType PlyType_from_name(const char* name, usize length) {
+    static const struct {
+        const char* name;
+        PlyType type;
+    } types[] = {
+        {"char", PLY_TYPE_I8},     {"int8", PLY_TYPE_I8},
+        {"uchar", PLY_TYPE_U8},    {"uint8", PLY_TYPE_U8},
+        {"short", PLY_TYPE_I16},   {"int16", PLY_TYPE_I16},
+        {"ushort", PLY_TYPE_U16},  {"uint16", PLY_TYPE_U16},
+        {"int", PLY_TYPE_I32},     {"int32", PLY_TYPE_I32},
+        {"uint", PLY_TYPE_U32},    {"uint32", PLY_TYPE_U32},
+        {"float", PLY_TYPE_F32},   {"float32", PLY_TYPE_F32},
+        {"double", PLY_TYPE_F64},  {"float64", PLY_TYPE_F64},
+    };
+    for (u32 i = 0; i < ARRAY_COUNT(types); ++i) {
+        if (strlen(types[i].name) == length &&
+            memcmp(types[i].name, name, length) == 0) {
+            return types[i].type;
+        }
+    }
+    return PLY_TYPE_NONE;
+}
+
+static inline u32 PlyType_size(PlyType type) {
+    switch (type) {
+        case PLY_TYPE_I8:
+        case PLY_TYPE_U8:
+            return 1;
+        case PLY_TYPE_I16:
+        case PLY_TYPE_U16:
+            return 2;
+        case PLY_TYPE_I32:
+        case PLY_TYPE_U32:
+        case PLY_TYPE_F32:
+            return 4;
+        case PLY_TYPE_F64:
+            return 8;
+        case PLY_TYPE_NONE:
+            break;
+    }
+    return 0;
+}
+
+static inline bool PlyType_is_integer(PlyType type) {
+    return type != PLY_TYPE_F32 && type != PLY_TYPE_F64;
+}
+
+static inline f64 ply_read_binary(const u8* p, PlyType type, bool swap) {
+    u8 bytes[8];
+    u32 size = PlyType_size(type);
+    for (u32 i = 0; i < size; ++i) bytes[i] = swap ? p[size - 1 - i] : p[i];
+    switch (type) {
+        case PLY_TYPE_I8:
+            return (i8)bytes[0];
+        case PLY_TYPE_U8:
+            return bytes[0];
+        case PLY_TYPE_I16: {
+            i16 v;
+            memcpy(&v, bytes, 2);
+            return v;
+        }
+        case PLY_TYPE_U16: {
+            u16 v;
+            memcpy(&v, bytes, 2);
+            return v;
+        }
+        case PLY_TYPE_I32: {
+            i32 v;
+            memcpy(&v, bytes, 4);
+            return v;
+        }
+        case PLY_TYPE_U32: {
+            u32 v;
+            memcpy(&v, bytes, 4);
+            return v;
+        }
+        case PLY_TYPE_F32: {
+            f32 v;
+            memcpy(&v, bytes, 4);
+            return v;
+        }
+        case PLY_TYPE_F64: {
+            f64 v;
+            memcpy(&v, bytes, 8);
+            return v;
+        }
+        case PLY_TYPE_NONE:
+            break;
+    }
+    return 0.0;
+}
+
+static PlyTarget ply_target_from_name(const char* name, usize length) {
+    static const char* names[] = {
+        "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue",
+    };
+    for (u32 i = 0; i < ARRAY_COUNT(names); ++i) {
+        if (strlen(names[i]) == length && memcmp(names[i], name, length) == 0) {
+            return (PlyTarget)i;
+        }
+    }
+    if ((length == 14 && memcmp(name, "vertex_indices", 14) == 0) ||
+        (length == 12 && memcmp(name, "vertex_index", 12) == 0)) {
+        return PLY_TARGET_INDICES;
+    }
+    return PLY_TARGET_NONE;
+}
+
+static const char* ply_next_word(
+    const char* p, const char* end, const char** word, usize* length
+) {
+    p = skip_space(p, end);
+    *word = p;
+    while (p < end && !is_space(*p) && *p != '\n') ++p;
+    *length = p - *word;
+    return p;
+}
+
+static inline bool word_eq(const char* word, usize length, const char* str) {
+    return strlen(str) == length && memcmp(word, str, length) == 0;
+}
+
+static ReturnStatus PlyHeader_parse(PlyHeader* header, const MappedFile* file) {
+    memset(header, 0, sizeof(*header));
+    const char* begin = (const char*)file->data;
+    const char* end = begin + file->size;
+    if (file->size < 4 || memcmp(begin, "ply", 3) != 0) {
+        LOG_ERROR("Missing PLY magic");
+        return RETURN_FAILURE;
+    }
+
+    const char* p = next_line(begin, end);
+    PlyElement* element = NULL;
+    while (p < end) {
+        const char* line_end = next_line(p, end);
+        const char* word;
+        usize length;
+        const char* q = ply_next_word(p, line_end, &word, &length);
+        if (word_eq(word, length, "end_header")) {
+            header->body_offset = line_end - begin;
+            return RETURN_SUCCESS;
+        } else if (word_eq(word, length, "format")) {
+            ply_next_word(q, line_end, &word, &length);
+            if (word_eq(word, length, "ascii")) {
+                header->format = PLY_FORMAT_ASCII;
+            } else if (word_eq(word, length, "binary_little_endian")) {
+                header->format = PLY_FORMAT_BINARY_LE;
+            } else if (word_eq(word, length, "binary_big_endian")) {
+                header->format = PLY_FORMAT_BINARY_BE;
+            } else {
+                LOG_ERROR("Unknown PLY format: %.*s", (int)length, word);
+                return RETURN_FAILURE;
+            }
+        } else if (word_eq(word, length, "element")) {
+            if (header->element_count == PLY_MAX_ELEMENTS) {
+                LOG_ERROR("Too many PLY elements");
+                return RETURN_FAILURE;
+            }
+            element = &header->elements[header->element_count++];
+            q = ply_next_word(q, line_end, &word, &length);
+            memcpy(
+                element->name,
+                word,
+                length < sizeof(element->name) ? length
+                                               : sizeof(element->name) - 1
+            );
+            i64 count = 0;
+            if (parse_i64(skip_space(q, line_end), line_end, &count) == NULL ||
+                count < 0) {
+                LOG_ERROR("Invalid PLY element count");
+                return RETURN_FAILURE;
+            }
+            element->count = (usize)count;
+            element->fixed_size = true;
+        } else if (word_eq(word, length, "property")) {
+            if (element == NULL ||
+                element->property_count == PLY_MAX_PROPERTIES) {
+                LOG_ERROR("Unexpected PLY property");
+                return RETURN_FAILURE;
+            }
+            PlyProperty* property =
+                &element->properties[element->property_count++];
+            q = ply_next_word(q, line_end, &word, &length);
+            if (word_eq(word, length, "list")) {
+                q = ply_next_word(q, line_end, &word, &length);
+                property->count_type = PlyType_from_name(word, length);
+                q = ply_next_word(q, line_end, &word, &length);
+                element->fixed_size = false;
+            }
+            property->type = PlyType_from_name(word, length);
+            ply_next_word(q, line_end, &word, &length);
+            property->target = ply_target_from_name(word, length);
+            property->offset = element->stride;
+            element->stride += PlyType_size(property->type);
+            if (property->type == PLY_TYPE_NONE) {
+                LOG_ERROR("Unknown PLY property type");
+                return RETURN_FAILURE;
+            }
+        }
+        p = line_end;
+    }
+    LOG_ERROR("Missing PLY end_header");
+    return RETURN_FAILURE;
+}
+
+typedef struct PlyImport {
+    const PlyHeader* header;
+    const PlyElement* vertex_element;
+    const PlyElement* face_element;
+    const MeshImportOptions* options;
+    Mesh* mesh;
+    // Binary sections
+    const u8* vertex_data;
+    const u8* face_data;
+    usize face_data_size;
+    // ASCII body lines where the vertex and face elements start, other
+    // elements are skipped
+    usize vertex_line;
+    usize face_line;
+    // ASCII chunks and the line number each one starts at
+    TextChunk chunks[MAX_WORKER_THREADS];
+    usize first_line[MAX_WORKER_THREADS];
+    IndexArray chunk_indices[MAX_WORKER_THREADS];
+    bool failed[MAX_WORKER_THREADS];
+} PlyImport;
+
+static inline void ply_store_property(
+    Vertex* vertex, const PlyProperty* property, f64 value
+) {
+    if (property->target < PLY_TARGET_NX) {
+        vertex->position[property->target] = (f32)value;
+    } else if (property->target < PLY_TARGET_RED) {
+        vertex->normal[property->target - PLY_TARGET_NX] = (f32)value;
+    } else if (property->target < PLY_TARGET_INDICES) {
+        if (PlyType_is_integer(property->type)) value /= 255.0;
+        vertex->color[property->target - PLY_TARGET_RED] = (f32)value;
+    }
+}
+
+static void ply_parse_binary_vertices(void* ctx, u32 index, u32 count) {
+    PlyImport* import = (PlyImport*)ctx;
+    const PlyElement* element = import->vertex_element;
+    bool swap = import->header->format == PLY_FORMAT_BINARY_BE;
+    usize begin = element->count * index / count;
+    usize end = element->count * (index + 1) / count;
+    for (usize i = begin; i < end; ++i) {
+        const u8* record = import->vertex_data + i * element->stride;
+        Vertex* vertex = &import->mesh->vertices.items[i];
+        for (u32 j = 0; j < element->property_count; ++j) {
+            const PlyProperty* property = &element->properties[j];
+            if (property->target == PLY_TARGET_NONE) continue;
+            ply_store_property(
+                vertex,
+                property,
+                ply_read_binary(record + property->offset, property->type, swap)
+            );
+        }
+    }
+}
+
+// Fast path for faces that are all triangles: every record has the same size
+// so the face range can be split across workers.  A worker that meets a
+// non-triangle marks the import as failed and the caller falls back to a
+// sequential scan.
+static void ply_parse_binary_triangles(void* ctx, u32 index, u32 count) {
+    PlyImport* import = (PlyImport*)ctx;
+    const PlyElement* element = import->face_element;
+    bool swap = import->header->format == PLY_FORMAT_BINARY_BE;
+    const PlyProperty* list = NULL;
+    u32 stride = 0, list_offset = 0;
+    for (u32 j = 0; j < element->property_count; ++j) {
+        const PlyProperty* property = &element->properties[j];
+        if (property->target == PLY_TARGET_INDICES) {
+            list = property;
+            list_offset = stride;
+            stride += PlyType_size(property->count_type) +
+                      3 * PlyType_size(property->type);
+        } else if (property->count_type == PLY_TYPE_NONE) {
+            stride += PlyType_size(property->type);
+        }
+    }
+    u32 count_size = PlyType_size(list->count_type);
+    u32 index_size = PlyType_size(list->type);
+    usize vertex_count = import->mesh->vertices.count;
+
+    usize begin = element->count * index / count;
+    usize end = element->count * (index + 1) / count;
+    u32* out = import->mesh->indices.items;
+    for (usize i = begin; i < end; ++i) {
+        const u8* record = import->face_data + i * stride + list_offset;
+        if (ply_read_binary(record, list->count_type, swap) != 3.0) {
+            import->failed[index] = true;
+            return;
+        }
+        for (u32 k = 0; k < 3; ++k) {
+            f64 v = ply_read_binary(
+                record + count_size + k * index_size, list->type, swap
+            );
+            if (v < 0.0 || v >= (f64)vertex_count) {
+                import->failed[index] = true;
+                return;
+            }
+            out[i * 3 + k] = (u32)v;
+        }
+    }
+}
+
+static ReturnStatus ply_parse_binary_faces(PlyImport* import) {
+    const PlyElement* element = import->face_element;
+    bool swap = import->header->format == PLY_FORMAT_BINARY_BE;
+    usize vertex_count = import->mesh->vertices.count;
+    const u8* p = import->face_data;
+    const u8* end = p + import->face_data_size;
+
+    IndexArray* indices = &import->mesh->indices;
+    indices->count = 0;
+    for (usize i = 0; i < element->count; ++i) {
+        for (u32 j = 0; j < element->property_count; ++j) {
+            const PlyProperty* property = &element->properties[j];
+            u32 size = PlyType_size(property->type);
+            if (property->count_type == PLY_TYPE_NONE) {
+                p += size;
+                continue;
+            }
+            u32 count_size = PlyType_size(property->count_type);
+            if (p + count_size > end) return RETURN_FAILURE;
+            u32 n = (u32)ply_read_binary(p, property->count_type, swap);
+            p += count_size;
+            if (p + (usize)n * size > end) return RETURN_FAILURE;
+            if (property->target == PLY_TARGET_INDICES) {
+                u32 first = 0, previous = 0;
+                for (u32 k = 0; k < n; ++k) {
+                    f64 v = ply_read_binary(p + k * size, property->type, swap);
+                    if (v < 0.0 || v >= (f64)vertex_count) {
+                        return RETURN_FAILURE;
+                    }
+                    if (k == 0) {
+                        first = (u32)v;
+                    } else if (k >= 2) {
+                        u32 triangle[3] = {first, previous, (u32)v};
+                        IndexArray_push_many(indices, triangle, 3);
+                    }
+                    previous = (u32)v;
+                }
+            }
+            p += (usize)n * size;
+        }
+        if (p > end) return RETURN_FAILURE;
+    }
+    return RETURN_SUCCESS;
+}
+
+static void ply_parse_ascii_chunk(void* ctx, u32 index, u32 count) {
+    (void)count;
+    PlyImport* import = (PlyImport*)ctx;
+    const PlyElement* vertex_element = import->vertex_element;
+    const PlyElement* face_element = import->face_element;
+    usize vertex_count = vertex_element->count;
+    usize line = import->first_line[index];
+    const char* p = import->chunks[index].begin;
+    const char* end = import->chunks[index].end;
+    IndexArray* indices = &import->chunk_indices[index];
+
+    while (p < end) {
+        const char* line_end = next_line(p, end);
+        if (line >= import->vertex_line &&
+            line - import->vertex_line < vertex_count) {
+            Vertex* vertex =
+                &import->mesh->vertices.items[line - import->vertex_line];
+            for (u32 j = 0; j < vertex_element->property_count; ++j) {
+                const PlyProperty* property = &vertex_element->properties[j];
+                f32 value = 0.0f;
+                p = parse_f32(skip_space(p, line_end), line_end, &value);
+                if (p == NULL) {
+                    import->failed[index] = true;
+                    return;
+                }
+                ply_store_property(vertex, property, value);
+            }
+        } else if (face_element != NULL && line >= import->face_line &&
+                   line - import->face_line < face_element->count) {
+            for (u32 j = 0; j < face_element->property_count; ++j) {
+                const PlyProperty* property = &face_element->properties[j];
+                i64 n = 1;
+                if (property->count_type != PLY_TYPE_NONE) {
+                    p = parse_i64(skip_space(p, line_end), line_end, &n);
+                    if (p == NULL || n < 0) {
+                        import->failed[index] = true;
+                        return;
+                    }
+                }
+                u32 first = 0, previous = 0;
+                for (i64 k = 0; k < n; ++k) {
+                    p = skip_space(p, line_end);
+                    if (property->target != PLY_TARGET_INDICES) {
+                        f32 ignored = 0.0f;
+                        p = parse_f32(p, line_end, &ignored);
+                        if (p == NULL) {
+                            import->failed[index] = true;
+                            return;
+                        }
+                        continue;
+                    }
+                    // Parsed as integers, f32 loses indices above 2^24
+                    i64 value = 0;
+                    p = parse_i64(p, line_end, &value);
+                    if (p == NULL || value < 0 || (u64)value >= vertex_count) {
+                        import->failed[index] = true;
+                        return;
+                    }
+                    if (k == 0) {
+                        first = (u32)value;
+                    } else if (k >= 2) {
+                        u32 triangle[3] = {first, previous, (u32)value};
+                        IndexArray_push_many(indices, triangle, 3);
+                    }
+                    previous = (u32)value;
+                }
+            }
+        }
+        p = line_end;
+        ++line;
+    }
+}
+
+static void count_lines(void* ctx, u32 index, u32 count) {
+    (void)count;
+    PlyImport* import = (PlyImport*)ctx;
+    const char* p = import->chunks[index].begin;
+    const char* end = import->chunks[index].end;
+    usize lines = 0;
+    while ((p = memchr(p, '\n', end - p)) != NULL) {
+        ++lines;
+        ++p;
+    }
+    // Stored shifted by one so that the prefix sum can run in place
+    import->first_line[index] = lines;
+}
+
+ReturnStatus Mesh_import_ply(
+    Mesh* mesh, const MappedFile* file, const MeshImportOptions* options
+) {
+    PlyHeader header;
+    if (PlyHeader_parse(&header, file) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    PlyImport* import = RAIJIN_REALLOC(NULL, sizeof(PlyImport));
+    RAIJIN_ASSERT(import != NULL && "Mesh_import_ply: Out of memory");
+    memset(import, 0, sizeof(*import));
+    import->header = &header;
+    import->options = options;
+    import->mesh = mesh;
+
+    bool has_normals = false;
+    for (u32 i = 0; i < header.element_count; ++i) {
+        const PlyElement* element = &header.elements[i];
+        if (strcmp(element->name, "vertex") == 0) {
+            import->vertex_element = element;
+            for (u32 j = 0; j < element->property_count; ++j) {
+                PlyTarget target = element->properties[j].target;
+                if (target >= PLY_TARGET_NX && target <= PLY_TARGET_NZ) {
+                    has_normals = true;
+                }
+            }
+        } else if (strcmp(element->name, "face") == 0) {
+            import->face_element = element;
+        }
+    }
+
+    ReturnStatus status = RETURN_SUCCESS;
+    const PlyElement* vertex_element = import->vertex_element;
+    const PlyElement* face_element = import->face_element;
+    if (vertex_element == NULL || !vertex_element->fixed_size) {
+        LOG_ERROR("PLY file has no usable vertex element");
+        status = RETURN_FAILURE;
+    }
+    if (face_element != NULL) {
+        bool has_indices = false;
+        for (u32 j = 0; j < face_element->property_count; ++j) {
+            const PlyProperty* property = &face_element->properties[j];
+            if (property->target == PLY_TARGET_INDICES &&
+                property->count_type != PLY_TYPE_NONE) {
+                has_indices = true;
+            }
+        }
+        if (!has_indices) face_element = import->face_element = NULL;
+    }
+
+    // Vertices start out with the default color and no normal; whatever the
+    // file provides overwrites them.
+    if (status == RETURN_SUCCESS) {
+        Vertex vertex = {0};
+        glm_vec3_copy((f32*)options->color, vertex.color);
+        VertexArray_reserve(&mesh->vertices, vertex_element->count);
+        mesh->vertices.count = vertex_element->count;
+        for (usize i = 0; i < vertex_element->count; ++i) {
+            mesh->vertices.items[i] = vertex;
+        }
+    }
+
+    u32 thread_count = import_thread_count(options);
+    if (status == RETURN_SUCCESS && header.format != PLY_FORMAT_ASCII) {
+        // Locate the vertex and face sections, skipping other fixed size
+        // elements in between
+        usize offset = header.body_offset;
+        for (u32 i = 0; i < header.element_count && status == RETURN_SUCCESS;
+             ++i) {
+            const PlyElement* element = &header.elements[i];
+            if (element == vertex_element) {
+                import->vertex_data = file->data + offset;
+            } else if (element == face_element) {
+                import->face_data = file->data + offset;
+                import->face_data_size = file->size - offset;
+                break;
+            }
+            if (!element->fixed_size) {
+                LOG_ERROR("Unsupported variable size PLY element before faces");
+                status = RETURN_FAILURE;
+            }
+            offset += element->count * element->stride;
+            if (offset > file->size) {
+                LOG_ERROR("Truncated PLY file");
+                status = RETURN_FAILURE;
+            }
+        }
+        if (status == RETURN_SUCCESS) {
+            parallel_for(
+                ply_parse_binary_vertices,
+                import,
+                task_count(thread_count, vertex_element->count)
+            );
+        }
+        if (status == RETURN_SUCCESS && face_element != NULL) {
+            u32 stride = 0;
+            bool triangle_stride = true;
+            for (u32 j = 0; j < face_element->property_count; ++j) {
+                const PlyProperty* property = &face_element->properties[j];
+                if (property->target == PLY_TARGET_INDICES) {
+                    stride += PlyType_size(property->count_type) +
+                              3 * PlyType_size(property->type);
+                } else if (property->count_type != PLY_TYPE_NONE) {
+                    triangle_stride = false;
+                } else {
+                    stride += PlyType_size(property->type);
+                }
+            }
+            bool parallel = triangle_stride &&
+                            face_element->count * stride <=
+                                import->face_data_size;
+            if (parallel) {
+                IndexArray_reserve(&mesh->indices, face_element->count * 3);
+                mesh->indices.count = face_element->count * 3;
+                u32 workers = task_count(thread_count, face_element->count);
+                parallel_for(ply_parse_binary_triangles, import, workers);
+                for (u32 i = 0; i < workers; ++i) {
+                    if (import->failed[i]) parallel = false;
+                }
+            }
+            if (!parallel) status = ply_parse_binary_faces(import);
+            if (status != RETURN_SUCCESS) {
+                LOG_ERROR("Malformed PLY faces");
+            }
+        }
+        if (status == RETURN_SUCCESS && import->vertex_data == NULL) {
+            LOG_ERROR("Unsupported PLY element order");
+            status = RETURN_FAILURE;
+        }
+    } else if (status == RETURN_SUCCESS) {
+        usize line = 0;
+        for (u32 i = 0; i < header.element_count; ++i) {
+            const PlyElement* element = &header.elements[i];
+            if (element == vertex_element) import->vertex_line = line;
+            if (element == face_element) import->face_line = line;
+            line += element->count;
+        }
+        const char* begin = (const char*)file->data + header.body_offset;
+        const char* end = (const char*)file->data + file->size;
+        u32 chunk_count = split_lines(begin, end, thread_count, import->chunks);
+        parallel_for(count_lines, import, chunk_count);
+        line = 0;
+        for (u32 i = 0; i < chunk_count; ++i) {
+            usize lines = import->first_line[i];
+            import->first_line[i] = line;
+            line += lines;
+        }
+        parallel_for(ply_parse_ascii_chunk, import, chunk_count);
+        usize index_count = 0;
+        for (u32 i = 0; i < chunk_count; ++i) {
+            if (import->failed[i]) status = RETURN_FAILURE;
+            index_count += import->chunk_indices[i].count;
+        }
+        if (status != RETURN_SUCCESS) {
+            LOG_ERROR("Malformed ASCII PLY data");
+        }
+        IndexArray_reserve(&mesh->indices, index_count);
+        for (u32 i = 0; i < chunk_count; ++i) {
+            IndexArray* indices = &import->chunk_indices[i];
+            if (indices->count > 0) {
+                IndexArray_push_many(
+                    &mesh->indices, indices->items, indices->count
+                );
+            }
+            IndexArray_free(indices);
+        }
+    }
+
+    if (status == RETURN_SUCCESS && !has_normals) {
+        Mesh_compute_normals(mesh);
+    }
+    RAIJIN_FREE(import);
+    return status;
+}
+
+/* STL */
+
+#define STL_HEADER_SIZE 84
+#define STL_TRIANGLE_SIZE 50
+
+typedef struct StlImport {
+    const u8* triangles;
+    usize triangle_count;
+    const MeshImportOptions* options;
+    VertexArray soup;
+} StlImport;
+
+// Facet normals are dropped: welding by position alone shares vertices between
+// neighbouring facets, and smooth normals are rebuilt afterwards.  Scanned
+// meshes would otherwise keep three unique vertices per triangle.
+static void stl_parse_triangles(void* ctx, u32 index, u32 count) {
+    StlImport* import = (StlImport*)ctx;
+    usize begin = import->triangle_count * index / count;
+    usize end = import->triangle_count * (index + 1) / count;
+    Vertex* out = import->soup.items;
+    for (usize i = begin; i < end; ++i) {
+        const u8* record = import->triangles + i * STL_TRIANGLE_SIZE;
+        for (u32 k = 0; k < 3; ++k) {
+            Vertex* vertex = &out[i * 3 + k];
+            // Skip the 12 byte facet normal
+            memcpy(vertex->position, record + 12 + k * 12, sizeof(vec3));
+            glm_vec3_copy((f32*)import->options->color, vertex->color);
+            glm_vec3_zero(vertex->normal);
+        }
+    }
+}
+
+ReturnStatus Mesh_import_stl(
+    Mesh* mesh, const MappedFile* file, const MeshImportOptions* options
+) {
+    if (file->size < STL_HEADER_SIZE) {
+        LOG_ERROR("Truncated STL file");
+        return RETURN_FAILURE;
+    }
+    u32 triangle_count;
+    memcpy(&triangle_count, file->data + 80, sizeof(triangle_count));
+    usize expected_size =
+        STL_HEADER_SIZE + (usize)triangle_count * STL_TRIANGLE_SIZE;
+    if (file->size != expected_size) {
+        if (memcmp(file->data, "solid", 5) == 0) {
+            LOG_ERROR("ASCII STL files are not supported");
+        } else {
+            LOG_ERROR("STL size does not match its triangle count");
+        }
+        return RETURN_FAILURE;
+    }
+
+    StlImport import = {
+        .triangles = file->data + STL_HEADER_SIZE,
+        .triangle_count = triangle_count,
+        .options = options,
+    };
+    VertexArray_reserve(&import.soup, (usize)triangle_count * 3);
+    import.soup.count = (usize)triangle_count * 3;
+    parallel_for(
+        stl_parse_triangles,
+        &import,
+        task_count(import_thread_count(options), triangle_count)
+    );
+    Mesh_weld_vertices(mesh, &import.soup, options);
+    VertexArray_free(&import.soup);
+    Mesh_compute_normals(mesh);
+    return RETURN_SUCCESS;
+}
+
+/* Welding */
+
+typedef struct WeldContext {
+    const WeldSource* source;
+    u32* hashes;
+    u32* remap;
+    U32Array representatives[MAX_WORKER_THREADS];
+    usize bases[MAX_WORKER_THREADS];
+    u32* unique;
+    u32* indices;
+} WeldContext;
+
+typedef struct WeldSlot {
+    u32 hash;
+    u32 local;
+} WeldSlot;
+
+static void weld_hash(void* ctx_ptr, u32 index, u32 count) {
+    WeldContext* ctx = (WeldContext*)ctx_ptr;
+    const WeldSource* source = ctx->source;
+    usize begin = source->count * index / count;
+    usize end = source->count * (index + 1) / count;
+    for (usize i = begin; i < end; ++i) {
+        ctx->hashes[i] = source->hash(source->user, i);
+    }
+}
+
+static inline u32 weld_partition(u32 hash, u32 count) { return hash % count; }
+
+// Each worker owns the elements whose hash falls in its partition, so the
+// hash tables never need locking.  Slots keep the full hash so that most
+// mismatches are rejected without touching the source data.
+static void weld_partition_task(void* ctx_ptr, u32 index, u32 count) {
+    WeldContext* ctx = (WeldContext*)ctx_ptr;
+    const WeldSource* source = ctx->source;
+    U32Array* representatives = &ctx->representatives[index];
+    usize capacity = 1024;
+    WeldSlot* table = RAIJIN_REALLOC(NULL, capacity * sizeof(WeldSlot));
+    RAIJIN_ASSERT(table != NULL && "weld: Out of memory");
+    memset(table, 0xFF, capacity * sizeof(WeldSlot));
+
+    for (usize i = 0; i < source->count; ++i) {
+        u32 hash = ctx->hashes[i];
+        if (weld_partition(hash, count) != index) continue;
+
+        usize slot = (hash / count) & (capacity - 1);
+        for (;;) {
+            WeldSlot entry = table[slot];
+            if (entry.local == UINT32_MAX) {
+                u32 local = (u32)representatives->count;
+                U32Array_push(representatives, (u32)i);
+                table[slot] = (WeldSlot){hash, local};
+                ctx->remap[i] = local;
+                break;
+            }
+            if (entry.hash == hash &&
+                source->equal(
+                    source->user, representatives->items[entry.local], i
+                )) {
+                ctx->remap[i] = entry.local;
+                break;
+            }
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        // Keep the load factor under one half
+        if (representatives->count * 2 > capacity) {
+            usize new_capacity = capacity * 2;
+            WeldSlot* new_table =
+                RAIJIN_REALLOC(NULL, new_capacity * sizeof(WeldSlot));
+            RAIJIN_ASSERT(new_table != NULL && "weld: Out of memory");
+            memset(new_table, 0xFF, new_capacity * sizeof(WeldSlot));
+            for (usize j = 0; j < capacity; ++j) {
+                if (table[j].local == UINT32_MAX) continue;
+                usize s = (table[j].hash / count) & (new_capacity - 1);
+                while (new_table[s].local != UINT32_MAX) {
+                    s = (s + 1) & (new_capacity - 1);
+                }
+                new_table[s] = table[j];
+            }
+            RAIJIN_FREE(table);
+            table = new_table;
+            capacity = new_capacity;
+        }
+    }
+    RAIJIN_FREE(table);
+}
+
+static void weld_scatter(void* ctx_ptr, u32 index, u32 count) {
+    WeldContext* ctx = (WeldContext*)ctx_ptr;
+    const U32Array* representatives = &ctx->representatives[index];
+    if (representatives->count > 0) {
+        memcpy(
+            ctx->unique + ctx->bases[index],
+            representatives->items,
+            representatives->count * sizeof(u32)
+        );
+    }
+    usize begin = ctx->source->count * index / count;
+    usize end = ctx->source->count * (index + 1) / count;
+    for (usize i = begin; i < end; ++i) {
+        u32 partition = weld_partition(ctx->hashes[i], count);
+        ctx->indices[i] = (u32)ctx->bases[partition] + ctx->remap[i];
+    }
+}
+
+/** Deduplicate the elements of `source`
+ *
+ * Elements are hashed in parallel, then every worker deduplicates the hash
+ * partition it owns.  Unique elements are numbered by first use so that
+ * vertex fetches of the resulting mesh stay local.
+ *
+ * @param[in] source        Elements to deduplicate
+ * @param[in] thread_count  Maximum number of workers
+ * @param[out] indices      Unique element number of every source element
+ * @param[out] first        Source index of every unique element
+ */
+static void weld(
+    const WeldSource* source,
+    u32 thread_count,
+    IndexArray* indices,
+    U32Array* first
+) {
+    indices->count = 0;
+    first->count = 0;
+    if (source->count == 0) return;
+
+    WeldContext* ctx = RAIJIN_REALLOC(NULL, sizeof(WeldContext));
+    RAIJIN_ASSERT(ctx != NULL && "weld: Out of memory");
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->source = source;
+    ctx->hashes = RAIJIN_REALLOC(NULL, source->count * sizeof(u32));
+    ctx->remap = RAIJIN_REALLOC(NULL, source->count * sizeof(u32));
+    RAIJIN_ASSERT(
+        ctx->hashes != NULL && ctx->remap != NULL && "weld: Out of memory"
+    );
+
+    u32 count = task_count(thread_count, source->count);
+    parallel_for(weld_hash, ctx, count);
+    parallel_for(weld_partition_task, ctx, count);
+
+    usize unique_count = 0;
+    for (u32 i = 0; i < count; ++i) {
+        ctx->bases[i] = unique_count;
+        unique_count += ctx->representatives[i].count;
+    }
+    ctx->unique = RAIJIN_REALLOC(NULL, unique_count * sizeof(u32));
+    RAIJIN_ASSERT(ctx->unique != NULL && "weld: Out of memory");
+    IndexArray_reserve(indices, source->count);
+    indices->count = source->count;
+    ctx->indices = indices->items;
+    parallel_for(weld_scatter, ctx, count);
+
+    // Renumber by first use, reusing `remap` as the old-to-new table
+    u32* order = ctx->remap;
+    memset(order, 0xFF, unique_count * sizeof(u32));
+    U32Array_reserve(first, unique_count);
+    u32 next = 0;
+    for (usize i = 0; i < indices->count; ++i) {
+        u32 old = indices->items[i];
+        if (order[old] == UINT32_MAX) {
+            order[old] = next;
+            first->items[next++] = ctx->unique[old];
+        }
+        indices->items[i] = order[old];
+    }
+    first->count = next;
+
+    for (u32 i = 0; i < count; ++i) U32Array_free(&ctx->representatives[i]);
+    RAIJIN_FREE(ctx->unique);
+    RAIJIN_FREE(ctx->hashes);
+    RAIJIN_FREE(ctx->remap);
+    RAIJIN_FREE(ctx);
+}
+
+typedef struct SoupWeld {
+    const Vertex* soup;
+    f32 inverse_epsilon;
+} SoupWeld;
+
+static inline void soup_weld_key(
+    const SoupWeld* weld, const Vertex* v, u32 key[9]
+) {
+    const f32* values = (const f32*)v;
+    for (u32 i = 0; i < 9; ++i) {
+        f32 value = values[i];
+        // Only positions snap to the grid, normals and colors must match
+        if (i < 3 && weld->inverse_epsilon > 0.0f) {
+            value = floorf(value * weld->inverse_epsilon + 0.5f);
+        }
+        // Fold negative zero onto zero
+        if (value == 0.0f) value = 0.0f;
+        memcpy(&key[i], &value, sizeof(u32));
+    }
+}
+
+static u32 soup_hash(const void* user, usize i) {
+    const SoupWeld* weld = (const SoupWeld*)user;
+    u32 key[9];
+    soup_weld_key(weld, &weld->soup[i], key);
+    u64 h = 0;
+    for (u32 k = 0; k < 9; ++k) h = mix_u64(h ^ key[k]);
+    return (u32)h;
+}
+
+static bool soup_equal(const void* user, usize a, usize b) {
+    const SoupWeld* weld = (const SoupWeld*)user;
+    u32 key_a[9], key_b[9];
+    soup_weld_key(weld, &weld->soup[a], key_a);
+    soup_weld_key(weld, &weld->soup[b], key_b);
+    return memcmp(key_a, key_b, sizeof(key_a)) == 0;
+}
+
+/** Merge identical vertices of a triangle soup into an indexed mesh
+ *
+ * @param[in,out] mesh      Receives the welded vertices and indices
+ * @param[in] soup          Three vertices per triangle
+ * @param[in] options       Weld epsilon and thread count
+ */
+void Mesh_weld_vertices(
+    Mesh* mesh, const VertexArray* soup, const MeshImportOptions* options
+) {
+    SoupWeld soup_weld = {
+        .soup = soup->items,
+        .inverse_epsilon =
+            options->weld_epsilon > 0.0f ? 1.0f / options->weld_epsilon : 0.0f,
+    };
+    WeldSource source = {
+        .count = soup->count,
+        .user = &soup_weld,
+        .hash = soup_hash,
+        .equal = soup_equal,
+    };
+    U32Array first = {0};
+    weld(&source, import_thread_count(options), &mesh->indices, &first);
+    VertexArray_reserve(&mesh->vertices, first.count);
+    mesh->vertices.count = first.count;
+    for (usize i = 0; i < first.count; ++i) {
+        mesh->vertices.items[i] = soup->items[first.items[i]];
+    }
+    U32Array_free(&first);
+}
+
+/** Replace vertex normals with area weighted face normals */
+void Mesh_compute_normals(Mesh* mesh) {
+    for (usize i = 0; i < mesh->vertices.count; ++i) {
+        glm_vec3_zero(mesh->vertices.items[i].normal);
+    }
+    for (usize i = 0; i + 2 < mesh->indices.count; i += 3) {
+        Vertex* a = &mesh->vertices.items[mesh->indices.items[i]];
+        Vertex* b = &mesh->vertices.items[mesh->indices.items[i + 1]];
+        Vertex* c = &mesh->vertices.items[mesh->indices.items[i + 2]];
+        vec3 ab, ac, normal;
+        glm_vec3_sub(b->position, a->position, ab);
+        glm_vec3_sub(c->position, a->position, ac);
+        // Unnormalized cross product weights by triangle area
+        glm_vec3_cross(ab, ac, normal);
+        glm_vec3_add(a->normal, normal, a->normal);
+        glm_vec3_add(b->normal, normal, b->normal);
+        glm_vec3_add(c->normal, normal, c->normal);
+    }
+    for (usize i = 0; i < mesh->vertices.count; ++i) {
+        glm_vec3_normalize(mesh->vertices.items[i].normal);
+    }
+}
+
+/* Edges */
+
+typedef struct EdgeEntry {
+    u32 other;
+    u32 triangle;
+} EdgeEntry;
+
+typedef struct EdgeContext {
+    const Mesh* mesh;
+    const u32* corners;
+    const u32* first;
+    usize corner_count;
+    f32* normals;
+    u32* offsets;
+    EdgeEntry* entries;
+    f32 cos_threshold;
+    IndexArray edges[MAX_WORKER_THREADS];
+} EdgeContext;
+
+static u32 position_hash(const void* user, usize i) {
+    const f32* position = ((const Mesh*)user)->vertices.items[i].position;
+    u32 bits[3];
+    for (u32 k = 0; k < 3; ++k) {
+        f32 value = position[k] == 0.0f ? 0.0f : position[k];
+        memcpy(&bits[k], &value, sizeof(u32));
+    }
+    return (u32)mix_u64(((u64)bits[0] << 32 | bits[1]) ^ mix_u64(bits[2]));
+}
+
+static bool position_equal(const void* user, usize a, usize b) {
+    const Vertex* vertices = ((const Mesh*)user)->vertices.items;
+    return glm_vec3_eqv(
+        (f32*)vertices[a].position, (f32*)vertices[b].position
+    );
+}
+
+static void edge_face_normals(void* ctx_ptr, u32 index, u32 count) {
+    EdgeContext* ctx = (EdgeContext*)ctx_ptr;
+    const Vertex* vertices = ctx->mesh->vertices.items;
+    const u32* indices = ctx->mesh->indices.items;
+    usize triangle_count = ctx->mesh->indices.count / 3;
+    usize begin = triangle_count * index / count;
+    usize end = triangle_count * (index + 1) / count;
+    for (usize t = begin; t < end; ++t) {
+        face_normal(
+            vertices[indices[t * 3]].position,
+            vertices[indices[t * 3 + 1]].position,
+            vertices[indices[t * 3 + 2]].position,
+            &ctx->normals[t * 3]
+        );
+    }
+}
+
+// Every corner owns the edges towards corners with a larger id.  Entries
+// sharing the other corner belong to faces meeting at that edge.
+static void edge_classify(void* ctx_ptr, u32 index, u32 count) {
+    EdgeContext* ctx = (EdgeContext*)ctx_ptr;
+    IndexArray* edges = &ctx->edges[index];
+    usize begin = ctx->corner_count * index / count;
+    usize end = ctx->corner_count * (index + 1) / count;
+    for (usize a = begin; a < end; ++a) {
+        EdgeEntry* list = ctx->entries + ctx->offsets[a];
+        u32 n = ctx->offsets[a + 1] - ctx->offsets[a];
+        for (u32 i = 0; i < n; ++i) {
+            if (list[i].other == UINT32_MAX) continue;
+            const f32* normal = &ctx->normals[list[i].triangle * 3];
+            u32 faces = 1;
+            bool crease = false;
+            for (u32 j = i + 1; j < n; ++j) {
+                if (list[j].other != list[i].other) continue;
+                f32 cos_angle = glm_vec3_dot(
+                    (f32*)normal, &ctx->normals[list[j].triangle * 3]
+                );
+                crease |= cos_angle < ctx->cos_threshold;
+                list[j].other = UINT32_MAX;
+                ++faces;
+            }
+            if (faces == 1 || crease) {
+                u32 edge[2] = {ctx->first[a], ctx->first[list[i].other]};
+                IndexArray_push_many(edges, edge, 2);
+            }
+        }
+    }
+}
+
+/** Fill `edge_indices` with boundary edges and edges sharper than a threshold
+ *
+ * Vertices split only by their normal or color are treated as one corner, so
+ * flat shaded meshes produce the same outlines as smooth ones.
+ *
+ * @param[in,out] mesh      Mesh with vertices and triangle indices
+ * @param[in] options       Edge angle in degrees, shared edges between faces
+ *                          bending less than this are skipped
+ */
+void Mesh_compute_edges(Mesh* mesh, const MeshImportOptions* options) {
+    mesh->edge_indices.count = 0;
+    usize triangle_count = mesh->indices.count / 3;
+    if (triangle_count == 0) return;
+    u32 thread_count = import_thread_count(options);
+
+    // Position-only weld so that edges are matched by location
+    WeldSource source = {
+        .count = mesh->vertices.count,
+        .user = mesh,
+        .hash = position_hash,
+        .equal = position_equal,
+    };
+    IndexArray corners = {0};
+    U32Array first = {0};
+    weld(&source, thread_count, &corners, &first);
+
+    EdgeContext* ctx = RAIJIN_REALLOC(NULL, sizeof(EdgeContext));
+    RAIJIN_ASSERT(ctx != NULL && "edges: Out of memory");
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->mesh = mesh;
+    ctx->corners = corners.items;
+    ctx->first = first.items;
+    ctx->corner_count = first.count;
+    ctx->cos_threshold = cosf(glm_rad(options->edge_angle));
+    ctx->normals = RAIJIN_REALLOC(NULL, triangle_count * sizeof(vec3));
+    ctx->offsets = RAIJIN_REALLOC(NULL, (first.count + 1) * sizeof(u32));
+    RAIJIN_ASSERT(
+        ctx->normals != NULL && ctx->offsets != NULL && "edges: Out of memory"
+    );
+    parallel_for(
+        edge_face_normals, ctx, task_count(thread_count, triangle_count)
+    );
+
+    // Bucket every triangle edge under its smaller corner (CSR layout)
+    const u32* indices = mesh->indices.items;
+    memset(ctx->offsets, 0, (first.count + 1) * sizeof(u32));
+    for (usize i = 0; i < triangle_count * 3; ++i) {
+        u32 a = corners.items[indices[i]];
+        u32 b = corners.items[indices[i - i % 3 + (i + 1) % 3]];
+        if (a != b) ++ctx->offsets[(a < b ? a : b) + 1];
+    }
+    for (usize i = 0; i < first.count; ++i) {
+        ctx->offsets[i + 1] += ctx->offsets[i];
+    }
+    ctx->entries = RAIJIN_REALLOC(
+        NULL, (ctx->offsets[first.count] + 1) * sizeof(EdgeEntry)
+    );
+    RAIJIN_ASSERT(ctx->entries != NULL && "edges: Out of memory");
+    for (usize i = 0; i < triangle_count * 3; ++i) {
+        u32 a = corners.items[indices[i]];
+        u32 b = corners.items[indices[i - i % 3 + (i + 1) % 3]];
+        if (a == b) continue;
+        u32 low = a < b ? a : b;
+        // Offsets temporarily serve as fill cursors and are restored below
+        ctx->entries[ctx->offsets[low]++] =
+            (EdgeEntry){a < b ? b : a, (u32)(i / 3)};
+    }
+    for (usize i = first.count; i > 0; --i) {
+        ctx->offsets[i] = ctx->offsets[i - 1];
+    }
+    ctx->offsets[0] = 0;
+
+    u32 count = task_count(thread_count, first.count);
+    parallel_for(edge_classify, ctx, count);
+    for (u32 i = 0; i < count; ++i) {
+        IndexArray* edges = &ctx->edges[i];
+        if (edges->count > 0) {
+            IndexArray_push_many(
+                &mesh->edge_indices, edges->items, edges->count
+            );
+        }
+        IndexArray_free(edges);
+    }
+
+    RAIJIN_FREE(ctx->entries);
+    RAIJIN_FREE(ctx->offsets);
+    RAIJIN_FREE(ctx->normals);
+    RAIJIN_FREE(ctx);
+    IndexArray_free(&corners);
+    U32Array_free(&first);
+}
+
+typedef struct EdgeFlagContext {
+    const Mesh* mesh;
+    const u32* corners;
+    const u32* offsets;
+    const u32* others;
+    u32* flags;
+} EdgeFlagContext;
+
+static void edge_flag_triangles(void* ctx_ptr, u32 index, u32 count) {
+    EdgeFlagContext* ctx = (EdgeFlagContext*)ctx_ptr;
+    const u32* indices = ctx->mesh->indices.items;
+    // Whole words per task, four triangles share one
+    usize word_count = (ctx->mesh->indices.count / 3 + 3) / 4;
+    usize begin = word_count * index / count * 4;
+    usize end = word_count * (index + 1) / count * 4;
+    usize triangle_count = ctx->mesh->indices.count / 3;
+    if (end > triangle_count) end = triangle_count;
+    for (usize t = begin; t < end; ++t) {
+        u32 mask = 0;
+        for (u32 k = 0; k < 3; ++k) {
+            u32 a = ctx->corners[indices[t * 3 + k]];
+            u32 b = ctx->corners[indices[t * 3 + (k + 1) % 3]];
+            u32 low = a < b ? a : b;
+            u32 high = a < b ? b : a;
+            for (u32 e = ctx->offsets[low]; e < ctx->offsets[low + 1]; ++e) {
+                if (ctx->others[e] == high) {
+                    mask |= 1u << k;
+                    break;
+                }
+            }
+        }
+        ctx->flags[t / 4] |= mask << (t % 4 * 8);
+    }
+}
+
+/** Mark which triangle sides lie on an outline edge
+ *
+ * Bit k of a triangle's byte is set when its side from corner k to corner
+ * k + 1 is one of `edge_indices`, matched by position.  Four triangles are
+ * packed into each word of `edge_flags`, for edge modes that draw outlines
+ * from the triangles themselves.
+ *
+ * @param[in,out] mesh      Mesh with indices and edge indices
+ * @param[in] options       Import options, NULL for the defaults
+ */
+void Mesh_compute_edge_flags(Mesh* mesh, const MeshImportOptions* options) {
+    MeshImportOptions defaults = MeshImportOptions_default();
+    if (options == NULL) options = &defaults;
+    usize triangle_count = mesh->indices.count / 3;
+    usize word_count = (triangle_count + 3) / 4;
+    mesh->edge_flags.count = 0;
+    U32Array_reserve(&mesh->edge_flags, word_count);
+    memset(mesh->edge_flags.items, 0, word_count * sizeof(u32));
+    mesh->edge_flags.count = word_count;
+    if (triangle_count == 0 || mesh->edge_indices.count == 0) return;
+    u32 thread_count = import_thread_count(options);
+
+    WeldSource source = {
+        .count = mesh->vertices.count,
+        .user = mesh,
+        .hash = position_hash,
+        .equal = position_equal,
+    };
+    IndexArray corners = {0};
+    U32Array first = {0};
+    weld(&source, thread_count, &corners, &first);
+
+    // Outline edges bucketed under their smaller corner (CSR layout)
+    usize edge_count = mesh->edge_indices.count / 2;
+    u32* offsets = RAIJIN_REALLOC(NULL, (first.count + 1) * sizeof(u32));
+    u32* others = RAIJIN_REALLOC(NULL, (edge_count + 1) * sizeof(u32));
+    RAIJIN_ASSERT(
+        offsets != NULL && others != NULL && "edge flags: Out of memory"
+    );
+    memset(offsets, 0, (first.count + 1) * sizeof(u32));
+    for (usize i = 0; i < edge_count; ++i) {
+        u32 a = corners.items[mesh->edge_indices.items[i * 2]];
+        u32 b = corners.items[mesh->edge_indices.items[i * 2 + 1]];
+        ++offsets[(a < b ? a : b) + 1];
+    }
+    for (usize i = 0; i < first.count; ++i) offsets[i + 1] += offsets[i];
+    for (usize i = 0; i < edge_count; ++i) {
+        u32 a = corners.items[mesh->edge_indices.items[i * 2]];
+        u32 b = corners.items[mesh->edge_indices.items[i * 2 + 1]];
+        others[offsets[a < b ? a : b]++] = a < b ? b : a;
+    }
+    for (usize i = first.count; i > 0; --i) offsets[i] = offsets[i - 1];
+    offsets[0] = 0;
+
+    EdgeFlagContext ctx = {
+        .mesh = mesh,
+        .corners = corners.items,
+        .offsets = offsets,
+        .others = others,
+        .flags = mesh->edge_flags.items,
+    };
+    parallel_for(
+        edge_flag_triangles, &ctx, task_count(thread_count, triangle_count)
+    );
+
+    RAIJIN_FREE(offsets);
+    RAIJIN_FREE(others);
+    IndexArray_free(&corners);
+    U32Array_free(&first);
+}
+
+#endif /* MESH_IMPORT_H */
@@ -0,0 +1,678 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include "core.h"
+#include "webgpu.h"
+#include "wgpu.h"
+
+// Registry of shader modules, layouts and render pipelines keyed by a hash of
+// their descriptors.  Requesting an object whose descriptor was seen before
+// returns the existing object instead of compiling it again.
+//
+// Keys only depend on descriptor contents: modules are keyed by their source,
+// and modules or layouts referenced by another descriptor contribute their own
+// key rather than their handle.  The same pipeline therefore has the same key
+// in every run.  Labels do not take part.
+//
+// The cache owns every object it returns, callers must not release them.
+//
+// The keys of the pipelines a run actually drew with are persisted to disk
+// (`PipelineCache_save`).  The next run on the same adapter and driver loads
+// them as a warm list (`PipelineCache_load`) and, while `defer_cold` is set,
+// only compiles warm pipelines up front: other requests return NULL and are
+// compiled on first use.  The file holds keys only, no driver blobs, so a
+// stale file costs at most a late compile.
+//
+// Requests may come from several threads at once.  Lookups and inserts are
+// serialized, compiles run outside the lock; when two threads miss on the
+// same key the object compiled last is released and the first one returned.
+// The warm list and `defer_cold` are only written between compiles.
+//
+// Objects that fail validation are cached like any other.  A caller that
+// checks a batch of requests inside an error scope takes a checkpoint first
+// (`PipelineCache_checkpoint`) and, if the scope reports an error, evicts
+// everything created since (`PipelineCache_rollback`) so the same descriptors
+// are compiled and validated again on the next request.
+
+#define PIPELINE_CACHE_MAGIC 0x43505252u /* "RRPC" */
+#define PIPELINE_CACHE_VERSION 1
+
+/* Types */
+
+typedef enum {
+    PIPELINE_CACHE_SHADER_MODULE,
+    PIPELINE_CACHE_BIND_GROUP_LAYOUT,
+    PIPELINE_CACHE_PIPELINE_LAYOUT,
+    PIPELINE_CACHE_RENDER_PIPELINE,
+    PIPELINE_CACHE_KIND_COUNT,
+} PipelineCacheKind;
+
+typedef struct PipelineCacheEntry {
+    u64 key;
+    void* object;
+} PipelineCacheEntry;
+DEFINE_DYNAMIC_ARRAY(PipelineCacheEntry, PipelineCacheEntryArray)
+DEFINE_DYNAMIC_ARRAY(u64, U64Array)
+
+typedef struct PipelineCacheHeader {
+    u32 magic;
+    u32 version;
+    // Hash of the adapter and driver the keys were recorded on
+    u64 identity;
+    u32 key_count;
+    u32 reserved;
+} PipelineCacheHeader;
+
+typedef struct PipelineCache {
+    // Objects are only valid on the device that created them
+    WGPUDevice device;
+    // Guards the entries, used keys and counters
+    pthread_mutex_t lock;
+    bool lock_initialized;
+    PipelineCacheEntryArray entries[PIPELINE_CACHE_KIND_COUNT];
+    // Render pipeline keys loaded from disk, and the ones drawn with so far
+    U64Array warm_keys;
+    U64Array used_keys;
+    u64 identity;
+    // Skip compiling render pipelines missing from a non-empty `warm_keys`
+    bool defer_cold;
+    u32 hits;
+    u32 misses;
+    u32 deferred;
+} PipelineCache;
+
+// Entry count of each kind, entries are only ever appended
+typedef struct PipelineCacheCheckpoint {
+    usize counts[PIPELINE_CACHE_KIND_COUNT];
+} PipelineCacheCheckpoint;
+
+/* Function Prototypes */
+
+void PipelineCache_set_device(PipelineCache* cache, WGPUDevice device);
+void PipelineCache_destroy(PipelineCache* cache);
+u64 adapter_identity(WGPUAdapter adapter);
+ReturnStatus PipelineCache_load(
+    PipelineCache* cache, const char* path, u64 identity
+);
+ReturnStatus PipelineCache_save(const PipelineCache* cache, const char* path);
+void PipelineCache_mark_used(
+    PipelineCache* cache, WGPURenderPipeline pipeline
+);
+PipelineCacheCheckpoint PipelineCache_checkpoint(PipelineCache* cache);
+void PipelineCache_rollback(
+    PipelineCache* cache, const PipelineCacheCheckpoint* checkpoint
+);
+WGPUShaderModule PipelineCache_shader_module(
+    PipelineCache* cache, const char* label, const char* code, usize size
+);
+WGPUBindGroupLayout PipelineCache_bind_group_layout(
+    PipelineCache* cache, const WGPUBindGroupLayoutDescriptor* desc
+);
+WGPUPipelineLayout PipelineCache_pipeline_layout(
+    PipelineCache* cache, const WGPUPipelineLayoutDescriptor* desc
+);
+u64 PipelineCache_render_pipeline_key(
+    const PipelineCache* cache, const WGPURenderPipelineDescriptor* desc
+);
+WGPURenderPipeline PipelineCache_render_pipeline(
+    PipelineCache* cache, const WGPURenderPipelineDescriptor* desc
+);
+
+/* Functions */
+
+static inline u64 hash_combine(u64 h, u64 value) {
+    return mix_u64(h ^ mix_u64(value + 0x9E3779B97F4A7C15ull));
+}
+
+static inline u64 hash_string_view(u64 h, WGPUStringView view) {
+    if (view.data == NULL) return hash_combine(h, 0);
+    usize length = view.length == WGPU_STRLEN ? strlen(view.data)
+                                              : view.length;
+    return hash_bytes(view.data, length, h);
+}
+
+static inline u64 hash_f64(u64 h, f64 value) {
+    u64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return hash_combine(h, bits);
+}
+
+static bool U64Array_contains(const U64Array* arr, u64 value) {
+    for (usize i = 0; i < arr->count; ++i) {
+        if (arr->items[i] == value) return true;
+    }
+    return false;
+}
+
+static void* PipelineCache_find(
+    const PipelineCache* cache, PipelineCacheKind kind, u64 key
+) {
+    const PipelineCacheEntryArray* entries = &cache->entries[kind];
+    for (usize i = 0; i < entries->count; ++i) {
+        if (entries->items[i].key == key) return entries->items[i].object;
+    }
+    return NULL;
+}
+
+// Key of an object handed out by the cache, the handle itself for objects the
+// cache did not create
+static u64 PipelineCache_key_of(
+    const PipelineCache* cache, PipelineCacheKind kind, const void* object
+) {
+    const PipelineCacheEntryArray* entries = &cache->entries[kind];
+    for (usize i = 0; i < entries->count; ++i) {
+        if (entries->items[i].object == object) return entries->items[i].key;
+    }
+    return (u64)(uintptr_t)object;
+}
+
+static void PipelineCache_release(PipelineCacheKind kind, void* object) {
+    switch (kind) {
+        case PIPELINE_CACHE_SHADER_MODULE: {
+            wgpuShaderModuleRelease(object);
+        } break;
+        case PIPELINE_CACHE_BIND_GROUP_LAYOUT: {
+            wgpuBindGroupLayoutRelease(object);
+        } break;
+        case PIPELINE_CACHE_PIPELINE_LAYOUT: {
+            wgpuPipelineLayoutRelease(object);
+        } break;
+        case PIPELINE_CACHE_RENDER_PIPELINE: {
+            wgpuRenderPipelineRelease(object);
+        } break;
+        case PIPELINE_CACHE_KIND_COUNT: break;
+    }
+}
+
+static void PipelineCache_clear(PipelineCache* cache) {
+    for (u32 kind = 0; kind < PIPELINE_CACHE_KIND_COUNT; ++kind) {
+        PipelineCacheEntryArray* entries = &cache->entries[kind];
+        for (usize i = 0; i < entries->count; ++i) {
+            PipelineCache_release(kind, entries->items[i].object);
+        }
+        entries->count = 0;
+    }
+}
+
+typedef void* (*PipelineCacheCreate)(WGPUDevice device, const void* desc);
+
+static void* PipelineCache_create_shader_module(
+    WGPUDevice device, const void* desc
+) {
+    return wgpuDeviceCreateShaderModule(device, desc);
+}
+
+static void* PipelineCache_create_bind_group_layout(
+    WGPUDevice device, const void* desc
+) {
+    return wgpuDeviceCreateBindGroupLayout(device, desc);
+}
+
+static void* PipelineCache_create_pipeline_layout(
+    WGPUDevice device, const void* desc
+) {
+    return wgpuDeviceCreatePipelineLayout(device, desc);
+}
+
+static void* PipelineCache_create_render_pipeline(
+    WGPUDevice device, const void* desc
+) {
+    return wgpuDeviceCreateRenderPipeline(device, desc);
+}
+
+// Object stored under `key`, created from `desc` outside the lock on a miss
+static void* PipelineCache_get(
+    PipelineCache* cache,
+    PipelineCacheKind kind,
+    u64 key,
+    PipelineCacheCreate create,
+    const void* desc
+) {
+    pthread_mutex_lock(&cache->lock);
+    void* object = PipelineCache_find(cache, kind, key);
+    if (object != NULL) ++cache->hits;
+    pthread_mutex_unlock(&cache->lock);
+    if (object != NULL) return object;
+
+    void* created = create(cache->device, desc);
+    pthread_mutex_lock(&cache->lock);
+    // Another thread may have compiled the same object meanwhile
+    object = PipelineCache_find(cache, kind, key);
+    if (object != NULL) {
+        ++cache->hits;
+    } else if (created != NULL) {
+        PipelineCacheEntryArray_push(
+            &cache->entries[kind], (PipelineCacheEntry){key, created}
+        );
+        ++cache->misses;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    if (object != NULL) {
+        if (created != NULL) PipelineCache_release(kind, created);
+        return object;
+    }
+    return created;
+}
+
+/** Bind the cache to a device, dropping objects created on another one
+ *
+ * @param[in,out] cache     Pipeline cache
+ * @param[in] device        Device the cached objects are created on
+ */
+void PipelineCache_set_device(PipelineCache* cache, WGPUDevice device) {
+    if (!cache->lock_initialized) {
+        pthread_mutex_init(&cache->lock, NULL);
+        cache->lock_initialized = true;
+    }
+    if (cache->device != device) PipelineCache_clear(cache);
+    cache->device = device;
+}
+
+void PipelineCache_destroy(PipelineCache* cache) {
+    PipelineCache_clear(cache);
+    for (u32 kind = 0; kind < PIPELINE_CACHE_KIND_COUNT; ++kind) {
+        PipelineCacheEntryArray_free(&cache->entries[kind]);
+    }
+    U64Array_free(&cache->warm_keys);
+    U64Array_free(&cache->used_keys);
+    if (cache->lock_initialized) {
+        pthread_mutex_destroy(&cache->lock);
+        cache->lock_initialized = false;
+    }
+    cache->device = NULL;
+}
+
+/** Identity of an adapter and the driver and runtime behind it
+ *
+ * @param[in] adapter   Adapter
+ * @returns             Hash of the adapter info and the wgpu version
+ */
+u64 adapter_identity(WGPUAdapter adapter) {
+    WGPUAdapterInfo info = {0};
+    u64 h = hash_combine(PIPELINE_CACHE_VERSION, wgpuGetVersion());
+    if (wgpuAdapterGetInfo(adapter, &info) != WGPUStatus_Success) return h;
+    // The description carries the driver version on most backends
+    h = hash_string_view(h, info.vendor);
+    h = hash_string_view(h, info.architecture);
+    h = hash_string_view(h, info.device);
+    h = hash_string_view(h, info.description);
+    h = hash_combine(h, info.backendType);
+    h = hash_combine(h, info.adapterType);
+    h = hash_combine(h, info.vendorID);
+    h = hash_combine(h, info.deviceID);
+    wgpuAdapterInfoFreeMembers(info);
+    return h;
+}
+
+/** Load the warm pipeline keys recorded by a previous run
+ *
+ * A missing file, or one recorded on another adapter or driver, leaves the
+ * warm list empty so every pipeline is compiled up front.
+ *
+ * @param[in,out] cache     Pipeline cache
+ * @param[in] path          Cache file
+ * @param[in] identity      `adapter_identity` of the current adapter
+ * @returns                 Return status, failure when nothing was loaded
+ */
+ReturnStatus PipelineCache_load(
+    PipelineCache* cache, const char* path, u64 identity
+) {
+    cache->identity = identity;
+    cache->warm_keys.count = 0;
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        LOG_DEBUG("No pipeline cache at %s", path);
+        return RETURN_FAILURE;
+    }
+    long file_size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) file_size = ftell(f);
+    PipelineCacheHeader header = {0};
+    bool ok = file_size >= 0 && fseek(f, 0, SEEK_SET) == 0 &&
+              fread(&header, sizeof(header), 1, f) == 1 &&
+              header.magic == PIPELINE_CACHE_MAGIC &&
+              header.version == PIPELINE_CACHE_VERSION;
+    // The key count must account for the rest of the file exactly
+    ok = ok && (u64)file_size ==
+                   sizeof(header) + (u64)header.key_count * sizeof(u64);
+    if (ok && header.identity != identity) {
+        LOG_INFO("Pipeline cache %s is for another adapter or driver", path);
+        fclose(f);
+        return RETURN_FAILURE;
+    }
+    if (ok) {
+        U64Array_reserve(&cache->warm_keys, header.key_count);
+        ok = fread(cache->warm_keys.items, sizeof(u64), header.key_count, f) ==
+             header.key_count;
+    }
+    fclose(f);
+    if (!ok) {
+        LOG_ERROR("Invalid pipeline cache: %s", path);
+        return RETURN_FAILURE;
+    }
+    cache->warm_keys.count = header.key_count;
+    LOG_DEBUG("Loaded %u warm pipeline keys from %s", header.key_count, path);
+    return RETURN_SUCCESS;
+}
+
+/** Record the keys of the pipelines drawn with for the next run
+ *
+ * Warm keys never drawn with this run are kept, so a mode that was not used
+ * this time stays warm.
+ *
+ * @param[in] cache     Pipeline cache
+ * @param[in] path      Cache file, replaced atomically
+ * @returns             Return status
+ */
+ReturnStatus PipelineCache_save(const PipelineCache* cache, const char* path) {
+    U64Array keys = {0};
+    U64Array_push_many(&keys, cache->used_keys.items, cache->used_keys.count);
+    for (usize i = 0; i < cache->warm_keys.count; ++i) {
+        if (!U64Array_contains(&keys, cache->warm_keys.items[i])) {
+            U64Array_push(&keys, cache->warm_keys.items[i]);
+        }
+    }
+    PipelineCacheHeader header = {
+        .magic = PIPELINE_CACHE_MAGIC,
+        .version = PIPELINE_CACHE_VERSION,
+        .identity = cache->identity,
+        .key_count = keys.count,
+    };
+    // Write next to the target and rename, a crash never leaves a torn file
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) {
+        LOG_ERROR("Failed to open file: %s", tmp_path);
+        U64Array_free(&keys);
+        return RETURN_FAILURE;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(keys.items, sizeof(u64), keys.count, f) == keys.count;
+    ok = fclose(f) == 0 && ok;
+    U64Array_free(&keys);
+    if (!ok || rename(tmp_path, path) != 0) {
+        LOG_ERROR("Failed to write file: %s", path);
+        remove(tmp_path);
+        return RETURN_FAILURE;
+    }
+    LOG_DEBUG("Saved %u pipeline keys to %s", header.key_count, path);
+    return RETURN_SUCCESS;
+}
+
+/** Note that a render pipeline was drawn with, it is saved as warm */
+void PipelineCache_mark_used(
+    PipelineCache* cache, WGPURenderPipeline pipeline
+) {
+    if (pipeline == NULL) return;
+    pthread_mutex_lock(&cache->lock);
+    u64 key =
+        PipelineCache_key_of(cache, PIPELINE_CACHE_RENDER_PIPELINE, pipeline);
+    if (!U64Array_contains(&cache->used_keys, key)) {
+        U64Array_push(&cache->used_keys, key);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/** Current entries, to evict whatever is created after with `rollback` */
+PipelineCacheCheckpoint PipelineCache_checkpoint(PipelineCache* cache) {
+    PipelineCacheCheckpoint checkpoint = {0};
+    pthread_mutex_lock(&cache->lock);
+    for (u32 kind = 0; kind < PIPELINE_CACHE_KIND_COUNT; ++kind) {
+        checkpoint.counts[kind] = cache->entries[kind].count;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return checkpoint;
+}
+
+/** Release every object created since a checkpoint
+ *
+ * Callers must not hold on to any of those objects.
+ *
+ * @param[in,out] cache     Pipeline cache
+ * @param[in] checkpoint    Checkpoint taken on the same device
+ */
+void PipelineCache_rollback(
+    PipelineCache* cache, const PipelineCacheCheckpoint* checkpoint
+) {
+    pthread_mutex_lock(&cache->lock);
+    for (u32 kind = 0; kind < PIPELINE_CACHE_KIND_COUNT; ++kind) {
+        PipelineCacheEntryArray* entries = &cache->entries[kind];
+        for (usize i = checkpoint->counts[kind]; i < entries->count; ++i) {
+            PipelineCache_release(kind, entries->items[i].object);
+        }
+        if (entries->count > checkpoint->counts[kind]) {
+            entries->count = checkpoint->counts[kind];
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/** Shader module compiled from WGSL source
+ *
+ * @param[in,out] cache     Pipeline cache
+ * @param[in] label         Label of a newly created module
+ * @param[in] code          WGSL source
+ * @param[in] size          Source length, in bytes
+ * @returns                 Shader module owned by the cache
+ */
+WGPUShaderModule PipelineCache_shader_module(
+    PipelineCache* cache, const char* label, const char* code, usize size
+) {
+    u64 key = hash_bytes(code, size, PIPELINE_CACHE_SHADER_MODULE);
+    WGPUShaderSourceWGSL wgsl_desc = {
+        .chain.sType = WGPUSType_ShaderSourceWGSL,
+        .code = {code, size},
+    };
+    WGPUShaderModuleDescriptor shader_desc = {
+        .nextInChain = &wgsl_desc.chain,
+        .label = {label, WGPU_STRLEN},
+    };
+    return PipelineCache_get(
+        cache,
+        PIPELINE_CACHE_SHADER_MODULE,
+        key,
+        PipelineCache_create_shader_module,
+        &shader_desc
+    );
+}
+
+WGPUBindGroupLayout PipelineCache_bind_group_layout(
+    PipelineCache* cache, const WGPUBindGroupLayoutDescriptor* desc
+) {
+    u64 key = hash_combine(PIPELINE_CACHE_BIND_GROUP_LAYOUT, desc->entryCount);
+    for (usize i = 0; i < desc->entryCount; ++i) {
+        const WGPUBindGroupLayoutEntry* entry = &desc->entries[i];
+        key = hash_combine(key, entry->binding);
+        key = hash_combine(key, entry->visibility);
+        key = hash_combine(key, entry->buffer.type);
+        key = hash_combine(key, entry->buffer.hasDynamicOffset);
+        key = hash_combine(key, entry->buffer.minBindingSize);
+        key = hash_combine(key, entry->sampler.type);
+        key = hash_combine(key, entry->texture.sampleType);
+        key = hash_combine(key, entry->texture.viewDimension);
+        key = hash_combine(key, entry->texture.multisampled);
+        key = hash_combine(key, entry->storageTexture.access);
+        key = hash_combine(key, entry->storageTexture.format);
+        key = hash_combine(key, entry->storageTexture.viewDimension);
+    }
+    return PipelineCache_get(
+        cache,
+        PIPELINE_CACHE_BIND_GROUP_LAYOUT,
+        key,
+        PipelineCache_create_bind_group_layout,
+        desc
+    );
+}
+
+WGPUPipelineLayout PipelineCache_pipeline_layout(
+    PipelineCache* cache, const WGPUPipelineLayoutDescriptor* desc
+) {
+    u64 key = hash_combine(
+        PIPELINE_CACHE_PIPELINE_LAYOUT, desc->bindGroupLayoutCount
+    );
+    pthread_mutex_lock(&cache->lock);
+    for (usize i = 0; i < desc->bindGroupLayoutCount; ++i) {
+        key = hash_combine(
+            key,
+            PipelineCache_key_of(
+                cache,
+                PIPELINE_CACHE_BIND_GROUP_LAYOUT,
+                desc->bindGroupLayouts[i]
+            )
+        );
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return PipelineCache_get(
+        cache,
+        PIPELINE_CACHE_PIPELINE_LAYOUT,
+        key,
+        PipelineCache_create_pipeline_layout,
+        desc
+    );
+}
+
+static u64 hash_constants(
+    u64 h, const WGPUConstantEntry* constants, usize count
+) {
+    h = hash_combine(h, count);
+    for (usize i = 0; i < count; ++i) {
+        h = hash_string_view(h, constants[i].key);
+        h = hash_f64(h, constants[i].value);
+    }
+    return h;
+}
+
+static u64 hash_blend_component(u64 h, const WGPUBlendComponent* component) {
+    h = hash_combine(h, component->operation);
+    h = hash_combine(h, component->srcFactor);
+    return hash_combine(h, component->dstFactor);
+}
+
+/** Key of a render pipeline descriptor, stable across runs
+ *
+ * Reads the cache without locking it, call it while no other thread inserts.
+ *
+ * @param[in] cache     Pipeline cache that created the module and layout
+ * @param[in] desc      Render pipeline descriptor
+ * @returns             Descriptor key
+ */
+u64 PipelineCache_render_pipeline_key(
+    const PipelineCache* cache, const WGPURenderPipelineDescriptor* desc
+) {
+    u64 h = PIPELINE_CACHE_RENDER_PIPELINE;
+    h = hash_combine(
+        h,
+        PipelineCache_key_of(
+            cache, PIPELINE_CACHE_PIPELINE_LAYOUT, desc->layout
+        )
+    );
+
+    const WGPUVertexState* vertex = &desc->vertex;
+    h = hash_combine(
+        h,
+        PipelineCache_key_of(
+            cache, PIPELINE_CACHE_SHADER_MODULE, vertex->module
+        )
+    );
+    h = hash_string_view(h, vertex->entryPoint);
+    h = hash_constants(h, vertex->constants, vertex->constantCount);
+    h = hash_combine(h, vertex->bufferCount);
+    for (usize i = 0; i < vertex->bufferCount; ++i) {
+        const WGPUVertexBufferLayout* buffer = &vertex->buffers[i];
+        h = hash_combine(h, buffer->arrayStride);
+        h = hash_combine(h, buffer->stepMode);
+        h = hash_combine(h, buffer->attributeCount);
+        for (usize j = 0; j < buffer->attributeCount; ++j) {
+            h = hash_combine(h, buffer->attributes[j].format);
+            h = hash_combine(h, buffer->attributes[j].offset);
+            h = hash_combine(h, buffer->attributes[j].shaderLocation);
+        }
+    }
+
+    h = hash_combine(h, desc->primitive.topology);
+    h = hash_combine(h, desc->primitive.stripIndexFormat);
+    h = hash_combine(h, desc->primitive.frontFace);
+    h = hash_combine(h, desc->primitive.cullMode);
+    h = hash_combine(h, desc->primitive.unclippedDepth);
+
+    const WGPUDepthStencilState* depth = desc->depthStencil;
+    h = hash_combine(h, depth != NULL);
+    if (depth != NULL) {
+        h = hash_combine(h, depth->format);
+        h = hash_combine(h, depth->depthWriteEnabled);
+        h = hash_combine(h, depth->depthCompare);
+        const WGPUStencilFaceState* faces[] = {
+            &depth->stencilFront,
+            &depth->stencilBack,
+        };
+        for (u32 i = 0; i < 2; ++i) {
+            h = hash_combine(h, faces[i]->compare);
+            h = hash_combine(h, faces[i]->failOp);
+            h = hash_combine(h, faces[i]->depthFailOp);
+            h = hash_combine(h, faces[i]->passOp);
+        }
+        h = hash_combine(h, depth->stencilReadMask);
+        h = hash_combine(h, depth->stencilWriteMask);
+        h = hash_combine(h, (u32)depth->depthBias);
+        h = hash_f64(h, depth->depthBiasSlopeScale);
+        h = hash_f64(h, depth->depthBiasClamp);
+    }
+
+    h = hash_combine(h, desc->multisample.count);
+    h = hash_combine(h, desc->multisample.mask);
+    h = hash_combine(h, desc->multisample.alphaToCoverageEnabled);
+
+    const WGPUFragmentState* fragment = desc->fragment;
+    h = hash_combine(h, fragment != NULL);
+    if (fragment != NULL) {
+        h = hash_combine(
+            h,
+            PipelineCache_key_of(
+                cache, PIPELINE_CACHE_SHADER_MODULE, fragment->module
+            )
+        );
+        h = hash_string_view(h, fragment->entryPoint);
+        h = hash_constants(h, fragment->constants, fragment->constantCount);
+        h = hash_combine(h, fragment->targetCount);
+        for (usize i = 0; i < fragment->targetCount; ++i) {
+            const WGPUColorTargetState* target = &fragment->targets[i];
+            h = hash_combine(h, target->format);
+            h = hash_combine(h, target->writeMask);
+            h = hash_combine(h, target->blend != NULL);
+            if (target->blend != NULL) {
+                h = hash_blend_component(h, &target->blend->color);
+                h = hash_blend_component(h, &target->blend->alpha);
+            }
+        }
+    }
+    return h;
+}
+
+/** Render pipeline matching a descriptor, compiled on first request
+ *
+ * @param[in,out] cache     Pipeline cache
+ * @param[in] desc          Render pipeline descriptor
+ * @returns                 Render pipeline owned by the cache
+ */
+WGPURenderPipeline PipelineCache_render_pipeline(
+    PipelineCache* cache, const WGPURenderPipelineDescriptor* desc
+) {
+    pthread_mutex_lock(&cache->lock);
+    u64 key = PipelineCache_render_pipeline_key(cache, desc);
+    bool cold =
+        cache->defer_cold && cache->warm_keys.count > 0 &&
+        !U64Array_contains(&cache->warm_keys, key) &&
+        PipelineCache_find(cache, PIPELINE_CACHE_RENDER_PIPELINE, key) == NULL;
+    if (cold) ++cache->deferred;
+    pthread_mutex_unlock(&cache->lock);
+    if (cold) return NULL;
+    return PipelineCache_get(
+        cache,
+        PIPELINE_CACHE_RENDER_PIPELINE,
+        key,
+        PipelineCache_create_render_pipeline,
+        desc
+    );
+}
+
+#endif /* PIPELINE_CACHE_H */
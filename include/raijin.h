@@ -9,6 +9,9 @@
 #include "cglm/mat4.h"
 #include "core.h"
 #include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_import.h"
+#include "render_thread.h"
 #include "renderer.h"
 
 // #ifdef RAIJIN_SDL3_IMPL
@@ -17,17 +20,27 @@
 
 #define CGLM_CONFIG_CLIP_CONTROL CGLM_CLIP_CONTROL_RH_ZO
 
+// Longest an idle on-demand event loop blocks, so simulation without input
+// still gets to run and submit changes
+#define RAIJIN_IDLE_WAIT_MS 250
+
 /* Types */
 
 typedef struct Raijin {
     SdlWindow window;
     Renderer renderer;
+    // Owns `renderer` while running, see `Raijin_start_render_thread`
+    RenderThread render_thread;
 } Raijin;
 
 /* Function prototypes */
 
 ReturnStatus Raijin_init(Raijin*, const char* title, u32 width, u32 height);
+ReturnStatus Raijin_start_render_thread(Raijin* engine);
 void Raijin_handle_events(Raijin* engine);
+void Raijin_set_on_demand(Raijin* engine, bool on_demand);
+void Raijin_invalidate(Raijin* engine);
+void Raijin_set_camera(Raijin* engine, mat4 proj_matrix, mat4 view_matrix);
  void Raijin_draw_cube(
      Raijin* engine, vec3 position, mat3 rotation, f32 scale, vec4 color
 );
@@ -38,15 +51,22 @@ void Raijin_destroy(Raijin* engine);
 ReturnStatus Raijin_init(
     Raijin* engine, const char* title, u32 width, u32 height
 ) {
-    if (!SdlWindow_init(&engine->window, title, width, height)) {
-        return RETURN_FAILURE;
-    }
+    f64 start = now_seconds();
     WGPUInstanceDescriptor instance_desc = {0};
     WGPUInstance instance = wgpuCreateInstance(&instance_desc);
     if (instance == NULL) {
         LOG_ERROR("Failed to create WGPU instance");
         return false;
     }
+    engine->renderer.init_phase_seconds[INIT_PHASE_INSTANCE] =
+        now_seconds() - start;
+    // Device and assets load while the window opens
+    Renderer_begin_init(&engine->renderer, instance);
+    if (!SdlWindow_init(&engine->window, title, width, height)) {
+        Renderer_destroy(&engine->renderer);
+        wgpuInstanceRelease(instance);
+        return RETURN_FAILURE;
+    }
 
     // Create platform-specific surface
     engine->renderer.render_target.windowed.surface =
@@ -59,12 +79,13 @@ ReturnStatus Raijin_init(
     ReturnStatus status =
         Renderer_init_windowed(&engine->renderer, instance, width, height);
     if (status != RETURN_SUCCESS) {
-        Renderer_destroy(&engine->renderer);
-        wgpuInstanceRelease(instance);
         Raijin_destroy(engine);
+        wgpuInstanceRelease(instance);
         return RETURN_FAILURE;
     }
 
+    engine->renderer.enable_edges = true;
+
     f32 aspect = (f32)width / (f32)height;
     mat4 proj_matrix = {0};
     glm_perspective(glm_rad(60.0f), aspect, 0.1, 1000.0, proj_matrix);
@@ -79,15 +100,91 @@ ReturnStatus Raijin_init(
     return RETURN_SUCCESS;
 }
 
+/** Render on a dedicated thread from now on
+ *
+ * `Raijin_render` then publishes the frame's draws and camera and returns
+ * at once, so events and simulation run at their own rate whatever the
+ * present mode or GPU load.  Its status is that of the last frame the
+ * render thread finished.
+ *
+ * @param[in,out] engine    Initialized engine
+ * @returns                 Return status
+ */
+ReturnStatus Raijin_start_render_thread(Raijin* engine) {
+    return RenderThread_start(&engine->render_thread, &engine->renderer);
+}
+
+/** Handle pending window events
+ *
+ * In on-demand mode, while the last frame was skipped as unchanged, this
+ * blocks until an event, `Raijin_invalidate` or RAIJIN_IDLE_WAIT_MS.
+ */
 void Raijin_handle_events(Raijin* engine) {
-    SdlWindow_handle_events(&engine->window, &engine->renderer);
+    // The surface belongs to the render thread, which resizes it before
+    // rendering the next snapshot
+    Renderer* renderer =
+        engine->render_thread.running ? NULL : &engine->renderer;
+    if (engine->renderer.on_demand && Renderer_is_idle(&engine->renderer)) {
+        SdlWindow_wait_events(&engine->window, renderer, RAIJIN_IDLE_WAIT_MS);
+    } else {
+        SdlWindow_handle_events(&engine->window, renderer);
+    }
+    if (engine->window.needs_redraw) {
+        Renderer_invalidate(&engine->renderer);
+        engine->window.needs_redraw = false;
+    }
+    if (engine->render_thread.running) {
+        RenderThread_resize(
+            &engine->render_thread, engine->window.width, engine->window.height
+        );
+    }
+}
+
+/** Only render frames that changed, see `Renderer_set_on_demand`
+ *
+ * Unchanged frames skip encoding, submission and present, and
+ * `Raijin_handle_events` blocks instead of spinning.  Set before
+ * `Raijin_start_render_thread`.
+ *
+ * @param[in,out] engine    Initialized engine
+ * @param[in] on_demand     Skip unchanged frames
+ */
+void Raijin_set_on_demand(Raijin* engine, bool on_demand) {
+    Renderer_set_on_demand(&engine->renderer, on_demand);
+}
+
+/** Render the next frame and wake a blocked `Raijin_handle_events`, from
+ * any thread, e.g. after new data arrived
+ */
+void Raijin_invalidate(Raijin* engine) {
+    Renderer_invalidate(&engine->renderer);
+    SDL_Event event = {.type = SDL_EVENT_USER};
+    SDL_PushEvent(&event);
 }
 
-void Raijin_destroy(Raijin* engine) { SdlWindow_destroy(&engine->window); }
+void Raijin_set_camera(Raijin* engine, mat4 proj_matrix, mat4 view_matrix) {
+    if (engine->render_thread.running) {
+        RenderThread_set_camera(
+            &engine->render_thread, proj_matrix, view_matrix
+        );
+    } else {
+        Renderer_update_uniforms(&engine->renderer, proj_matrix, view_matrix);
+    }
+}
+
+void Raijin_destroy(Raijin* engine) {
+    RenderThread_stop(&engine->render_thread);
+    // Saves the pipeline cache, so the next start compiles the used pipelines
+    Renderer_destroy(&engine->renderer);
+    SdlWindow_destroy(&engine->window);
+}
 // #endif
 
 ReturnStatus Raijin_render(Raijin* engine) {
-    // Renderer_update_uniforms(&engine->renderer, proj_matrix, view_matrix);
+    if (engine->render_thread.running) {
+        RenderThread_publish(&engine->render_thread);
+        return RenderThread_status(&engine->render_thread);
+    }
     return Renderer_render(&engine->renderer);
 }
 
@@ -96,10 +193,13 @@ void Raijin_draw_cube_instance(Raijin* engine, Instance instance) {
         .mesh_type = MESH_TYPE_CUBE,
         .instance = instance,
     };
-    DrawCommandArray_push(&engine->renderer.draw_commands, cmd);
-    LOG_DEBUG(
-        "Array Push command count: %ld", engine->renderer.draw_commands.count
-    );
+    DrawCommandArray* draw_commands = &engine->renderer.draw_commands;
+    if (engine->render_thread.running) {
+        draw_commands = &RenderThread_snapshot(&engine->render_thread)
+                             ->draw_commands;
+    }
+    DrawCommandArray_push(draw_commands, cmd);
+    LOG_DEBUG("Array Push command count: %ld", draw_commands->count);
 }
 
 void Raijin_draw_cube(
@@ -19,6 +19,8 @@ typedef struct {
     int width;
     int height;
     bool should_close;
+    // Set when the window contents must be drawn again, e.g. once exposed
+    bool needs_redraw;
 } SdlWindow;
 
 /* Function Prototypes */
@@ -28,8 +30,15 @@ ReturnStatus SdlWindow_init(
 );
 void SdlWindow_handle_events(SdlWindow* window, Renderer* renderer);
 void SdlWindow_handle_events(SdlWindow* window, Renderer* renderer);
+bool SdlWindow_wait_events(
+    SdlWindow* window, Renderer* renderer, i32 timeout_ms
+);
 void SdlWindow_destroy(SdlWindow* window);
 
+static void SdlWindow_handle_event(
+    SdlWindow* window, Renderer* renderer, const SDL_Event* event
+);
+
 WGPUSurface create_surface_sdl3(
     WGPUInstance instance, SDL_Window* window
 );
@@ -72,21 +81,54 @@ void SdlWindow_destroy(SdlWindow* window) {
 void SdlWindow_handle_events(SdlWindow* window, Renderer* renderer) {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
-        switch (event.type) {
-            case SDL_EVENT_QUIT:
-                window->should_close = true;
-                break;
-            case SDL_EVENT_WINDOW_RESIZED:
-                window->width = event.window.data1;
-                window->height = event.window.data2;
+        SdlWindow_handle_event(window, renderer, &event);
+    }
+}
+
+/** Block until an event arrives or `timeout_ms` passes, then handle every
+ * pending event
+ *
+ * @param[in,out] window    Window
+ * @param[in] renderer      Renderer to resize, NULL if the render thread
+ *                          owns it
+ * @param[in] timeout_ms    Longest wait in milliseconds
+ * @returns                 Whether any event arrived
+ */
+bool SdlWindow_wait_events(
+    SdlWindow* window, Renderer* renderer, i32 timeout_ms
+) {
+    SDL_Event event;
+    if (!SDL_WaitEventTimeout(&event, timeout_ms)) return false;
+    SdlWindow_handle_event(window, renderer, &event);
+    SdlWindow_handle_events(window, renderer);
+    return true;
+}
+
+static void SdlWindow_handle_event(
+    SdlWindow* window, Renderer* renderer, const SDL_Event* event
+) {
+    switch (event->type) {
+        case SDL_EVENT_QUIT:
+            window->should_close = true;
+            break;
+        case SDL_EVENT_WINDOW_RESIZED:
+            window->width = event->window.data1;
+            window->height = event->window.data2;
+            // Coalesced by the renderer, the next frame applies the last
+            // size.  NULL when the render thread owns the renderer.
+            if (renderer != NULL) {
                 Renderer_handle_resize(renderer, window->width, window->height);
-                break;
-            case SDL_EVENT_KEY_DOWN:
-                if (event.key.key == SDLK_ESCAPE) {
-                    window->should_close = true;
-                }
-                break;
-        }
+            }
+            break;
+        case SDL_EVENT_WINDOW_EXPOSED:
+        case SDL_EVENT_WINDOW_RESTORED:
+            window->needs_redraw = true;
+            break;
+        case SDL_EVENT_KEY_DOWN:
+            if (event->key.key == SDLK_ESCAPE) {
+                window->should_close = true;
+            }
+            break;
     }
 }
 
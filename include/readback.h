@@ -0,0 +1,342 @@
+#ifndef READBACK_H
+#define READBACK_H
+
+#include "core.h"
+#include "webgpu.h"
+#include "wgpu.h"
+
+// Ring of headless render targets read back to the CPU.  Every frame renders
+// into the texture of its own slot and is copied into the slot's mappable
+// buffer in the same submission, then the buffer is mapped asynchronously.
+// With READBACK_RING_SIZE slots the GPU renders frame N+2 while frame N is
+// mapped and read, the renderer only waits once every slot is in flight.
+//
+// Frames are delivered in order to a callback from `ReadbackRing_poll`.
+// Rows are copied with their stride padded to READBACK_ROW_ALIGNMENT, as
+// texture to buffer copies require, `HeadlessFrame.bytes_per_row` is the
+// padded stride.
+//
+// Slot textures may be 2D arrays, one layer per view of a multi-view frame.
+// Every layer is copied out with the frame, one image after the other.
+
+#define READBACK_RING_SIZE 3
+#define READBACK_ROW_ALIGNMENT 256
+
+/* Types */
+
+typedef enum {
+    READBACK_SLOT_IDLE,
+    // Copy submitted, waiting for the buffer to map
+    READBACK_SLOT_PENDING,
+    READBACK_SLOT_MAPPED,
+    READBACK_SLOT_FAILED,
+} ReadbackSlotState;
+
+typedef struct ReadbackSlot {
+    WGPUTexture texture;
+    WGPUBuffer buffer;
+    ReadbackSlotState state;
+    u64 frame_index;
+} ReadbackSlot;
+
+// A frame read back from the GPU, `pixels` is only valid in the callback
+typedef struct HeadlessFrame {
+    // `layer_count` images of `bytes_per_row * height` bytes
+    const u8* pixels;
+    u64 index;
+    u32 width;
+    u32 height;
+    u32 bytes_per_row;
+    u32 layer_count;
+    WGPUTextureFormat format;
+} HeadlessFrame;
+
+typedef void (*HeadlessFrameCallback)(
+    const HeadlessFrame* frame, void* userdata
+);
+
+typedef struct ReadbackRing {
+    WGPUDevice device;
+    ReadbackSlot slots[READBACK_RING_SIZE];
+    WGPUTextureFormat format;
+    u32 width;
+    u32 height;
+    u32 bytes_per_row;
+    u32 layer_count;
+    // Frames rendered, and frames delivered or skipped, so far
+    u64 frame_count;
+    u64 delivered_count;
+    // Frames are only copied and mapped while a callback is set
+    HeadlessFrameCallback callback;
+    void* userdata;
+} ReadbackRing;
+
+/* Function Prototypes */
+
+u32 readback_bytes_per_row(u32 width, u32 bytes_per_pixel);
+ReturnStatus ReadbackRing_init(
+    ReadbackRing* ring,
+    WGPUDevice device,
+    WGPUTextureFormat format,
+    u32 width,
+    u32 height,
+    u32 layer_count
+);
+usize ReadbackRing_frame_size(const ReadbackRing* ring);
+void ReadbackRing_destroy(ReadbackRing* ring);
+ReadbackSlot* ReadbackRing_acquire(ReadbackRing* ring);
+void ReadbackRing_encode_copy(
+    ReadbackRing* ring, ReadbackSlot* slot, WGPUCommandEncoder encoder
+);
+void ReadbackRing_submitted(ReadbackRing* ring, ReadbackSlot* slot);
+u32 ReadbackRing_poll(ReadbackRing* ring, bool wait);
+
+static void ReadbackRing_release_slots(ReadbackRing* ring);
+static void readback_map_callback(
+    WGPUMapAsyncStatus status,
+    WGPUStringView msg,
+    void* userdata1,
+    void* userdata2
+);
+
+/* Functions */
+
+/** Row stride of a texture to buffer copy
+ *
+ * @param[in] width             Row width, in texels
+ * @param[in] bytes_per_pixel   Texel size
+ * @returns                     Row size rounded up to READBACK_ROW_ALIGNMENT
+ */
+u32 readback_bytes_per_row(u32 width, u32 bytes_per_pixel) {
+    u32 size = width * bytes_per_pixel;
+    return (size + READBACK_ROW_ALIGNMENT - 1) /
+           READBACK_ROW_ALIGNMENT * READBACK_ROW_ALIGNMENT;
+}
+
+/** Create the render target and readback buffer of every slot
+ *
+ * Recreating a ring flushes the frames still in flight to the callback,
+ * which is kept, and frame indices carry on from the previous frames.
+ *
+ * @param[in,out] ring      Readback ring
+ * @param[in] device        Device
+ * @param[in] format        Render target format, 4 bytes per texel
+ * @param[in] width         Target width, 0 is clamped to 1
+ * @param[in] height        Target height, 0 is clamped to 1
+ * @param[in] layer_count   Array layers of each target, 0 is clamped to 1
+ * @returns                 Return status
+ */
+ReturnStatus ReadbackRing_init(
+    ReadbackRing* ring,
+    WGPUDevice device,
+    WGPUTextureFormat format,
+    u32 width,
+    u32 height,
+    u32 layer_count
+) {
+    ReadbackRing_release_slots(ring);
+    ring->device = device;
+    ring->format = format;
+    ring->width = width > 0 ? width : 1;
+    ring->height = height > 0 ? height : 1;
+    ring->bytes_per_row = readback_bytes_per_row(ring->width, 4);
+    ring->layer_count = layer_count > 0 ? layer_count : 1;
+    WGPUTextureDescriptor texture_desc = {
+        .label = {"Headless Texture", WGPU_STRLEN},
+        .size =
+            (WGPUExtent3D){
+                .width = ring->width,
+                .height = ring->height,
+                .depthOrArrayLayers = ring->layer_count,
+            },
+        .mipLevelCount = 1,
+        .sampleCount = 1,
+        .dimension = WGPUTextureDimension_2D,
+        .format = format,
+        .usage = WGPUTextureUsage_RenderAttachment |
+                 WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopySrc,
+        .viewFormats = &format,
+        .viewFormatCount = 1,
+    };
+    WGPUBufferDescriptor buffer_desc = {
+        .label = {"Readback Buffer", WGPU_STRLEN},
+        .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+        .size = ReadbackRing_frame_size(ring),
+        .mappedAtCreation = false,
+    };
+    for (u32 i = 0; i < READBACK_RING_SIZE; ++i) {
+        ReadbackSlot* slot = &ring->slots[i];
+        slot->texture = wgpuDeviceCreateTexture(device, &texture_desc);
+        slot->buffer = wgpuDeviceCreateBuffer(device, &buffer_desc);
+        slot->state = READBACK_SLOT_IDLE;
+        if (slot->texture == NULL || slot->buffer == NULL) {
+            LOG_ERROR("Failed to create readback slot");
+            ReadbackRing_release_slots(ring);
+            return RETURN_FAILURE;
+        }
+    }
+    return RETURN_SUCCESS;
+}
+
+/** Bytes read back per frame, every layer included */
+usize ReadbackRing_frame_size(const ReadbackRing* ring) {
+    return (usize)ring->bytes_per_row * ring->height * ring->layer_count;
+}
+
+/** Deliver the frames still in flight, then release every slot */
+void ReadbackRing_destroy(ReadbackRing* ring) {
+    ReadbackRing_release_slots(ring);
+    ring->device = NULL;
+}
+
+/** Slot to render the next frame into
+ *
+ * Delivers finished frames first and blocks while every slot is in flight.
+ *
+ * @param[in,out] ring  Readback ring
+ * @returns             Idle slot
+ */
+ReadbackSlot* ReadbackRing_acquire(ReadbackRing* ring) {
+    ReadbackRing_poll(ring, false);
+    while (ring->frame_count - ring->delivered_count >= READBACK_RING_SIZE) {
+        ReadbackRing_poll(ring, true);
+    }
+    ReadbackSlot* slot = &ring->slots[ring->frame_count % READBACK_RING_SIZE];
+    slot->frame_index = ring->frame_count;
+    return slot;
+}
+
+/** Record the copy of a slot's texture into its buffer, if frames are read
+ *
+ * @param[in] ring      Readback ring
+ * @param[in] slot      Slot from `ReadbackRing_acquire`
+ * @param[in] encoder   Encoder of the frame rendered into the slot
+ */
+void ReadbackRing_encode_copy(
+    ReadbackRing* ring, ReadbackSlot* slot, WGPUCommandEncoder encoder
+) {
+    if (ring->callback == NULL) return;
+    WGPUTexelCopyTextureInfo source = {
+        .texture = slot->texture,
+        .mipLevel = 0,
+        .origin = {0, 0, 0},
+        .aspect = WGPUTextureAspect_All,
+    };
+    WGPUTexelCopyBufferInfo destination = {
+        .layout =
+            (WGPUTexelCopyBufferLayout){
+                .offset = 0,
+                .bytesPerRow = ring->bytes_per_row,
+                .rowsPerImage = ring->height,
+            },
+        .buffer = slot->buffer,
+    };
+    WGPUExtent3D size = {ring->width, ring->height, ring->layer_count};
+    wgpuCommandEncoderCopyTextureToBuffer(
+        encoder, &source, &destination, &size
+    );
+}
+
+/** Start mapping a slot once its frame was submitted
+ *
+ * @param[in,out] ring  Readback ring
+ * @param[in] slot      Slot whose copy was just submitted
+ */
+void ReadbackRing_submitted(ReadbackRing* ring, ReadbackSlot* slot) {
+    ++ring->frame_count;
+    if (ring->callback == NULL) {
+        slot->state = READBACK_SLOT_IDLE;
+        return;
+    }
+    slot->state = READBACK_SLOT_PENDING;
+    WGPUBufferMapCallbackInfo map_cb_info = {
+        .mode = WGPUCallbackMode_AllowProcessEvents,
+        .callback = readback_map_callback,
+        .userdata1 = slot,
+    };
+    wgpuBufferMapAsync(
+        slot->buffer,
+        WGPUMapMode_Read,
+        0,
+        ReadbackRing_frame_size(ring),
+        map_cb_info
+    );
+}
+
+/** Deliver mapped frames to the callback, oldest first
+ *
+ * @param[in,out] ring  Readback ring
+ * @param[in] wait      Block until every frame in flight was delivered
+ * @returns             Number of frames delivered
+ */
+u32 ReadbackRing_poll(ReadbackRing* ring, bool wait) {
+    if (ring->device == NULL) return 0;
+    u32 delivered = 0;
+    wgpuDevicePoll(ring->device, false, NULL);
+    while (ring->delivered_count < ring->frame_count) {
+        ReadbackSlot* slot =
+            &ring->slots[ring->delivered_count % READBACK_RING_SIZE];
+        if (slot->state == READBACK_SLOT_PENDING) {
+            if (!wait) break;
+            // Map callbacks run from the poll once the copy finished
+            wgpuDevicePoll(ring->device, true, NULL);
+            continue;
+        }
+        if (slot->state == READBACK_SLOT_MAPPED) {
+            usize size = ReadbackRing_frame_size(ring);
+            HeadlessFrame frame = {
+                .pixels = wgpuBufferGetConstMappedRange(slot->buffer, 0, size),
+                .index = slot->frame_index,
+                .width = ring->width,
+                .height = ring->height,
+                .bytes_per_row = ring->bytes_per_row,
+                .layer_count = ring->layer_count,
+                .format = ring->format,
+            };
+            if (frame.pixels != NULL && ring->callback != NULL) {
+                ring->callback(&frame, ring->userdata);
+                ++delivered;
+            }
+            wgpuBufferUnmap(slot->buffer);
+        } else if (slot->state == READBACK_SLOT_FAILED) {
+            LOG_ERROR(
+                "Dropped headless frame %llu",
+                (unsigned long long)slot->frame_index
+            );
+        }
+        slot->state = READBACK_SLOT_IDLE;
+        ++ring->delivered_count;
+    }
+    return delivered;
+}
+
+static void ReadbackRing_release_slots(ReadbackRing* ring) {
+    ReadbackRing_poll(ring, true);
+    for (u32 i = 0; i < READBACK_RING_SIZE; ++i) {
+        ReadbackSlot* slot = &ring->slots[i];
+        if (slot->texture != NULL) wgpuTextureRelease(slot->texture);
+        if (slot->buffer != NULL) wgpuBufferRelease(slot->buffer);
+        slot->texture = NULL;
+        slot->buffer = NULL;
+        slot->state = READBACK_SLOT_IDLE;
+    }
+}
+
+static void readback_map_callback(
+    WGPUMapAsyncStatus status,
+    WGPUStringView msg,
+    void* userdata1,
+    void* userdata2
+) {
+    ReadbackSlot* slot = (ReadbackSlot*)userdata1;
+    if (status == WGPUMapAsyncStatus_Success) {
+        slot->state = READBACK_SLOT_MAPPED;
+    } else {
+        LOG_ERROR(
+            "Failed to map readback buffer: %.*s", (int)msg.length, msg.data
+        );
+        slot->state = READBACK_SLOT_FAILED;
+    }
+}
+
+#endif /* READBACK_H */
@@ -0,0 +1,272 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include "core.h"
+#include "renderer.h"
+
+// Runs `Renderer_render` on its own thread so simulation and input never
+// wait on vsync, the surface acquire or GPU back-pressure.
+//
+// The simulation thread fills a `FrameSnapshot` and publishes it, the
+// render thread renders the newest published snapshot.  Snapshots go
+// through a lock-free triple buffer: the writer and the reader each own
+// one snapshot and swap it with the shared middle one atomically, so
+// neither ever blocks on the other.  When the simulation outpaces the
+// renderer unrendered snapshots are replaced, never queued.
+//
+// A mutex and condition variable only park the render thread while no new
+// snapshot is published, they never guard snapshot data.
+
+#define SNAPSHOT_COUNT 3
+// Set in `SnapshotTripleBuffer.shared` when the middle snapshot is unread
+#define SNAPSHOT_FRESH 0x4u
+#define SNAPSHOT_INDEX_MASK 0x3u
+
+/* Types */
+
+// Everything the render thread needs for one frame
+typedef struct FrameSnapshot {
+    DrawCommandArray draw_commands;
+    // Camera, carried over to the next snapshot until changed
+    Uniform uniform;
+    bool has_uniform;
+    // Surface size, carried over like the camera
+    u32 width;
+    u32 height;
+    u64 sequence;
+} FrameSnapshot;
+
+typedef struct SnapshotTripleBuffer {
+    FrameSnapshot snapshots[SNAPSHOT_COUNT];
+    // Owned by the writer and the reader respectively
+    u32 write_index;
+    u32 read_index;
+    // Middle snapshot index, with SNAPSHOT_FRESH if published and unread
+    u32 shared;
+} SnapshotTripleBuffer;
+
+typedef struct RenderThread {
+    Renderer* renderer;
+    SnapshotTripleBuffer buffer;
+    pthread_t thread;
+    bool running;
+    bool stopping;
+    pthread_mutex_t wake_lock;
+    pthread_cond_t wake;
+    u64 published;
+    // Written by the render thread
+    u64 frames_rendered;
+    ReturnStatus last_status;
+} RenderThread;
+
+/* Function Prototypes */
+
+void SnapshotTripleBuffer_init(SnapshotTripleBuffer* buffer);
+void SnapshotTripleBuffer_free(SnapshotTripleBuffer* buffer);
+FrameSnapshot* SnapshotTripleBuffer_write(SnapshotTripleBuffer* buffer);
+void SnapshotTripleBuffer_publish(SnapshotTripleBuffer* buffer);
+FrameSnapshot* SnapshotTripleBuffer_read(SnapshotTripleBuffer* buffer);
+ReturnStatus RenderThread_start(RenderThread* thread, Renderer* renderer);
+FrameSnapshot* RenderThread_snapshot(RenderThread* thread);
+void RenderThread_set_camera(
+    RenderThread* thread, mat4 proj_matrix, mat4 view_matrix
+);
+void RenderThread_resize(RenderThread* thread, u32 width, u32 height);
+void RenderThread_publish(RenderThread* thread);
+ReturnStatus RenderThread_status(const RenderThread* thread);
+void RenderThread_stop(RenderThread* thread);
+
+static void* RenderThread_main(void* arg);
+
+/* Functions */
+
+void SnapshotTripleBuffer_init(SnapshotTripleBuffer* buffer) {
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->write_index = 0;
+    buffer->shared = 1;
+    buffer->read_index = 2;
+}
+
+void SnapshotTripleBuffer_free(SnapshotTripleBuffer* buffer) {
+    for (u32 i = 0; i < SNAPSHOT_COUNT; ++i) {
+        DrawCommandArray_free(&buffer->snapshots[i].draw_commands);
+    }
+}
+
+/** Snapshot the writer is filling */
+FrameSnapshot* SnapshotTripleBuffer_write(SnapshotTripleBuffer* buffer) {
+    return &buffer->snapshots[buffer->write_index];
+}
+
+/** Hand the written snapshot to the reader and start the next one
+ *
+ * The next snapshot starts with no draws, and the camera and size of the
+ * published one.
+ */
+void SnapshotTripleBuffer_publish(SnapshotTripleBuffer* buffer) {
+    FrameSnapshot* published = &buffer->snapshots[buffer->write_index];
+    u32 previous = __atomic_exchange_n(
+        &buffer->shared,
+        buffer->write_index | SNAPSHOT_FRESH,
+        __ATOMIC_ACQ_REL
+    );
+    buffer->write_index = previous & SNAPSHOT_INDEX_MASK;
+    FrameSnapshot* next = &buffer->snapshots[buffer->write_index];
+    DrawCommandArray_clear(&next->draw_commands);
+    next->uniform = published->uniform;
+    next->has_uniform = published->has_uniform;
+    next->width = published->width;
+    next->height = published->height;
+    next->sequence = published->sequence + 1;
+}
+
+/** Newest published snapshot, or NULL if none was published since the
+ * last read
+ */
+FrameSnapshot* SnapshotTripleBuffer_read(SnapshotTripleBuffer* buffer) {
+    if ((__atomic_load_n(&buffer->shared, __ATOMIC_ACQUIRE) &
+         SNAPSHOT_FRESH) == 0) {
+        return NULL;
+    }
+    u32 previous = __atomic_exchange_n(
+        &buffer->shared, buffer->read_index, __ATOMIC_ACQ_REL
+    );
+    buffer->read_index = previous & SNAPSHOT_INDEX_MASK;
+    return &buffer->snapshots[buffer->read_index];
+}
+
+/** Start rendering published snapshots on a new thread
+ *
+ * The renderer belongs to the render thread until `RenderThread_stop`.
+ *
+ * @param[out] thread   Render thread
+ * @param[in] renderer  Initialized renderer
+ * @returns             Return status
+ */
+ReturnStatus RenderThread_start(RenderThread* thread, Renderer* renderer) {
+    memset(thread, 0, sizeof(*thread));
+    thread->renderer = renderer;
+    SnapshotTripleBuffer_init(&thread->buffer);
+    u32 width = 0;
+    u32 height = 0;
+    if (renderer->render_mode == RENDER_MODE_WINDOWED) {
+        width = renderer->render_target.windowed.surface_config.width;
+        height = renderer->render_target.windowed.surface_config.height;
+    }
+    for (u32 i = 0; i < SNAPSHOT_COUNT; ++i) {
+        thread->buffer.snapshots[i].width = width;
+        thread->buffer.snapshots[i].height = height;
+    }
+    pthread_mutex_init(&thread->wake_lock, NULL);
+    pthread_cond_init(&thread->wake, NULL);
+    if (pthread_create(&thread->thread, NULL, RenderThread_main, thread) !=
+        0) {
+        LOG_ERROR("Failed to start render thread");
+        pthread_cond_destroy(&thread->wake);
+        pthread_mutex_destroy(&thread->wake_lock);
+        SnapshotTripleBuffer_free(&thread->buffer);
+        return RETURN_FAILURE;
+    }
+    thread->running = true;
+    return RETURN_SUCCESS;
+}
+
+/** Snapshot the simulation thread is filling for the next frame */
+FrameSnapshot* RenderThread_snapshot(RenderThread* thread) {
+    return SnapshotTripleBuffer_write(&thread->buffer);
+}
+
+/** Set the camera of the snapshot being filled and the ones after it */
+void RenderThread_set_camera(
+    RenderThread* thread, mat4 proj_matrix, mat4 view_matrix
+) {
+    FrameSnapshot* snapshot = RenderThread_snapshot(thread);
+    glm_mat4_mul(proj_matrix, view_matrix, snapshot->uniform.view_proj);
+    snapshot->has_uniform = true;
+}
+
+/** Resize the surface before rendering the snapshot being filled */
+void RenderThread_resize(RenderThread* thread, u32 width, u32 height) {
+    FrameSnapshot* snapshot = RenderThread_snapshot(thread);
+    snapshot->width = width;
+    snapshot->height = height;
+}
+
+/** Publish the snapshot being filled, never blocks */
+void RenderThread_publish(RenderThread* thread) {
+    SnapshotTripleBuffer_publish(&thread->buffer);
+    ++thread->published;
+    pthread_mutex_lock(&thread->wake_lock);
+    pthread_cond_signal(&thread->wake);
+    pthread_mutex_unlock(&thread->wake_lock);
+}
+
+/** Status of the last frame the render thread rendered */
+ReturnStatus RenderThread_status(const RenderThread* thread) {
+    return __atomic_load_n(&thread->last_status, __ATOMIC_ACQUIRE);
+}
+
+/** Render the last published snapshot if pending, then join the thread */
+void RenderThread_stop(RenderThread* thread) {
+    if (!thread->running) return;
+    pthread_mutex_lock(&thread->wake_lock);
+    __atomic_store_n(&thread->stopping, true, __ATOMIC_RELEASE);
+    pthread_cond_signal(&thread->wake);
+    pthread_mutex_unlock(&thread->wake_lock);
+    pthread_join(thread->thread, NULL);
+    thread->running = false;
+    pthread_cond_destroy(&thread->wake);
+    pthread_mutex_destroy(&thread->wake_lock);
+    SnapshotTripleBuffer_free(&thread->buffer);
+    LOG_INFO(
+        "Render thread stopped, %llu of %llu snapshots rendered",
+        (unsigned long long)thread->frames_rendered,
+        (unsigned long long)thread->published
+    );
+}
+
+static void* RenderThread_main(void* arg) {
+    RenderThread* thread = (RenderThread*)arg;
+    Renderer* renderer = thread->renderer;
+    for (;;) {
+        FrameSnapshot* snapshot = SnapshotTripleBuffer_read(&thread->buffer);
+        if (snapshot == NULL) {
+            // Checked again under the lock so a publish can't be missed
+            pthread_mutex_lock(&thread->wake_lock);
+            bool stopping =
+                __atomic_load_n(&thread->stopping, __ATOMIC_ACQUIRE);
+            bool fresh =
+                (__atomic_load_n(&thread->buffer.shared, __ATOMIC_ACQUIRE) &
+                 SNAPSHOT_FRESH) != 0;
+            if (!stopping && !fresh) {
+                pthread_cond_wait(&thread->wake, &thread->wake_lock);
+            }
+            pthread_mutex_unlock(&thread->wake_lock);
+            if (stopping && !fresh) break;
+            continue;
+        }
+
+        // Only recorded when changed, the render applies it
+        Renderer_handle_resize(renderer, snapshot->width, snapshot->height);
+        if (snapshot->has_uniform) {
+            UniformRing_write(
+                &renderer->uniforms,
+                UNIFORM_BLOCK_MAIN,
+                &snapshot->uniform,
+                sizeof(Uniform)
+            );
+        }
+        // Swapped rather than copied.  The snapshot gets back the renderer's
+        // list, cleared but with its storage, so lists stop reallocating
+        // once they fit a frame
+        DrawCommandArray draw_commands = renderer->draw_commands;
+        renderer->draw_commands = snapshot->draw_commands;
+        snapshot->draw_commands = draw_commands;
+        ReturnStatus status = Renderer_render(renderer);
+        __atomic_store_n(&thread->last_status, status, __ATOMIC_RELEASE);
+        ++thread->frames_rendered;
+    }
+    return NULL;
+}
+
+#endif /* RENDER_THREAD_H */
@@ -5,26 +5,107 @@
 #include "cglm/mat4.h"
 #include "cglm/vec3.h"
 #include "core.h"
+#include "frame_pacing.h"
+#include "gpu_timer.h"
 #include "mesh.h"
+#include "mesh_import.h"
+#include "pipeline_cache.h"
+#include "readback.h"
+#include "renderer_stats.h"
+#include "shader_watch.h"
+#include "uniform_ring.h"
 #include "webgpu.h"
 
+// Pipeline keys used by the last run, written by `Renderer_destroy` and read
+// at init to compile them early.  Relative to the working directory, so
+// define it to a path under a cache directory to share it between launch
+// directories.
+#ifndef RAIJIN_PIPELINE_CACHE_PATH
+#define RAIJIN_PIPELINE_CACHE_PATH "raijin_pipelines.cache"
+#endif
+
+// Most views one `Renderer_render_views` call renders
+#define RENDERER_MAX_VIEWS 64
+// Main camera, then a block per view of a multi-view frame
+#define RENDERER_UNIFORM_BLOCKS (UNIFORM_RING_RESERVED + RENDERER_MAX_VIEWS)
+
 /* Types */
 
 typedef struct Uniform {
     mat4 view_proj;
 } Uniform;
 
+// Camera of one view of `Renderer_render_views`
+typedef struct RenderView {
+    mat4 view;
+    mat4 proj;
+} RenderView;
+
+// Instances of each mesh a view draws, a range of the mesh instance buffer
+typedef struct ViewInstances {
+    u32 first[MESH_TYPE_COUNT];
+    u32 count[MESH_TYPE_COUNT];
+} ViewInstances;
+
 typedef struct DrawCommand {
     MeshType mesh_type;
     Instance instance;
 } DrawCommand;
 DEFINE_DYNAMIC_ARRAY(DrawCommand, DrawCommandArray)
 
+typedef enum {
+    // LineList draw of the edge indices after each solid draw
+    EDGE_MODE_LINES,
+    // Outlines shaded by the solid draw itself from barycentrics and the
+    // mesh edge flags, no extra geometry
+    EDGE_MODE_BARYCENTRIC,
+    // Full screen pass detecting depth, normal and object discontinuities,
+    // cost scales with pixels rather than edges
+    EDGE_MODE_SCREEN_SPACE,
+} EdgeMode;
+
+// Everything a recorded solid pass depends on besides buffer contents
+typedef struct RenderBundleKey {
+    u32 instance_counts[MESH_TYPE_COUNT];
+    u32 mesh_generations[MESH_TYPE_COUNT];
+    u32 pipeline_generation;
+    bool enable_edges;
+    EdgeMode edge_mode;
+} RenderBundleKey;
+
 typedef enum {
     RENDER_MODE_HEADLESS,
     RENDER_MODE_WINDOWED,
 } RenderMode;
 
+// Progress of an init started by `Renderer_begin_init`
+typedef enum {
+    RENDERER_INIT_IDLE,
+    RENDERER_INIT_REQUESTING_ADAPTER,
+    RENDERER_INIT_REQUESTING_DEVICE,
+    RENDERER_INIT_DEVICE_READY,
+    RENDERER_INIT_CREATING_RESOURCES,
+    RENDERER_INIT_READY,
+    RENDERER_INIT_FAILED,
+} RendererInitState;
+
+// Startup steps timed in `Renderer.init_phase_seconds`
+typedef enum {
+    INIT_PHASE_INSTANCE,
+    INIT_PHASE_DEVICE,
+    INIT_PHASE_SURFACE,
+    INIT_PHASE_DEPTH_TEXTURE,
+    INIT_PHASE_SHADERS,
+    INIT_PHASE_PIPELINES,
+    INIT_PHASE_MESH_BUFFERS,
+    INIT_PHASE_COUNT,
+} InitPhase;
+
+typedef struct ErrorScopeContext {
+    bool completed;
+    bool failed;
+} ErrorScopeContext;
+
 typedef struct WgpuCallbackContext {
     bool completed;
     bool success;
@@ -34,32 +115,120 @@ typedef struct WgpuCallbackContext {
 
 typedef struct Renderer {
     bool enable_edges;
+    EdgeMode edge_mode;
+    // Request the software adapter, for machines without a GPU.  Set before
+    // init.
+    bool force_fallback_adapter;
     WGPUAdapter adapter;
     WGPUDevice device;
     WGPUQueue queue;
     RenderMode render_mode;
     union {
         struct {
-            WGPUTexture texture;
+            // Frames render into the ring's textures, see `readback.h`
+            ReadbackRing readback;
         } headless;
         struct {
             WGPUSurface surface;
             WGPUSurfaceConfiguration surface_config;
+            // Size of the next surface configuration, applied once at the
+            // start of a frame however many resizes were requested
+            u32 pending_width;
+            u32 pending_height;
+            bool reconfigure_pending;
         } windowed;
     } render_target;
-    WGPURenderPipeline solid_pipeline;
-    WGPURenderPipeline edges_pipeline;
-    WGPUBuffer uniform_buffer;
+    // Set before init or with `Renderer_set_frame_pacing`, RAIJIN_* variables
+    // override it, see `frame_pacing.h`
+    FramePacingConfig pacing_config;
+    FramePacer pacer;
+    // Times every pass when the device supports timestamp queries
+    GpuTimer gpu_timer;
+    // Filled while a frame renders, then pushed to `stats_history`
+    RendererStats stats;
+    RendererStatsHistory stats_history;
+    // Owns the pipelines and layouts below, they are borrowed from it
+    PipelineCache pipeline_cache;
+    WGPUBindGroupLayout uniform_bind_group_layout;
+    // One pipeline per vertex format
+    WGPURenderPipeline solid_pipelines[VERTEX_FORMAT_COUNT];
+    WGPURenderPipeline edges_pipelines[VERTEX_FORMAT_COUNT];
+    WGPURenderPipeline wireframe_pipelines[VERTEX_FORMAT_COUNT];
+    WGPUBindGroupLayout wireframe_bind_group_layout;
+    // EDGE_MODE_SCREEN_SPACE: the solid pass also writes normals and object
+    // ids, the outline pass reads them with the depth texture
+    WGPURenderPipeline gbuffer_pipelines[VERTEX_FORMAT_COUNT];
+    WGPURenderPipeline outline_pipeline;
+    WGPUBindGroupLayout outline_bind_group_layout;
+    WGPUBindGroup outline_bind_group;
+    WGPUTexture normal_texture;
+    WGPUTextureView normal_texture_view;
+    WGPUTexture id_texture;
+    WGPUTextureView id_texture_view;
+    // Every pass binds `uniform_bind_group` at the offset of its block
+    UniformRing uniforms;
     WGPUBindGroup uniform_bind_group;
     WGPUTexture depth_texture;
     WGPUTextureView depth_texture_view;
     DrawCommandArray draw_commands;
     Mesh meshes[MESH_TYPE_COUNT];
+    // Solid pass draws recorded once and replayed while `bundle_key` holds
+    WGPURenderBundle solid_bundle;
+    RenderBundleKey bundle_key;
+    // Bumped whenever pipelines are recreated
+    u32 pipeline_generation;
+    // Frames identical to the last presented one are skipped, see
+    // `Renderer_set_on_demand`
+    bool on_demand;
+    // Set when the last `Renderer_render` skipped its frame, and by
+    // `Renderer_invalidate`.  Both are atomic, any thread may read or set
+    // them.
+    bool idle;
+    bool invalidated;
+    bool has_presented_hash;
+    u64 presented_hash;
+    u64 skipped_frames;
+    // Active when RAIJIN_SHADER_DIR is set, see `Renderer_reload_shaders`
+    ShaderWatcher shader_watcher;
+    // Device request and asset loading threads of `Renderer_begin_init`,
+    // joined by `Renderer_init_windowed` and `Renderer_init_headless`
+    RendererInitState init_state;
+    WGPUInstance init_instance;
+    pthread_t init_threads[2];
+    bool init_threads_spawned[2];
+    bool init_threads_running;
+    ReturnStatus asset_status;
+    // Default shader read ahead by the asset thread, consumed by
+    // `Renderer_create_pipelines`
+    CharArray shader_source;
+    // Duration of each step of the last init.  The device request and the
+    // shader read run concurrently, so phases may overlap.
+    f64 init_phase_seconds[INIT_PHASE_COUNT];
 } Renderer;
 
+// Read-only inputs shared by the pipeline compile threads
+typedef struct PipelineBuildContext {
+    Renderer* renderer;
+    WGPUShaderModule shader;
+    WGPUBindGroupLayout uniform_layout;
+    WGPUPipelineLayout pipeline_layout;
+    const WGPUColorTargetState* color_target;
+    const WGPUDepthStencilState* depth_stencil;
+    WGPUTextureFormat color_format;
+} PipelineBuildContext;
+
 /* Function Prototypes */
 
+void Renderer_create_vertex_buffer(
+    Renderer* renderer, Mesh* mesh, const Vertex* vertices, u32 count
+);
+void Renderer_create_edge_flag_buffer(
+    Renderer* renderer, Mesh* mesh, const u32* flags, u32 word_count
+);
 void Renderer_create_mesh_buffers(Mesh* mesh, Renderer* renderer);
+void Renderer_begin_init(Renderer* renderer, const WGPUInstance instance);
+RendererInitState Renderer_init_state(const Renderer* renderer);
+const char* InitPhase_name(InitPhase phase);
 ReturnStatus Renderer_init_windowed(
     Renderer* renderer,
     const WGPUInstance instance,
@@ -67,26 +236,151 @@ ReturnStatus Renderer_init_windowed(
     const u32 height
 );
 ReturnStatus Renderer_init_headless(Renderer* renderer, u32 width, u32 height);
+void Renderer_create_depth_texture(Renderer* renderer, u32 width, u32 height);
+ReturnStatus Renderer_create_pipelines(
+    Renderer* renderer, WGPUTextureFormat color_format
+);
+ReturnStatus Renderer_reload_shaders(Renderer* renderer);
+u32 Renderer_upload_instances(Renderer* renderer, const MeshType mesh_type);
 void Renderer_render_mesh(
     Renderer* renderer,
     const MeshType mesh_type,
-    const WGPURenderPassEncoder render_pass_encoder
+    const u32 first_instance,
+    const u32 instance_count,
+    const WGPURenderBundleEncoder bundle_encoder
+);
+void Renderer_invalidate_render_bundle(Renderer* renderer);
+void Renderer_require_pipelines(
+    Renderer* renderer, const u32 instance_counts[MESH_TYPE_COUNT]
 );
 void Renderer_render_pass_solid(
     Renderer* renderer,
     const WGPUCommandEncoder command_encoder,
     const WGPUTextureView texture_view
 );
-void Renderer_render_to_view(
+void Renderer_render_pass_outline(
+    Renderer* renderer,
+    const WGPUCommandEncoder command_encoder,
+    const WGPUTextureView texture_view
+);
+WGPUSubmissionIndex Renderer_render_to_view(
     Renderer* renderer, const WGPUTextureView texture_view
 );
+void Renderer_set_frame_pacing(
+    Renderer* renderer, const FramePacingConfig* config
+);
+void Renderer_set_frame_callback(
+    Renderer* renderer, HeadlessFrameCallback callback, void* userdata
+);
+u32 Renderer_poll_frames(Renderer* renderer, bool wait);
+void Renderer_set_on_demand(Renderer* renderer, bool on_demand);
+void Renderer_invalidate(Renderer* renderer);
+bool Renderer_is_idle(const Renderer* renderer);
+const GpuFrameTimes* Renderer_gpu_times(const Renderer* renderer);
+const RendererStats* Renderer_stats(const Renderer* renderer);
+void Renderer_stats_summary(
+    const Renderer* renderer, RendererStatsSummary* summary
+);
+void Renderer_create_outline_targets(Renderer* renderer, u32 width, u32 height);
 ReturnStatus Renderer_render(Renderer* renderer);
+ReturnStatus Renderer_render_views(
+    Renderer* renderer, const RenderView* views, u32 view_count
+);
 void Renderer_destroy(Renderer* renderer);
 void Renderer_handle_resize(Renderer* renderer, u32 width, u32 height);
 void Renderer_update_uniforms(
     Renderer* renderer, mat4 proj_matrix, mat4 view_matrix
 );
 
+static ReturnStatus Renderer_request_device(
+    Renderer* renderer,
+    const WGPUInstance instance,
+    const WGPUSurface compatible_surface
+);
+static ReturnStatus Renderer_load_assets(Renderer* renderer);
+static ReturnStatus Renderer_wait_init(Renderer* renderer);
+static ReturnStatus Renderer_init_resources(
+    Renderer* renderer, WGPUTextureFormat color_format, u32 width, u32 height
+);
+static void Renderer_create_wireframe_pipelines(
+    Renderer* renderer,
+    WGPUShaderModule shader,
+    WGPUBindGroupLayout uniform_layout,
+    const WGPUColorTargetState* color_target,
+    WGPUTextureFormat depth_format
+);
+static WGPUBindGroup Renderer_wireframe_bind_group(
+    Renderer* renderer, Mesh* mesh
+);
+static void Renderer_gather_instances(
+    const Renderer* renderer, const MeshType mesh_type, InstanceArray* out
+);
+static void Renderer_write_instances(
+    Renderer* renderer, const MeshType mesh_type, InstanceArray* instances
+);
+static void Renderer_upload_view_instances(
+    Renderer* renderer,
+    const MeshType mesh_type,
+    vec4 (*frustums)[6],
+    u32 view_count,
+    ViewInstances* ranges
+);
+static void Renderer_count_draws(
+    Renderer* renderer, const u32 instance_counts[MESH_TYPE_COUNT]
+);
+static void Renderer_request_reconfigure(Renderer* renderer);
+static bool Renderer_apply_resize(Renderer* renderer);
+static void Renderer_fit_targets(Renderer* renderer, u32 width, u32 height);
+static ReturnStatus Renderer_acquire_surface_texture(
+    Renderer* renderer, WGPUSurfaceTexture* surface_texture
+);
+static u64 Renderer_frame_hash(const Renderer* renderer);
+static bool Renderer_frame_unchanged(Renderer* renderer, u64 hash);
+static f64 Renderer_begin_stats(Renderer* renderer);
+static void Renderer_end_stats(Renderer* renderer, f64 start);
+static void Renderer_flush_uniforms(Renderer* renderer);
+static WGPURenderBundle Renderer_record_render_bundle(
+    Renderer* renderer,
+    const RenderBundleKey* key,
+    u32 uniform_offset,
+    const u32 first_instances[MESH_TYPE_COUNT]
+);
+static void Renderer_execute_solid_pass(
+    Renderer* renderer,
+    const WGPUCommandEncoder command_encoder,
+    const WGPUTextureView texture_view,
+    WGPURenderBundle bundle
+);
+static void Renderer_encode_outline_pass(
+    Renderer* renderer,
+    const WGPUCommandEncoder command_encoder,
+    const WGPUTextureView texture_view,
+    u32 uniform_offset
+);
+static ReturnStatus Renderer_set_view_layers(
+    Renderer* renderer, u32 layer_count
+);
+static u32 Renderer_mesh_pipelines(
+    const Renderer* renderer, VertexFormat format, WGPURenderPipeline out[2]
+);
+static void Renderer_encode_passes(
+    Renderer* renderer,
+    const WGPUCommandEncoder command_encoder,
+    const WGPUTextureView texture_view
+);
+static ReturnStatus Renderer_render_headless(Renderer* renderer);
+static void Renderer_apply_frame_pacing(
+    Renderer* renderer, const WGPUSurfaceCapabilities* surface_caps
+);
+static void Renderer_create_outline_pipelines(
+    Renderer* renderer,
+    WGPUShaderModule shader,
+    WGPUBindGroupLayout uniform_layout,
+    const WGPUColorTargetState* color_target,
+    const WGPUDepthStencilState* depth_stencil,
+    WGPUTextureFormat color_format
+);
+
 static inline void adapter_request_callback(
     WGPURequestAdapterStatus status,
     WGPUAdapter adapter,
@@ -103,38 +397,126 @@ static inline void device_request_callback(
     void* userdata2
 );
 
+static inline void error_scope_callback(
+    WGPUPopErrorScopeStatus status,
+    WGPUErrorType type,
+    WGPUStringView msg,
+    void* userdata1,
+    void* userdata2
+);
+
 /* Functions */
 
-void Renderer_create_mesh_buffers(Mesh* mesh, Renderer* renderer) {
-    // Vertex buffer
+static inline void Renderer_set_init_state(
+    Renderer* renderer, RendererInitState state
+) {
+    __atomic_store_n(&renderer->init_state, state, __ATOMIC_RELEASE);
+}
+
+/** Format of the color target the renderer draws into */
+static inline WGPUTextureFormat Renderer_color_format(
+    const Renderer* renderer
+) {
+    return renderer->render_mode == RENDER_MODE_WINDOWED
+               ? renderer->render_target.windowed.surface_config.format
+               : WGPUTextureFormat_RGBA8Unorm;
+}
+
+/** Create and fill the vertex buffer of a mesh in its vertex format
+ *
+ * @param[in] renderer      Renderer
+ * @param[in,out] mesh      Mesh, `bounds` is set, and `dequantize` for
+ *                          quantized meshes
+ * @param[in] vertices      Full precision vertices
+ * @param[in] count         Number of vertices
+ */
+void Renderer_create_vertex_buffer(
+    Renderer* renderer, Mesh* mesh, const Vertex* vertices, u32 count
+) {
+    const void* data = vertices;
+    QuantizedVertexArray quantized = {0};
+    if (mesh->vertex_format == VERTEX_FORMAT_QUANTIZED) {
+        quantize_vertices(vertices, count, &quantized, mesh->dequantize);
+        data = quantized.items;
+    }
+    compute_vertex_bounds(vertices, count, mesh->bounds[0], mesh->bounds[1]);
+    u64 size = (u64)count * VertexFormat_stride(mesh->vertex_format);
+    // Anything recorded against the previous buffers is stale
+    ++mesh->buffer_generation;
+    if (mesh->wireframe_bind_group != NULL) {
+        wgpuBindGroupRelease(mesh->wireframe_bind_group);
+        mesh->wireframe_bind_group = NULL;
+    }
+    if (mesh->vertex_buffer != NULL) wgpuBufferRelease(mesh->vertex_buffer);
+    // Storage for vertex pulling in EDGE_MODE_BARYCENTRIC
     mesh->vertex_buffer = create_buffer(
         renderer->device,
-        mesh->vertices.count * sizeof(Vertex),
-        WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst,
+        size,
+        WGPUBufferUsage_Vertex | WGPUBufferUsage_Storage |
+            WGPUBufferUsage_CopyDst,
         "Vertex Buffer"
     );
+    wgpuQueueWriteBuffer(renderer->queue, mesh->vertex_buffer, 0, data, size);
+    QuantizedVertexArray_free(&quantized);
+}
 
-    wgpuQueueWriteBuffer(
-        renderer->queue,
-        mesh->vertex_buffer,
-        0,
-        mesh->vertices.items,
-        mesh->vertices.count * sizeof(Vertex)
+/** Create and fill the edge flag buffer of a mesh
+ *
+ * @param[in] renderer      Renderer
+ * @param[in,out] mesh      Mesh
+ * @param[in] flags         Packed flags, see `Mesh_compute_edge_flags`
+ * @param[in] word_count    Number of words in `flags`
+ */
+void Renderer_create_edge_flag_buffer(
+    Renderer* renderer, Mesh* mesh, const u32* flags, u32 word_count
+) {
+    if (mesh->edge_flag_buffer != NULL) {
+        wgpuBufferRelease(mesh->edge_flag_buffer);
+    }
+    // Storage bindings can't be empty
+    mesh->edge_flag_buffer = create_buffer(
+        renderer->device,
+        (word_count > 0 ? word_count : 1) * sizeof(u32),
+        WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+        "Edge Flag Buffer"
+    );
+    if (word_count > 0) {
+        wgpuQueueWriteBuffer(
+            renderer->queue,
+            mesh->edge_flag_buffer,
+            0,
+            flags,
+            word_count * sizeof(u32)
+        );
+    }
+}
+
+void Renderer_create_mesh_buffers(Mesh* mesh, Renderer* renderer) {
+    mesh->vertex_count = mesh->vertices.count;
+    mesh->index_count = mesh->indices.count;
+    mesh->edge_index_count = mesh->edge_indices.count;
+
+    // Vertex buffer
+    Renderer_create_vertex_buffer(
+        renderer, mesh, mesh->vertices.items, mesh->vertices.count
     );
 
     // Instance buffer
+    if (mesh->instance_buffer != NULL) wgpuBufferRelease(mesh->instance_buffer);
     mesh->instance_buffer = create_buffer(
         renderer->device,
         mesh->instance_capacity * sizeof(Instance),
         WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst,
-        "Index Buffer"
+        "Mesh Instance Buffer"
     );
 
     // Index buffer
+    if (mesh->index_buffer != NULL) wgpuBufferRelease(mesh->index_buffer);
     mesh->index_buffer = create_buffer(
         renderer->device,
-        mesh->indices.count * sizeof(u16),
-        WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst,
+        mesh->indices.count * sizeof(u32),
+        WGPUBufferUsage_Index | WGPUBufferUsage_Storage |
+            WGPUBufferUsage_CopyDst,
         "Index Buffer"
     );
 
@@ -143,23 +525,18 @@ void Renderer_create_mesh_buffers(Mesh* mesh, Renderer* renderer) {
         mesh->index_buffer,
         0,
         mesh->indices.items,
-        mesh->indices.count * sizeof(u16)
-    );
-
-    // Edge instance buffer
-    mesh->edge_instance_buffer = create_buffer(
-        renderer->device,
-        mesh->edge_instance_capacity * sizeof(Instance),
-        WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst,
-        "Index Buffer"
+        mesh->indices.count * sizeof(u32)
     );
 
-    // Index buffer
+    // Edge index buffer
+    if (mesh->edge_index_buffer != NULL) {
+        wgpuBufferRelease(mesh->edge_index_buffer);
+    }
     mesh->edge_index_buffer = create_buffer(
         renderer->device,
-        mesh->edge_indices.count * sizeof(u16),
+        mesh->edge_indices.count * sizeof(u32),
         WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst,
-        "Index Buffer"
+        "Edge Index Buffer"
     );
 
     wgpuQueueWriteBuffer(
@@ -167,17 +544,29 @@ void Renderer_create_mesh_buffers(Mesh* mesh, Renderer* renderer) {
         mesh->edge_index_buffer,
         0,
         mesh->edge_indices.items,
-        mesh->edge_indices.count * sizeof(u16)
+        mesh->edge_indices.count * sizeof(u32)
+    );
+
+    // Edge flag buffer
+    Renderer_create_edge_flag_buffer(
+        renderer, mesh, mesh->edge_flags.items, mesh->edge_flags.count
     );
 }
 
-ReturnStatus Renderer_init_windowed(
+// Request the adapter and device once, re-initialization keeps them so the
+// pipeline cache stays valid
+static ReturnStatus Renderer_request_device(
     Renderer* renderer,
     const WGPUInstance instance,
-    const u32 width,
-    const u32 height
+    const WGPUSurface compatible_surface
 ) {
-    renderer->render_mode = RENDER_MODE_WINDOWED;
+    if (renderer->device != NULL) {
+        LOG_DEBUG("Reusing device");
+        Renderer_set_init_state(renderer, RENDERER_INIT_DEVICE_READY);
+        return RETURN_SUCCESS;
+    }
+    Renderer_set_init_state(renderer, RENDERER_INIT_REQUESTING_ADAPTER);
+    f64 start = now_seconds();
     WgpuCallbackContext cb_ctx = {
         .completed = false,
         .adapter = &renderer->adapter,
@@ -189,10 +578,9 @@ ReturnStatus Renderer_init_windowed(
         wgpuAdapterRelease(renderer->adapter);
     }
     WGPURequestAdapterOptions adapter_options = {
-        // Don't need a surface
-        .compatibleSurface = renderer->render_target.windowed.surface,
+        .compatibleSurface = compatible_surface,
         .powerPreference = WGPUPowerPreference_HighPerformance,
-        .forceFallbackAdapter = false,
+        .forceFallbackAdapter = renderer->force_fallback_adapter,
     };
     WGPURequestAdapterCallbackInfo adapter_cb_info = {
         .callback = adapter_request_callback,
@@ -200,20 +588,32 @@ ReturnStatus Renderer_init_windowed(
     };
     wgpuInstanceRequestAdapter(instance, &adapter_options, adapter_cb_info);
 
-    // TODO (mmckenna) : Handle this async
+    // Blocks the init thread only, see `Renderer_begin_init`
     while (!cb_ctx.completed) {
         wgpuInstanceProcessEvents(instance);
     }
     if (!cb_ctx.success) {
+        Renderer_set_init_state(renderer, RENDERER_INIT_FAILED);
         return RETURN_FAILURE;
     }
     LOG_DEBUG("Adapter request successful");
 
     // Device request
-    if (renderer->device != NULL) {
-        wgpuDeviceRelease(renderer->device);
+    Renderer_set_init_state(renderer, RENDERER_INIT_REQUESTING_DEVICE);
+    cb_ctx.completed = false;
+    // Timestamp queries are optional, GPU timing stays off without them
+    WGPUFeatureName features[1];
+    usize feature_count = 0;
+    if (wgpuAdapterHasFeature(
+            renderer->adapter, WGPUFeatureName_TimestampQuery
+        )) {
+        features[feature_count++] = WGPUFeatureName_TimestampQuery;
     }
-    WGPUDeviceDescriptor device_desc = {.label = {"Device", WGPU_STRLEN}};
+    WGPUDeviceDescriptor device_desc = {
+        .label = {"Device", WGPU_STRLEN},
+        .requiredFeatureCount = feature_count,
+        .requiredFeatures = features,
+    };
     WGPURequestDeviceCallbackInfo device_cb_info = {
         .callback = device_request_callback,
         .userdata1 = &cb_ctx,
@@ -221,67 +621,144 @@ ReturnStatus Renderer_init_windowed(
 
     wgpuAdapterRequestDevice(renderer->adapter, &device_desc, device_cb_info);
 
-    // TODO (mckenna) : Handle this async
     while (!cb_ctx.completed) {
         wgpuInstanceProcessEvents(instance);
     }
     if (!cb_ctx.success) {
         LOG_ERROR("Device request error");
         wgpuAdapterRelease(renderer->adapter);
+        renderer->adapter = NULL;
+        Renderer_set_init_state(renderer, RENDERER_INIT_FAILED);
         return RETURN_FAILURE;
     }
     LOG_DEBUG("Device request successful");
 
     // Get device queue
     renderer->queue = wgpuDeviceGetQueue(renderer->device);
+    renderer->init_phase_seconds[INIT_PHASE_DEVICE] = now_seconds() - start;
+    Renderer_set_init_state(renderer, RENDERER_INIT_DEVICE_READY);
+    return RETURN_SUCCESS;
+}
 
-    // Create render target
-    WGPUSurfaceCapabilities surface_caps = {0};
-    wgpuSurfaceGetCapabilities(
-        renderer->render_target.windowed.surface,
-        renderer->adapter,
-        &surface_caps
-    );
-    if (surface_caps.formatCount == 0) {
-        LOG_ERROR("No supported surface formats found");
+static void* Renderer_device_thread_main(void* arg) {
+    Renderer* renderer = (Renderer*)arg;
+    Renderer_request_device(renderer, renderer->init_instance, NULL);
+    return NULL;
+}
+
+static void* Renderer_asset_thread_main(void* arg) {
+    Renderer* renderer = (Renderer*)arg;
+    renderer->asset_status = Renderer_load_assets(renderer);
+    return NULL;
+}
+
+/** Start requesting the device and loading assets in the background
+ *
+ * Returns right away so the caller can create its window meanwhile, startup
+ * then takes as long as the slowest of the three.  The init functions call
+ * it themselves when nobody did and wait for it.  The adapter is requested
+ * without a compatible surface, `Renderer_init_windowed` checks it can
+ * present to the surface.
+ *
+ * @param[in] renderer  Renderer
+ * @param[in] instance  Instance, outlives the init
+ */
+void Renderer_begin_init(Renderer* renderer, const WGPUInstance instance) {
+    if (renderer->init_threads_running) return;
+    renderer->init_instance = instance;
+    renderer->init_threads_running = true;
+    Renderer_set_init_state(renderer, RENDERER_INIT_REQUESTING_ADAPTER);
+    void* (*thread_mains[2])(void*) = {
+        Renderer_device_thread_main,
+        Renderer_asset_thread_main,
+    };
+    for (u32 i = 0; i < 2; ++i) {
+        renderer->init_threads_spawned[i] =
+            pthread_create(
+                &renderer->init_threads[i], NULL, thread_mains[i], renderer
+            ) == 0;
+        if (!renderer->init_threads_spawned[i]) thread_mains[i](renderer);
+    }
+}
+
+/** Current init step, safe to call while `Renderer_begin_init` runs */
+RendererInitState Renderer_init_state(const Renderer* renderer) {
+    return __atomic_load_n(&renderer->init_state, __ATOMIC_ACQUIRE);
+}
+
+const char* InitPhase_name(InitPhase phase) {
+    switch (phase) {
+        case INIT_PHASE_INSTANCE: return "instance";
+        case INIT_PHASE_DEVICE: return "device";
+        case INIT_PHASE_SURFACE: return "surface";
+        case INIT_PHASE_DEPTH_TEXTURE: return "depth_texture";
+        case INIT_PHASE_SHADERS: return "shaders";
+        case INIT_PHASE_PIPELINES: return "pipelines";
+        case INIT_PHASE_MESH_BUFFERS: return "mesh_buffers";
+        case INIT_PHASE_COUNT: break;
+    }
+    return "unknown";
+}
+
+// CPU side of the startup assets, runs before the device exists
+static ReturnStatus Renderer_load_assets(Renderer* renderer) {
+    Mesh* cube = &renderer->meshes[MESH_TYPE_CUBE];
+    if (cube->vertex_buffer == NULL && cube->vertices.count == 0) {
+        Mesh_create_cube(cube);
+        Mesh_compute_edge_flags(cube, NULL);
+    }
+    if (renderer->shader_source.count > 0) return RETURN_SUCCESS;
+    f64 start = now_seconds();
+    ReturnStatus status =
+        load_shader_source("default_shader.wgsl", &renderer->shader_source);
+    renderer->init_phase_seconds[INIT_PHASE_SHADERS] = now_seconds() - start;
+    return status;
+}
+
+// Joins the threads of `Renderer_begin_init`
+static ReturnStatus Renderer_wait_init(Renderer* renderer) {
+    if (!renderer->init_threads_running) return RETURN_FAILURE;
+    for (u32 i = 0; i < 2; ++i) {
+        if (renderer->init_threads_spawned[i]) {
+            pthread_join(renderer->init_threads[i], NULL);
+            renderer->init_threads_spawned[i] = false;
+        }
+    }
+    renderer->init_threads_running = false;
+    if (renderer->asset_status != RETURN_SUCCESS) {
+        LOG_ERROR("Failed to load shader");
+        Renderer_set_init_state(renderer, RENDERER_INIT_FAILED);
         return RETURN_FAILURE;
     }
-    LOG_DEBUG("%ld surface formats found.", surface_caps.formatCount);
-    WGPUTextureFormat texture_format = surface_caps.formats[0];
-    renderer->render_target.windowed.surface_config =
-        (WGPUSurfaceConfiguration){
-            .usage = WGPUTextureUsage_RenderAttachment,
-            .format = texture_format,
-            .width = width,
-            .height = height,
-            .presentMode = WGPUPresentMode_Fifo,
-            .device = renderer->device,
-        };
-    wgpuSurfaceConfigure(
-        renderer->render_target.windowed.surface,
-        &renderer->render_target.windowed.surface_config
-    );
-    LOG_DEBUG(
-        "Configured surface size: [%d, %d]",
-        renderer->render_target.windowed.surface_config.width,
-        renderer->render_target.windowed.surface_config.height
-    );
+    if (Renderer_init_state(renderer) != RENDERER_INIT_DEVICE_READY) {
+        return RETURN_FAILURE;
+    }
+    Renderer_set_init_state(renderer, RENDERER_INIT_CREATING_RESOURCES);
+    return RETURN_SUCCESS;
+}
 
-    // Create depth texture
+/** (Re)create the depth texture and the targets sized after it
+ *
+ * @param[in] renderer  Renderer
+ * @param[in] width     Target width, 0 is clamped to 1
+ * @param[in] height    Target height, 0 is clamped to 1
+ */
+void Renderer_create_depth_texture(Renderer* renderer, u32 width, u32 height) {
     WGPUTextureFormat depth_texture_format = WGPUTextureFormat_Depth24Plus;
     WGPUTextureDescriptor depth_texture_desc = {
         .label = {"Depth Texture", WGPU_STRLEN},
         .size =
             (WGPUExtent3D){
-                .width = width > 0 ? width : 256,
-                .height = height > 0 ? height : 256,
+                .width = width > 0 ? width : 1,
+                .height = height > 0 ? height : 1,
                 .depthOrArrayLayers = 1,
             },
         .mipLevelCount = 1,
         .sampleCount = 1,
         .dimension = WGPUTextureDimension_2D,
         .format = depth_texture_format,
-        .usage = WGPUTextureUsage_RenderAttachment,
+        .usage = WGPUTextureUsage_RenderAttachment |
+                 WGPUTextureUsage_TextureBinding,
         .viewFormats = &depth_texture_format,
         .viewFormatCount = 1,
     };
@@ -306,26 +783,139 @@ ReturnStatus Renderer_init_windowed(
     renderer->depth_texture_view = wgpuTextureCreateView(
         renderer->depth_texture, &depth_texture_view_desc
     );
-
-    // Create uniform buffer
-    mat4 proj_matrix = {0};
-    glm_perspective_rh_no(
-        glm_rad(60.0), (f32)width / (f32)height, 0.1, 1000.0, proj_matrix
+    Renderer_create_outline_targets(
+        renderer,
+        wgpuTextureGetWidth(renderer->depth_texture),
+        wgpuTextureGetHeight(renderer->depth_texture)
     );
-    mat4 view_matrix = {0};
-    glm_mat4_identity(view_matrix);
-    WGPUBufferDescriptor uniform_buffer_desc = {
-        .label = {"Uniform Buffer", WGPU_STRLEN},
-        .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
-        .size = sizeof(Uniform),
-        .mappedAtCreation = false,
+}
+
+// Groups of `Renderer_create_pipeline_group`: solid and edges per vertex
+// format, then wireframe and screen space outline
+#define PIPELINE_GROUP_COUNT (VERTEX_FORMAT_COUNT + 2)
+
+// Solid and edges pipelines for meshes of one vertex format
+static void Renderer_create_solid_pipelines(
+    const PipelineBuildContext* ctx, VertexFormat format
+) {
+    Renderer* renderer = ctx->renderer;
+    PipelineCache* cache = &renderer->pipeline_cache;
+    WGPUFragmentState frag_state = {
+        .module = ctx->shader,
+        .entryPoint = {"fs_main", WGPU_STRLEN},
+        .targets = ctx->color_target,
+        .targetCount = 1,
+    };
+    WGPUFragmentState edges_frag_state = {
+        .module = ctx->shader,
+        .entryPoint = {"edges_fs_main", WGPU_STRLEN},
+        .targets = ctx->color_target,
+        .targetCount = 1,
+    };
+    // Edges lie on the solid surface they outline
+    WGPUDepthStencilState edges_depth_pencil_state = {
+        .format = WGPUTextureFormat_Depth24Plus,
+        .depthWriteEnabled = false,
+        .depthCompare = WGPUCompareFunction_LessEqual,
+    };
+    // Same entry point, decoding the quantized attributes
+    WGPUVertexBufferLayout buffers[] = {
+        Vertex_desc(format),
+        Instance_desc(),
+    };
+    WGPUConstantEntry constants[] = {
+        {
+            .key = {"QUANTIZED", WGPU_STRLEN},
+            .value = format == VERTEX_FORMAT_QUANTIZED,
+        },
+    };
+    WGPURenderPipelineDescriptor pipeline_desc = {
+        .label = {"Solid Pipeline", WGPU_STRLEN},
+        .layout = ctx->pipeline_layout,
+        .vertex =
+            (WGPUVertexState){
+                .module = ctx->shader,
+                .entryPoint = {"vs_main", WGPU_STRLEN},
+                .constants = constants,
+                .constantCount = 1,
+                .bufferCount = 2,
+                .buffers = buffers,
+            },
+        .fragment = &frag_state,
+        .depthStencil = ctx->depth_stencil,
+        .primitive =
+            (WGPUPrimitiveState){
+                .topology = WGPUPrimitiveTopology_TriangleList,
+                .frontFace = WGPUFrontFace_CCW,
+                .cullMode = WGPUCullMode_Back,
+                .unclippedDepth = false,
+            },
+        .multisample = (WGPUMultisampleState){
+            .count = 1,
+            .mask = 0xFFFFFFFF,
+            .alphaToCoverageEnabled = false,
+        },
     };
-    renderer->uniform_buffer =
-        wgpuDeviceCreateBuffer(renderer->device, &uniform_buffer_desc);
+    renderer->solid_pipelines[format] =
+        PipelineCache_render_pipeline(cache, &pipeline_desc);
+
+    pipeline_desc.label = (WGPUStringView){"Edges Pipeline", WGPU_STRLEN};
+    pipeline_desc.fragment = &edges_frag_state;
+    pipeline_desc.depthStencil = &edges_depth_pencil_state;
+    pipeline_desc.primitive.topology = WGPUPrimitiveTopology_LineList;
+    renderer->edges_pipelines[format] =
+        PipelineCache_render_pipeline(cache, &pipeline_desc);
+}
+
+static void Renderer_create_pipeline_group(void* arg, u32 index, u32 count) {
+    (void)count;
+    const PipelineBuildContext* ctx = (const PipelineBuildContext*)arg;
+    if (index < VERTEX_FORMAT_COUNT) {
+        Renderer_create_solid_pipelines(ctx, index);
+    } else if (index == VERTEX_FORMAT_COUNT) {
+        Renderer_create_wireframe_pipelines(
+            ctx->renderer,
+            ctx->shader,
+            ctx->uniform_layout,
+            ctx->color_target,
+            WGPUTextureFormat_Depth24Plus
+        );
+    } else {
+        Renderer_create_outline_pipelines(
+            ctx->renderer,
+            ctx->shader,
+            ctx->uniform_layout,
+            ctx->color_target,
+            ctx->depth_stencil,
+            ctx->color_format
+        );
+    }
+}
 
-    // Create meshes
-    Mesh_create_cube(&renderer->meshes[MESH_TYPE_CUBE]);
-    Renderer_create_mesh_buffers(&renderer->meshes[MESH_TYPE_CUBE], renderer);
+/** Create every pipeline drawing into `color_format`
+ *
+ * Goes through the pipeline cache, so calling it again with unchanged
+ * shaders and formats compiles nothing.
+ *
+ * @param[in] renderer      Renderer
+ * @param[in] color_format  Format of the color target
+ * @returns                 Return status
+ */
+ReturnStatus Renderer_create_pipelines(
+    Renderer* renderer, WGPUTextureFormat color_format
+) {
+    PipelineCache* cache = &renderer->pipeline_cache;
+    PipelineCache_set_device(cache, renderer->device);
+    // Only compile what the previous run on this adapter drew with, the
+    // rest is compiled by `Renderer_require_pipelines` on first use
+    if (cache->identity == 0) {
+        PipelineCache_load(
+            cache,
+            RAIJIN_PIPELINE_CACHE_PATH,
+            adapter_identity(renderer->adapter)
+        );
+        cache->defer_cold = true;
+    }
 
     // Create bind group layout
     WGPUBindGroupLayoutEntry bind_group_layout_entries[] = {
@@ -335,7 +925,7 @@ ReturnStatus Renderer_init_windowed(
             .visibility = WGPUShaderStage_Vertex,
             .buffer = (WGPUBufferBindingLayout){
                 .type = WGPUBufferBindingType_Uniform,
-                .hasDynamicOffset = false,
+                .hasDynamicOffset = true,
                 .minBindingSize = sizeof(Uniform),
             },
         },
@@ -345,57 +935,33 @@ ReturnStatus Renderer_init_windowed(
         .entries = bind_group_layout_entries,
         .entryCount = 1,
     };
-    WGPUBindGroupLayout bind_group_layout = wgpuDeviceCreateBindGroupLayout(
-        renderer->device, &bind_group_layout_desc
-    );
-
-    // Create bind group
-    WGPUBindGroupEntry bind_group_entries[] = {
-        (WGPUBindGroupEntry){
-            .binding = 0,
-            .buffer = renderer->uniform_buffer,
-            .offset = 0,
-            .size = sizeof(Uniform),
-        },
-    };
-    WGPUBindGroupDescriptor bind_group_desc = {
-        .label = {"Bind Group", WGPU_STRLEN},
-        .layout = bind_group_layout,
-        .entries = bind_group_entries,
-        .entryCount = 1,
-    };
-    renderer->uniform_bind_group =
-        wgpuDeviceCreateBindGroup(renderer->device, &bind_group_desc);
-
-    // Create solid render pipeline
-    CharArray default_shader_src = {0};
-    ReturnStatus shader_load_status = load_shader(
-        RAIJIN_ASSETS_DIR "/shaders/default_shader.wgsl", &default_shader_src
-    );
-    if (shader_load_status != RETURN_SUCCESS) {
+    WGPUBindGroupLayout bind_group_layout =
+        PipelineCache_bind_group_layout(cache, &bind_group_layout_desc);
+    renderer->uniform_bind_group_layout = bind_group_layout;
+
+    // Create shader module, from the source read ahead at startup if any
+    CharArray* default_shader_src = &renderer->shader_source;
+    f64 shader_start = now_seconds();
+    f64 read_ahead_seconds = 0.0;
+    if (default_shader_src->count > 0) {
+        read_ahead_seconds = renderer->init_phase_seconds[INIT_PHASE_SHADERS];
+    }
+    if (default_shader_src->count == 0 &&
+        load_shader_source("default_shader.wgsl", default_shader_src) !=
+            RETURN_SUCCESS) {
         LOG_ERROR("Failed to load shader");
-        // TODO (mmcknna) : what to do when shader loading fails?
+        return RETURN_FAILURE;
     }
-    WGPUShaderSourceWGSL wgsl_desc = {
-        .chain.sType = WGPUSType_ShaderSourceWGSL,
-        .code = {.data = default_shader_src.items, default_shader_src.count}
-    };
-    WGPUShaderModuleDescriptor default_shader_desc = {
-        .nextInChain = &wgsl_desc.chain,
-        .label = {"Default Shader", WGPU_STRLEN},
-    };
-    WGPUShaderModule default_shader =
-        wgpuDeviceCreateShaderModule(renderer->device, &default_shader_desc);
-    WGPUVertexBufferLayout vertex_buffer_layouts[] = {
-        Vertex_desc(),
-        Instance_desc(),
-    };
-    WGPUVertexState vert_state = {
-        .module = default_shader,
-        .entryPoint = {"vs_main", WGPU_STRLEN},
-        .bufferCount = 2,
-        .buffers = vertex_buffer_layouts,
-    };
+    WGPUShaderModule default_shader = PipelineCache_shader_module(
+        cache,
+        "Default Shader",
+        default_shader_src->items,
+        default_shader_src->count
+    );
+    CharArray_free(default_shader_src);
+    f64 pipeline_start = now_seconds();
+    renderer->init_phase_seconds[INIT_PHASE_SHADERS] =
+        read_ahead_seconds + pipeline_start - shader_start;
 
     WGPUBlendState blend_state = {
         .color =
@@ -411,561 +977,1321 @@ ReturnStatus Renderer_init_windowed(
         },
     };
     WGPUColorTargetState color_target_state = {
-        .format = texture_format,
+        .format = color_format,
         .blend = &blend_state,
         .writeMask = WGPUColorWriteMask_All,
     };
-    WGPUFragmentState frag_state = {
-        .module = default_shader,
-        .entryPoint = {"fs_main", WGPU_STRLEN},
-        .targets = &color_target_state,
-        .targetCount = 1,
-    };
     WGPUDepthStencilState depth_pencil_state = {
-        .format = depth_texture_format,
+        .format = WGPUTextureFormat_Depth24Plus,
         .depthWriteEnabled = true,
         .depthCompare = WGPUCompareFunction_Less,
     };
-    WGPUPipelineLayoutDescriptor solid_pipeline_layout_desc = {
+    // Solid and edges pipelines share one layout
+    WGPUPipelineLayoutDescriptor pipeline_layout_desc = {
         .label = {"Solid Pipeline Layout", WGPU_STRLEN},
         .bindGroupLayouts = &bind_group_layout,
         .bindGroupLayoutCount = 1,
     };
-    WGPURenderPipelineDescriptor solid_pipeline_desc = {
-        .label = {"Solid Pipeline", WGPU_STRLEN},
-        .layout = wgpuDeviceCreatePipelineLayout(
-            renderer->device, &solid_pipeline_layout_desc
-        ),
-        .vertex = vert_state,
-        .fragment = &frag_state,
-        .depthStencil = &depth_pencil_state,
-        .primitive =
-            (WGPUPrimitiveState){
-                .topology = WGPUPrimitiveTopology_TriangleList,
-                .frontFace = WGPUFrontFace_CCW,
-                .cullMode = WGPUCullMode_Back,
-                .unclippedDepth = false,
-            },
-        .multisample = (WGPUMultisampleState){
-            .count = 1,
-            .mask = 0xFFFFFFFF,
-            .alphaToCoverageEnabled = false,
-        },
+    WGPUPipelineLayout pipeline_layout =
+        PipelineCache_pipeline_layout(cache, &pipeline_layout_desc);
+
+    // Pipelines compile independently, one thread per group
+    PipelineBuildContext build_ctx = {
+        .renderer = renderer,
+        .shader = default_shader,
+        .uniform_layout = bind_group_layout,
+        .pipeline_layout = pipeline_layout,
+        .color_target = &color_target_state,
+        .depth_stencil = &depth_pencil_state,
+        .color_format = color_format,
     };
-    renderer->solid_pipeline =
-        wgpuDeviceCreateRenderPipeline(renderer->device, &solid_pipeline_desc);
+    parallel_for(
+        Renderer_create_pipeline_group, &build_ctx, PIPELINE_GROUP_COUNT
+    );
+    renderer->init_phase_seconds[INIT_PHASE_PIPELINES] =
+        now_seconds() - pipeline_start;
+    ++renderer->pipeline_generation;
+    LOG_DEBUG(
+        "Pipeline cache: %u hits, %u misses, %u deferred",
+        cache->hits,
+        cache->misses,
+        cache->deferred
+    );
+    return RETURN_SUCCESS;
+}
 
-    // Create edges render pipeline
-    WGPUFragmentState edges_frag_state = {
-        .module = default_shader,
-        .entryPoint = {"edges_fs_main", WGPU_STRLEN},
-        .targets = &color_target_state,
+/** Rebuild the pipelines after a shader edit, between two frames
+ *
+ * Only modules whose source changed are recompiled, and only pipelines
+ * using them are recreated, the rest are pipeline cache hits.  Scene data
+ * stays in place.  If the new source fails validation the previous
+ * pipelines are kept.
+ *
+ * @param[in] renderer  Renderer
+ * @returns             Return status
+ */
+ReturnStatus Renderer_reload_shaders(Renderer* renderer) {
+    WGPURenderPipeline* pipeline_sets[] = {
+        renderer->solid_pipelines,
+        renderer->edges_pipelines,
+        renderer->wireframe_pipelines,
+        renderer->gbuffer_pipelines,
     };
-    WGPUPipelineLayoutDescriptor edges_pipeline_layout_desc = {
-        .label = {"Edges Pipeline Layout", WGPU_STRLEN},
-        .bindGroupLayouts = &bind_group_layout,
-        .bindGroupLayoutCount = 1,
-    };
-    WGPUDepthStencilState edges_depth_pencil_state = {
-        .format = WGPUTextureFormat_Depth24Plus,
-        .depthWriteEnabled = false,
-        .depthCompare = WGPUCompareFunction_Less,
-    };
-    WGPURenderPipelineDescriptor edges_pipeline_desc = {
-        .label = {"Edges Pipeline", WGPU_STRLEN},
-        .layout = wgpuDeviceCreatePipelineLayout(
-            renderer->device, &edges_pipeline_layout_desc
-        ),
-        .vertex = vert_state,
-        .fragment = &edges_frag_state,
-        .depthStencil = &edges_depth_pencil_state,
-        .primitive =
-            (WGPUPrimitiveState){
-                .topology = WGPUPrimitiveTopology_LineList,
-                .frontFace = WGPUFrontFace_CCW,
-                .cullMode = WGPUCullMode_Back,
-                .unclippedDepth = false,
-            },
-        .multisample = (WGPUMultisampleState){
-            .count = 1,
-            .mask = 0xFFFFFFFF,
-            .alphaToCoverageEnabled = false,
-        },
+    WGPURenderPipeline previous[ARRAY_COUNT(pipeline_sets)]
+                              [VERTEX_FORMAT_COUNT];
+    for (u32 i = 0; i < ARRAY_COUNT(pipeline_sets); ++i) {
+        memcpy(previous[i], pipeline_sets[i], sizeof(previous[i]));
+    }
+    WGPURenderPipeline previous_outline = renderer->outline_pipeline;
+    WGPUBindGroupLayout previous_layout = renderer->uniform_bind_group_layout;
+
+    // Compile everything now so the whole edit is validated at once
+    renderer->pipeline_cache.defer_cold = false;
+    PipelineCacheCheckpoint checkpoint =
+        PipelineCache_checkpoint(&renderer->pipeline_cache);
+    wgpuDevicePushErrorScope(renderer->device, WGPUErrorFilter_Validation);
+    ReturnStatus status =
+        Renderer_create_pipelines(renderer, Renderer_color_format(renderer));
+    ErrorScopeContext scope = {0};
+    WGPUPopErrorScopeCallbackInfo scope_cb_info = {
+        .mode = WGPUCallbackMode_AllowSpontaneous,
+        .callback = error_scope_callback,
+        .userdata1 = &scope,
     };
-    renderer->edges_pipeline =
-        wgpuDeviceCreateRenderPipeline(renderer->device, &edges_pipeline_desc);
+    wgpuDevicePopErrorScope(renderer->device, scope_cb_info);
+    if (!scope.completed) wgpuDevicePoll(renderer->device, true, NULL);
 
-    CharArray_free(&default_shader_src);
+    if (status != RETURN_SUCCESS || scope.failed) {
+        LOG_ERROR("Shader reload failed, keeping the previous pipelines");
+        for (u32 i = 0; i < ARRAY_COUNT(pipeline_sets); ++i) {
+            memcpy(pipeline_sets[i], previous[i], sizeof(previous[i]));
+        }
+        renderer->outline_pipeline = previous_outline;
+        renderer->uniform_bind_group_layout = previous_layout;
+        // Drop the invalid objects, otherwise saving the same source again
+        // is a cache hit that skips validation
+        PipelineCache_rollback(&renderer->pipeline_cache, &checkpoint);
+        ++renderer->pipeline_generation;
+        return RETURN_FAILURE;
+    }
+    LOG_INFO("Shaders reloaded");
     return RETURN_SUCCESS;
 }
 
-ReturnStatus Renderer_init_headless(Renderer* renderer, u32 width, u32 height) {
-    renderer->render_mode = RENDER_MODE_HEADLESS;
-    WgpuCallbackContext cb_ctx = {
-        .completed = false,
-        .adapter = &renderer->adapter,
-        .device = &renderer->device,
-    };
-    WGPUInstanceDescriptor instance_desc = {0};
-    WGPUInstance instance = wgpuCreateInstance(&instance_desc);
-    if (instance == NULL) {
-        LOG_ERROR("Failed to create WGPU instance");
+// Everything both render modes share once the device and color target exist
+static ReturnStatus Renderer_init_resources(
+    Renderer* renderer, WGPUTextureFormat color_format, u32 width, u32 height
+) {
+    f64 start = now_seconds();
+    Renderer_create_depth_texture(renderer, width, height);
+    renderer->init_phase_seconds[INIT_PHASE_DEPTH_TEXTURE] =
+        now_seconds() - start;
+
+    // Create uniform buffer
+    if (renderer->uniforms.buffer == NULL &&
+        UniformRing_init(
+            &renderer->uniforms, renderer->device, RENDERER_UNIFORM_BLOCKS
+        ) != RETURN_SUCCESS) {
+        Renderer_set_init_state(renderer, RENDERER_INIT_FAILED);
         return RETURN_FAILURE;
     }
-
-    // Adapter request
-    if (renderer->adapter != NULL) {
-        wgpuAdapterRelease(renderer->adapter);
+    // Timing is optional, the renderer works without it
+    if (renderer->gpu_timer.device == NULL) {
+        GpuTimer_init(&renderer->gpu_timer, renderer->device);
     }
-    WGPURequestAdapterOptions adapter_options = {
-        // Don't need a surface
-        .compatibleSurface = NULL,
-        .powerPreference = WGPUPowerPreference_HighPerformance,
-        .forceFallbackAdapter = false,
-    };
-    WGPURequestAdapterCallbackInfo adapter_cb_info = {
-        .callback = adapter_request_callback,
-        .userdata1 = &cb_ctx,
-    };
-    wgpuInstanceRequestAdapter(instance, &adapter_options, adapter_cb_info);
 
-    // TODO (mmckenna) : Handle this async
-    while (!cb_ctx.completed) {
-        wgpuInstanceProcessEvents(instance);
+    // Upload meshes built by the asset thread
+    Mesh* cube = &renderer->meshes[MESH_TYPE_CUBE];
+    start = now_seconds();
+    if (cube->vertex_buffer == NULL) {
+        Renderer_create_mesh_buffers(cube, renderer);
     }
-    if (!cb_ctx.success) {
+    renderer->init_phase_seconds[INIT_PHASE_MESH_BUFFERS] =
+        now_seconds() - start;
+
+    if (Renderer_create_pipelines(renderer, color_format) != RETURN_SUCCESS) {
+        Renderer_set_init_state(renderer, RENDERER_INIT_FAILED);
         return RETURN_FAILURE;
     }
 
-    // Device request
-    if (renderer->device != NULL) {
-        wgpuDeviceRelease(renderer->device);
+    // Shaders loaded from disk are a development setup, follow their edits
+    const char* shader_dir = getenv("RAIJIN_SHADER_DIR");
+    if (shader_dir != NULL && shader_dir[0] != '\0' &&
+        !renderer->shader_watcher.active) {
+        ShaderWatcher_init(&renderer->shader_watcher, shader_dir);
     }
-    WGPUDeviceDescriptor device_desc = {.label = {"Device", WGPU_STRLEN}};
-    WGPURequestDeviceCallbackInfo device_cb_info = {
-        .callback = device_request_callback,
-        .userdata1 = &cb_ctx,
-    };
 
-    wgpuAdapterRequestDevice(renderer->adapter, &device_desc, device_cb_info);
+    // Create bind group
+    if (renderer->uniform_bind_group == NULL) {
+        WGPUBindGroupEntry bind_group_entries[] = {
+            // One block, the pass picks which with a dynamic offset
+            (WGPUBindGroupEntry){
+                .binding = 0,
+                .buffer = renderer->uniforms.buffer,
+                .offset = 0,
+                .size = sizeof(Uniform),
+            },
+        };
+        WGPUBindGroupDescriptor bind_group_desc = {
+            .label = {"Bind Group", WGPU_STRLEN},
+            .layout = renderer->uniform_bind_group_layout,
+            .entries = bind_group_entries,
+            .entryCount = 1,
+        };
+        renderer->uniform_bind_group =
+            wgpuDeviceCreateBindGroup(renderer->device, &bind_group_desc);
+    }
+    Renderer_set_init_state(renderer, RENDERER_INIT_READY);
+    return RETURN_SUCCESS;
+}
 
-    // TODO (mckenna) : Handle this async
-    while (!cb_ctx.completed) {
-        wgpuInstanceProcessEvents(instance);
+ReturnStatus Renderer_init_windowed(
+    Renderer* renderer,
+    const WGPUInstance instance,
+    const u32 width,
+    const u32 height
+) {
+    renderer->render_mode = RENDER_MODE_WINDOWED;
+    Renderer_begin_init(renderer, instance);
+    if (Renderer_wait_init(renderer) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
     }
-    if (!cb_ctx.success) {
-        wgpuAdapterRelease(renderer->adapter);
+
+    // Create render target.  The adapter was picked before the surface
+    // existed, no formats means it cannot present to it.
+    f64 start = now_seconds();
+    WGPUSurfaceCapabilities surface_caps = {0};
+    wgpuSurfaceGetCapabilities(
+        renderer->render_target.windowed.surface,
+        renderer->adapter,
+        &surface_caps
+    );
+    if (surface_caps.formatCount == 0) {
+        LOG_ERROR("No supported surface formats found");
+        Renderer_set_init_state(renderer, RENDERER_INIT_FAILED);
         return RETURN_FAILURE;
     }
+    LOG_DEBUG("%ld surface formats found.", surface_caps.formatCount);
+    WGPUTextureFormat texture_format = surface_caps.formats[0];
+    renderer->render_target.windowed.surface_config =
+        (WGPUSurfaceConfiguration){
+            .usage = WGPUTextureUsage_RenderAttachment,
+            .format = texture_format,
+            .width = width,
+            .height = height,
+            .presentMode = WGPUPresentMode_Fifo,
+            .device = renderer->device,
+        };
+    Renderer_apply_frame_pacing(renderer, &surface_caps);
+    wgpuSurfaceCapabilitiesFreeMembers(surface_caps);
+    wgpuSurfaceConfigure(
+        renderer->render_target.windowed.surface,
+        &renderer->render_target.windowed.surface_config
+    );
+    renderer->init_phase_seconds[INIT_PHASE_SURFACE] = now_seconds() - start;
+    LOG_DEBUG(
+        "Configured surface size: [%d, %d]",
+        renderer->render_target.windowed.surface_config.width,
+        renderer->render_target.windowed.surface_config.height
+    );
 
-    // Get device queue
-    renderer->queue = wgpuDeviceGetQueue(renderer->device);
+    return Renderer_init_resources(renderer, texture_format, width, height);
+}
+
+ReturnStatus Renderer_init_headless(Renderer* renderer, u32 width, u32 height) {
+    renderer->render_mode = RENDER_MODE_HEADLESS;
+    if (!renderer->init_threads_running) {
+        // A reused device needs no instance
+        WGPUInstance instance = NULL;
+        if (renderer->device == NULL) {
+            f64 start = now_seconds();
+            WGPUInstanceDescriptor instance_desc = {0};
+            instance = wgpuCreateInstance(&instance_desc);
+            renderer->init_phase_seconds[INIT_PHASE_INSTANCE] =
+                now_seconds() - start;
+            if (instance == NULL) {
+                LOG_ERROR("Failed to create WGPU instance");
+                return RETURN_FAILURE;
+            }
+        }
+        Renderer_begin_init(renderer, instance);
+    }
+    if (Renderer_wait_init(renderer) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
 
-    // Create render target
+    // Create render targets
     // TODO (mmckenna) : Look at different formats, including `Bgra8UnormSrgb`
     WGPUTextureFormat texture_format = WGPUTextureFormat_RGBA8Unorm;
-    WGPUTextureDescriptor texture_desc = {
-        .label = {"Headless Texture", WGPU_STRLEN},
-        .size =
-            (WGPUExtent3D){
-                .width = width > 0 ? width : 1,
-                .height = height > 0 ? height : 1,
-                .depthOrArrayLayers = 1,
-            },
-        .mipLevelCount = 1,
-        .sampleCount = 1,
-        .dimension = WGPUTextureDimension_2D,
-        .format = texture_format,
-        .usage = WGPUTextureUsage_RenderAttachment |
-                 WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopySrc,
-        .viewFormats = &texture_format,
-        .viewFormatCount = 1,
-    };
-    renderer->render_target.headless.texture =
-        wgpuDeviceCreateTexture(renderer->device, &texture_desc);
+    ReturnStatus target_status = ReadbackRing_init(
+        &renderer->render_target.headless.readback,
+        renderer->device,
+        texture_format,
+        width,
+        height,
+        1
+    );
+    if (target_status != RETURN_SUCCESS) {
+        Renderer_set_init_state(renderer, RENDERER_INIT_FAILED);
+        return RETURN_FAILURE;
+    }
+    // The readback ring bounds frames in flight, only the cap applies
+    Renderer_apply_frame_pacing(renderer, NULL);
 
-    // Create depth texture
-    WGPUTextureFormat depth_texture_format = WGPUTextureFormat_Depth24Plus;
-    WGPUTextureDescriptor depth_texture_desc = {
-        .label = {"Depth Texture", WGPU_STRLEN},
-        .size =
-            (WGPUExtent3D){
-                .width = width > 0 ? width : 1,
-                .height = height > 0 ? height : 1,
-                .depthOrArrayLayers = 1,
-            },
-        .mipLevelCount = 1,
-        .sampleCount = 1,
-        .dimension = WGPUTextureDimension_2D,
-        .format = depth_texture_format,
-        .usage = WGPUTextureUsage_RenderAttachment,
-        .viewFormats = &depth_texture_format,
-        .viewFormatCount = 1,
-    };
-    if (renderer->depth_texture != NULL) {
-        wgpuTextureRelease(renderer->depth_texture);
+    return Renderer_init_resources(renderer, texture_format, width, height);
+}
+
+// TODO (mmckenna): Target for arena allocator
+/** Write this frame's instances of a mesh to its instance buffer
+ *
+ * @param[in] renderer      Renderer
+ * @param[in] mesh_type     Mesh whose draw commands are gathered
+ * @returns                 Number of instances written
+ */
+u32 Renderer_upload_instances(Renderer* renderer, const MeshType mesh_type) {
+    InstanceArray instances;
+    InstanceArray_init(&instances);
+    f64 start = now_seconds();
+    Renderer_gather_instances(renderer, mesh_type, &instances);
+    RendererStats_add_time(&renderer->stats, STATS_TIMER_GATHER, start);
+    u32 count = instances.count;
+    start = now_seconds();
+    if (count > 0) Renderer_write_instances(renderer, mesh_type, &instances);
+    RendererStats_add_time(&renderer->stats, STATS_TIMER_UPLOAD, start);
+    InstanceArray_free(&instances);
+    return count;
+}
+
+// Appends this frame's instances of a mesh, in draw order
+static void Renderer_gather_instances(
+    const Renderer* renderer, const MeshType mesh_type, InstanceArray* out
+) {
+    for (u32 i = 0; i < renderer->draw_commands.count; ++i) {
+        DrawCommand* cmd = &renderer->draw_commands.items[i];
+        if (cmd->mesh_type == mesh_type) {
+            InstanceArray_push(out, cmd->instance);
+        }
     }
-    renderer->depth_texture =
-        wgpuDeviceCreateTexture(renderer->device, &depth_texture_desc);
+}
 
-    if (renderer->depth_texture_view != NULL) {
-        wgpuTextureViewRelease(renderer->depth_texture_view);
+// Writes instances to the start of the mesh instance buffer, growing it if
+// needed.  Model matrices of quantized meshes are modified in place.
+static void Renderer_write_instances(
+    Renderer* renderer, const MeshType mesh_type, InstanceArray* instances
+) {
+    Mesh* mesh = &renderer->meshes[mesh_type];
+    // Quantized positions are in [0, 1], fold the mapping back to mesh space
+    // into the model matrices
+    if (mesh->vertex_format == VERTEX_FORMAT_QUANTIZED) {
+        for (u32 i = 0; i < instances->count; ++i) {
+            glm_mat4_mul(
+                instances->items[i].model_matrix,
+                mesh->dequantize,
+                instances->items[i].model_matrix
+            );
+        }
     }
-    WGPUTextureViewDescriptor depth_texture_view_desc = {
-        .label = {"Depth Texture View", WGPU_STRLEN},
-        .format = WGPUTextureFormat_Depth24Plus,
-        .dimension = WGPUTextureViewDimension_2D,
-        .baseMipLevel = 0,
-        .mipLevelCount = 1,
-        .baseArrayLayer = 0,
-        .arrayLayerCount = 1,
-    };
-    renderer->depth_texture_view = wgpuTextureCreateView(
-        renderer->depth_texture, &depth_texture_view_desc
+    if (instances->count > mesh->instance_capacity) {
+        Mesh_realloc_instance_buffer(mesh, renderer->device, instances->count);
+        ++renderer->stats.buffer_reallocations;
+    }
+    renderer->stats.upload_bytes += instances->count * sizeof(Instance);
+    wgpuQueueWriteBuffer(
+        renderer->queue,
+        mesh->instance_buffer,
+        0,
+        instances->items,
+        instances->count * sizeof(Instance)
     );
+}
 
-    // Create uniform buffer
-    mat4 proj_matrix = {0};
-    glm_perspective_rh_no(
-        glm_rad(60.0), (f32)width / (f32)height, 0.1, 1000.0, proj_matrix
-    );
-    mat4 view_matrix = {0};
-    glm_mat4_identity(view_matrix);
-    WGPUBufferDescriptor uniform_buffer_desc = {
-        .label = {"Uniform Buffer", WGPU_STRLEN},
-        .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
-        .size = sizeof(Uniform),
-        .mappedAtCreation = false,
-    };
-    renderer->uniform_buffer =
-        wgpuDeviceCreateBuffer(renderer->device, &uniform_buffer_desc);
+// Uploads the instances of a mesh for every view of a multi-view frame in
+// one write.  All instances come first, a view that culls none of them
+// draws that range.  Views that cull some draw a compacted copy of their
+// visible instances appended after it.
+static void Renderer_upload_view_instances(
+    Renderer* renderer,
+    const MeshType mesh_type,
+    vec4 (*frustums)[6],
+    u32 view_count,
+    ViewInstances* ranges
+) {
+    Mesh* mesh = &renderer->meshes[mesh_type];
+    InstanceArray instances;
+    InstanceArray_init(&instances);
+    f64 start = now_seconds();
+    Renderer_gather_instances(renderer, mesh_type, &instances);
+    u32 total = instances.count;
+    for (u32 v = 0; v < view_count; ++v) {
+        ranges[v].first[mesh_type] = 0;
+        ranges[v].count[mesh_type] = 0;
+    }
+    if (total == 0) {
+        RendererStats_add_time(&renderer->stats, STATS_TIMER_GATHER, start);
+        return;
+    }
 
-    // Create meshes
-    Mesh_create_cube(&renderer->meshes[MESH_TYPE_CUBE]);
+    // World space bounds, transformed once and tested against every view
+    vec3(*boxes)[2] = RAIJIN_REALLOC(NULL, total * sizeof(*boxes));
+    RAIJIN_ASSERT(boxes != NULL && "Out of memory");
+    for (u32 i = 0; i < total; ++i) {
+        glm_aabb_transform(
+            mesh->bounds, instances.items[i].model_matrix, boxes[i]
+        );
+    }
+    for (u32 v = 0; v < view_count; ++v) {
+        u32 first = instances.count;
+        for (u32 i = 0; i < total; ++i) {
+            if (glm_aabb_frustum(boxes[i], frustums[v])) {
+                InstanceArray_push(&instances, instances.items[i]);
+            }
+        }
+        u32 visible = instances.count - first;
+        renderer->stats.culled += total - visible;
+        if (visible == total) {
+            instances.count = first;
+            first = 0;
+        }
+        ranges[v].first[mesh_type] = first;
+        ranges[v].count[mesh_type] = visible;
+    }
+    RAIJIN_FREE(boxes);
+    RendererStats_add_time(&renderer->stats, STATS_TIMER_GATHER, start);
+    start = now_seconds();
+    Renderer_write_instances(renderer, mesh_type, &instances);
+    RendererStats_add_time(&renderer->stats, STATS_TIMER_UPLOAD, start);
+    InstanceArray_free(&instances);
+}
 
-    // Create bind group layout
-    WGPUBindGroupLayoutEntry bind_group_layout_entries[] = {
-        // Uniforms entry.  Currently the same for all render pipelines.
-        (WGPUBindGroupLayoutEntry){
-            .binding = 0,
-            .visibility = WGPUShaderStage_Vertex,
-            .buffer = (WGPUBufferBindingLayout){
-                .type = WGPUBufferBindingType_Uniform,
-                .hasDynamicOffset = false,
-                .minBindingSize = 0,
-            },
-        },
-    };
-    WGPUBindGroupLayoutDescriptor bind_group_layout_desc = {
-        .label = {"Bind Group Layout", WGPU_STRLEN},
-        .entries = bind_group_layout_entries,
-        .entryCount = 1,
-    };
-    WGPUBindGroupLayout bind_group_layout = wgpuDeviceCreateBindGroupLayout(
-        renderer->device, &bind_group_layout_desc
+/** Record the draws of a mesh
+ *
+ * Only references the mesh buffers, so the recording stays valid while the
+ * buffers and the instance range stay the same.
+ *
+ * @param[in] renderer          Renderer
+ * @param[in] mesh_type         Mesh to draw
+ * @param[in] first_instance    First instance of the instance buffer drawn
+ * @param[in] instance_count    Instances from `Renderer_upload_instances`
+ * @param[in] bundle_encoder    Encoder recording the draws
+ */
+void Renderer_render_mesh(
+    Renderer* renderer,
+    const MeshType mesh_type,
+    const u32 first_instance,
+    const u32 instance_count,
+    const WGPURenderBundleEncoder bundle_encoder
+) {
+    Mesh* mesh = &renderer->meshes[mesh_type];
+    // Bound at an offset rather than drawn with a first instance, so
+    // `instance_index` in the shaders starts at 0 for every range
+    u64 instance_offset = (u64)first_instance * sizeof(Instance);
+    bool wireframe =
+        renderer->enable_edges && renderer->edge_mode == EDGE_MODE_BARYCENTRIC;
+
+    // Wireframe pulls vertices and indices from storage, the instances are
+    // its only vertex buffer
+    if (wireframe) {
+        wgpuRenderBundleEncoderSetPipeline(
+            bundle_encoder, renderer->wireframe_pipelines[mesh->vertex_format]
+        );
+        wgpuRenderBundleEncoderSetBindGroup(
+            bundle_encoder,
+            1,
+            Renderer_wireframe_bind_group(renderer, mesh),
+            0,
+            NULL
+        );
+        wgpuRenderBundleEncoderSetVertexBuffer(
+            bundle_encoder,
+            0,
+            mesh->instance_buffer,
+            instance_offset,
+            instance_count * sizeof(Instance)
+        );
+        wgpuRenderBundleEncoderDraw(
+            bundle_encoder, mesh->index_count, instance_count, 0, 0
+        );
+        return;
+    }
+
+    bool screen_space = renderer->enable_edges &&
+                        renderer->edge_mode == EDGE_MODE_SCREEN_SPACE;
+    wgpuRenderBundleEncoderSetPipeline(
+        bundle_encoder,
+        screen_space ? renderer->gbuffer_pipelines[mesh->vertex_format]
+                     : renderer->solid_pipelines[mesh->vertex_format]
+    );
+    wgpuRenderBundleEncoderSetVertexBuffer(
+        bundle_encoder,
+        0,
+        mesh->vertex_buffer,
+        0,
+        mesh->vertex_count * VertexFormat_stride(mesh->vertex_format)
+    );
+    wgpuRenderBundleEncoderSetVertexBuffer(
+        bundle_encoder,
+        1,
+        mesh->instance_buffer,
+        instance_offset,
+        instance_count * sizeof(Instance)
+    );
+    wgpuRenderBundleEncoderSetIndexBuffer(
+        bundle_encoder,
+        mesh->index_buffer,
+        WGPUIndexFormat_Uint32,
+        0,
+        mesh->index_count * sizeof(u32)
+    );
+    wgpuRenderBundleEncoderDrawIndexed(
+        bundle_encoder, mesh->index_count, instance_count, 0, 0, 0
     );
 
-    // Create bind group
-    WGPUBindGroupEntry bind_group_enties[] = {
-        (WGPUBindGroupEntry){
-            .binding = 0,
-            .buffer = renderer->uniform_buffer,
-            .offset = 0,
-            .size = sizeof(Uniform),
-        },
-    };
-    WGPUBindGroupDescriptor bind_group_desc = {
-        .label = {"Bind Group", WGPU_STRLEN},
-        .layout = bind_group_layout,
-        .entries = bind_group_enties,
-    };
-    wgpuDeviceCreateBindGroup(renderer->device, &bind_group_desc);
+    // Edges reuse the bound vertex and instance buffers and the depth
+    // attachment, only the pipeline and index buffer change
+    if (renderer->enable_edges && renderer->edge_mode == EDGE_MODE_LINES &&
+        mesh->edge_index_count > 0) {
+        wgpuRenderBundleEncoderSetPipeline(
+            bundle_encoder, renderer->edges_pipelines[mesh->vertex_format]
+        );
+        wgpuRenderBundleEncoderSetIndexBuffer(
+            bundle_encoder,
+            mesh->edge_index_buffer,
+            WGPUIndexFormat_Uint32,
+            0,
+            mesh->edge_index_count * sizeof(u32)
+        );
+        wgpuRenderBundleEncoderDrawIndexed(
+            bundle_encoder, mesh->edge_index_count, instance_count, 0, 0, 0
+        );
+    }
+}
 
-    // Create solid render pipeline
-    CharArray default_shader_src = {0};
-    ReturnStatus shader_load_status = load_shader(
-        RAIJIN_ASSETS_DIR "/shaders/default_shader.wgsl", &default_shader_src
-    );
-    if (shader_load_status != RETURN_SUCCESS) {
-        LOG_ERROR("Failed to load shader");
-        // TODO (mmcknna) : what to do when shader loading fails?
+// Counts the draws a solid pass bundle executes, mirroring
+// `Renderer_record_render_bundle` and `Renderer_render_mesh`
+static void Renderer_count_draws(
+    Renderer* renderer, const u32 instance_counts[MESH_TYPE_COUNT]
+) {
+    RendererStats* stats = &renderer->stats;
+    // The uniform bind group, set once per bundle
+    ++stats->bind_group_switches;
+    bool wireframe =
+        renderer->enable_edges && renderer->edge_mode == EDGE_MODE_BARYCENTRIC;
+    bool lines =
+        renderer->enable_edges && renderer->edge_mode == EDGE_MODE_LINES;
+    for (u32 i = 0; i < MESH_TYPE_COUNT; ++i) {
+        u32 count = instance_counts[i];
+        if (count == 0) continue;
+        const Mesh* mesh = &renderer->meshes[i];
+        u32 draws = 1;
+        ++stats->pipeline_switches;
+        stats->triangles += (u64)mesh->index_count / 3 * count;
+        if (wireframe) {
+            ++stats->bind_group_switches;
+        } else if (lines && mesh->edge_index_count > 0) {
+            ++draws;
+            ++stats->pipeline_switches;
+            stats->lines += (u64)mesh->edge_index_count / 2 * count;
+        }
+        stats->draw_calls += draws;
+        stats->mesh_draw_calls[i] += draws;
+        stats->mesh_instances[i] += count;
+        stats->visible += count;
     }
-    WGPUShaderSourceWGSL wgsl_desc = {
-        .chain.sType = WGPUSType_ShaderSourceWGSL,
-        .code = {.data = default_shader_src.items, default_shader_src.count}
-    };
-    WGPUShaderModuleDescriptor default_shader_desc = {
-        .nextInChain = &wgsl_desc.chain,
-        .label = {"Default Shader", WGPU_STRLEN},
+}
+
+// Pipelines the current edge mode draws a mesh of `format` with
+static u32 Renderer_mesh_pipelines(
+    const Renderer* renderer, VertexFormat format, WGPURenderPipeline out[2]
+) {
+    if (!renderer->enable_edges) {
+        out[0] = renderer->solid_pipelines[format];
+        return 1;
+    }
+    switch (renderer->edge_mode) {
+        case EDGE_MODE_LINES: {
+            out[0] = renderer->solid_pipelines[format];
+            out[1] = renderer->edges_pipelines[format];
+            return 2;
+        }
+        case EDGE_MODE_BARYCENTRIC: {
+            out[0] = renderer->wireframe_pipelines[format];
+            return 1;
+        }
+        case EDGE_MODE_SCREEN_SPACE: {
+            out[0] = renderer->gbuffer_pipelines[format];
+            out[1] = renderer->outline_pipeline;
+            return 2;
+        }
+    }
+    return 0;
+}
+
+/** Compile the pipelines this frame draws with if startup deferred them
+ *
+ * @param[in] renderer          Renderer
+ * @param[in] instance_counts   Instances per mesh this frame
+ */
+void Renderer_require_pipelines(
+    Renderer* renderer, const u32 instance_counts[MESH_TYPE_COUNT]
+) {
+    // The outline pass runs in screen space mode even when nothing is drawn
+    bool missing = renderer->enable_edges &&
+                   renderer->edge_mode == EDGE_MODE_SCREEN_SPACE &&
+                   renderer->outline_pipeline == NULL;
+    for (u32 i = 0; i < MESH_TYPE_COUNT && !missing; ++i) {
+        if (instance_counts[i] == 0) continue;
+        WGPURenderPipeline pipelines[2];
+        u32 count = Renderer_mesh_pipelines(
+            renderer, renderer->meshes[i].vertex_format, pipelines
+        );
+        for (u32 j = 0; j < count; ++j) {
+            missing = missing || pipelines[j] == NULL;
+        }
+    }
+    if (!missing) return;
+    LOG_DEBUG("Compiling deferred pipelines");
+    renderer->pipeline_cache.defer_cold = false;
+    Renderer_create_pipelines(renderer, Renderer_color_format(renderer));
+}
+
+/** Drop the recorded solid pass, the next frame records it again */
+void Renderer_invalidate_render_bundle(Renderer* renderer) {
+    if (renderer->solid_bundle != NULL) {
+        wgpuRenderBundleRelease(renderer->solid_bundle);
+        renderer->solid_bundle = NULL;
+    }
+}
+
+// Records the draws of every mesh with instances this frame, reading the
+// instances of each mesh from `first_instances`, or 0 if NULL
+static WGPURenderBundle Renderer_record_render_bundle(
+    Renderer* renderer,
+    const RenderBundleKey* key,
+    u32 uniform_offset,
+    const u32 first_instances[MESH_TYPE_COUNT]
+) {
+    bool screen_space = key->enable_edges &&
+                        key->edge_mode == EDGE_MODE_SCREEN_SPACE;
+    WGPUTextureFormat color_formats[] = {
+        Renderer_color_format(renderer),
+        WGPUTextureFormat_RGBA16Float,
+        WGPUTextureFormat_R32Uint,
     };
-    WGPUShaderModule default_shader =
-        wgpuDeviceCreateShaderModule(renderer->device, &default_shader_desc);
-    WGPUVertexBufferLayout vertex_buffer_layouts[] = {
-        Vertex_desc(),
-        Instance_desc(),
+    WGPURenderBundleEncoderDescriptor bundle_encoder_desc = {
+        .label = {"Solid Bundle Encoder", WGPU_STRLEN},
+        .colorFormats = color_formats,
+        .colorFormatCount = screen_space ? 3 : 1,
+        .depthStencilFormat = WGPUTextureFormat_Depth24Plus,
+        .sampleCount = 1,
     };
-    WGPUVertexState vert_state = {
-        .module = default_shader,
-        .entryPoint = {"vs_main", WGPU_STRLEN},
-        .bufferCount = 2,
-        .buffers = vertex_buffer_layouts,
+    WGPURenderBundleEncoder bundle_encoder =
+        wgpuDeviceCreateRenderBundleEncoder(
+            renderer->device, &bundle_encoder_desc
+        );
+    wgpuRenderBundleEncoderSetBindGroup(
+        bundle_encoder, 0, renderer->uniform_bind_group, 1, &uniform_offset
+    );
+    for (u32 i = 0; i < MESH_TYPE_COUNT; ++i) {
+        if (key->instance_counts[i] == 0) continue;
+        Renderer_render_mesh(
+            renderer,
+            i,
+            first_instances != NULL ? first_instances[i] : 0,
+            key->instance_counts[i],
+            bundle_encoder
+        );
+        // Warm for the next run
+        WGPURenderPipeline pipelines[2];
+        u32 count = Renderer_mesh_pipelines(
+            renderer, renderer->meshes[i].vertex_format, pipelines
+        );
+        for (u32 j = 0; j < count; ++j) {
+            PipelineCache_mark_used(&renderer->pipeline_cache, pipelines[j]);
+        }
+    }
+    WGPURenderBundleDescriptor bundle_desc = {
+        .label = {"Solid Bundle", WGPU_STRLEN},
     };
+    WGPURenderBundle bundle =
+        wgpuRenderBundleEncoderFinish(bundle_encoder, &bundle_desc);
+    wgpuRenderBundleEncoderRelease(bundle_encoder);
+    LOG_DEBUG("Recorded solid render bundle");
+    return bundle;
+}
 
-    WGPUBlendState blend_state = {
-        .color =
-            (WGPUBlendComponent){
-                .operation = WGPUBlendOperation_Add,
-                .srcFactor = WGPUBlendFactor_SrcAlpha,
-                .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
+void Renderer_render_pass_solid(
+    Renderer* renderer,
+    const WGPUCommandEncoder command_encoder,
+    const WGPUTextureView texture_view
+) {
+    // Instance data is uploaded every frame, the recorded draws are replayed
+    // for as long as nothing they reference changes
+    RenderBundleKey key;
+    memset(&key, 0, sizeof(key));
+    for (u32 i = 0; i < MESH_TYPE_COUNT; ++i) {
+        key.instance_counts[i] = Renderer_upload_instances(renderer, i);
+        key.mesh_generations[i] = renderer->meshes[i].buffer_generation;
+    }
+    Renderer_count_draws(renderer, key.instance_counts);
+    Renderer_require_pipelines(renderer, key.instance_counts);
+    key.pipeline_generation = renderer->pipeline_generation;
+    key.enable_edges = renderer->enable_edges;
+    key.edge_mode = renderer->edge_mode;
+    if (renderer->solid_bundle == NULL ||
+        memcmp(&key, &renderer->bundle_key, sizeof(key)) != 0) {
+        Renderer_invalidate_render_bundle(renderer);
+        renderer->solid_bundle = Renderer_record_render_bundle(
+            renderer, &key, UNIFORM_BLOCK_MAIN * UNIFORM_BLOCK_ALIGNMENT, NULL
+        );
+        memcpy(&renderer->bundle_key, &key, sizeof(key));
+    }
+    Renderer_execute_solid_pass(
+        renderer, command_encoder, texture_view, renderer->solid_bundle
+    );
+}
+
+// Clears the targets of the solid pass and replays `bundle` into them
+static void Renderer_execute_solid_pass(
+    Renderer* renderer,
+    const WGPUCommandEncoder command_encoder,
+    const WGPUTextureView texture_view,
+    WGPURenderBundle bundle
+) {
+    WGPURenderPassColorAttachment color_attachment = {
+        .view = texture_view,
+        .loadOp = WGPULoadOp_Clear,
+        .clearValue =
+            (WGPUColor){
+                .r = 0.01,
+                .g = 0.01,
+                .b = 0.01,
+                .a = 1.0,
             },
-        .alpha = (WGPUBlendComponent){
-            .operation = WGPUBlendOperation_Add,
-            .srcFactor = WGPUBlendFactor_One,
-            .dstFactor = WGPUBlendFactor_Zero,
+        .storeOp = WGPUStoreOp_Store,
+    };
+    // Normal and id targets are cleared to zero, id 0 is the background
+    WGPURenderPassColorAttachment color_attachments[] = {
+        color_attachment,
+        {
+            .view = renderer->normal_texture_view,
+            .loadOp = WGPULoadOp_Clear,
+            .storeOp = WGPUStoreOp_Store,
+            .depthSlice = WGPU_DEPTH_SLICE_UNDEFINED,
+        },
+        {
+            .view = renderer->id_texture_view,
+            .loadOp = WGPULoadOp_Clear,
+            .storeOp = WGPUStoreOp_Store,
+            .depthSlice = WGPU_DEPTH_SLICE_UNDEFINED,
         },
     };
-    WGPUColorTargetState color_target_state = {
-        .format = texture_format,
-        .blend = &blend_state,
-        .writeMask = WGPUColorWriteMask_All,
+    bool screen_space = renderer->enable_edges &&
+                        renderer->edge_mode == EDGE_MODE_SCREEN_SPACE;
+    WGPURenderPassDepthStencilAttachment depth_stencil_attachment = {
+        .view = renderer->depth_texture_view,
+        .depthLoadOp = WGPULoadOp_Clear,
+        .depthClearValue = 1.0,
+        .depthStoreOp = WGPUStoreOp_Store,
     };
-    WGPUFragmentState frag_state = {
-        .module = default_shader,
-        .entryPoint = {"fs_main", WGPU_STRLEN},
-        .targets = &color_target_state,
+    WGPURenderPassDescriptor render_pass_desc = {
+        .label = {"Render Pass", WGPU_STRLEN},
+        .colorAttachments = color_attachments,
+        .colorAttachmentCount = screen_space ? 3 : 1,
+        .depthStencilAttachment = &depth_stencil_attachment,
+        .timestampWrites =
+            GpuTimer_render_pass(&renderer->gpu_timer, "Solid Pass"),
     };
-    WGPUDepthStencilState depth_pencil_state = {
-        .format = depth_texture_format,
-        .depthWriteEnabled = true,
-        .depthCompare = WGPUCompareFunction_Less,
+    WGPURenderPassEncoder render_pass_encoder =
+        wgpuCommandEncoderBeginRenderPass(command_encoder, &render_pass_desc);
+    wgpuRenderPassEncoderExecuteBundles(render_pass_encoder, 1, &bundle);
+    wgpuRenderPassEncoderEnd(render_pass_encoder);
+    wgpuRenderPassEncoderRelease(render_pass_encoder);
+}
+
+/** Composite outlines found in the solid pass targets onto the color target
+ *
+ * @param[in] renderer          Renderer
+ * @param[in] command_encoder   Encoder recording the frame
+ * @param[in] texture_view      Color target written by the solid pass
+ */
+void Renderer_render_pass_outline(
+    Renderer* renderer,
+    const WGPUCommandEncoder command_encoder,
+    const WGPUTextureView texture_view
+) {
+    Renderer_encode_outline_pass(
+        renderer,
+        command_encoder,
+        texture_view,
+        UNIFORM_BLOCK_MAIN * UNIFORM_BLOCK_ALIGNMENT
+    );
+}
+
+static void Renderer_encode_outline_pass(
+    Renderer* renderer,
+    const WGPUCommandEncoder command_encoder,
+    const WGPUTextureView texture_view,
+    u32 uniform_offset
+) {
+    if (renderer->outline_bind_group == NULL) {
+        WGPUBindGroupEntry entries[] = {
+            {.binding = 3, .textureView = renderer->depth_texture_view},
+            {.binding = 4, .textureView = renderer->normal_texture_view},
+            {.binding = 5, .textureView = renderer->id_texture_view},
+        };
+        WGPUBindGroupDescriptor bind_group_desc = {
+            .label = {"Outline Bind Group", WGPU_STRLEN},
+            .layout = renderer->outline_bind_group_layout,
+            .entries = entries,
+            .entryCount = 3,
+        };
+        renderer->outline_bind_group =
+            wgpuDeviceCreateBindGroup(renderer->device, &bind_group_desc);
+    }
+    WGPURenderPassColorAttachment color_attachment = {
+        .view = texture_view,
+        .loadOp = WGPULoadOp_Load,
+        .storeOp = WGPUStoreOp_Store,
+        .depthSlice = WGPU_DEPTH_SLICE_UNDEFINED,
     };
-    WGPUPipelineLayoutDescriptor solid_pipeline_layout_desc = {
-        .label = {"Solid Pipeline Layout", WGPU_STRLEN},
-        .bindGroupLayouts = &bind_group_layout,
-        .bindGroupLayoutCount = 1,
+    WGPURenderPassDescriptor render_pass_desc = {
+        .label = {"Outline Pass", WGPU_STRLEN},
+        .colorAttachments = &color_attachment,
+        .colorAttachmentCount = 1,
+        .timestampWrites =
+            GpuTimer_render_pass(&renderer->gpu_timer, "Outline Pass"),
     };
-    WGPURenderPipelineDescriptor solid_pipeline_desc = {
-        .label = {"Solid Pipeline", WGPU_STRLEN},
-        .layout = wgpuDeviceCreatePipelineLayout(
-            renderer->device, &solid_pipeline_layout_desc
-        ),
-        .vertex = vert_state,
-        .fragment = &frag_state,
-        .depthStencil = &depth_pencil_state,
-        .primitive =
-            (WGPUPrimitiveState){
-                .topology = WGPUPrimitiveTopology_TriangleList,
-                .frontFace = WGPUFrontFace_CCW,
-                .cullMode = WGPUCullMode_Back,
-                .unclippedDepth = false,
-            },
-        .multisample = (WGPUMultisampleState){
-            .count = 1,
-            .mask = 0xFFFFFFFF,
-            .alphaToCoverageEnabled = false,
-        },
+    WGPURenderPassEncoder render_pass_encoder =
+        wgpuCommandEncoderBeginRenderPass(command_encoder, &render_pass_desc);
+    wgpuRenderPassEncoderSetPipeline(
+        render_pass_encoder, renderer->outline_pipeline
+    );
+    wgpuRenderPassEncoderSetBindGroup(
+        render_pass_encoder, 0, renderer->uniform_bind_group, 1, &uniform_offset
+    );
+    wgpuRenderPassEncoderSetBindGroup(
+        render_pass_encoder, 1, renderer->outline_bind_group, 0, NULL
+    );
+    // Full screen triangle
+    wgpuRenderPassEncoderDraw(render_pass_encoder, 3, 1, 0, 0);
+    ++renderer->stats.draw_calls;
+    ++renderer->stats.triangles;
+    ++renderer->stats.pipeline_switches;
+    renderer->stats.bind_group_switches += 2;
+    wgpuRenderPassEncoderEnd(render_pass_encoder);
+    wgpuRenderPassEncoderRelease(render_pass_encoder);
+}
+
+// Records every pass of a frame drawn into `texture_view`
+static void Renderer_encode_passes(
+    Renderer* renderer,
+    const WGPUCommandEncoder command_encoder,
+    const WGPUTextureView texture_view
+) {
+    // Edges are drawn in the solid pass except in screen space mode
+    Renderer_render_pass_solid(renderer, command_encoder, texture_view);
+    if (renderer->enable_edges &&
+        renderer->edge_mode == EDGE_MODE_SCREEN_SPACE) {
+        Renderer_render_pass_outline(renderer, command_encoder, texture_view);
+    }
+}
+
+/** Render a frame into `texture_view` and submit it
+ *
+ * @param[in] renderer      Renderer
+ * @param[in] texture_view  Color target
+ * @returns                 Index of the frame's submission
+ */
+WGPUSubmissionIndex Renderer_render_to_view(
+    Renderer* renderer, const WGPUTextureView texture_view
+) {
+    WGPUCommandEncoderDescriptor command_encoder_desc = {
+        .label = {"Encoder", WGPU_STRLEN}
+
     };
-    renderer->solid_pipeline =
-        wgpuDeviceCreateRenderPipeline(renderer->device, &solid_pipeline_desc);
+    WGPUCommandEncoder command_encoder =
+        wgpuDeviceCreateCommandEncoder(renderer->device, &command_encoder_desc);
+    f64 start = now_seconds();
+    f64 nested_ms = RendererStats_nested_ms(&renderer->stats);
+    GpuTimer_begin_frame(&renderer->gpu_timer);
+    Renderer_encode_passes(renderer, command_encoder, texture_view);
+    GpuTimer_resolve(&renderer->gpu_timer, command_encoder);
 
-    // Create edges render pipeline
-    WGPUFragmentState edges_frag_state = {
-        .module = default_shader,
-        .entryPoint = {"edges_fs_main", WGPU_STRLEN},
-        .targets = &color_target_state,
+    WGPUCommandBufferDescriptor command_buffer_desc = {
+        .label = {"Command Buffer", WGPU_STRLEN}
     };
-    WGPUPipelineLayoutDescriptor edges_pipeline_layout_desc = {
-        .label = {"Edges Pipeline Layout", WGPU_STRLEN},
-        .bindGroupLayouts = &bind_group_layout,
-        .bindGroupLayoutCount = 1,
+    WGPUCommandBuffer command_buffer =
+        wgpuCommandEncoderFinish(command_encoder, &command_buffer_desc);
+    RendererStats_add_encode_time(&renderer->stats, start, nested_ms);
+    Renderer_flush_uniforms(renderer);
+
+    start = now_seconds();
+    WGPUSubmissionIndex submission =
+        wgpuQueueSubmitForIndex(renderer->queue, 1, &command_buffer);
+    GpuTimer_submitted(&renderer->gpu_timer);
+    RendererStats_add_time(&renderer->stats, STATS_TIMER_PRESENT, start);
+
+    // Cleanup
+    wgpuCommandBufferRelease(command_buffer);
+    wgpuCommandEncoderRelease(command_encoder);
+    return submission;
+}
+
+// Resolves the pacing settings, and picks the present mode if `surface_caps`
+// is given
+static void Renderer_apply_frame_pacing(
+    Renderer* renderer, const WGPUSurfaceCapabilities* surface_caps
+) {
+    FramePacingConfig config = renderer->pacing_config;
+    FramePacingConfig_from_env(&config);
+    FramePacer_drain(&renderer->pacer);
+    FramePacer_init(&renderer->pacer, renderer->device, &config);
+    if (surface_caps == NULL) return;
+    WGPUPresentMode preferred = config.present_mode;
+    if (preferred == WGPUPresentMode_Undefined) {
+        preferred = WGPUPresentMode_Fifo;
+    }
+    WGPUPresentMode mode = select_present_mode(surface_caps, preferred);
+    if (mode != preferred) {
+        LOG_WARN(
+            "Present mode %s unsupported, using %s",
+            PresentMode_name(preferred),
+            PresentMode_name(mode)
+        );
+    }
+    renderer->render_target.windowed.surface_config.presentMode = mode;
+    LOG_INFO(
+        "Present mode %s, %u frames in flight, %.0f fps cap",
+        PresentMode_name(mode),
+        renderer->pacer.max_frames_in_flight,
+        config.max_fps
+    );
+}
+
+/** Change the present mode, frames in flight or frame rate cap
+ *
+ * Takes effect on the next frame, a new present mode reconfigures the
+ * surface.
+ *
+ * @param[in] renderer  Initialized renderer
+ * @param[in] config    Pacing settings, RAIJIN_* variables still override it
+ */
+void Renderer_set_frame_pacing(
+    Renderer* renderer, const FramePacingConfig* config
+) {
+    renderer->pacing_config = *config;
+    if (renderer->render_mode != RENDER_MODE_WINDOWED) {
+        Renderer_apply_frame_pacing(renderer, NULL);
+        return;
+    }
+    WGPUSurfaceCapabilities surface_caps = {0};
+    wgpuSurfaceGetCapabilities(
+        renderer->render_target.windowed.surface,
+        renderer->adapter,
+        &surface_caps
+    );
+    Renderer_apply_frame_pacing(renderer, &surface_caps);
+    wgpuSurfaceCapabilitiesFreeMembers(surface_caps);
+    wgpuSurfaceConfigure(
+        renderer->render_target.windowed.surface,
+        &renderer->render_target.windowed.surface_config
+    );
+    Renderer_invalidate(renderer);
+}
+
+// Renders into the next slot of the readback ring and copies the frame out
+// in the same submission
+static ReturnStatus Renderer_render_headless(Renderer* renderer) {
+    if (Renderer_set_view_layers(renderer, 1) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    ReadbackRing* ring = &renderer->render_target.headless.readback;
+    f64 start = now_seconds();
+    ReadbackSlot* slot = ReadbackRing_acquire(ring);
+    RendererStats_add_time(&renderer->stats, STATS_TIMER_ACQUIRE, start);
+    WGPUTextureViewDescriptor texture_view_desc = {
+        .label = {"Headless Texture View", WGPU_STRLEN},
+        .format = ring->format,
+        .dimension = WGPUTextureViewDimension_2D,
+        .baseMipLevel = 0,
+        .mipLevelCount = 1,
+        .baseArrayLayer = 0,
+        .arrayLayerCount = 1,
+        .aspect = WGPUTextureAspect_All,
     };
-    WGPUDepthStencilState edges_depth_pencil_state = {
-        .format = WGPUTextureFormat_Depth24Plus,
-        .depthWriteEnabled = false,
-        .depthCompare = WGPUCompareFunction_Less,
+    WGPUTextureView texture_view =
+        wgpuTextureCreateView(slot->texture, &texture_view_desc);
+    if (texture_view == NULL) {
+        LOG_ERROR("Failed to create headless texture view");
+        return RETURN_FAILURE;
+    }
+    WGPUCommandEncoderDescriptor command_encoder_desc = {
+        .label = {"Headless Encoder", WGPU_STRLEN},
     };
-    WGPURenderPipelineDescriptor edges_pipeline_desc = {
-        .label = {"Edges Pipeline", WGPU_STRLEN},
-        .layout = wgpuDeviceCreatePipelineLayout(
-            renderer->device, &edges_pipeline_layout_desc
-        ),
-        .vertex = vert_state,
-        .fragment = &edges_frag_state,
-        .depthStencil = &edges_depth_pencil_state,
-        .primitive =
-            (WGPUPrimitiveState){
-                .topology = WGPUPrimitiveTopology_LineList,
-                .frontFace = WGPUFrontFace_CCW,
-                .cullMode = WGPUCullMode_Back,
-                .unclippedDepth = false,
-            },
-        .multisample = (WGPUMultisampleState){
-            .count = 1,
-            .mask = 0xFFFFFFFF,
-            .alphaToCoverageEnabled = false,
-        },
+    start = now_seconds();
+    f64 nested_ms = RendererStats_nested_ms(&renderer->stats);
+    WGPUCommandEncoder command_encoder =
+        wgpuDeviceCreateCommandEncoder(renderer->device, &command_encoder_desc);
+    GpuTimer_begin_frame(&renderer->gpu_timer);
+    Renderer_encode_passes(renderer, command_encoder, texture_view);
+    GpuTimer_resolve(&renderer->gpu_timer, command_encoder);
+    ReadbackRing_encode_copy(ring, slot, command_encoder);
+    WGPUCommandBufferDescriptor command_buffer_desc = {
+        .label = {"Headless Command Buffer", WGPU_STRLEN},
     };
-    renderer->edges_pipeline =
-        wgpuDeviceCreateRenderPipeline(renderer->device, &edges_pipeline_desc);
+    WGPUCommandBuffer command_buffer =
+        wgpuCommandEncoderFinish(command_encoder, &command_buffer_desc);
+    RendererStats_add_encode_time(&renderer->stats, start, nested_ms);
+    Renderer_flush_uniforms(renderer);
+
+    start = now_seconds();
+    wgpuQueueSubmit(renderer->queue, 1, &command_buffer);
+    GpuTimer_submitted(&renderer->gpu_timer);
+    ReadbackRing_submitted(ring, slot);
+    RendererStats_add_time(&renderer->stats, STATS_TIMER_PRESENT, start);
 
-    CharArray_free(&default_shader_src);
+    wgpuCommandBufferRelease(command_buffer);
+    wgpuCommandEncoderRelease(command_encoder);
+    wgpuTextureViewRelease(texture_view);
     return RETURN_SUCCESS;
 }
 
-// TODO (mmckenna): Target for arena allocator
-void Renderer_render_mesh(
-    Renderer* renderer,
-    const MeshType mesh_type,
-    const WGPURenderPassEncoder render_pass_encoder
+// Gives the headless targets one array layer per view
+static ReturnStatus Renderer_set_view_layers(
+    Renderer* renderer, u32 layer_count
 ) {
-    InstanceArray instances;
-    InstanceArray_init(&instances);
-    for (u32 i = 0; i < renderer->draw_commands.count; ++i) {
-        DrawCommand* cmd = &renderer->draw_commands.items[i];
-        if (cmd->mesh_type == mesh_type) {
-            InstanceArray_push(&instances, cmd->instance);
+    ReadbackRing* ring = &renderer->render_target.headless.readback;
+    if (ring->layer_count == layer_count) return RETURN_SUCCESS;
+    return ReadbackRing_init(
+        ring,
+        renderer->device,
+        ring->format,
+        ring->width,
+        ring->height,
+        layer_count
+    );
+}
+
+/** Render the scene from several cameras in a single submission
+ *
+ * Headless only.  View i renders into layer i of the frame's 2D array
+ * target, and the frame callback receives all layers of the frame at once.
+ * The draws of this frame are uploaded once for all views, and each view
+ * only draws the instances inside its frustum.  Changing the number of
+ * views between frames recreates the headless targets.
+ *
+ * @param[in] renderer      Headless renderer
+ * @param[in] views         Camera of each view
+ * @param[in] view_count    Number of views, at most RENDERER_MAX_VIEWS
+ * @returns                 Return status
+ */
+ReturnStatus Renderer_render_views(
+    Renderer* renderer, const RenderView* views, u32 view_count
+) {
+    if (renderer->render_mode != RENDER_MODE_HEADLESS) {
+        LOG_ERROR("Multi-view rendering is only supported in headless mode");
+        return RETURN_FAILURE;
+    }
+    if (view_count == 0 || view_count > RENDERER_MAX_VIEWS) {
+        LOG_ERROR("Unsupported view count: %u", view_count);
+        return RETURN_FAILURE;
+    }
+    if (ShaderWatcher_poll(&renderer->shader_watcher)) {
+        Renderer_reload_shaders(renderer);
+    }
+    if (Renderer_set_view_layers(renderer, view_count) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    f64 frame_start = Renderer_begin_stats(renderer);
+
+    // A uniform block per view, uploaded with the main camera block in one
+    // write.  The frustum planes assume a [-1, 1] depth range, with WebGPU's
+    // [0, 1] the near plane ends up behind the camera and culling stays
+    // conservative.
+    u32 uniform_offsets[RENDERER_MAX_VIEWS];
+    vec4 frustums[RENDERER_MAX_VIEWS][6];
+    UniformRing_reset(&renderer->uniforms);
+    for (u32 v = 0; v < view_count; ++v) {
+        mat4 proj, view;
+        Uniform uniform = {0};
+        memcpy(proj, views[v].proj, sizeof(mat4));
+        memcpy(view, views[v].view, sizeof(mat4));
+        glm_mat4_mul(proj, view, uniform.view_proj);
+        glm_frustum_planes(uniform.view_proj, frustums[v]);
+        uniform_offsets[v] =
+            UniformRing_push(&renderer->uniforms, &uniform, sizeof(uniform));
+    }
+    Renderer_flush_uniforms(renderer);
+
+    ViewInstances ranges[RENDERER_MAX_VIEWS];
+    u32 instance_counts[MESH_TYPE_COUNT] = {0};
+    for (u32 i = 0; i < MESH_TYPE_COUNT; ++i) {
+        Renderer_upload_view_instances(
+            renderer, i, frustums, view_count, ranges
+        );
+        for (u32 v = 0; v < view_count; ++v) {
+            instance_counts[i] += ranges[v].count[i];
+        }
+    }
+    Renderer_require_pipelines(renderer, instance_counts);
+
+    ReadbackRing* ring = &renderer->render_target.headless.readback;
+    f64 start = now_seconds();
+    ReadbackSlot* slot = ReadbackRing_acquire(ring);
+    RendererStats_add_time(&renderer->stats, STATS_TIMER_ACQUIRE, start);
+    WGPUCommandEncoderDescriptor command_encoder_desc = {
+        .label = {"Multi-View Encoder", WGPU_STRLEN},
+    };
+    start = now_seconds();
+    f64 nested_ms = RendererStats_nested_ms(&renderer->stats);
+    WGPUCommandEncoder command_encoder =
+        wgpuDeviceCreateCommandEncoder(renderer->device, &command_encoder_desc);
+    // Passes past GPU_TIMER_MAX_PASSES, from the later views, go untimed
+    GpuTimer_begin_frame(&renderer->gpu_timer);
+    WGPUTextureView texture_views[RENDERER_MAX_VIEWS] = {0};
+    WGPURenderBundle bundles[RENDERER_MAX_VIEWS] = {0};
+    bool screen_space = renderer->enable_edges &&
+                        renderer->edge_mode == EDGE_MODE_SCREEN_SPACE;
+    ReturnStatus status = RETURN_SUCCESS;
+    for (u32 v = 0; v < view_count; ++v) {
+        WGPUTextureViewDescriptor texture_view_desc = {
+            .label = {"Multi-View Layer View", WGPU_STRLEN},
+            .format = ring->format,
+            .dimension = WGPUTextureViewDimension_2D,
+            .baseMipLevel = 0,
+            .mipLevelCount = 1,
+            .baseArrayLayer = v,
+            .arrayLayerCount = 1,
+            .aspect = WGPUTextureAspect_All,
+        };
+        texture_views[v] =
+            wgpuTextureCreateView(slot->texture, &texture_view_desc);
+        if (texture_views[v] == NULL) {
+            LOG_ERROR("Failed to create view of layer %u", v);
+            status = RETURN_FAILURE;
+            break;
+        }
+        // Ranges differ per view and per frame, so bundles are not kept
+        RenderBundleKey key;
+        memset(&key, 0, sizeof(key));
+        memcpy(key.instance_counts, ranges[v].count, sizeof(ranges[v].count));
+        key.enable_edges = renderer->enable_edges;
+        key.edge_mode = renderer->edge_mode;
+        bundles[v] = Renderer_record_render_bundle(
+            renderer, &key, uniform_offsets[v], ranges[v].first
+        );
+        Renderer_count_draws(renderer, key.instance_counts);
+        // The depth and outline targets are shared, views render in turn
+        Renderer_execute_solid_pass(
+            renderer, command_encoder, texture_views[v], bundles[v]
+        );
+        if (screen_space) {
+            Renderer_encode_outline_pass(
+                renderer, command_encoder, texture_views[v], uniform_offsets[v]
+            );
         }
     }
-
-    // No instances to render
-    if (instances.count == 0) {
-        return;
+    if (status == RETURN_SUCCESS) {
+        GpuTimer_resolve(&renderer->gpu_timer, command_encoder);
+        ReadbackRing_encode_copy(ring, slot, command_encoder);
+        WGPUCommandBufferDescriptor command_buffer_desc = {
+            .label = {"Multi-View Command Buffer", WGPU_STRLEN},
+        };
+        WGPUCommandBuffer command_buffer =
+            wgpuCommandEncoderFinish(command_encoder, &command_buffer_desc);
+        RendererStats_add_encode_time(&renderer->stats, start, nested_ms);
+        start = now_seconds();
+        wgpuQueueSubmit(renderer->queue, 1, &command_buffer);
+        GpuTimer_submitted(&renderer->gpu_timer);
+        ReadbackRing_submitted(ring, slot);
+        RendererStats_add_time(&renderer->stats, STATS_TIMER_PRESENT, start);
+        wgpuCommandBufferRelease(command_buffer);
     }
 
-    Mesh* mesh = &renderer->meshes[mesh_type];
-    if (instances.count > mesh->instance_capacity) {
-        Mesh_realloc_instance_buffer(mesh, renderer->device, instances.count);
+    for (u32 v = 0; v < view_count; ++v) {
+        if (bundles[v] != NULL) wgpuRenderBundleRelease(bundles[v]);
+        if (texture_views[v] != NULL) wgpuTextureViewRelease(texture_views[v]);
     }
-    wgpuQueueWriteBuffer(
-        renderer->queue,
-        mesh->instance_buffer,
-        0,
-        instances.items,
-        instances.count * sizeof(Instance)
-    );
-    wgpuRenderPassEncoderSetVertexBuffer(
-        render_pass_encoder,
-        0,
-        mesh->vertex_buffer,
-        0,
-        mesh->vertices.count * sizeof(Vertex)
-    );
-    wgpuRenderPassEncoderSetVertexBuffer(
-        render_pass_encoder,
-        1,
-        mesh->instance_buffer,
-        0,
-        instances.count * sizeof(Instance)
-    );
-    wgpuRenderPassEncoderSetIndexBuffer(
-        render_pass_encoder,
-        mesh->index_buffer,
-        WGPUIndexFormat_Uint16,
-        0,
-        mesh->indices.count * sizeof(u16)
-    );
-    wgpuRenderPassEncoderDrawIndexed(
-        render_pass_encoder, mesh->indices.count, instances.count, 0, 0, 0
-    );
-    InstanceArray_free(&instances);
+    wgpuCommandEncoderRelease(command_encoder);
+    DrawCommandArray_clear(&renderer->draw_commands);
+    Renderer_end_stats(renderer, frame_start);
+    return status;
 }
 
-void Renderer_render_pass_solid(
-    Renderer* renderer,
-    const WGPUCommandEncoder command_encoder,
-    const WGPUTextureView texture_view
+/** Receive every headless frame rendered from now on
+ *
+ * Frames are delivered in order from `Renderer_render` and
+ * `Renderer_poll_frames`, a few frames after they were rendered.  Without a
+ * callback frames are not read back at all.
+ *
+ * @param[in] renderer  Headless renderer
+ * @param[in] callback  Called with each frame, NULL to stop reading back
+ * @param[in] userdata  Passed to the callback
+ */
+void Renderer_set_frame_callback(
+    Renderer* renderer, HeadlessFrameCallback callback, void* userdata
 ) {
-    WGPURenderPassColorAttachment color_attachment = {
-        .view = texture_view,
-        .loadOp = WGPULoadOp_Clear,
-        .clearValue =
-            (WGPUColor){
-                .r = 0.01,
-                .g = 0.01,
-                .b = 0.01,
-                .a = 1.0,
-            },
-        .storeOp = WGPUStoreOp_Store,
-    };
-    WGPURenderPassDepthStencilAttachment depth_stencil_attachment = {
-        .view = renderer->depth_texture_view,
-        .depthLoadOp = WGPULoadOp_Clear,
-        .depthClearValue = 1.0,
-        .depthStoreOp = WGPUStoreOp_Store,
-    };
-    WGPURenderPassDescriptor render_pass_desc = {
-        .label = {"Render Pass", WGPU_STRLEN},
-        .colorAttachments = &color_attachment,
-        .colorAttachmentCount = 1,
-        .depthStencilAttachment = &depth_stencil_attachment,
-    };
-    WGPURenderPassEncoder render_pass_encoder =
-        wgpuCommandEncoderBeginRenderPass(command_encoder, &render_pass_desc);
-    wgpuRenderPassEncoderSetPipeline(
-        render_pass_encoder, renderer->solid_pipeline
-    );
-    wgpuRenderPassEncoderSetBindGroup(
-        render_pass_encoder, 0, renderer->uniform_bind_group, 0, NULL
-    );
-    // TODO (mmckenna) : render mesh instances
-    for (u32 i = 0; i < MESH_TYPE_COUNT; ++i) {
-        switch (i) {
-            case MESH_TYPE_TRIANGLE: {
-                Renderer_render_mesh(
-                    renderer, MESH_TYPE_TRIANGLE, render_pass_encoder
-                );
-            } break;
-            case MESH_TYPE_CUBE: {
-                Renderer_render_mesh(
-                    renderer, MESH_TYPE_CUBE, render_pass_encoder
-                );
-            } break;
-            case MESH_TYPE_TETRAHEDRON: {
-                Renderer_render_mesh(
-                    renderer, MESH_TYPE_TETRAHEDRON, render_pass_encoder
-                );
-            } break;
-            case MESH_TYPE_SPHERE: {
-                Renderer_render_mesh(
-                    renderer, MESH_TYPE_SPHERE, render_pass_encoder
-                );
-            } break;
-        }
+    if (renderer->render_mode != RENDER_MODE_HEADLESS) {
+        LOG_WARN("Frame callbacks are only supported in headless mode");
+        return;
     }
-    wgpuRenderPassEncoderEnd(render_pass_encoder);
-    wgpuRenderPassEncoderRelease(render_pass_encoder);
-    return;
+    ReadbackRing* ring = &renderer->render_target.headless.readback;
+    ring->callback = callback;
+    ring->userdata = userdata;
 }
 
-void Renderer_render_to_view(
-    Renderer* renderer, const WGPUTextureView texture_view
+/** Deliver the headless frames whose readback finished
+ *
+ * @param[in] renderer  Headless renderer
+ * @param[in] wait      Block until every rendered frame was delivered
+ * @returns             Number of frames delivered
+ */
+u32 Renderer_poll_frames(Renderer* renderer, bool wait) {
+    if (renderer->render_mode != RENDER_MODE_HEADLESS) return 0;
+    return ReadbackRing_poll(&renderer->render_target.headless.readback, wait);
+}
+
+/** GPU time of each pass of a recent frame
+ *
+ * Frames are read back asynchronously, so the times lag a few frames
+ * behind.  Only available when the adapter supports timestamp queries.
+ *
+ * @param[in] renderer  Renderer
+ * @returns             Pass times, NULL if unavailable or none read back yet
+ */
+const GpuFrameTimes* Renderer_gpu_times(const Renderer* renderer) {
+    return GpuTimer_latest(&renderer->gpu_timer);
+}
+
+/** Counters and CPU timings of the last frame rendered
+ *
+ * @param[in] renderer  Renderer
+ * @returns             Stats, NULL before the first frame
+ */
+const RendererStats* Renderer_stats(const Renderer* renderer) {
+    return RendererStatsHistory_latest(&renderer->stats_history);
+}
+
+/** Median and 99th percentile of the stats of the last frames
+ *
+ * @param[in] renderer  Renderer
+ * @param[out] summary  Percentiles over up to RENDERER_STATS_HISTORY frames
+ */
+void Renderer_stats_summary(
+    const Renderer* renderer, RendererStatsSummary* summary
 ) {
-    WGPUCommandEncoderDescriptor command_encoder_desc = {
-        .label = {"Encoder", WGPU_STRLEN}
+    RendererStatsHistory_summarize(&renderer->stats_history, summary);
+}
 
-    };
-    WGPUCommandEncoder command_encoder =
-        wgpuDeviceCreateCommandEncoder(renderer->device, &command_encoder_desc);
+/** Render only frames that differ from the last presented one
+ *
+ * `Renderer_render` then hashes the draw list, the camera and the surface
+ * state, and returns at once without encoding, submitting or presenting
+ * when they match the last presented frame.  Headless frames are skipped
+ * the same way, with no frame callback.
+ *
+ * @param[in] renderer      Renderer
+ * @param[in] on_demand     Skip unchanged frames
+ */
+void Renderer_set_on_demand(Renderer* renderer, bool on_demand) {
+    renderer->on_demand = on_demand;
+    Renderer_invalidate(renderer);
+}
 
-    Renderer_render_pass_solid(renderer, command_encoder, texture_view);
-    // TODO (mmckenna) : Outline render pass
+/** Render the next frame even if nothing changed, from any thread */
+void Renderer_invalidate(Renderer* renderer) {
+    __atomic_store_n(&renderer->invalidated, true, __ATOMIC_RELEASE);
+}
 
-    WGPUCommandBufferDescriptor command_buffer_desc = {
-        .label = {"Command Buffer", WGPU_STRLEN}
-    };
-    WGPUCommandBuffer command_buffer =
-        wgpuCommandEncoderFinish(command_encoder, &command_buffer_desc);
+/** Whether the last `Renderer_render` skipped an unchanged frame, from any
+ * thread.  An event loop can then block until something changes.
+ */
+bool Renderer_is_idle(const Renderer* renderer) {
+    return __atomic_load_n(&renderer->idle, __ATOMIC_ACQUIRE);
+}
 
-    wgpuQueueSubmit(renderer->queue, 1, &command_buffer);
+// What a frame's pixels depend on, apart from the surface state that
+// `Renderer_frame_unchanged` checks
+static u64 Renderer_frame_hash(const Renderer* renderer) {
+    u64 h = hash_combine(0, renderer->draw_commands.count);
+    for (u32 i = 0; i < renderer->draw_commands.count; ++i) {
+        const DrawCommand* cmd = &renderer->draw_commands.items[i];
+        h = hash_bytes(
+            &cmd->instance, sizeof(Instance), hash_combine(h, cmd->mesh_type)
+        );
+    }
+    // The persistent blocks hold the camera
+    if (renderer->uniforms.blocks != NULL) {
+        h = hash_bytes(
+            renderer->uniforms.blocks,
+            UNIFORM_RING_RESERVED * UNIFORM_BLOCK_ALIGNMENT,
+            h
+        );
+    }
+    // Replacing a mesh's geometry bumps its generation
+    for (u32 i = 0; i < MESH_TYPE_COUNT; ++i) {
+        h = hash_combine(h, renderer->meshes[i].buffer_generation);
+    }
+    h = hash_combine(h, renderer->enable_edges);
+    h = hash_combine(h, renderer->edge_mode);
+    return hash_combine(h, renderer->pipeline_generation);
+}
 
-    // Cleanup
-    wgpuCommandBufferRelease(command_buffer);
-    wgpuCommandEncoderRelease(command_encoder);
-    return;
+// Whether the frame about to render matches the last presented one, and
+// records the result for `Renderer_is_idle`
+static bool Renderer_frame_unchanged(Renderer* renderer, u64 hash) {
+    bool invalidated =
+        __atomic_exchange_n(&renderer->invalidated, false, __ATOMIC_ACQ_REL);
+    bool unchanged = !invalidated && renderer->has_presented_hash &&
+                     renderer->presented_hash == hash;
+    // Resizes and recoveries reconfigure the surface, which always renders
+    if (renderer->render_mode == RENDER_MODE_WINDOWED &&
+        renderer->render_target.windowed.reconfigure_pending) {
+        unchanged = false;
+    }
+    __atomic_store_n(&renderer->idle, unchanged, __ATOMIC_RELEASE);
+    return unchanged;
+}
+
+// Starts the stats of a frame, returns its start time
+static f64 Renderer_begin_stats(Renderer* renderer) {
+    RendererStats_begin(&renderer->stats, renderer->stats_history.frame_count);
+    return now_seconds();
+}
+
+static void Renderer_end_stats(Renderer* renderer, f64 start) {
+    const GpuFrameTimes* gpu_times = GpuTimer_latest(&renderer->gpu_timer);
+    renderer->stats.gpu_ms = gpu_times != NULL ? gpu_times->total_ms : 0.0;
+    renderer->stats.frame_ms = (now_seconds() - start) * 1e3;
+    RendererStatsHistory_push(&renderer->stats_history, &renderer->stats);
+}
+
+// Uploads the uniform blocks written this frame
+static void Renderer_flush_uniforms(Renderer* renderer) {
+    f64 start = now_seconds();
+    renderer->stats.upload_bytes +=
+        UniformRing_flush(&renderer->uniforms, renderer->queue);
+    RendererStats_add_time(&renderer->stats, STATS_TIMER_UPLOAD, start);
 }
 
 // Provide a single interface for all render modes
 ReturnStatus Renderer_render(Renderer* renderer) {
+    // Polled before the idle check so an edited shader redraws
+    bool reload = ShaderWatcher_poll(&renderer->shader_watcher);
+    u64 hash = 0;
+    if (renderer->on_demand && !reload) {
+        hash = Renderer_frame_hash(renderer);
+        if (Renderer_frame_unchanged(renderer, hash)) {
+            DrawCommandArray_clear(&renderer->draw_commands);
+            ++renderer->skipped_frames;
+            return RETURN_SUCCESS;
+        }
+    }
+    f64 frame_start = Renderer_begin_stats(renderer);
+    if (reload) Renderer_reload_shaders(renderer);
+    // Wait for a free frame slot first, so the cap paces frame starts
+    FramePacer_wait(&renderer->pacer);
+    FramePacer_limit(&renderer->pacer);
     WGPUTextureViewDescriptor texture_view_desc = {
         .dimension = WGPUTextureViewDimension_2D,
         .baseMipLevel = 0,
@@ -976,48 +2302,50 @@ ReturnStatus Renderer_render(Renderer* renderer) {
     };
     WGPUTextureView texture_view = {0};
     ReturnStatus status = RETURN_SUCCESS;
+    bool presented = false;
     switch (renderer->render_mode) {
         case RENDER_MODE_HEADLESS: {
-            texture_view_desc.label =
-                (WGPUStringView){"Headless Texture View", WGPU_STRLEN};
-            texture_view_desc.format = WGPUTextureFormat_RGBA8Unorm;
-            texture_view = wgpuTextureCreateView(
-                renderer->render_target.headless.texture, &texture_view_desc
-            );
-            if (texture_view != NULL) wgpuTextureViewRelease(texture_view);
+            status = Renderer_render_headless(renderer);
+            presented = status == RETURN_SUCCESS;
         } break;
         case RENDER_MODE_WINDOWED: {
+            // A minimized window has nothing to present
+            if (!Renderer_apply_resize(renderer)) break;
             texture_view_desc.label =
                 (WGPUStringView){"Headless Texture View", WGPU_STRLEN};
             texture_view_desc.format =
                 renderer->render_target.windowed.surface_config.format;
             WGPUSurfaceTexture surface_texture = {0};
-            wgpuSurfaceGetCurrentTexture(
-                renderer->render_target.windowed.surface, &surface_texture
+            f64 start = now_seconds();
+            status =
+                Renderer_acquire_surface_texture(renderer, &surface_texture);
+            RendererStats_add_time(
+                &renderer->stats, STATS_TIMER_ACQUIRE, start
             );
-            // TODO (mmckenna): Handle each status variant
-            if (surface_texture.status !=
-                WGPUSurfaceGetCurrentTextureStatus_SuccessOptimal) {
-                LOG_ERROR("Failed to get surface texture");
-                // TODO (mmckenna) reconfigure surface and re-initialize depth
-                // texture
-                status = RETURN_FAILURE;
-                break;
-            }
-
-            if (status == RETURN_SUCCESS) {
+            // Skipped on timeout
+            if (status == RETURN_SUCCESS && surface_texture.texture != NULL) {
                 texture_view = wgpuTextureCreateView(
                     surface_texture.texture, &texture_view_desc
                 );
-                Renderer_render_to_view(renderer, texture_view);
+                WGPUSubmissionIndex submission =
+                    Renderer_render_to_view(renderer, texture_view);
+                start = now_seconds();
                 WGPUStatus present_status = wgpuSurfacePresent(
                     renderer->render_target.windowed.surface
                 );
-                // TODO (mmckenna): Handle each status variant
+                RendererStats_add_time(
+                    &renderer->stats, STATS_TIMER_PRESENT, start
+                );
+                FramePacer_submitted(
+                    &renderer->pacer, renderer->queue, submission
+                );
+                // The frame is lost, the next one starts on a fresh
+                // configuration
                 if (present_status != WGPUStatus_Success) {
-                    LOG_ERROR("Failed to present surface");
-                    status = RETURN_FAILURE;
+                    LOG_WARN("Failed to present surface, reconfiguring");
+                    Renderer_request_reconfigure(renderer);
                 }
+                presented = present_status == WGPUStatus_Success;
             }
             if (texture_view != NULL) wgpuTextureViewRelease(texture_view);
             if (surface_texture.texture != NULL) {
@@ -1026,21 +2354,36 @@ ReturnStatus Renderer_render(Renderer* renderer) {
         } break;
     }
     LOG_DEBUG("Command count: %ld", renderer->draw_commands.count);
-    DrawCommandArray_reset(&renderer->draw_commands);
+    DrawCommandArray_clear(&renderer->draw_commands);
     LOG_DEBUG("Command count after: %ld", renderer->draw_commands.count);
+    // Skipped, failed and recovering frames leave nothing to compare with
+    renderer->has_presented_hash = renderer->on_demand && !reload && presented;
+    renderer->presented_hash = hash;
+    Renderer_end_stats(renderer, frame_start);
     return status;
 }
 
 void Renderer_destroy(Renderer* renderer) {
-    if (renderer->uniform_buffer != NULL) {
-        wgpuBufferRelease(renderer->uniform_buffer);
+    // An init that failed early may still have its threads running
+    Renderer_wait_init(renderer);
+    CharArray_free(&renderer->shader_source);
+    DrawCommandArray_free(&renderer->draw_commands);
+    FramePacer_drain(&renderer->pacer);
+    GpuTimer_destroy(&renderer->gpu_timer);
+    Renderer_invalidate_render_bundle(renderer);
+    UniformRing_destroy(&renderer->uniforms);
+    if (renderer->uniform_bind_group != NULL) {
+        wgpuBindGroupRelease(renderer->uniform_bind_group);
     }
-    if (renderer->solid_pipeline != NULL) {
-        wgpuRenderPipelineRelease(renderer->solid_pipeline);
-    }
-    if (renderer->edges_pipeline != NULL) {
-        wgpuRenderPipelineRelease(renderer->edges_pipeline);
+    // Pipelines and layouts are borrowed from the cache
+    if (renderer->pipeline_cache.used_keys.count > 0) {
+        PipelineCache_save(
+            &renderer->pipeline_cache, RAIJIN_PIPELINE_CACHE_PATH
+        );
     }
+    PipelineCache_destroy(&renderer->pipeline_cache);
+    ShaderWatcher_destroy(&renderer->shader_watcher);
+    Renderer_create_outline_targets(renderer, 0, 0);
     if (renderer->depth_texture_view != NULL) {
         wgpuTextureViewRelease(renderer->depth_texture_view);
     }
@@ -1054,34 +2397,490 @@ void Renderer_destroy(Renderer* renderer) {
             }
         } break;
         case RENDER_MODE_HEADLESS: {
-            if (renderer->render_target.headless.texture != NULL) {
-                wgpuTextureRelease(renderer->render_target.headless.texture);
-            }
+            ReadbackRing_destroy(&renderer->render_target.headless.readback);
         } break;
     }
     if (renderer->queue != NULL) wgpuQueueRelease(renderer->queue);
     if (renderer->device != NULL) wgpuDeviceRelease(renderer->device);
     if (renderer->adapter != NULL) wgpuAdapterRelease(renderer->adapter);
+    renderer->queue = NULL;
+    renderer->device = NULL;
+    renderer->adapter = NULL;
 }
 
+/** Request a new surface size
+ *
+ * Only records the size: the surface is reconfigured once at the start of
+ * the next frame, with the depth texture and the other size dependent
+ * targets, however many resizes came in between.  The current size is
+ * ignored unless it cancels a pending one.  A zero size, from a minimized
+ * window, skips frames until the next resize.
+ *
+ * @param[in] renderer  Windowed renderer
+ * @param[in] width     New surface width
+ * @param[in] height    New surface height
+ */
 void Renderer_handle_resize(Renderer* renderer, u32 width, u32 height) {
-    renderer->render_target.windowed.surface_config.width = width;
-    renderer->render_target.windowed.surface_config.height = height;
-    wgpuSurfaceConfigure(
-        renderer->render_target.windowed.surface,
-        &renderer->render_target.windowed.surface_config
-    );
-    LOG_INFO("Surface configured successfully");
-    return;
+    if (renderer->render_mode != RENDER_MODE_WINDOWED) return;
+    const WGPUSurfaceConfiguration* config =
+        &renderer->render_target.windowed.surface_config;
+    if (!renderer->render_target.windowed.reconfigure_pending &&
+        width == config->width && height == config->height) {
+        return;
+    }
+    renderer->render_target.windowed.pending_width = width;
+    renderer->render_target.windowed.pending_height = height;
+    renderer->render_target.windowed.reconfigure_pending = true;
+}
+
+// Reconfigures the surface at the start of the next frame, at the last
+// requested size if a resize is pending
+static void Renderer_request_reconfigure(Renderer* renderer) {
+    if (renderer->render_target.windowed.reconfigure_pending) return;
+    const WGPUSurfaceConfiguration* config =
+        &renderer->render_target.windowed.surface_config;
+    renderer->render_target.windowed.pending_width = config->width;
+    renderer->render_target.windowed.pending_height = config->height;
+    renderer->render_target.windowed.reconfigure_pending = true;
 }
 
+// Applies a pending reconfiguration and fits the size dependent targets to
+// the surface.  False while the requested size is zero.
+static bool Renderer_apply_resize(Renderer* renderer) {
+    WGPUSurfaceConfiguration* config =
+        &renderer->render_target.windowed.surface_config;
+    if (renderer->render_target.windowed.reconfigure_pending) {
+        u32 width = renderer->render_target.windowed.pending_width;
+        u32 height = renderer->render_target.windowed.pending_height;
+        if (width == 0 || height == 0) return false;
+        config->width = width;
+        config->height = height;
+        wgpuSurfaceConfigure(renderer->render_target.windowed.surface, config);
+        renderer->render_target.windowed.reconfigure_pending = false;
+        ++renderer->stats.surface_reconfigures;
+        LOG_DEBUG("Configured surface size: [%u, %u]", width, height);
+    }
+    Renderer_fit_targets(renderer, config->width, config->height);
+    return true;
+}
+
+// Recreates the depth texture, and the outline targets with it, when they
+// no longer match the color target
+static void Renderer_fit_targets(Renderer* renderer, u32 width, u32 height) {
+    if (renderer->depth_texture != NULL &&
+        wgpuTextureGetWidth(renderer->depth_texture) == width &&
+        wgpuTextureGetHeight(renderer->depth_texture) == height) {
+        return;
+    }
+    Renderer_create_depth_texture(renderer, width, height);
+}
+
+// Acquires the next surface texture.  Outdated and lost surfaces are
+// reconfigured and acquired again within the frame.  Succeeds without a
+// texture on timeout, the frame is then skipped.
+static ReturnStatus Renderer_acquire_surface_texture(
+    Renderer* renderer, WGPUSurfaceTexture* surface_texture
+) {
+    WGPUSurface surface = renderer->render_target.windowed.surface;
+    for (u32 attempt = 0; attempt < 2; ++attempt) {
+        wgpuSurfaceGetCurrentTexture(surface, surface_texture);
+        switch (surface_texture->status) {
+            case WGPUSurfaceGetCurrentTextureStatus_SuccessOptimal:
+                return RETURN_SUCCESS;
+            case WGPUSurfaceGetCurrentTextureStatus_SuccessSuboptimal:
+                // Still presentable, reconfigured before the next frame
+                Renderer_request_reconfigure(renderer);
+                return RETURN_SUCCESS;
+            case WGPUSurfaceGetCurrentTextureStatus_Timeout:
+                LOG_WARN("Timed out acquiring the surface texture");
+                if (surface_texture->texture != NULL) {
+                    wgpuTextureRelease(surface_texture->texture);
+                    surface_texture->texture = NULL;
+                }
+                return RETURN_SUCCESS;
+            case WGPUSurfaceGetCurrentTextureStatus_Outdated:
+            case WGPUSurfaceGetCurrentTextureStatus_Lost:
+                if (surface_texture->texture != NULL) {
+                    wgpuTextureRelease(surface_texture->texture);
+                    surface_texture->texture = NULL;
+                }
+                LOG_INFO("Surface outdated or lost, reconfiguring");
+                Renderer_request_reconfigure(renderer);
+                if (!Renderer_apply_resize(renderer)) return RETURN_SUCCESS;
+                break;
+            default:
+                LOG_ERROR(
+                    "Failed to get surface texture: %d", surface_texture->status
+                );
+                return RETURN_FAILURE;
+        }
+    }
+    LOG_ERROR("Surface still outdated after reconfiguring");
+    return RETURN_FAILURE;
+}
+
+/** Set the main camera, uploaded with the next frame
+ *
+ * @param[in] renderer      Renderer
+ * @param[in] proj_matrix   Projection matrix
+ * @param[in] view_matrix   View matrix
+ */
 void Renderer_update_uniforms(
     Renderer* renderer, mat4 proj_matrix, mat4 view_matrix
 ) {
     Uniform uniform = {0};
     glm_mat4_mul(proj_matrix, view_matrix, uniform.view_proj);
-    wgpuQueueWriteBuffer(
-        renderer->queue, renderer->uniform_buffer, 0, &uniform, sizeof(Uniform)
+    UniformRing_write(
+        &renderer->uniforms, UNIFORM_BLOCK_MAIN, &uniform, sizeof(Uniform)
+    );
+}
+
+// Solid pipelines that draw the mesh without index or vertex buffers: group 1
+// exposes the mesh buffers as storage and `vs_wireframe` pulls the triangle
+// corners by `vertex_index`
+static void Renderer_create_wireframe_pipelines(
+    Renderer* renderer,
+    WGPUShaderModule shader,
+    WGPUBindGroupLayout uniform_layout,
+    const WGPUColorTargetState* color_target,
+    WGPUTextureFormat depth_format
+) {
+    WGPUBindGroupLayoutEntry entries[3];
+    for (u32 i = 0; i < 3; ++i) {
+        entries[i] = (WGPUBindGroupLayoutEntry){
+            .binding = i,
+            .visibility = WGPUShaderStage_Vertex,
+            .buffer = (WGPUBufferBindingLayout){
+                .type = WGPUBufferBindingType_ReadOnlyStorage,
+            },
+        };
+    }
+    WGPUBindGroupLayoutDescriptor layout_desc = {
+        .label = {"Wireframe Bind Group Layout", WGPU_STRLEN},
+        .entries = entries,
+        .entryCount = 3,
+    };
+    renderer->wireframe_bind_group_layout = PipelineCache_bind_group_layout(
+        &renderer->pipeline_cache, &layout_desc
+    );
+
+    WGPUBindGroupLayout layouts[] = {
+        uniform_layout,
+        renderer->wireframe_bind_group_layout,
+    };
+    WGPUPipelineLayoutDescriptor pipeline_layout_desc = {
+        .label = {"Wireframe Pipeline Layout", WGPU_STRLEN},
+        .bindGroupLayouts = layouts,
+        .bindGroupLayoutCount = 2,
+    };
+    WGPUPipelineLayout pipeline_layout = PipelineCache_pipeline_layout(
+        &renderer->pipeline_cache, &pipeline_layout_desc
+    );
+    WGPUVertexBufferLayout instance_layout = Instance_desc();
+    WGPUFragmentState frag_state = {
+        .module = shader,
+        .entryPoint = {"wireframe_fs_main", WGPU_STRLEN},
+        .targets = color_target,
+        .targetCount = 1,
+    };
+    WGPUDepthStencilState depth_stencil_state = {
+        .format = depth_format,
+        .depthWriteEnabled = true,
+        .depthCompare = WGPUCompareFunction_Less,
+    };
+    for (u32 format = 0; format < VERTEX_FORMAT_COUNT; ++format) {
+        WGPUConstantEntry constants[] = {
+            {
+                .key = {"QUANTIZED", WGPU_STRLEN},
+                .value = format == VERTEX_FORMAT_QUANTIZED,
+            },
+        };
+        WGPURenderPipelineDescriptor pipeline_desc = {
+            .label = {"Wireframe Pipeline", WGPU_STRLEN},
+            .layout = pipeline_layout,
+            .vertex =
+                (WGPUVertexState){
+                    .module = shader,
+                    .entryPoint = {"vs_wireframe", WGPU_STRLEN},
+                    .constants = constants,
+                    .constantCount = 1,
+                    .bufferCount = 1,
+                    .buffers = &instance_layout,
+                },
+            .fragment = &frag_state,
+            .depthStencil = &depth_stencil_state,
+            .primitive =
+                (WGPUPrimitiveState){
+                    .topology = WGPUPrimitiveTopology_TriangleList,
+                    .frontFace = WGPUFrontFace_CCW,
+                    .cullMode = WGPUCullMode_Back,
+                },
+            .multisample = (WGPUMultisampleState){
+                .count = 1,
+                .mask = 0xFFFFFFFF,
+            },
+        };
+        renderer->wireframe_pipelines[format] = PipelineCache_render_pipeline(
+            &renderer->pipeline_cache, &pipeline_desc
+        );
+    }
+}
+
+static WGPUBindGroup Renderer_wireframe_bind_group(
+    Renderer* renderer, Mesh* mesh
+) {
+    if (mesh->wireframe_bind_group != NULL) return mesh->wireframe_bind_group;
+    WGPUBindGroupEntry entries[] = {
+        {
+            .binding = 0,
+            .buffer = mesh->vertex_buffer,
+            .size = WGPU_WHOLE_SIZE,
+        },
+        {
+            .binding = 1,
+            .buffer = mesh->index_buffer,
+            .size = WGPU_WHOLE_SIZE,
+        },
+        {
+            .binding = 2,
+            .buffer = mesh->edge_flag_buffer,
+            .size = WGPU_WHOLE_SIZE,
+        },
+    };
+    WGPUBindGroupDescriptor bind_group_desc = {
+        .label = {"Wireframe Bind Group", WGPU_STRLEN},
+        .layout = renderer->wireframe_bind_group_layout,
+        .entries = entries,
+        .entryCount = 3,
+    };
+    mesh->wireframe_bind_group =
+        wgpuDeviceCreateBindGroup(renderer->device, &bind_group_desc);
+    return mesh->wireframe_bind_group;
+}
+
+/** (Re)create the normal and id targets of the screen space outline mode
+ *
+ * Must follow every depth texture change since the outline bind group reads
+ * all three.  A zero size only releases them.
+ *
+ * @param[in] renderer  Renderer
+ * @param[in] width     Target width, matching the depth texture
+ * @param[in] height    Target height, matching the depth texture
+ */
+void Renderer_create_outline_targets(
+    Renderer* renderer, u32 width, u32 height
+) {
+    if (renderer->outline_bind_group != NULL) {
+        wgpuBindGroupRelease(renderer->outline_bind_group);
+        renderer->outline_bind_group = NULL;
+    }
+    WGPUTexture* textures[] = {
+        &renderer->normal_texture,
+        &renderer->id_texture,
+    };
+    WGPUTextureView* views[] = {
+        &renderer->normal_texture_view,
+        &renderer->id_texture_view,
+    };
+    WGPUTextureFormat formats[] = {
+        WGPUTextureFormat_RGBA16Float,
+        WGPUTextureFormat_R32Uint,
+    };
+    const char* labels[] = {"Normal Texture", "Id Texture"};
+    for (u32 i = 0; i < 2; ++i) {
+        if (*views[i] != NULL) wgpuTextureViewRelease(*views[i]);
+        if (*textures[i] != NULL) wgpuTextureRelease(*textures[i]);
+        *views[i] = NULL;
+        *textures[i] = NULL;
+        if (width == 0 || height == 0) continue;
+        WGPUTextureDescriptor texture_desc = {
+            .label = {labels[i], WGPU_STRLEN},
+            .size = {width, height, 1},
+            .mipLevelCount = 1,
+            .sampleCount = 1,
+            .dimension = WGPUTextureDimension_2D,
+            .format = formats[i],
+            .usage = WGPUTextureUsage_RenderAttachment |
+                     WGPUTextureUsage_TextureBinding,
+        };
+        *textures[i] = wgpuDeviceCreateTexture(renderer->device, &texture_desc);
+        *views[i] = wgpuTextureCreateView(*textures[i], NULL);
+    }
+}
+
+// Pipelines of the screen space outline mode: solid pipelines with the extra
+// normal and id targets, and the full screen outline pass
+static void Renderer_create_outline_pipelines(
+    Renderer* renderer,
+    WGPUShaderModule shader,
+    WGPUBindGroupLayout uniform_layout,
+    const WGPUColorTargetState* color_target,
+    const WGPUDepthStencilState* depth_stencil,
+    WGPUTextureFormat color_format
+) {
+    WGPUPipelineLayoutDescriptor gbuffer_layout_desc = {
+        .label = {"GBuffer Pipeline Layout", WGPU_STRLEN},
+        .bindGroupLayouts = &uniform_layout,
+        .bindGroupLayoutCount = 1,
+    };
+    WGPUPipelineLayout gbuffer_layout = PipelineCache_pipeline_layout(
+        &renderer->pipeline_cache, &gbuffer_layout_desc
+    );
+    WGPUColorTargetState gbuffer_targets[] = {
+        *color_target,
+        {
+            .format = WGPUTextureFormat_RGBA16Float,
+            .writeMask = WGPUColorWriteMask_All,
+        },
+        {
+            .format = WGPUTextureFormat_R32Uint,
+            .writeMask = WGPUColorWriteMask_All,
+        },
+    };
+    WGPUFragmentState gbuffer_frag_state = {
+        .module = shader,
+        .entryPoint = {"gbuffer_fs_main", WGPU_STRLEN},
+        .targets = gbuffer_targets,
+        .targetCount = 3,
+    };
+    for (u32 format = 0; format < VERTEX_FORMAT_COUNT; ++format) {
+        WGPUVertexBufferLayout buffers[] = {
+            Vertex_desc(format),
+            Instance_desc(),
+        };
+        WGPUConstantEntry constants[] = {
+            {
+                .key = {"QUANTIZED", WGPU_STRLEN},
+                .value = format == VERTEX_FORMAT_QUANTIZED,
+            },
+        };
+        WGPURenderPipelineDescriptor pipeline_desc = {
+            .label = {"GBuffer Pipeline", WGPU_STRLEN},
+            .layout = gbuffer_layout,
+            .vertex =
+                (WGPUVertexState){
+                    .module = shader,
+                    .entryPoint = {"vs_main", WGPU_STRLEN},
+                    .constants = constants,
+                    .constantCount = 1,
+                    .bufferCount = 2,
+                    .buffers = buffers,
+                },
+            .fragment = &gbuffer_frag_state,
+            .depthStencil = depth_stencil,
+            .primitive =
+                (WGPUPrimitiveState){
+                    .topology = WGPUPrimitiveTopology_TriangleList,
+                    .frontFace = WGPUFrontFace_CCW,
+                    .cullMode = WGPUCullMode_Back,
+                },
+            .multisample = (WGPUMultisampleState){
+                .count = 1,
+                .mask = 0xFFFFFFFF,
+            },
+        };
+        renderer->gbuffer_pipelines[format] = PipelineCache_render_pipeline(
+            &renderer->pipeline_cache, &pipeline_desc
+        );
+    }
+
+    // Bindings 3 to 5 of group 1, clear of the wireframe storage bindings
+    WGPUBindGroupLayoutEntry entries[] = {
+        {
+            .binding = 3,
+            .visibility = WGPUShaderStage_Fragment,
+            .texture = {
+                .sampleType = WGPUTextureSampleType_Depth,
+                .viewDimension = WGPUTextureViewDimension_2D,
+            },
+        },
+        {
+            .binding = 4,
+            .visibility = WGPUShaderStage_Fragment,
+            .texture = {
+                .sampleType = WGPUTextureSampleType_UnfilterableFloat,
+                .viewDimension = WGPUTextureViewDimension_2D,
+            },
+        },
+        {
+            .binding = 5,
+            .visibility = WGPUShaderStage_Fragment,
+            .texture = {
+                .sampleType = WGPUTextureSampleType_Uint,
+                .viewDimension = WGPUTextureViewDimension_2D,
+            },
+        },
+    };
+    WGPUBindGroupLayoutDescriptor outline_layout_desc = {
+        .label = {"Outline Bind Group Layout", WGPU_STRLEN},
+        .entries = entries,
+        .entryCount = 3,
+    };
+    renderer->outline_bind_group_layout = PipelineCache_bind_group_layout(
+        &renderer->pipeline_cache, &outline_layout_desc
+    );
+
+    WGPUBindGroupLayout layouts[] = {
+        uniform_layout,
+        renderer->outline_bind_group_layout,
+    };
+    WGPUPipelineLayoutDescriptor outline_layout = {
+        .label = {"Outline Pipeline Layout", WGPU_STRLEN},
+        .bindGroupLayouts = layouts,
+        .bindGroupLayoutCount = 2,
+    };
+    WGPUPipelineLayout pipeline_layout = PipelineCache_pipeline_layout(
+        &renderer->pipeline_cache, &outline_layout
+    );
+    // The pass outputs the outline coverage c and blends it as
+    // dst * (1 + c): outline pixels reach the full instance color that the
+    // solid pass shades at half intensity, like the line list edges
+    WGPUBlendState blend_state = {
+        .color =
+            {
+                .operation = WGPUBlendOperation_Add,
+                .srcFactor = WGPUBlendFactor_Dst,
+                .dstFactor = WGPUBlendFactor_One,
+            },
+        .alpha = {
+            .operation = WGPUBlendOperation_Add,
+            .srcFactor = WGPUBlendFactor_Zero,
+            .dstFactor = WGPUBlendFactor_One,
+        },
+    };
+    WGPUColorTargetState target = {
+        .format = color_format,
+        .blend = &blend_state,
+        .writeMask = WGPUColorWriteMask_All,
+    };
+    WGPUFragmentState frag_state = {
+        .module = shader,
+        .entryPoint = {"outline_fs_main", WGPU_STRLEN},
+        .targets = &target,
+        .targetCount = 1,
+    };
+    WGPURenderPipelineDescriptor pipeline_desc = {
+        .label = {"Outline Pipeline", WGPU_STRLEN},
+        .layout = pipeline_layout,
+        .vertex =
+            (WGPUVertexState){
+                .module = shader,
+                .entryPoint = {"vs_fullscreen", WGPU_STRLEN},
+            },
+        .fragment = &frag_state,
+        .primitive =
+            (WGPUPrimitiveState){
+                .topology = WGPUPrimitiveTopology_TriangleList,
+                .frontFace = WGPUFrontFace_CCW,
+                .cullMode = WGPUCullMode_None,
+            },
+        .multisample = (WGPUMultisampleState){
+            .count = 1,
+            .mask = 0xFFFFFFFF,
+        },
+    };
+    renderer->outline_pipeline = PipelineCache_render_pipeline(
+        &renderer->pipeline_cache, &pipeline_desc
     );
 }
 
@@ -1125,4 +2924,20 @@ static inline void device_request_callback(
     }
 }
 
+static inline void error_scope_callback(
+    WGPUPopErrorScopeStatus status,
+    WGPUErrorType type,
+    WGPUStringView msg,
+    void* userdata1,
+    void* userdata2
+) {
+    ErrorScopeContext* ctx = (ErrorScopeContext*)userdata1;
+    ctx->completed = true;
+    if (status == WGPUPopErrorScopeStatus_Success &&
+        type != WGPUErrorType_NoError) {
+        LOG_ERROR("Validation error: %.*s", (int)msg.length, msg.data);
+        ctx->failed = true;
+    }
+}
+
 #endif /* RENDERER_H */
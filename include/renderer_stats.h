@@ -0,0 +1,221 @@
+#ifndef RENDERER_STATS_H
+#define RENDERER_STATS_H
+
+#include "core.h"
+#include "mesh.h"
+
+// Per frame counters and CPU timings of the renderer, and a rolling
+// history of the last frames summarized as percentiles.
+//
+// Stats are written by the thread that renders and are only consistent
+// when read from it, between frames.
+
+// Frames kept for the percentiles
+#define RENDERER_STATS_HISTORY 256
+
+/* Types */
+
+// CPU time of a step of the frame.  Gather and upload happen while the
+// passes are encoded, encode only counts the rest.
+typedef enum {
+    // Collecting the draw commands of each mesh, and culling
+    STATS_TIMER_GATHER,
+    // Writing instances and uniforms to the queue
+    STATS_TIMER_UPLOAD,
+    // Recording passes and bundles
+    STATS_TIMER_ENCODE,
+    // Waiting for a surface texture or headless target
+    STATS_TIMER_ACQUIRE,
+    // Queue submission and surface present
+    STATS_TIMER_PRESENT,
+    STATS_TIMER_COUNT,
+} StatsTimer;
+
+// Values summarized over the history, the timers come first
+typedef enum {
+    STATS_METRIC_GATHER_MS = STATS_TIMER_GATHER,
+    STATS_METRIC_UPLOAD_MS = STATS_TIMER_UPLOAD,
+    STATS_METRIC_ENCODE_MS = STATS_TIMER_ENCODE,
+    STATS_METRIC_ACQUIRE_MS = STATS_TIMER_ACQUIRE,
+    STATS_METRIC_PRESENT_MS = STATS_TIMER_PRESENT,
+    STATS_METRIC_FRAME_MS,
+    STATS_METRIC_GPU_MS,
+    STATS_METRIC_DRAW_CALLS,
+    STATS_METRIC_TRIANGLES,
+    STATS_METRIC_UPLOAD_BYTES,
+    STATS_METRIC_COUNT,
+} StatsMetric;
+
+typedef struct RendererStats {
+    u64 frame_index;
+    // Draws as executed, so a replayed bundle counts every frame
+    u32 draw_calls;
+    u32 mesh_draw_calls[MESH_TYPE_COUNT];
+    u32 mesh_instances[MESH_TYPE_COUNT];
+    u64 triangles;
+    u64 lines;
+    // Written with `wgpuQueueWriteBuffer`
+    u64 upload_bytes;
+    u32 buffer_reallocations;
+    u32 pipeline_switches;
+    u32 bind_group_switches;
+    // Windowed surface configurations, from resizes and recoveries
+    u32 surface_reconfigures;
+    // Instances drawn and instances dropped by frustum culling, summed over
+    // views
+    u32 visible;
+    u32 culled;
+    f64 cpu_ms[STATS_TIMER_COUNT];
+    // Whole `Renderer_render` call, frame pacing waits included
+    f64 frame_ms;
+    // GPU time of the latest frame read back, a few frames old.  0 without
+    // timestamp queries.
+    f64 gpu_ms;
+} RendererStats;
+
+typedef struct StatsPercentiles {
+    f64 p50;
+    f64 p99;
+} StatsPercentiles;
+
+typedef struct RendererStatsSummary {
+    // Frames summarized, at most RENDERER_STATS_HISTORY
+    u32 frame_count;
+    StatsPercentiles metrics[STATS_METRIC_COUNT];
+} RendererStatsSummary;
+
+typedef struct RendererStatsHistory {
+    RendererStats frames[RENDERER_STATS_HISTORY];
+    u64 frame_count;
+} RendererStatsHistory;
+
+/* Function Prototypes */
+
+const char* StatsMetric_name(StatsMetric metric);
+f64 RendererStats_metric(const RendererStats* stats, StatsMetric metric);
+void RendererStats_begin(RendererStats* stats, u64 frame_index);
+void RendererStats_add_time(
+    RendererStats* stats, StatsTimer timer, f64 start
+);
+f64 RendererStats_nested_ms(const RendererStats* stats);
+void RendererStats_add_encode_time(
+    RendererStats* stats, f64 start, f64 nested_ms
+);
+void RendererStatsHistory_push(
+    RendererStatsHistory* history, const RendererStats* stats
+);
+const RendererStats* RendererStatsHistory_latest(
+    const RendererStatsHistory* history
+);
+void RendererStatsHistory_summarize(
+    const RendererStatsHistory* history, RendererStatsSummary* summary
+);
+
+
+/* Functions */
+
+const char* StatsMetric_name(StatsMetric metric) {
+    switch (metric) {
+        case STATS_METRIC_GATHER_MS: return "gather_ms";
+        case STATS_METRIC_UPLOAD_MS: return "upload_ms";
+        case STATS_METRIC_ENCODE_MS: return "encode_ms";
+        case STATS_METRIC_ACQUIRE_MS: return "acquire_ms";
+        case STATS_METRIC_PRESENT_MS: return "present_ms";
+        case STATS_METRIC_FRAME_MS: return "frame_ms";
+        case STATS_METRIC_GPU_MS: return "gpu_ms";
+        case STATS_METRIC_DRAW_CALLS: return "draw_calls";
+        case STATS_METRIC_TRIANGLES: return "triangles";
+        case STATS_METRIC_UPLOAD_BYTES: return "upload_bytes";
+        default: return "unknown";
+    }
+}
+
+f64 RendererStats_metric(const RendererStats* stats, StatsMetric metric) {
+    if (metric < (StatsMetric)STATS_TIMER_COUNT) return stats->cpu_ms[metric];
+    switch (metric) {
+        case STATS_METRIC_FRAME_MS: return stats->frame_ms;
+        case STATS_METRIC_GPU_MS: return stats->gpu_ms;
+        case STATS_METRIC_DRAW_CALLS: return (f64)stats->draw_calls;
+        case STATS_METRIC_TRIANGLES: return (f64)stats->triangles;
+        case STATS_METRIC_UPLOAD_BYTES: return (f64)stats->upload_bytes;
+        default: return 0.0;
+    }
+}
+
+/** Clear the counters for a new frame */
+void RendererStats_begin(RendererStats* stats, u64 frame_index) {
+    memset(stats, 0, sizeof(*stats));
+    stats->frame_index = frame_index;
+}
+
+/** Add the time since `start`, from `now_seconds`, to a timer */
+void RendererStats_add_time(
+    RendererStats* stats, StatsTimer timer, f64 start
+) {
+    stats->cpu_ms[timer] += (now_seconds() - start) * 1e3;
+}
+
+/** Time of the timers that run inside encoding, to subtract from it */
+f64 RendererStats_nested_ms(const RendererStats* stats) {
+    return stats->cpu_ms[STATS_TIMER_GATHER] +
+           stats->cpu_ms[STATS_TIMER_UPLOAD];
+}
+
+/** Add the time since `start` to the encode timer, less the gather and
+ * upload time spent since `RendererStats_nested_ms` returned `nested_ms`
+ */
+void RendererStats_add_encode_time(
+    RendererStats* stats, f64 start, f64 nested_ms
+) {
+    RendererStats_add_time(stats, STATS_TIMER_ENCODE, start);
+    stats->cpu_ms[STATS_TIMER_ENCODE] -=
+        RendererStats_nested_ms(stats) - nested_ms;
+}
+
+void RendererStatsHistory_push(
+    RendererStatsHistory* history, const RendererStats* stats
+) {
+    history->frames[history->frame_count % RENDERER_STATS_HISTORY] = *stats;
+    ++history->frame_count;
+}
+
+/** Stats of the last finished frame, NULL before the first one */
+const RendererStats* RendererStatsHistory_latest(
+    const RendererStatsHistory* history
+) {
+    if (history->frame_count == 0) return NULL;
+    return &history->frames[(history->frame_count - 1) %
+                            RENDERER_STATS_HISTORY];
+}
+
+/** Median and 99th percentile of every metric over the history
+ *
+ * Uses the nearest rank, so every percentile is a value some frame had.
+ *
+ * @param[in] history   Stats history
+ * @param[out] summary  Percentiles, all zero without frames
+ */
+void RendererStatsHistory_summarize(
+    const RendererStatsHistory* history, RendererStatsSummary* summary
+) {
+    memset(summary, 0, sizeof(*summary));
+    u32 count = history->frame_count < RENDERER_STATS_HISTORY
+                    ? (u32)history->frame_count
+                    : RENDERER_STATS_HISTORY;
+    summary->frame_count = count;
+    if (count == 0) return;
+    f64 values[RENDERER_STATS_HISTORY];
+    for (u32 m = 0; m < STATS_METRIC_COUNT; ++m) {
+        for (u32 i = 0; i < count; ++i) {
+            values[i] = RendererStats_metric(&history->frames[i], m);
+        }
+        qsort(values, count, sizeof(f64), compare_f64);
+        // Rank ceil(p * count), 1-based
+        u32 p50 = (count * 50 + 99) / 100;
+        u32 p99 = (count * 99 + 99) / 100;
+        summary->metrics[m].p50 = values[p50 - 1];
+        summary->metrics[m].p99 = values[p99 - 1];
+    }
+}
+
+#endif /* RENDERER_STATS_H */
@@ -0,0 +1,105 @@
+#ifndef SHADER_WATCH_H
+#define SHADER_WATCH_H
+
+#include "core.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// Development only: watches a shader directory so the renderer can rebuild
+// its pipelines when a .wgsl file is saved.  Editors that save through a
+// temporary file and a rename are covered by watching the directory rather
+// than the files.  A no-op on platforms without inotify.
+
+/* Types */
+
+typedef struct ShaderWatcher {
+    bool active;
+    int fd;
+    int watch;
+} ShaderWatcher;
+
+/* Function Prototypes */
+
+ReturnStatus ShaderWatcher_init(ShaderWatcher* watcher, const char* dir);
+bool ShaderWatcher_poll(ShaderWatcher* watcher);
+void ShaderWatcher_destroy(ShaderWatcher* watcher);
+
+/* Functions */
+
+/** Start watching a shader directory
+ *
+ * @param[out] watcher  Shader watcher
+ * @param[in] dir       Directory holding the .wgsl files
+ * @returns             Return status
+ */
+ReturnStatus ShaderWatcher_init(ShaderWatcher* watcher, const char* dir) {
+    watcher->active = false;
+    watcher->fd = -1;
+    watcher->watch = -1;
+#ifdef __linux__
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd < 0) {
+        LOG_ERROR("Failed to create inotify instance");
+        return RETURN_FAILURE;
+    }
+    watcher->watch = inotify_add_watch(
+        watcher->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE
+    );
+    if (watcher->watch < 0) {
+        LOG_ERROR("Failed to watch shader directory: %s", dir);
+        close(watcher->fd);
+        watcher->fd = -1;
+        return RETURN_FAILURE;
+    }
+    watcher->active = true;
+    LOG_INFO("Watching %s for shader changes", dir);
+    return RETURN_SUCCESS;
+#else
+    (void)dir;
+    LOG_WARN("Shader hot reload is not supported on this platform");
+    return RETURN_FAILURE;
+#endif
+}
+
+/** Drain pending events without blocking
+ *
+ * @param[in] watcher   Shader watcher
+ * @returns             Whether any .wgsl file changed since the last poll
+ */
+bool ShaderWatcher_poll(ShaderWatcher* watcher) {
+    if (!watcher->active) return false;
+    bool changed = false;
+#ifdef __linux__
+    // Aligned for the event headers read into it
+    union {
+        struct inotify_event event;
+        char bytes[4096];
+    } buffer;
+    for (;;) {
+        ssize_t size = read(watcher->fd, buffer.bytes, sizeof(buffer));
+        if (size <= 0) break;
+        for (char* p = buffer.bytes; p < buffer.bytes + size;) {
+            struct inotify_event* event = (struct inotify_event*)p;
+            usize length = event->len > 0 ? strlen(event->name) : 0;
+            if (length > 5 &&
+                strcmp(event->name + length - 5, ".wgsl") == 0) {
+                LOG_DEBUG("Shader changed: %s", event->name);
+                changed = true;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#endif
+    return changed;
+}
+
+void ShaderWatcher_destroy(ShaderWatcher* watcher) {
+    if (watcher->active) close(watcher->fd);
+    watcher->active = false;
+    watcher->fd = -1;
+    watcher->watch = -1;
+}
+
+#endif /* SHADER_WATCH_H */
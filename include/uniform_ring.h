@@ -0,0 +1,158 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include "core.h"
+#include "webgpu.h"
+
+// One uniform buffer holding a block per view or pass, selected with a
+// dynamic offset on a single bind group.  Blocks are filled in a CPU copy
+// and every block changed since the last flush goes out in one
+// `wgpuQueueWriteBuffer`, instead of a write per view.
+//
+// Queue writes land in submission order, so the blocks of a frame can be
+// reused by the next one while the first is still in flight: the GPU sees
+// the old contents in the earlier submission and the new ones after.
+//
+// The first UNIFORM_RING_RESERVED blocks persist across frames, the rest is
+// handed out again every frame after `UniformRing_reset`.
+
+// Blocks bound at a dynamic offset are this far apart, the largest
+// minUniformBufferOffsetAlignment WebGPU allows
+#define UNIFORM_BLOCK_ALIGNMENT 256
+// Block of the main camera, set by `Renderer_update_uniforms`
+#define UNIFORM_BLOCK_MAIN 0
+#define UNIFORM_RING_RESERVED 1
+
+/* Types */
+
+typedef struct UniformRing {
+    WGPUBuffer buffer;
+    // CPU copy of every block
+    u8* blocks;
+    u32 capacity;
+    // Blocks in use, reserved ones included
+    u32 count;
+    // Block range changed since the last flush
+    u32 dirty_begin;
+    u32 dirty_end;
+} UniformRing;
+
+/* Function Prototypes */
+
+ReturnStatus UniformRing_init(
+    UniformRing* ring, WGPUDevice device, u32 capacity
+);
+void UniformRing_destroy(UniformRing* ring);
+void UniformRing_reset(UniformRing* ring);
+u32 UniformRing_write(
+    UniformRing* ring, u32 block, const void* data, usize size
+);
+u32 UniformRing_push(UniformRing* ring, const void* data, usize size);
+usize UniformRing_flush(UniformRing* ring, WGPUQueue queue);
+
+/* Functions */
+
+/** Create the uniform buffer and its CPU copy
+ *
+ * @param[out] ring     Uniform ring
+ * @param[in] device    Device
+ * @param[in] capacity  Number of blocks, reserved ones included
+ * @returns             Return status
+ */
+ReturnStatus UniformRing_init(
+    UniformRing* ring, WGPUDevice device, u32 capacity
+) {
+    memset(ring, 0, sizeof(*ring));
+    ring->buffer = create_buffer(
+        device,
+        capacity * UNIFORM_BLOCK_ALIGNMENT,
+        WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+        "Uniform Ring Buffer"
+    );
+    ring->blocks = RAIJIN_REALLOC(NULL, capacity * UNIFORM_BLOCK_ALIGNMENT);
+    if (ring->buffer == NULL || ring->blocks == NULL) {
+        LOG_ERROR("Failed to create uniform ring");
+        UniformRing_destroy(ring);
+        return RETURN_FAILURE;
+    }
+    memset(ring->blocks, 0, capacity * UNIFORM_BLOCK_ALIGNMENT);
+    ring->capacity = capacity;
+    ring->count = UNIFORM_RING_RESERVED;
+    ring->dirty_begin = 0;
+    ring->dirty_end = UNIFORM_RING_RESERVED;
+    return RETURN_SUCCESS;
+}
+
+void UniformRing_destroy(UniformRing* ring) {
+    if (ring->buffer != NULL) wgpuBufferRelease(ring->buffer);
+    RAIJIN_FREE(ring->blocks);
+    memset(ring, 0, sizeof(*ring));
+}
+
+/** Hand out the per frame blocks again, reserved blocks keep their data */
+void UniformRing_reset(UniformRing* ring) {
+    ring->count = UNIFORM_RING_RESERVED;
+}
+
+/** Overwrite a block
+ *
+ * @param[in,out] ring  Uniform ring
+ * @param[in] block     Block index, below `capacity`
+ * @param[in] data      Block contents
+ * @param[in] size      Size of `data`, at most UNIFORM_BLOCK_ALIGNMENT
+ * @returns             Dynamic offset of the block
+ */
+u32 UniformRing_write(
+    UniformRing* ring, u32 block, const void* data, usize size
+) {
+    RAIJIN_ASSERT(block < ring->capacity && size <= UNIFORM_BLOCK_ALIGNMENT);
+    memcpy(ring->blocks + block * UNIFORM_BLOCK_ALIGNMENT, data, size);
+    if (ring->dirty_begin >= ring->dirty_end) {
+        ring->dirty_begin = block;
+        ring->dirty_end = block + 1;
+    } else {
+        if (block < ring->dirty_begin) ring->dirty_begin = block;
+        if (block + 1 > ring->dirty_end) ring->dirty_end = block + 1;
+    }
+    return block * UNIFORM_BLOCK_ALIGNMENT;
+}
+
+/** Allocate and fill the next block of this frame
+ *
+ * @param[in,out] ring  Uniform ring
+ * @param[in] data      Block contents
+ * @param[in] size      Size of `data`, at most UNIFORM_BLOCK_ALIGNMENT
+ * @returns             Dynamic offset of the block, that of the last block
+ *                      if the ring is full
+ */
+u32 UniformRing_push(UniformRing* ring, const void* data, usize size) {
+    if (ring->count == ring->capacity) {
+        LOG_ERROR("Uniform ring full, %u blocks", ring->capacity);
+        return UniformRing_write(ring, ring->capacity - 1, data, size);
+    }
+    return UniformRing_write(ring, ring->count++, data, size);
+}
+
+/** Upload every block written since the last flush, in one write
+ *
+ * @param[in,out] ring  Uniform ring
+ * @param[in] queue     Queue written to
+ * @returns             Bytes written
+ */
+usize UniformRing_flush(UniformRing* ring, WGPUQueue queue) {
+    if (ring->dirty_begin >= ring->dirty_end) return 0;
+    usize size =
+        (usize)(ring->dirty_end - ring->dirty_begin) * UNIFORM_BLOCK_ALIGNMENT;
+    wgpuQueueWriteBuffer(
+        queue,
+        ring->buffer,
+        ring->dirty_begin * UNIFORM_BLOCK_ALIGNMENT,
+        ring->blocks + ring->dirty_begin * UNIFORM_BLOCK_ALIGNMENT,
+        size
+    );
+    ring->dirty_begin = 0;
+    ring->dirty_end = 0;
+    return size;
+}
+
+#endif /* UNIFORM_RING_H */
@@ -1,21 +1,304 @@
 #define NOB_IMPLEMENTATION
 #include "nob.h"
 
-#define COMMON_CFLAGS \
-    "-std=c99", "-Wall", "-Wextra", "-pedantic", "-ggdb", "-Wno-gnu-zero-variadic-macro-arguments"
+#define COMMON_CFLAGS                                               \
+    "-std=c99", "-Wall", "-Wextra", "-pedantic", "-ggdb",           \
+        "-Wno-gnu-zero-variadic-macro-arguments", "-D_DEFAULT_SOURCE"
+#define INCLUDE_FLAGS "-Iinclude", "-Ilib/wgpu/include", "-Ilib/cglm/include"
 #define BUILD_DIR "build/"
 #define SRC_DIR "src/"
+#define MESH_DIR "assets/meshes/"
+#define MESH_CACHE_DIR BUILD_DIR "meshes/"
+#define SHADER_DIR "assets/shaders/"
+#define SHADER_HEADER BUILD_DIR "raijin_shaders.h"
+
+static bool build_raijin(Nob_Cmd* cmd) {
+    nob_cmd_append(cmd, "clang", COMMON_CFLAGS);
+    nob_cmd_append(cmd, INCLUDE_FLAGS);
+    nob_cmd_append(cmd, "-I" BUILD_DIR, "-DRAIJIN_EMBED_SHADERS");
+    nob_cmd_append(cmd, SRC_DIR "main.c");
+    nob_cmd_append(cmd, "-o", BUILD_DIR "raijin");
+    nob_cmd_append(cmd, "-lm", "-pthread", "-Llib/wgpu", "-lwgpu_native", "-Llib/cglm", "-lcglm", "-lSDL3");
+    return nob_cmd_run_sync_and_reset(cmd);
+}
+
+static bool build_rjm_convert(Nob_Cmd* cmd) {
+    nob_cmd_append(cmd, "clang", COMMON_CFLAGS, "-O2");
+    nob_cmd_append(cmd, INCLUDE_FLAGS);
+    nob_cmd_append(cmd, SRC_DIR "rjm_convert.c");
+    nob_cmd_append(cmd, "-o", BUILD_DIR "rjm_convert");
+    nob_cmd_append(cmd, "-lm", "-pthread", "-Llib/wgpu", "-lwgpu_native");
+    return nob_cmd_run_sync_and_reset(cmd);
+}
+
+static bool build_bench_startup(Nob_Cmd* cmd) {
+    nob_cmd_append(cmd, "clang", COMMON_CFLAGS, "-O2");
+    nob_cmd_append(cmd, INCLUDE_FLAGS);
+    nob_cmd_append(cmd, "-I" BUILD_DIR, "-DRAIJIN_EMBED_SHADERS");
+    // Logging to the terminal would be timed with the phases
+    nob_cmd_append(cmd, "-DLOG_VERBOSITY=LOG_LEVEL_WARN");
+    nob_cmd_append(cmd, SRC_DIR "bench_startup.c");
+    nob_cmd_append(cmd, "-o", BUILD_DIR "bench_startup");
+    nob_cmd_append(cmd, "-lm", "-pthread", "-Llib/wgpu", "-lwgpu_native", "-Llib/cglm", "-lcglm", "-lSDL3");
+    return nob_cmd_run_sync_and_reset(cmd);
+}
+
+static bool build_render_frames(Nob_Cmd* cmd) {
+    nob_cmd_append(cmd, "clang", COMMON_CFLAGS, "-O2");
+    nob_cmd_append(cmd, INCLUDE_FLAGS);
+    nob_cmd_append(cmd, "-I" BUILD_DIR, "-DRAIJIN_EMBED_SHADERS");
+    nob_cmd_append(cmd, SRC_DIR "render_frames.c");
+    nob_cmd_append(cmd, "-o", BUILD_DIR "render_frames");
+    // image_encode.h compresses PNG with zlib
+    nob_cmd_append(cmd, "-lm", "-pthread", "-Llib/wgpu", "-lwgpu_native", "-Llib/cglm", "-lcglm", "-lz");
+    return nob_cmd_run_sync_and_reset(cmd);
+}
+
+static bool build_bench_render(Nob_Cmd* cmd) {
+    nob_cmd_append(cmd, "clang", COMMON_CFLAGS, "-O2");
+    nob_cmd_append(cmd, INCLUDE_FLAGS);
+    nob_cmd_append(cmd, "-I" BUILD_DIR, "-DRAIJIN_EMBED_SHADERS");
+    // Keeps stdout to the JSON report
+    nob_cmd_append(cmd, "-DLOG_VERBOSITY=LOG_LEVEL_ERROR");
+    nob_cmd_append(cmd, SRC_DIR "bench_render.c");
+    nob_cmd_append(cmd, "-o", BUILD_DIR "bench_render");
+    // image_encode.h compresses PNG with zlib
+    nob_cmd_append(cmd, "-lm", "-pthread", "-Llib/wgpu", "-lwgpu_native", "-Llib/cglm", "-lcglm", "-lz");
+    return nob_cmd_run_sync_and_reset(cmd);
+}
+
+static bool build_bench_micro(Nob_Cmd* cmd) {
+    nob_cmd_append(cmd, "clang", COMMON_CFLAGS, "-O2");
+    nob_cmd_append(cmd, INCLUDE_FLAGS);
+    // LOG_INFO is measured, LOG_DEBUG is the filtered case
+    nob_cmd_append(cmd, "-DLOG_VERBOSITY=LOG_LEVEL_INFO");
+    nob_cmd_append(cmd, SRC_DIR "bench_micro.c");
+    nob_cmd_append(cmd, "-o", BUILD_DIR "bench_micro");
+    // image_encode.h compresses PNG with zlib
+    nob_cmd_append(cmd, "-lm", "-pthread", "-Llib/wgpu", "-lwgpu_native", "-Llib/cglm", "-lcglm", "-lz");
+    return nob_cmd_run_sync_and_reset(cmd);
+}
+
+static bool is_ident_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+// Whitespace next to these is never significant.  Operators are left alone
+// so that e.g. `a - -b` or `vec2<f32> = v` keep their meaning
+static bool is_separator_char(char c) {
+    return c != '\0' && strchr("(){}[],;:.@", c) != NULL;
+}
+
+// Strip comments and collapse whitespace.  WGSL has no preprocessor, line
+// breaks only matter inside comments
+static void minify_wgsl(Nob_String_View src, Nob_String_Builder* out) {
+    size_t i = 0;
+    bool pending_space = false;
+    while (i < src.count) {
+        char c = src.data[i];
+        if (c == '/' && i + 1 < src.count && src.data[i + 1] == '/') {
+            while (i < src.count && src.data[i] != '\n') ++i;
+            pending_space = true;
+            continue;
+        }
+        // Block comments nest in WGSL
+        if (c == '/' && i + 1 < src.count && src.data[i + 1] == '*') {
+            int depth = 0;
+            do {
+                if (src.data[i] == '/' && i + 1 < src.count &&
+                    src.data[i + 1] == '*') {
+                    ++depth;
+                    i += 2;
+                } else if (src.data[i] == '*' && i + 1 < src.count &&
+                           src.data[i + 1] == '/') {
+                    --depth;
+                    i += 2;
+                } else {
+                    ++i;
+                }
+            } while (depth > 0 && i < src.count);
+            pending_space = true;
+            continue;
+        }
+        if (isspace((unsigned char)c)) {
+            pending_space = true;
+            ++i;
+            continue;
+        }
+        if (pending_space && out->count > 0) {
+            char prev = out->items[out->count - 1];
+            if (!is_separator_char(prev) && !is_separator_char(c)) {
+                nob_da_append(out, ' ');
+            }
+        }
+        pending_space = false;
+        nob_da_append(out, c);
+        ++i;
+    }
+}
+
+// Generate SHADER_HEADER holding every .wgsl in SHADER_DIR, minified, as
+// byte arrays.  The renderer uses them unless RAIJIN_SHADER_DIR is set
+static bool embed_shaders(void) {
+    Nob_File_Paths files = {0};
+    Nob_File_Paths shaders = {0};
+    if (!nob_read_entire_dir(SHADER_DIR, &files)) return false;
+    for (size_t i = 0; i < files.count; ++i) {
+        if (nob_sv_end_with(nob_sv_from_cstr(files.items[i]), ".wgsl")) {
+            nob_da_append(
+                &shaders, nob_temp_sprintf(SHADER_DIR "%s", files.items[i])
+            );
+        }
+    }
+    nob_da_free(files);
+    int rebuild =
+        nob_needs_rebuild(SHADER_HEADER, shaders.items, shaders.count);
+    if (rebuild <= 0) {
+        nob_da_free(shaders);
+        return rebuild == 0;
+    }
+
+    bool result = true;
+    Nob_String_Builder header = {0};
+    Nob_String_Builder table = {0};
+    nob_sb_append_cstr(
+        &header,
+        "// Generated by nob.c from " SHADER_DIR ", do not edit\n"
+        "#ifndef RAIJIN_SHADERS_H\n"
+        "#define RAIJIN_SHADERS_H\n\n"
+    );
+    for (size_t i = 0; i < shaders.count && result; ++i) {
+        Nob_String_Builder src = {0};
+        Nob_String_Builder minified = {0};
+        result = nob_read_entire_file(shaders.items[i], &src);
+        if (!result) break;
+        minify_wgsl(nob_sb_to_sv(src), &minified);
+        const char* name = shaders.items[i] + strlen(SHADER_DIR);
+        nob_sb_append_cstr(
+            &header,
+            nob_temp_sprintf("static const char EMBEDDED_SHADER_%zu[] = {", i)
+        );
+        for (size_t j = 0; j < minified.count; ++j) {
+            char byte[16];
+            const char* indent = j % 16 ? "" : "\n    ";
+            unsigned char value = (unsigned char)minified.items[j];
+            snprintf(byte, sizeof(byte), "%s0x%02x,", indent, value);
+            nob_sb_append_cstr(&header, byte);
+        }
+        nob_sb_append_cstr(&header, "\n    0x00,\n};\n\n");
+        nob_sb_append_cstr(
+            &table,
+            nob_temp_sprintf(
+                "    {\"%s\", EMBEDDED_SHADER_%zu, %zu},\n",
+                name, i, minified.count
+            )
+        );
+        nob_log(
+            NOB_INFO,
+            "Embedded %s: %zu -> %zu bytes",
+            name,
+            src.count,
+            minified.count
+        );
+        nob_sb_free(src);
+        nob_sb_free(minified);
+    }
+    if (result) {
+        nob_sb_append_cstr(
+            &header, "static const EmbeddedShader EMBEDDED_SHADERS[] = {\n"
+        );
+        nob_sb_append_buf(&header, table.items, table.count);
+        nob_sb_append_cstr(&header, "};\n\n#endif /* RAIJIN_SHADERS_H */\n");
+        result =
+            nob_write_entire_file(SHADER_HEADER, header.items, header.count);
+    }
+    nob_sb_free(header);
+    nob_sb_free(table);
+    nob_da_free(shaders);
+    return result;
+}
+
+// Convert every OBJ/PLY/STL in MESH_DIR whose .rjm is missing or older than
+// the source or the converter
+static bool convert_meshes(Nob_Cmd* cmd) {
+    if (!nob_file_exists(MESH_DIR)) {
+        nob_log(NOB_INFO, "No %s directory, nothing to convert", MESH_DIR);
+        return true;
+    }
+    if (!nob_mkdir_if_not_exists(MESH_CACHE_DIR)) return false;
+    Nob_File_Paths meshes = {0};
+    if (!nob_read_entire_dir(MESH_DIR, &meshes)) return false;
+    bool result = true;
+    for (size_t i = 0; i < meshes.count && result; ++i) {
+        Nob_String_View name = nob_sv_from_cstr(meshes.items[i]);
+        if (!nob_sv_end_with(name, ".obj") && !nob_sv_end_with(name, ".ply") &&
+            !nob_sv_end_with(name, ".stl")) {
+            continue;
+        }
+        const char* input = nob_temp_sprintf(MESH_DIR "%s", meshes.items[i]);
+        const char* output = nob_temp_sprintf(
+            MESH_CACHE_DIR "%.*s.rjm", (int)(name.count - 4), name.data
+        );
+        const char* inputs[] = {input, BUILD_DIR "rjm_convert"};
+        int rebuild = nob_needs_rebuild(output, inputs, NOB_ARRAY_LEN(inputs));
+        if (rebuild < 0) result = false;
+        if (rebuild <= 0) continue;
+        nob_cmd_append(cmd, BUILD_DIR "rjm_convert", input, output);
+        result = nob_cmd_run_sync_and_reset(cmd);
+    }
+    nob_da_free(meshes);
+    return result;
+}
 
 int main(int argc, char** argv) {
     NOB_GO_REBUILD_URSELF(argc, argv);
+    const char* program = nob_shift(argv, argc);
+    const char* target = argc > 0 ? nob_shift(argv, argc) : "raijin";
     Nob_Cmd cmd = {0};
     if (!nob_mkdir_if_not_exists(BUILD_DIR)) return 1;
 
-    nob_cmd_append(&cmd, "clang", COMMON_CFLAGS);
-    nob_cmd_append(&cmd, "-Iinclude", "-Ilib/wgpu/include", "-Ilib/cglm/include");
-    nob_cmd_append(&cmd, SRC_DIR "main.c");
-    nob_cmd_append(&cmd, "-o", BUILD_DIR "raijin");
-    nob_cmd_append(&cmd, "-lm", "-Llib/wgpu", "-lwgpu_native", "-Llib/cglm", "-lcglm", "-lSDL3");
-    if (!nob_cmd_run_sync(cmd)) return 1;
+    if (strcmp(target, "raijin") == 0) {
+        if (!embed_shaders()) return 1;
+        if (!build_raijin(&cmd)) return 1;
+    } else if (strcmp(target, "rjm") == 0) {
+        if (!build_rjm_convert(&cmd)) return 1;
+        if (!convert_meshes(&cmd)) return 1;
+    } else if (strcmp(target, "bench_startup") == 0) {
+        if (!embed_shaders()) return 1;
+        if (!build_bench_startup(&cmd)) return 1;
+        // Remaining arguments go to the benchmark, e.g. --runs 50
+        nob_cmd_append(&cmd, BUILD_DIR "bench_startup");
+        while (argc > 0) nob_cmd_append(&cmd, nob_shift(argv, argc));
+        if (!nob_cmd_run_sync_and_reset(&cmd)) return 1;
+    } else if (strcmp(target, "frames") == 0) {
+        if (!embed_shaders()) return 1;
+        if (!build_render_frames(&cmd)) return 1;
+        // Remaining arguments go to the tool, e.g. --format png out
+        nob_cmd_append(&cmd, BUILD_DIR "render_frames");
+        while (argc > 0) nob_cmd_append(&cmd, nob_shift(argv, argc));
+        if (!nob_cmd_run_sync_and_reset(&cmd)) return 1;
+    } else if (strcmp(target, "bench") == 0) {
+        if (!embed_shaders()) return 1;
+        if (!build_bench_render(&cmd)) return 1;
+        // Remaining arguments go to the benchmark, e.g. --fallback
+        nob_cmd_append(&cmd, BUILD_DIR "bench_render");
+        while (argc > 0) nob_cmd_append(&cmd, nob_shift(argv, argc));
+        if (!nob_cmd_run_sync_and_reset(&cmd)) return 1;
+    } else if (strcmp(target, "bench_micro") == 0) {
+        if (!build_bench_micro(&cmd)) return 1;
+        // Remaining arguments go to the benchmark, e.g. --baseline FILE
+        nob_cmd_append(&cmd, BUILD_DIR "bench_micro");
+        while (argc > 0) nob_cmd_append(&cmd, nob_shift(argv, argc));
+        if (!nob_cmd_run_sync_and_reset(&cmd)) return 1;
+    } else {
+        nob_log(NOB_ERROR, "Unknown target: %s", target);
+        nob_log(
+            NOB_INFO,
+            "Usage: %s [raijin|rjm|bench_startup|frames|bench|bench_micro]",
+            program
+        );
+        return 1;
+    }
     return 0;
 }
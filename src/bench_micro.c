@@ -0,0 +1,1103 @@
+#include "image_encode.h"
+#include "renderer.h"
+
+#include <errno.h>
+#include <float.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Microbenchmarks of the CPU pieces on every hot path: dynamic arrays,
+// model matrix construction, draw command bucketing, logging and frame
+// encoding.  Results are per operation, so they are tracked apart from any
+// GPU noise:
+//   bench_micro [--repetitions N] [--warmup N] [--filter NAME]
+//               [--baseline FILE] [--save FILE] [--threshold PERCENT]
+//
+// Every benchmark is calibrated during warm-up until one repetition takes
+// at least BENCH_MIN_REPETITION_SECONDS, then timed for N repetitions with
+// `clock_gettime` and, on x86, `rdtsc`.  TSC ticks run at a fixed rate, not
+// the core clock, so compare them on the same machine only.
+//
+// --save writes the median ns per operation of every benchmark to a
+// baseline file, one "name ns" line each.  --baseline compares against one
+// and exits with 2 when a benchmark got slower by more than the threshold.
+//
+// Before timing anything, the batched matrix kernel is checked against cglm,
+// every image encoder against a decoder for its format, the number parsers
+// against the C library and every mesh importer on a small cube, so a fast
+// but wrong kernel fails the run.
+
+#define BENCH_DEFAULT_REPETITIONS 15
+#define BENCH_DEFAULT_WARMUP 3
+#define BENCH_DEFAULT_THRESHOLD 10.0
+#define BENCH_MIN_REPETITION_SECONDS 0.005
+#define BENCH_MAX_ITERATIONS (1u << 24)
+#define BENCH_ARRAY_ITEMS 4096
+#define BENCH_PUSH_MANY_CHUNK 64
+#define BENCH_MATRIX_INSTANCES 1024
+#define BENCH_DRAW_COMMANDS 4096
+#define BENCH_LOG_MESSAGES 64
+#define BENCH_NAME_LENGTH 64
+// A 16:9 frame, even sized so 2x2 chroma blocks cover it
+#define BENCH_IMAGE_WIDTH 320
+#define BENCH_IMAGE_HEIGHT 180
+#define BENCH_IMAGE_PIXELS (BENCH_IMAGE_WIDTH * BENCH_IMAGE_HEIGHT)
+// Largest channel error a Y4M round trip may introduce
+#define BENCH_Y4M_TOLERANCE 4
+
+// Runs `iterations` times over its data and returns the operations done
+typedef u64 (*BenchFunction)(u32 iterations);
+
+typedef struct Benchmark {
+    const char* name;
+    BenchFunction run;
+} Benchmark;
+
+typedef struct BenchResult {
+    // Per operation
+    f64 median_ns;
+    f64 min_ns;
+    f64 p95_ns;
+    f64 median_ticks;
+    u64 operations;
+    u32 iterations;
+} BenchResult;
+
+typedef struct BaselineEntry {
+    char name[BENCH_NAME_LENGTH];
+    f64 ns;
+} BaselineEntry;
+DEFINE_DYNAMIC_ARRAY(BaselineEntry, BaselineArray)
+
+// Results are summed into it so the measured work is not optimized away
+static volatile u64 bench_sink;
+
+static u32 bench_values[BENCH_ARRAY_ITEMS];
+static vec3 bench_positions[BENCH_MATRIX_INSTANCES];
+static mat3 bench_rotations[BENCH_MATRIX_INSTANCES];
+static f32 bench_scales[BENCH_MATRIX_INSTANCES];
+static Instance bench_instances[BENCH_MATRIX_INSTANCES];
+static Renderer bench_renderer;
+static u8 bench_rgba[BENCH_IMAGE_PIXELS * 4];
+static u8 bench_rgb[BENCH_IMAGE_PIXELS * 3];
+
+static inline u64 read_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void setup_data(void) {
+    for (u32 i = 0; i < BENCH_ARRAY_ITEMS; ++i) {
+        bench_values[i] = (u32)mix_u64(i);
+    }
+    for (u32 i = 0; i < BENCH_MATRIX_INSTANCES; ++i) {
+        f32 angle = (f32)i * 0.01f;
+        glm_vec3_copy(
+            (vec3){(f32)i, (f32)(i % 7), (f32)(i % 13)}, bench_positions[i]
+        );
+        mat4 rotation;
+        glm_euler_xyz((vec3){angle, angle * 0.5f, angle * 0.25f}, rotation);
+        glm_mat4_pick3(rotation, bench_rotations[i]);
+        bench_scales[i] = 0.5f + (f32)(i % 4) * 0.25f;
+    }
+    DrawCommandArray* draw_commands = &bench_renderer.draw_commands;
+    DrawCommandArray_init(draw_commands);
+    for (u32 i = 0; i < BENCH_DRAW_COMMANDS; ++i) {
+        DrawCommand cmd = {
+            .mesh_type = (MeshType)(mix_u64(i) % MESH_TYPE_COUNT),
+        };
+        glm_mat4_identity(cmd.instance.model_matrix);
+        DrawCommandArray_push(draw_commands, cmd);
+    }
+    // Gradients with flat bands and some noise, like a shaded frame
+    for (u32 y = 0; y < BENCH_IMAGE_HEIGHT; ++y) {
+        for (u32 x = 0; x < BENCH_IMAGE_WIDTH; ++x) {
+            u32 i = y * BENCH_IMAGE_WIDTH + x;
+            u8* px = bench_rgba + (usize)i * 4;
+            px[0] = (u8)(x * 255 / BENCH_IMAGE_WIDTH);
+            px[1] = (u8)((y / 8) * 8);
+            px[2] = (u8)((x / 40 + y / 30) % 2 ? 200 : mix_u64(i) & 0xFF);
+            px[3] = 255;
+        }
+    }
+    rgba_to_rgb(bench_rgba, bench_rgb, BENCH_IMAGE_PIXELS);
+}
+
+static u64 bench_array_push(u32 iterations) {
+    for (u32 it = 0; it < iterations; ++it) {
+        U32Array array;
+        U32Array_init(&array);
+        for (u32 i = 0; i < BENCH_ARRAY_ITEMS; ++i) {
+            U32Array_push(&array, bench_values[i]);
+        }
+        bench_sink += array.items[array.count - 1];
+        U32Array_free(&array);
+    }
+    return (u64)iterations * BENCH_ARRAY_ITEMS;
+}
+
+static u64 bench_array_reserve_push(u32 iterations) {
+    for (u32 it = 0; it < iterations; ++it) {
+        U32Array array;
+        U32Array_init(&array);
+        U32Array_reserve(&array, BENCH_ARRAY_ITEMS);
+        for (u32 i = 0; i < BENCH_ARRAY_ITEMS; ++i) {
+            U32Array_push(&array, bench_values[i]);
+        }
+        bench_sink += array.items[array.count - 1];
+        U32Array_free(&array);
+    }
+    return (u64)iterations * BENCH_ARRAY_ITEMS;
+}
+
+static u64 bench_array_push_many(u32 iterations) {
+    for (u32 it = 0; it < iterations; ++it) {
+        U32Array array;
+        U32Array_init(&array);
+        for (u32 i = 0; i < BENCH_ARRAY_ITEMS; i += BENCH_PUSH_MANY_CHUNK) {
+            U32Array_push_many(
+                &array, bench_values + i, BENCH_PUSH_MANY_CHUNK
+            );
+        }
+        bench_sink += array.items[array.count - 1];
+        U32Array_free(&array);
+    }
+    return (u64)iterations * BENCH_ARRAY_ITEMS;
+}
+
+// The draw list as the renderer fills it: grown once, then reused
+static u64 bench_draw_command_push(u32 iterations) {
+    DrawCommandArray array;
+    DrawCommandArray_init(&array);
+    for (u32 it = 0; it < iterations; ++it) {
+        array.count = 0;
+        for (u32 i = 0; i < BENCH_DRAW_COMMANDS; ++i) {
+            DrawCommandArray_push(
+                &array, bench_renderer.draw_commands.items[i]
+            );
+        }
+        bench_sink += array.count;
+    }
+    DrawCommandArray_free(&array);
+    return (u64)iterations * BENCH_DRAW_COMMANDS;
+}
+
+// translate * rotate * scale composed from full cglm products
+static u64 bench_matrix_cglm(u32 iterations) {
+    for (u32 it = 0; it < iterations; ++it) {
+        for (u32 i = 0; i < BENCH_MATRIX_INSTANCES; ++i) {
+            mat4 rotation;
+            glm_mat4_identity(rotation);
+            glm_mat4_ins3(bench_rotations[i], rotation);
+            glm_translate_make(
+                bench_instances[i].model_matrix, bench_positions[i]
+            );
+            glm_mat4_mul(
+                bench_instances[i].model_matrix,
+                rotation,
+                bench_instances[i].model_matrix
+            );
+            glm_scale_uni(bench_instances[i].model_matrix, bench_scales[i]);
+        }
+        bench_sink += (u64)bench_instances[it % BENCH_MATRIX_INSTANCES]
+                          .model_matrix[3][0];
+    }
+    return (u64)iterations * BENCH_MATRIX_INSTANCES;
+}
+
+static u64 bench_matrix_batch(u32 iterations) {
+    for (u32 it = 0; it < iterations; ++it) {
+        Instance_build_model_matrices(
+            bench_instances,
+            bench_positions,
+            bench_rotations,
+            bench_scales,
+            BENCH_MATRIX_INSTANCES
+        );
+        bench_sink += (u64)bench_instances[it % BENCH_MATRIX_INSTANCES]
+                          .model_matrix[3][0];
+    }
+    return (u64)iterations * BENCH_MATRIX_INSTANCES;
+}
+
+// Every mesh's instances gathered from a shuffled draw list, per command
+static u64 bench_bucket_draws(u32 iterations) {
+    InstanceArray instances;
+    InstanceArray_init(&instances);
+    InstanceArray_reserve(&instances, BENCH_DRAW_COMMANDS);
+    for (u32 it = 0; it < iterations; ++it) {
+        for (u32 mesh = 0; mesh < MESH_TYPE_COUNT; ++mesh) {
+            instances.count = 0;
+            Renderer_gather_instances(&bench_renderer, mesh, &instances);
+            bench_sink += instances.count;
+        }
+    }
+    InstanceArray_free(&instances);
+    return (u64)iterations * BENCH_DRAW_COMMANDS;
+}
+
+// Below LOG_VERBOSITY, the call compiles to nothing
+static u64 bench_log_filtered(u32 iterations) {
+    for (u32 it = 0; it < iterations; ++it) {
+        for (u32 i = 0; i < BENCH_LOG_MESSAGES; ++i) {
+            LOG_DEBUG("Draw command %u of %u", i, it);
+            bench_sink += i;
+        }
+    }
+    return (u64)iterations * BENCH_LOG_MESSAGES;
+}
+
+// Timestamp, formatting and stdio, with stdout sent to /dev/null
+static u64 bench_log_info(u32 iterations) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    if (saved < 0 || null < 0) {
+        if (saved >= 0) close(saved);
+        if (null >= 0) close(null);
+        return 0;
+    }
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    for (u32 it = 0; it < iterations; ++it) {
+        for (u32 i = 0; i < BENCH_LOG_MESSAGES; ++i) {
+            LOG_INFO("Draw command %u of %u", i, it);
+        }
+    }
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    return (u64)iterations * BENCH_LOG_MESSAGES;
+}
+
+static u64 bench_rgba_to_rgb(u32 iterations) {
+    static u8 rgb[BENCH_IMAGE_PIXELS * 3];
+    for (u32 it = 0; it < iterations; ++it) {
+        rgba_to_rgb(bench_rgba, rgb, BENCH_IMAGE_PIXELS);
+        bench_sink += rgb[it % sizeof(rgb)];
+    }
+    return (u64)iterations * BENCH_IMAGE_PIXELS;
+}
+
+static u64 bench_encode_qoi(u32 iterations) {
+    U8Array out;
+    U8Array_init(&out);
+    for (u32 it = 0; it < iterations; ++it) {
+        out.count = 0;
+        encode_qoi(bench_rgb, BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT, &out);
+        bench_sink += out.count;
+    }
+    U8Array_free(&out);
+    return (u64)iterations * BENCH_IMAGE_PIXELS;
+}
+
+static u64 bench_encode_png(u32 iterations) {
+    U8Array out;
+    U8Array_init(&out);
+    for (u32 it = 0; it < iterations; ++it) {
+        out.count = 0;
+        encode_png(bench_rgb, BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT, &out);
+        bench_sink += out.count;
+    }
+    U8Array_free(&out);
+    return (u64)iterations * BENCH_IMAGE_PIXELS;
+}
+
+static u64 bench_encode_y4m(u32 iterations) {
+    U8Array out;
+    U8Array_init(&out);
+    for (u32 it = 0; it < iterations; ++it) {
+        out.count = 0;
+        encode_y4m_frame(
+            bench_rgb, BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT, &out
+        );
+        bench_sink += out.count;
+    }
+    U8Array_free(&out);
+    return (u64)iterations * BENCH_IMAGE_PIXELS;
+}
+
+static const Benchmark benchmarks[] = {
+    {"array_push", bench_array_push},
+    {"array_reserve_push", bench_array_reserve_push},
+    {"array_push_many", bench_array_push_many},
+    {"draw_command_push", bench_draw_command_push},
+    {"matrix_cglm", bench_matrix_cglm},
+    {"matrix_batch", bench_matrix_batch},
+    {"bucket_draws", bench_bucket_draws},
+    {"log_filtered", bench_log_filtered},
+    {"log_info", bench_log_info},
+    {"rgba_to_rgb", bench_rgba_to_rgb},
+    {"encode_qoi", bench_encode_qoi},
+    {"encode_png", bench_encode_png},
+    {"encode_y4m", bench_encode_y4m},
+};
+
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+// Both matrix paths must build the same matrices for the timings to compare
+static bool check_matrix_kernels(void) {
+    bench_matrix_cglm(1);
+    Instance expected[BENCH_MATRIX_INSTANCES];
+    memcpy(expected, bench_instances, sizeof(expected));
+    bench_matrix_batch(1);
+    for (u32 i = 0; i < BENCH_MATRIX_INSTANCES; ++i) {
+        for (u32 c = 0; c < 4; ++c) {
+            for (u32 r = 0; r < 4; ++r) {
+                f32 a = expected[i].model_matrix[c][r];
+                f32 b = bench_instances[i].model_matrix[c][r];
+                if (fabsf(a - b) > 1e-4f * (1.0f + fabsf(a))) {
+                    LOG_ERROR("Model matrix %u differs at [%u][%u]", i, c, r);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Every pixel count up to a few vector widths, so both the SIMD loop, SSSE3
+// or NEON, and the scalar tail are covered
+static bool check_rgba_to_rgb(void) {
+    u8 rgb[67 * 3];
+    for (u32 count = 0; count <= 67; ++count) {
+        memset(rgb, 0xA5, sizeof(rgb));
+        rgba_to_rgb(bench_rgba, rgb, count);
+        for (u32 i = 0; i < count * 3; ++i) {
+            if (rgb[i] != bench_rgba[i / 3 * 4 + i % 3]) {
+                LOG_ERROR(
+                    "rgba_to_rgb of %u pixels differs at byte %u", count, i
+                );
+                return false;
+            }
+        }
+        // Nothing past the last pixel is written
+        for (u32 i = count * 3; i < sizeof(rgb); ++i) {
+            if (rgb[i] != 0xA5) {
+                LOG_ERROR(
+                    "rgba_to_rgb of %u pixels writes past the end", count
+                );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static u32 read_u32_be(const u8* p) {
+    return (u32)p[0] << 24 | (u32)p[1] << 16 | (u32)p[2] << 8 | p[3];
+}
+
+// Reference QOI decoder, RGB output
+static bool decode_qoi(const U8Array* data, u32 width, u32 height, u8* rgb) {
+    const u8* p = data->items;
+    const u8* end = data->items + data->count;
+    if (data->count < 14 + 8 || memcmp(p, "qoif", 4) != 0 ||
+        read_u32_be(p + 4) != width || read_u32_be(p + 8) != height) {
+        return false;
+    }
+    p += 14;
+    end -= 8;
+    u8 index[64][4] = {{0}};
+    u8 px[4] = {0, 0, 0, 255};
+    usize pixel_count = (usize)width * height;
+    for (usize i = 0; i < pixel_count;) {
+        if (p >= end) return false;
+        u8 op = *p++;
+        u32 run = 1;
+        if (op == 0xFE) {
+            if (end - p < 3) return false;
+            memcpy(px, p, 3);
+            p += 3;
+        } else if (op == 0xFF) {
+            if (end - p < 4) return false;
+            memcpy(px, p, 4);
+            p += 4;
+        } else if ((op & 0xC0) == 0x00) {
+            memcpy(px, index[op], 4);
+        } else if ((op & 0xC0) == 0x40) {
+            px[0] += ((op >> 4) & 3) - 2;
+            px[1] += ((op >> 2) & 3) - 2;
+            px[2] += (op & 3) - 2;
+        } else if ((op & 0xC0) == 0x80) {
+            if (p >= end) return false;
+            i32 dg = (op & 0x3F) - 32;
+            px[0] += dg - 8 + (*p >> 4);
+            px[1] += dg;
+            px[2] += dg - 8 + (*p & 0x0F);
+            ++p;
+        } else {
+            run = (op & 0x3F) + 1;
+        }
+        u32 slot = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+        memcpy(index[slot], px, 4);
+        for (; run > 0; --run) {
+            if (i == pixel_count) return false;
+            memcpy(rgb + i++ * 3, px, 3);
+        }
+    }
+    static const u8 end_marker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    return p == end && memcmp(end, end_marker, 8) == 0;
+}
+
+// Reference PNG decoder for 8 bit RGB, checking every chunk CRC
+static bool decode_png(const U8Array* data, u32 width, u32 height, u8* rgb) {
+    static const u8 signature[8] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+    };
+    if (data->count < 8 || memcmp(data->items, signature, 8) != 0) {
+        return false;
+    }
+    U8Array idat;
+    U8Array_init(&idat);
+    bool header_ok = false;
+    bool ended = false;
+    usize offset = 8;
+    while (!ended && offset + 12 <= data->count) {
+        const u8* chunk = data->items + offset;
+        u32 size = read_u32_be(chunk);
+        if (size > data->count - offset - 12) break;
+        u32 crc = (u32)crc32(0, chunk + 4, size + 4);
+        if (crc != read_u32_be(chunk + 8 + size)) break;
+        const u8* body = chunk + 8;
+        if (memcmp(chunk + 4, "IHDR", 4) == 0 && size == 13) {
+            header_ok = read_u32_be(body) == width &&
+                        read_u32_be(body + 4) == height && body[8] == 8 &&
+                        body[9] == 2 && body[12] == 0;
+        } else if (memcmp(chunk + 4, "IDAT", 4) == 0) {
+            U8Array_push_many(&idat, body, size);
+        } else if (memcmp(chunk + 4, "IEND", 4) == 0) {
+            ended = true;
+        }
+        offset += 12 + size;
+    }
+    usize row_size = (usize)width * 3;
+    uLongf filtered_size = (row_size + 1) * height;
+    u8* filtered = RAIJIN_REALLOC(NULL, filtered_size);
+    bool ok = header_ok && ended && filtered != NULL &&
+              uncompress(filtered, &filtered_size, idat.items, idat.count) ==
+                  Z_OK &&
+              filtered_size == (row_size + 1) * height;
+    for (u32 y = 0; ok && y < height; ++y) {
+        const u8* src = filtered + y * (row_size + 1);
+        u8* row = rgb + y * row_size;
+        const u8* above = y > 0 ? row - row_size : NULL;
+        for (usize x = 0; x < row_size; ++x) {
+            u8 a = x >= 3 ? row[x - 3] : 0;
+            u8 b = above != NULL ? above[x] : 0;
+            u8 c = above != NULL && x >= 3 ? above[x - 3] : 0;
+            u8 predictor = 0;
+            switch (src[0]) {
+                case 0: break;
+                case 1: predictor = a; break;
+                case 2: predictor = b; break;
+                case 3: predictor = (u8)((a + b) / 2); break;
+                case 4: {
+                    i32 pa = abs(b - c);
+                    i32 pb = abs(a - c);
+                    i32 pc = abs(a + b - 2 * c);
+                    predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+                } break;
+                default: ok = false; break;
+            }
+            row[x] = src[1 + x] + predictor;
+        }
+    }
+    RAIJIN_FREE(filtered);
+    U8Array_free(&idat);
+    return ok;
+}
+
+// Inverse of the encoder's BT.601 studio range conversion
+static bool decode_y4m_frame(
+    const U8Array* data, u32 width, u32 height, u8* rgb
+) {
+    u32 chroma_width = (width + 1) / 2;
+    u32 chroma_height = (height + 1) / 2;
+    usize luma_size = (usize)width * height;
+    usize chroma_size = (usize)chroma_width * chroma_height;
+    if (data->count != 6 + luma_size + 2 * chroma_size ||
+        memcmp(data->items, "FRAME\n", 6) != 0) {
+        return false;
+    }
+    const u8* y_plane = data->items + 6;
+    const u8* u_plane = y_plane + luma_size;
+    const u8* v_plane = u_plane + chroma_size;
+    for (u32 y = 0; y < height; ++y) {
+        for (u32 x = 0; x < width; ++x) {
+            usize c = (usize)(y / 2) * chroma_width + x / 2;
+            f32 luma = 1.164f * (f32)(y_plane[(usize)y * width + x] - 16);
+            f32 u = (f32)u_plane[c] - 128.0f;
+            f32 v = (f32)v_plane[c] - 128.0f;
+            f32 channels[3] = {
+                luma + 1.596f * v,
+                luma - 0.392f * u - 0.813f * v,
+                luma + 2.017f * u,
+            };
+            for (u32 k = 0; k < 3; ++k) {
+                rgb[((usize)y * width + x) * 3 + k] =
+                    clamp_u8((i32)lroundf(channels[k]));
+            }
+        }
+    }
+    return true;
+}
+
+// Encodes `rgb` with every format and decodes it back
+static bool check_image_round_trip(const u8* rgb, u32 width, u32 height) {
+    usize size = (usize)width * height * 3;
+    u8* decoded = RAIJIN_REALLOC(NULL, size);
+    U8Array data;
+    U8Array_init(&data);
+    bool qoi_ok = false;
+    bool png_ok = false;
+    bool y4m_ok = false;
+
+    encode_qoi(rgb, width, height, &data);
+    qoi_ok = decode_qoi(&data, width, height, decoded) &&
+             memcmp(decoded, rgb, size) == 0;
+
+    data.count = 0;
+    png_ok = encode_png(rgb, width, height, &data) == RETURN_SUCCESS &&
+             decode_png(&data, width, height, decoded) &&
+             memcmp(decoded, rgb, size) == 0;
+
+    // Chroma is shared by 2x2 blocks, so the source repeats each block's
+    // top left pixel to round trip within the tolerance
+    u8* blocks = RAIJIN_REALLOC(NULL, size);
+    for (u32 y = 0; y < height; ++y) {
+        for (u32 x = 0; x < width; ++x) {
+            usize src = ((usize)(y & ~1u) * width + (x & ~1u)) * 3;
+            memcpy(blocks + ((usize)y * width + x) * 3, rgb + src, 3);
+        }
+    }
+    data.count = 0;
+    encode_y4m_frame(blocks, width, height, &data);
+    y4m_ok = decode_y4m_frame(&data, width, height, decoded);
+    for (usize i = 0; y4m_ok && i < size; ++i) {
+        y4m_ok = abs(decoded[i] - blocks[i]) <= BENCH_Y4M_TOLERANCE;
+    }
+
+    if (!qoi_ok) LOG_ERROR("QOI round trip failed at %ux%u", width, height);
+    if (!png_ok) LOG_ERROR("PNG round trip failed at %ux%u", width, height);
+    if (!y4m_ok) LOG_ERROR("Y4M round trip failed at %ux%u", width, height);
+    RAIJIN_FREE(blocks);
+    RAIJIN_FREE(decoded);
+    U8Array_free(&data);
+    return qoi_ok && png_ok && y4m_ok;
+}
+
+// Encoders must decode back to the frame they were given, odd sizes
+// included
+static bool check_image_encoders(void) {
+    if (!check_rgba_to_rgb()) return false;
+    if (!check_image_round_trip(
+            bench_rgb, BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT
+        )) {
+        return false;
+    }
+    // Top left corner of the bench image, odd sized
+    u8 small[13 * 7 * 3];
+    for (u32 y = 0; y < 7; ++y) {
+        memcpy(
+            small + y * 13 * 3,
+            bench_rgb + (usize)y * BENCH_IMAGE_WIDTH * 3,
+            13 * 3
+        );
+    }
+    return check_image_round_trip(small, 13, 7);
+}
+
+// Text parsers against the C library, on the cases the fast paths special
+// case: signs, exponents, mantissas past 19 digits and out of range values
+static bool check_number_parsers(void) {
+    static const char* floats[] = {
+        "0",
+        "-0.5",
+        "+7",
+        ".5",
+        "5.",
+        "1e",
+        "1.5e3",
+        "2E-5",
+        "1e+2",
+        "-3.25e-10",
+        "0.1",
+        "16777217",
+        "3.14159265358979323846264338327950288",
+        "123456789012345678901234567890",
+        "0.000000000000000000000000000001234567",
+        "3.4028235e38",
+        "1e39",
+        "-1e50",
+        "1e-50",
+        "1e100000",
+    };
+    for (u32 i = 0; i < ARRAY_COUNT(floats); ++i) {
+        const char* text = floats[i];
+        char* expected_end;
+        f32 expected = strtof(text, &expected_end);
+        f32 value = 0.0f;
+        const char* end = parse_f32(text, text + strlen(text), &value);
+        // Parsed through a double, so allow the last bit to round apart
+        bool same_value = value == expected ||
+                          fabsf(value - expected) <=
+                              FLT_EPSILON * fabsf(expected);
+        if (end != expected_end || !same_value) {
+            LOG_ERROR(
+                "parse_f32(\"%s\") gives %.9g, strtof %.9g",
+                text,
+                value,
+                expected
+            );
+            return false;
+        }
+    }
+    static const char* integers[] = {
+        "0",
+        "-45",
+        "+6",
+        "12abc",
+        "-",
+        "x1",
+        "9223372036854775807",
+        "9223372036854775808",
+        "-9223372036854775808",
+        "-9223372036854775809",
+        "99999999999999999999",
+    };
+    for (u32 i = 0; i < ARRAY_COUNT(integers); ++i) {
+        const char* text = integers[i];
+        char* expected_end;
+        errno = 0;
+        long long expected = strtoll(text, &expected_end, 10);
+        // strtoll clamps where parse_i64 rejects
+        bool rejected = expected_end == text || errno == ERANGE;
+        i64 value = 0;
+        const char* end = parse_i64(text, text + strlen(text), &value);
+        bool matches = rejected ? end == NULL
+                                : end == expected_end && value == expected;
+        if (!matches) {
+            LOG_ERROR("parse_i64(\"%s\") differs from strtoll", text);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Unit cube with outward winding, vertex i at the corner of bits x, y, z
+static const u32 CHECK_CUBE_TRIANGLES[12][3] = {
+    {0, 2, 3}, {0, 3, 1}, {4, 5, 7}, {4, 7, 6}, {0, 1, 5}, {0, 5, 4},
+    {2, 6, 7}, {2, 7, 3}, {0, 4, 6}, {0, 6, 2}, {1, 3, 7}, {1, 7, 5},
+};
+#define CHECK_CUBE_VERTICES 8
+#define CHECK_CUBE_TRIANGLE_COUNT ARRAY_COUNT(CHECK_CUBE_TRIANGLES)
+
+static void check_cube_position(u32 vertex, vec3 position) {
+    for (u32 axis = 0; axis < 3; ++axis) {
+        position[axis] = (vertex >> axis & 1) ? 0.5f : -0.5f;
+    }
+}
+
+// Same cube, in the spellings OBJ exporters use
+static const char* check_obj_coordinate(u32 vertex, u32 axis) {
+    bool positive = vertex >> axis & 1;
+    if ((vertex + axis) % 2 == 0) return positive ? "0.5E0" : "-5e-1";
+    return positive ? "+0.50" : "-.5";
+}
+
+static usize check_write_obj(char* text, usize capacity) {
+    usize size = snprintf(text, capacity, "# cube\n");
+    for (u32 v = 0; v < CHECK_CUBE_VERTICES; ++v) {
+        size += snprintf(
+            text + size,
+            capacity - size,
+            "v %s %s %s\n",
+            check_obj_coordinate(v, 0),
+            check_obj_coordinate(v, 1),
+            check_obj_coordinate(v, 2)
+        );
+    }
+    // Every other face uses indices relative to the end of the positions
+    for (u32 t = 0; t < CHECK_CUBE_TRIANGLE_COUNT; ++t) {
+        const u32* tri = CHECK_CUBE_TRIANGLES[t];
+        i32 base = t % 2 == 0 ? 1 : -CHECK_CUBE_VERTICES;
+        size += snprintf(
+            text + size,
+            capacity - size,
+            "f %d %d %d\n",
+            (i32)tri[0] + base,
+            (i32)tri[1] + base,
+            (i32)tri[2] + base
+        );
+    }
+    return size;
+}
+
+static usize check_write_ply_header(char* text, usize capacity, bool binary) {
+    return snprintf(
+        text,
+        capacity,
+        "ply\n"
+        "format %s 1.0\n"
+        "element vertex %u\n"
+        "property float x\n"
+        "property float y\n"
+        "property float z\n"
+        "element face %u\n"
+        "property list uchar int vertex_indices\n"
+        "end_header\n",
+        binary ? "binary_little_endian" : "ascii",
+        CHECK_CUBE_VERTICES,
+        (u32)CHECK_CUBE_TRIANGLE_COUNT
+    );
+}
+
+static usize check_write_ply_ascii(char* text, usize capacity) {
+    usize size = check_write_ply_header(text, capacity, false);
+    for (u32 v = 0; v < CHECK_CUBE_VERTICES; ++v) {
+        vec3 p;
+        check_cube_position(v, p);
+        size += snprintf(
+            text + size, capacity - size, "%g %g %g\n", p[0], p[1], p[2]
+        );
+    }
+    for (u32 t = 0; t < CHECK_CUBE_TRIANGLE_COUNT; ++t) {
+        const u32* tri = CHECK_CUBE_TRIANGLES[t];
+        size += snprintf(
+            text + size,
+            capacity - size,
+            "3 %u %u %u\n",
+            tri[0],
+            tri[1],
+            tri[2]
+        );
+    }
+    return size;
+}
+
+// Binary files are written in host order, little endian on every target
+static usize check_write_ply_binary(u8* data, usize capacity) {
+    usize size = check_write_ply_header((char*)data, capacity, true);
+    for (u32 v = 0; v < CHECK_CUBE_VERTICES; ++v) {
+        vec3 p;
+        check_cube_position(v, p);
+        memcpy(data + size, p, sizeof(vec3));
+        size += sizeof(vec3);
+    }
+    for (u32 t = 0; t < CHECK_CUBE_TRIANGLE_COUNT; ++t) {
+        data[size++] = 3;
+        for (u32 k = 0; k < 3; ++k) {
+            i32 index = (i32)CHECK_CUBE_TRIANGLES[t][k];
+            memcpy(data + size, &index, sizeof(index));
+            size += sizeof(index);
+        }
+    }
+    return size;
+}
+
+static usize check_write_stl(u8* data) {
+    memset(data, 0, STL_HEADER_SIZE);
+    u32 triangle_count = CHECK_CUBE_TRIANGLE_COUNT;
+    memcpy(data + 80, &triangle_count, sizeof(triangle_count));
+    usize size = STL_HEADER_SIZE;
+    for (u32 t = 0; t < CHECK_CUBE_TRIANGLE_COUNT; ++t) {
+        // The facet normal is ignored, normals come from the welded mesh
+        memset(data + size, 0, STL_TRIANGLE_SIZE);
+        for (u32 k = 0; k < 3; ++k) {
+            vec3 p;
+            check_cube_position(CHECK_CUBE_TRIANGLES[t][k], p);
+            memcpy(data + size + 12 + k * 12, p, sizeof(vec3));
+        }
+        size += STL_TRIANGLE_SIZE;
+    }
+    return size;
+}
+
+// The cube welds back to its 8 corners, keeps its triangles in order and
+// outlines its 12 sides but none of the face diagonals
+static bool check_imported_cube(const char* format, const Mesh* mesh) {
+    if (mesh->vertices.count != CHECK_CUBE_VERTICES ||
+        mesh->indices.count != CHECK_CUBE_TRIANGLE_COUNT * 3 ||
+        mesh->edge_indices.count != 12 * 2) {
+        LOG_ERROR(
+            "%s cube imports as %zu vertices, %zu indices, %zu edge indices",
+            format,
+            mesh->vertices.count,
+            mesh->indices.count,
+            mesh->edge_indices.count
+        );
+        return false;
+    }
+    for (u32 i = 0; i < mesh->indices.count; ++i) {
+        u32 index = mesh->indices.items[i];
+        vec3 expected;
+        check_cube_position(CHECK_CUBE_TRIANGLES[i / 3][i % 3], expected);
+        if (index >= mesh->vertices.count ||
+            !glm_vec3_eqv(mesh->vertices.items[index].position, expected)) {
+            LOG_ERROR("%s cube corner %u is misplaced", format, i);
+            return false;
+        }
+    }
+    for (u32 i = 0; i < mesh->edge_indices.count; i += 2) {
+        const f32* a =
+            mesh->vertices.items[mesh->edge_indices.items[i]].position;
+        const f32* b =
+            mesh->vertices.items[mesh->edge_indices.items[i + 1]].position;
+        // Sides differ in one coordinate, diagonals in two
+        u32 differing = (a[0] != b[0]) + (a[1] != b[1]) + (a[2] != b[2]);
+        if (differing != 1) {
+            LOG_ERROR("%s cube edge %u is not a side", format, i / 2);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every importer on the same cube, with the steps `Mesh_import` runs after
+// parsing
+static bool check_importers(void) {
+    static u8 data[4096];
+    MeshImportOptions options = MeshImportOptions_default();
+    const char* formats[] = {"OBJ", "ASCII PLY", "binary PLY", "STL"};
+    bool ok = true;
+    for (u32 f = 0; ok && f < ARRAY_COUNT(formats); ++f) {
+        MappedFile file = {.data = data};
+        Mesh mesh = {0};
+        ReturnStatus status = RETURN_FAILURE;
+        switch (f) {
+            case 0: {
+                file.size = check_write_obj((char*)data, sizeof(data));
+                status = Mesh_import_obj(&mesh, &file, &options);
+            } break;
+            case 1: {
+                file.size = check_write_ply_ascii((char*)data, sizeof(data));
+                status = Mesh_import_ply(&mesh, &file, &options);
+            } break;
+            case 2: {
+                file.size = check_write_ply_binary(data, sizeof(data));
+                status = Mesh_import_ply(&mesh, &file, &options);
+            } break;
+            case 3: {
+                file.size = check_write_stl(data);
+                status = Mesh_import_stl(&mesh, &file, &options);
+            } break;
+        }
+        if (status == RETURN_SUCCESS) {
+            Mesh_compute_edges(&mesh, &options);
+            Mesh_compute_edge_flags(&mesh, &options);
+            ok = check_imported_cube(formats[f], &mesh);
+        } else {
+            LOG_ERROR("%s cube failed to import", formats[f]);
+            ok = false;
+        }
+        VertexArray_free(&mesh.vertices);
+        IndexArray_free(&mesh.indices);
+        IndexArray_free(&mesh.edge_indices);
+        U32Array_free(&mesh.edge_flags);
+    }
+    return ok;
+}
+
+static BenchResult run_benchmark(
+    const Benchmark* benchmark, u32 warmup, u32 repetitions
+) {
+    BenchResult result = {.iterations = 1};
+    // Doubles the iterations until a repetition is long enough to time
+    for (;;) {
+        f64 start = now_seconds();
+        benchmark->run(result.iterations);
+        f64 elapsed = now_seconds() - start;
+        if (elapsed >= BENCH_MIN_REPETITION_SECONDS ||
+            result.iterations >= BENCH_MAX_ITERATIONS) {
+            break;
+        }
+        result.iterations *= 2;
+    }
+    for (u32 i = 0; i < warmup; ++i) benchmark->run(result.iterations);
+
+    F64Array ns;
+    F64Array ticks;
+    F64Array_init(&ns);
+    F64Array_init(&ticks);
+    for (u32 i = 0; i < repetitions; ++i) {
+        u64 start_ticks = read_ticks();
+        f64 start = now_seconds();
+        u64 operations = benchmark->run(result.iterations);
+        f64 elapsed = now_seconds() - start;
+        u64 end_ticks = read_ticks();
+        if (operations == 0) break;
+        result.operations = operations;
+        F64Array_push(&ns, elapsed * 1e9 / (f64)operations);
+        F64Array_push(&ticks, (f64)(end_ticks - start_ticks) / operations);
+    }
+    qsort(ns.items, ns.count, sizeof(f64), compare_f64);
+    qsort(ticks.items, ticks.count, sizeof(f64), compare_f64);
+    result.median_ns = percentile(&ns, 0.5);
+    result.min_ns = percentile(&ns, 0.0);
+    result.p95_ns = percentile(&ns, 0.95);
+    result.median_ticks = percentile(&ticks, 0.5);
+    F64Array_free(&ns);
+    F64Array_free(&ticks);
+    return result;
+}
+
+static ReturnStatus load_baseline(const char* path, BaselineArray* out) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        LOG_ERROR("Failed to open baseline: %s", path);
+        return RETURN_FAILURE;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        BaselineEntry entry = {0};
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%63s %lf", entry.name, &entry.ns) == 2) {
+            BaselineArray_push(out, entry);
+        }
+    }
+    fclose(file);
+    return RETURN_SUCCESS;
+}
+
+static const BaselineEntry* find_baseline(
+    const BaselineArray* baseline, const char* name
+) {
+    for (u32 i = 0; i < baseline->count; ++i) {
+        if (strcmp(baseline->items[i].name, name) == 0) {
+            return &baseline->items[i];
+        }
+    }
+    return NULL;
+}
+
+static ReturnStatus save_baseline(
+    const char* path, const bool* ran, const BenchResult* results
+) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        LOG_ERROR("Failed to write baseline: %s", path);
+        return RETURN_FAILURE;
+    }
+    fprintf(file, "# bench_micro baseline, median ns per operation\n");
+    for (u32 i = 0; i < BENCHMARK_COUNT; ++i) {
+        if (!ran[i]) continue;
+        fprintf(file, "%s %.6f\n", benchmarks[i].name, results[i].median_ns);
+    }
+    fclose(file);
+    return RETURN_SUCCESS;
+}
+
+static void print_usage(const char* program) {
+    fprintf(
+        stderr,
+        "Usage: %s [--repetitions N] [--warmup N] [--filter NAME]\n"
+        "          [--baseline FILE] [--save FILE] [--threshold PERCENT]\n",
+        program
+    );
+}
+
+int main(int argc, char** argv) {
+    u32 repetitions = BENCH_DEFAULT_REPETITIONS;
+    u32 warmup = BENCH_DEFAULT_WARMUP;
+    f64 threshold = BENCH_DEFAULT_THRESHOLD;
+    const char* filter = NULL;
+    const char* baseline_path = NULL;
+    const char* save_path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            repetitions = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = strtod(argv[++i], NULL);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (repetitions == 0) repetitions = 1;
+
+    BaselineArray baseline;
+    BaselineArray_init(&baseline);
+    if (baseline_path != NULL &&
+        load_baseline(baseline_path, &baseline) != RETURN_SUCCESS) {
+        return 1;
+    }
+    setup_data();
+    if (!check_matrix_kernels() || !check_image_encoders() ||
+        !check_number_parsers() || !check_importers()) {
+        return 1;
+    }
+
+    bool ran[BENCHMARK_COUNT] = {0};
+    BenchResult results[BENCHMARK_COUNT] = {0};
+    u32 regressions = 0;
+    printf("{\n");
+    printf("  \"repetitions\": %u,\n", repetitions);
+    printf("  \"warmup\": %u,\n", warmup);
+    printf("  \"benchmarks\": [");
+    bool first = true;
+    for (u32 i = 0; i < BENCHMARK_COUNT; ++i) {
+        const Benchmark* benchmark = &benchmarks[i];
+        if (filter != NULL && strstr(benchmark->name, filter) == NULL) {
+            continue;
+        }
+        BenchResult* result = &results[i];
+        *result = run_benchmark(benchmark, warmup, repetitions);
+        ran[i] = true;
+        printf(
+            "%s\n    {\"name\": \"%s\", \"operations\": %llu, "
+            "\"median_ns\": %.3f, \"min_ns\": %.3f, \"p95_ns\": %.3f, "
+            "\"median_ticks\": %.2f",
+            first ? "" : ",",
+            benchmark->name,
+            (unsigned long long)result->operations,
+            result->median_ns,
+            result->min_ns,
+            result->p95_ns,
+            result->median_ticks
+        );
+        const BaselineEntry* entry = find_baseline(&baseline, benchmark->name);
+        if (entry != NULL && entry->ns > 0.0) {
+            f64 change = (result->median_ns / entry->ns - 1.0) * 100.0;
+            bool regressed = change > threshold;
+            if (regressed) ++regressions;
+            printf(
+                ", \"baseline_ns\": %.3f, \"change_pct\": %.1f, "
+                "\"regressed\": %s",
+                entry->ns,
+                change,
+                regressed ? "true" : "false"
+            );
+        }
+        printf("}");
+        fflush(stdout);
+        first = false;
+    }
+    printf("\n  ]");
+    if (baseline_path != NULL) {
+        printf(",\n  \"threshold_pct\": %.1f", threshold);
+        printf(",\n  \"regressions\": %u", regressions);
+    }
+    printf("\n}\n");
+
+    BaselineArray_free(&baseline);
+    DrawCommandArray_free(&bench_renderer.draw_commands);
+    if (save_path != NULL &&
+        save_baseline(save_path, ran, results) != RETURN_SUCCESS) {
+        return 1;
+    }
+    return regressions > 0 ? 2 : 0;
+}
@@ -0,0 +1,346 @@
+#include "image_encode.h"
+#include "renderer.h"
+
+// Render path stress benchmark.  Renders scenes of 1k to 1M cubes headless,
+// with every cube static, every cube moving, or one in MIXED_DYNAMIC_EVERY
+// moving, and reports per frame percentiles as JSON:
+//   bench_render [--frames N] [--warmup N] [--max-cubes N] [--fallback]
+//                [--dump DIR] [--dump-format qoi|png|y4m|raw]
+//
+// The default adapter is used when there is one, otherwise or with
+// --fallback the software adapter, so the benchmark runs on machines
+// without a GPU.  Compare runs on the same adapter only.  Logs below errors
+// are compiled out, errors go to stderr, so stdout is valid JSON.
+//
+// Per frame it measures:
+//   build_ms   filling the draw list, moving cubes included
+//   submit_ms  the `Renderer_render` call
+//   frame_ms   build, submit and waiting for the GPU to finish the frame
+//   gpu_ms     GPU time of the passes, when timestamp queries are supported
+// and reports the renderer's upload bytes and draw calls for the frame.
+//
+// --dump writes every rendered frame, warm-up included, to DIR with
+// `ImageEncoder`, QOI by default, to check what a run drew.  Reading the
+// frames back costs time, so do not compare timings of dumped runs.
+
+#define BENCH_DEFAULT_FRAMES 50
+#define BENCH_DEFAULT_WARMUP 5
+#define BENCH_DEFAULT_MAX_CUBES 1000000
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+#define BENCH_CUBE_SPACING 2.0f
+#define MIXED_DYNAMIC_EVERY 10
+
+typedef enum {
+    SCENE_STATIC,
+    SCENE_DYNAMIC,
+    SCENE_MIXED,
+    SCENE_KIND_COUNT,
+} SceneKind;
+
+typedef enum {
+    METRIC_BUILD,
+    METRIC_SUBMIT,
+    METRIC_FRAME,
+    METRIC_GPU,
+    METRIC_COUNT,
+} BenchMetric;
+
+static const char* scene_kind_name(SceneKind kind) {
+    switch (kind) {
+        case SCENE_STATIC: return "static";
+        case SCENE_DYNAMIC: return "dynamic";
+        case SCENE_MIXED: return "mixed";
+        default: return "unknown";
+    }
+}
+
+static const char* metric_name(BenchMetric metric) {
+    switch (metric) {
+        case METRIC_BUILD: return "build_ms";
+        case METRIC_SUBMIT: return "submit_ms";
+        case METRIC_FRAME: return "frame_ms";
+        case METRIC_GPU: return "gpu_ms";
+        default: return "unknown";
+    }
+}
+
+static const char* backend_name(WGPUBackendType backend) {
+    switch (backend) {
+        case WGPUBackendType_Null: return "null";
+        case WGPUBackendType_D3D11: return "d3d11";
+        case WGPUBackendType_D3D12: return "d3d12";
+        case WGPUBackendType_Metal: return "metal";
+        case WGPUBackendType_Vulkan: return "vulkan";
+        case WGPUBackendType_OpenGL: return "opengl";
+        case WGPUBackendType_OpenGLES: return "opengles";
+        default: return "unknown";
+    }
+}
+
+static const char* adapter_type_name(WGPUAdapterType type) {
+    switch (type) {
+        case WGPUAdapterType_DiscreteGPU: return "discrete";
+        case WGPUAdapterType_IntegratedGPU: return "integrated";
+        case WGPUAdapterType_CPU: return "cpu";
+        default: return "unknown";
+    }
+}
+
+static bool is_dynamic(SceneKind kind, u32 index) {
+    switch (kind) {
+        case SCENE_STATIC: return false;
+        case SCENE_DYNAMIC: return true;
+        case SCENE_MIXED: return index % MIXED_DYNAMIC_EVERY == 0;
+        default: return false;
+    }
+}
+
+// Cube `index` of a grid `side` cubes wide, spinning with `angle`
+static void place_cube(Instance* instance, u32 index, u32 side, f32 angle) {
+    f32 half = 0.5f * (f32)side;
+    vec3 position = {
+        ((f32)(index % side) - half) * BENCH_CUBE_SPACING,
+        ((f32)(index / side % side) - half) * BENCH_CUBE_SPACING,
+        ((f32)(index / (side * side)) - half) * BENCH_CUBE_SPACING,
+    };
+    glm_mat4_identity(instance->model_matrix);
+    glm_translate(instance->model_matrix, position);
+    glm_rotate_z(instance->model_matrix, angle, instance->model_matrix);
+    glm_mat4_scale(instance->model_matrix, 0.5f);
+    instance->color[0] = (f32)(index % side) / (f32)side;
+    instance->color[1] = (f32)(index / side % side) / (f32)side;
+    instance->color[2] = 0.5f;
+    instance->color[3] = 1.0f;
+}
+
+// Camera far enough back to see the whole grid
+static void frame_grid(Renderer* renderer, u32 side) {
+    f32 extent = (f32)side * BENCH_CUBE_SPACING;
+    mat4 proj_matrix;
+    mat4 view_matrix;
+    glm_perspective(
+        glm_rad(60.0f),
+        (f32)BENCH_WIDTH / (f32)BENCH_HEIGHT,
+        0.1f,
+        extent * 4.0f,
+        proj_matrix
+    );
+    glm_lookat(
+        (vec3){extent, extent, extent},
+        (vec3){0.0f, 0.0f, 0.0f},
+        (vec3){0.0f, 0.0f, 1.0f},
+        view_matrix
+    );
+    Renderer_update_uniforms(renderer, proj_matrix, view_matrix);
+}
+
+// Prints a string as a quoted JSON string
+static void print_json_string(WGPUStringView view) {
+    usize length = 0;
+    if (view.data != NULL) {
+        length = view.length == WGPU_STRLEN ? strlen(view.data) : view.length;
+    }
+    putchar('"');
+    for (usize i = 0; i < length; ++i) {
+        u8 c = (u8)view.data[i];
+        if (c == '"' || c == '\\') {
+            printf("\\%c", c);
+        } else if (c < 0x20) {
+            printf("\\u%04x", c);
+        } else {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+// Renders one scene and prints its JSON object
+static void run_scene(
+    Renderer* renderer,
+    SceneKind kind,
+    u32 cube_count,
+    u32 frames,
+    u32 warmup,
+    bool last
+) {
+    u32 side = 1;
+    while (side * side * side < cube_count) ++side;
+    frame_grid(renderer, side);
+    InstanceArray instances;
+    InstanceArray_init(&instances);
+    InstanceArray_reserve(&instances, cube_count);
+    for (u32 i = 0; i < cube_count; ++i) {
+        Instance instance;
+        place_cube(&instance, i, side, 0.0f);
+        InstanceArray_push(&instances, instance);
+    }
+
+    F64Array samples[METRIC_COUNT] = {0};
+    u64 upload_bytes = 0;
+    u32 draw_calls = 0;
+    for (u32 frame = 0; frame < warmup + frames; ++frame) {
+        f64 frame_start = now_seconds();
+        f32 angle = 0.01f * (f32)frame;
+        DrawCommandArray_reserve(&renderer->draw_commands, cube_count);
+        for (u32 i = 0; i < cube_count; ++i) {
+            if (is_dynamic(kind, i)) {
+                place_cube(&instances.items[i], i, side, angle);
+            }
+            DrawCommand cmd = {
+                .mesh_type = MESH_TYPE_CUBE,
+                .instance = instances.items[i],
+            };
+            DrawCommandArray_push(&renderer->draw_commands, cmd);
+        }
+        f64 submit_start = now_seconds();
+        Renderer_render(renderer);
+        f64 submit_end = now_seconds();
+        wgpuDevicePoll(renderer->device, true, NULL);
+        f64 frame_end = now_seconds();
+        if (frame < warmup) continue;
+
+        const RendererStats* stats = Renderer_stats(renderer);
+        f64 values[METRIC_COUNT] = {
+            [METRIC_BUILD] = (submit_start - frame_start) * 1e3,
+            [METRIC_SUBMIT] = (submit_end - submit_start) * 1e3,
+            [METRIC_FRAME] = (frame_end - frame_start) * 1e3,
+            [METRIC_GPU] = stats->gpu_ms,
+        };
+        for (u32 m = 0; m < METRIC_COUNT; ++m) {
+            F64Array_push(&samples[m], values[m]);
+        }
+        upload_bytes = stats->upload_bytes;
+        draw_calls = stats->draw_calls;
+    }
+
+    printf("    {\n");
+    printf(
+        "      \"name\": \"%s_%u%s\",\n",
+        scene_kind_name(kind),
+        cube_count >= 1000000 ? cube_count / 1000000 : cube_count / 1000,
+        cube_count >= 1000000 ? "m" : "k"
+    );
+    printf("      \"cubes\": %u,\n", cube_count);
+    printf("      \"upload_bytes\": %llu,\n", (unsigned long long)upload_bytes);
+    printf("      \"draw_calls\": %u", draw_calls);
+    for (u32 m = 0; m < METRIC_COUNT; ++m) {
+        F64Array* values = &samples[m];
+        qsort(values->items, values->count, sizeof(f64), compare_f64);
+        printf(
+            ",\n      \"%s\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f}",
+            metric_name(m),
+            percentile(values, 0.5),
+            percentile(values, 0.95),
+            percentile(values, 0.99)
+        );
+        F64Array_free(values);
+    }
+    printf("\n    }%s\n", last ? "" : ",");
+    fflush(stdout);
+    InstanceArray_free(&instances);
+}
+
+static ReturnStatus init_renderer(Renderer* renderer, bool fallback) {
+    memset(renderer, 0, sizeof(*renderer));
+    renderer->force_fallback_adapter = fallback;
+    return Renderer_init_headless(renderer, BENCH_WIDTH, BENCH_HEIGHT);
+}
+
+int main(int argc, char** argv) {
+    u32 frames = BENCH_DEFAULT_FRAMES;
+    u32 warmup = BENCH_DEFAULT_WARMUP;
+    u32 max_cubes = BENCH_DEFAULT_MAX_CUBES;
+    bool fallback = false;
+    const char* dump_directory = NULL;
+    ImageFormat dump_format = IMAGE_FORMAT_QOI;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--fallback") == 0) {
+            fallback = true;
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dump_directory = argv[++i];
+        } else if (strcmp(argv[i], "--dump-format") == 0 && i + 1 < argc &&
+                   ImageFormat_parse(argv[i + 1], &dump_format)) {
+            ++i;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-cubes") == 0 && i + 1 < argc) {
+            max_cubes = (u32)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(
+                stderr,
+                "Usage: %s [--frames N] [--warmup N] [--max-cubes N] "
+                "[--fallback]\n"
+                "          [--dump DIR] [--dump-format qoi|png|y4m|raw]\n",
+                argv[0]
+            );
+            return 1;
+        }
+    }
+    if (frames == 0) frames = 1;
+
+    static Renderer renderer;
+    if (init_renderer(&renderer, fallback) != RETURN_SUCCESS) {
+        if (fallback) return 1;
+        // stdout carries the JSON only
+        fprintf(stderr, "No default adapter, using the fallback adapter\n");
+        Renderer_destroy(&renderer);
+        fallback = true;
+        if (init_renderer(&renderer, fallback) != RETURN_SUCCESS) return 1;
+    }
+    static ImageEncoder encoder;
+    if (dump_directory != NULL) {
+        struct stat st;
+        mkdir(dump_directory, 0755);
+        if (stat(dump_directory, &st) != 0 || !S_ISDIR(st.st_mode)) {
+            LOG_ERROR("Failed to create directory: %s", dump_directory);
+            Renderer_destroy(&renderer);
+            return 1;
+        }
+        if (ImageEncoder_init(&encoder, dump_format, dump_directory, 0) !=
+            RETURN_SUCCESS) {
+            Renderer_destroy(&renderer);
+            return 1;
+        }
+        Renderer_set_frame_callback(
+            &renderer, ImageEncoder_frame_callback, &encoder
+        );
+    }
+    WGPUAdapterInfo info = {0};
+    wgpuAdapterGetInfo(renderer.adapter, &info);
+
+    printf("{\n");
+    printf("  \"adapter\": {\"name\": ");
+    print_json_string(info.device);
+    printf(
+        ", \"backend\": \"%s\", \"type\": \"%s\", \"fallback\": %s},\n",
+        backend_name(info.backendType),
+        adapter_type_name(info.adapterType),
+        fallback ? "true" : "false"
+    );
+    printf("  \"width\": %u,\n", BENCH_WIDTH);
+    printf("  \"height\": %u,\n", BENCH_HEIGHT);
+    printf("  \"frames\": %u,\n", frames);
+    printf("  \"warmup\": %u,\n", warmup);
+    printf("  \"scenes\": [\n");
+    wgpuAdapterInfoFreeMembers(info);
+
+    u32 largest = 1000;
+    while (largest <= max_cubes / 10) largest *= 10;
+    for (u64 count = 1000; count <= max_cubes; count *= 10) {
+        for (u32 kind = 0; kind < SCENE_KIND_COUNT; ++kind) {
+            bool last = count == largest && kind == SCENE_KIND_COUNT - 1;
+            run_scene(&renderer, kind, (u32)count, frames, warmup, last);
+        }
+    }
+    printf("  ]\n}\n");
+    // Destroying the renderer delivers the frames still in flight
+    Renderer_destroy(&renderer);
+    if (dump_directory != NULL &&
+        ImageEncoder_finish(&encoder) != RETURN_SUCCESS) {
+        return 1;
+    }
+    return 0;
+}
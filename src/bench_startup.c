@@ -0,0 +1,179 @@
+#include "raijin.h"
+
+// Startup benchmark.  Every sample is a fresh process, this binary run with
+// --child, so nothing stays warm in-process.  Each child prints the init
+// phase timings of `Renderer.init_phase_seconds`, and the driver reports
+// their median and p95 as JSON:
+//   bench_startup [--runs N] [--windowed]
+//
+// Cold runs delete the pipeline cache first, warm runs start from the one
+// the previous run saved.  Driver-level shader caches are left alone.
+
+#define BENCH_DEFAULT_RUNS 20
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+#define BENCH_RESULT_PREFIX "raijin_startup"
+
+// Init phases, then the whole init call and the first frame
+#define BENCH_TOTAL INIT_PHASE_COUNT
+#define BENCH_FIRST_FRAME (INIT_PHASE_COUNT + 1)
+#define BENCH_METRIC_COUNT (INIT_PHASE_COUNT + 2)
+
+static const char* metric_name(u32 metric) {
+    if (metric == BENCH_TOTAL) return "total";
+    if (metric == BENCH_FIRST_FRAME) return "first_frame";
+    return InitPhase_name(metric);
+}
+
+// One startup and first frame, timings printed on a single line
+static int run_child(bool windowed) {
+    f64 metrics[BENCH_METRIC_COUNT] = {0};
+    Raijin engine = {0};
+    Renderer* renderer = &engine.renderer;
+    f64 start = now_seconds();
+    ReturnStatus status =
+        windowed ? Raijin_init(&engine, "Raijin", BENCH_WIDTH, BENCH_HEIGHT)
+                 : Renderer_init_headless(renderer, BENCH_WIDTH, BENCH_HEIGHT);
+    if (status != RETURN_SUCCESS) return 1;
+    metrics[BENCH_TOTAL] = now_seconds() - start;
+    memcpy(
+        metrics,
+        renderer->init_phase_seconds,
+        sizeof(renderer->init_phase_seconds)
+    );
+
+    // Drawing marks the pipelines used, so the next warm run finds them
+    start = now_seconds();
+    Instance instance = {.color = {1.0f, 1.0f, 1.0f, 1.0f}};
+    glm_mat4_identity(instance.model_matrix);
+    Raijin_draw_cube_instance(&engine, instance);
+    Renderer_render(renderer);
+    wgpuDevicePoll(renderer->device, true, NULL);
+    metrics[BENCH_FIRST_FRAME] = now_seconds() - start;
+
+    printf(BENCH_RESULT_PREFIX);
+    for (u32 i = 0; i < BENCH_METRIC_COUNT; ++i) printf(" %.9f", metrics[i]);
+    printf("\n");
+    if (windowed) {
+        Raijin_destroy(&engine);
+    } else {
+        Renderer_destroy(renderer);
+    }
+    return 0;
+}
+
+// Spawns one child and appends its timings to `samples`
+static ReturnStatus run_sample(
+    const char* self, bool windowed, F64Array samples[BENCH_METRIC_COUNT]
+) {
+    char command[4096];
+    snprintf(
+        command,
+        sizeof(command),
+        "'%s' --child%s",
+        self,
+        windowed ? " --windowed" : ""
+    );
+    FILE* child = popen(command, "r");
+    if (!child) {
+        LOG_ERROR("Failed to run: %s", command);
+        return RETURN_FAILURE;
+    }
+    bool found = false;
+    char line[1024];
+    while (fgets(line, sizeof(line), child)) {
+        usize prefix_length = strlen(BENCH_RESULT_PREFIX);
+        if (found || strncmp(line, BENCH_RESULT_PREFIX, prefix_length) != 0) {
+            continue;
+        }
+        char* cursor = line + prefix_length;
+        f64 metrics[BENCH_METRIC_COUNT];
+        u32 parsed = 0;
+        for (; parsed < BENCH_METRIC_COUNT; ++parsed) {
+            char* end = NULL;
+            metrics[parsed] = strtod(cursor, &end);
+            if (end == cursor) break;
+            cursor = end;
+        }
+        if (parsed != BENCH_METRIC_COUNT) continue;
+        for (u32 i = 0; i < BENCH_METRIC_COUNT; ++i) {
+            F64Array_push(&samples[i], metrics[i]);
+        }
+        found = true;
+    }
+    if (pclose(child) != 0 || !found) {
+        LOG_ERROR("Startup sample failed");
+        return RETURN_FAILURE;
+    }
+    return RETURN_SUCCESS;
+}
+
+static void print_summary(
+    const char* name,
+    F64Array samples[BENCH_METRIC_COUNT],
+    bool windowed,
+    bool last
+) {
+    printf("  \"%s\": {\n", name);
+    bool first = true;
+    for (u32 i = 0; i < BENCH_METRIC_COUNT; ++i) {
+        // Headless startup has no surface
+        if (i == INIT_PHASE_SURFACE && !windowed) continue;
+        F64Array* values = &samples[i];
+        qsort(values->items, values->count, sizeof(f64), compare_f64);
+        printf(
+            "%s    \"%s\": {\"median_ms\": %.3f, \"p95_ms\": %.3f}",
+            first ? "" : ",\n",
+            metric_name(i),
+            percentile(values, 0.5) * 1e3,
+            percentile(values, 0.95) * 1e3
+        );
+        first = false;
+    }
+    printf("\n  }%s\n", last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    bool child = false;
+    bool windowed = false;
+    u32 runs = BENCH_DEFAULT_RUNS;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--child") == 0) {
+            child = true;
+        } else if (strcmp(argv[i], "--windowed") == 0) {
+            windowed = true;
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = (u32)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(
+                stderr, "Usage: %s [--runs N] [--windowed]\n", argv[0]
+            );
+            return 1;
+        }
+    }
+    if (child) return run_child(windowed);
+    if (runs == 0) runs = 1;
+
+    F64Array cold[BENCH_METRIC_COUNT] = {0};
+    F64Array warm[BENCH_METRIC_COUNT] = {0};
+    for (u32 i = 0; i < runs; ++i) {
+        remove(RAIJIN_PIPELINE_CACHE_PATH);
+        if (run_sample(argv[0], windowed, cold) != RETURN_SUCCESS) return 1;
+    }
+    // The last cold run saved the pipeline cache the warm runs start from
+    for (u32 i = 0; i < runs; ++i) {
+        if (run_sample(argv[0], windowed, warm) != RETURN_SUCCESS) return 1;
+    }
+
+    printf("{\n");
+    printf("  \"mode\": \"%s\",\n", windowed ? "windowed" : "headless");
+    printf("  \"runs\": %u,\n", runs);
+    print_summary("cold", cold, windowed, false);
+    print_summary("warm", warm, windowed, true);
+    printf("}\n");
+    for (u32 i = 0; i < BENCH_METRIC_COUNT; ++i) {
+        F64Array_free(&cold[i]);
+        F64Array_free(&warm[i]);
+    }
+    return 0;
+}
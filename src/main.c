@@ -5,6 +5,9 @@
 int main(void) {
     Raijin engine = {0};
     Raijin_init(&engine, "Raijin", 1280, 720);
+    // The scene is static, only redraw when something changes
+    Raijin_set_on_demand(&engine, true);
+    Raijin_start_render_thread(&engine);
     Instance cube_instances[] = {
         {.color = {1.0, 0.0, 1.0, 1.0}},
         {.color = {1.0, 1.0, 0.0, 1.0}},
@@ -23,4 +26,5 @@ int main(void) {
         }
         Raijin_render(&engine);
     }
+    Raijin_destroy(&engine);
 }
@@ -0,0 +1,136 @@
+#include "image_encode.h"
+#include "renderer.h"
+
+// Renders a turning grid of cubes headless and writes every frame to disk
+// with `ImageEncoder`, to see what the renderer draws without a window:
+//   render_frames [--frames N] [--width N] [--height N]
+//                 [--format qoi|png|y4m|raw] DIR
+//
+// DIR is created if missing.  Per frame formats write one file per frame,
+// Y4M one DIR/frames.y4m stream that video players open directly.
+
+#define FRAMES_DEFAULT_COUNT 60
+#define FRAMES_DEFAULT_WIDTH 640
+#define FRAMES_DEFAULT_HEIGHT 360
+#define FRAMES_GRID_SIDE 5
+#define FRAMES_CUBE_SPACING 3.0f
+
+static void print_usage(const char* program) {
+    fprintf(
+        stderr,
+        "Usage: %s [--frames N] [--width N] [--height N]\n"
+        "          [--format qoi|png|y4m|raw] DIR\n",
+        program
+    );
+}
+
+static void set_camera(Renderer* renderer, u32 width, u32 height) {
+    f32 extent = FRAMES_GRID_SIDE * FRAMES_CUBE_SPACING;
+    mat4 proj_matrix;
+    mat4 view_matrix;
+    glm_perspective(
+        glm_rad(45.0f),
+        (f32)width / (f32)height,
+        0.1f,
+        extent * 4.0f,
+        proj_matrix
+    );
+    glm_lookat(
+        (vec3){extent, extent, extent * 0.75f},
+        (vec3){0.0f, 0.0f, 0.0f},
+        (vec3){0.0f, 0.0f, 1.0f},
+        view_matrix
+    );
+    Renderer_update_uniforms(renderer, proj_matrix, view_matrix);
+}
+
+// Cubes centered on the origin, each turning at its own rate
+static void draw_cubes(Renderer* renderer, u32 frame) {
+    f32 offset = (FRAMES_GRID_SIDE - 1) * FRAMES_CUBE_SPACING * 0.5f;
+    for (u32 y = 0; y < FRAMES_GRID_SIDE; ++y) {
+        for (u32 x = 0; x < FRAMES_GRID_SIDE; ++x) {
+            u32 i = y * FRAMES_GRID_SIDE + x;
+            DrawCommand cmd = {
+                .mesh_type = MESH_TYPE_CUBE,
+                .instance.color = {
+                    (f32)x / (FRAMES_GRID_SIDE - 1),
+                    (f32)y / (FRAMES_GRID_SIDE - 1),
+                    0.5f,
+                    1.0f,
+                },
+            };
+            glm_translate_make(
+                cmd.instance.model_matrix,
+                (vec3){
+                    (f32)x * FRAMES_CUBE_SPACING - offset,
+                    (f32)y * FRAMES_CUBE_SPACING - offset,
+                    0.0f,
+                }
+            );
+            glm_rotate_z(
+                cmd.instance.model_matrix,
+                0.02f * (f32)(frame * (i % 3 + 1)),
+                cmd.instance.model_matrix
+            );
+            DrawCommandArray_push(&renderer->draw_commands, cmd);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    u32 frames = FRAMES_DEFAULT_COUNT;
+    u32 width = FRAMES_DEFAULT_WIDTH;
+    u32 height = FRAMES_DEFAULT_HEIGHT;
+    ImageFormat format = IMAGE_FORMAT_QOI;
+    const char* directory = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            width = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+            height = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc &&
+                   ImageFormat_parse(argv[i + 1], &format)) {
+            ++i;
+        } else if (argv[i][0] != '-' && directory == NULL) {
+            directory = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (directory == NULL || width == 0 || height == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    struct stat st;
+    mkdir(directory, 0755);
+    if (stat(directory, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        LOG_ERROR("Failed to create directory: %s", directory);
+        return 1;
+    }
+    static Renderer renderer;
+    if (Renderer_init_headless(&renderer, width, height) != RETURN_SUCCESS) {
+        return 1;
+    }
+    static ImageEncoder encoder;
+    if (ImageEncoder_init(&encoder, format, directory, 0) != RETURN_SUCCESS) {
+        Renderer_destroy(&renderer);
+        return 1;
+    }
+    Renderer_set_frame_callback(
+        &renderer, ImageEncoder_frame_callback, &encoder
+    );
+    set_camera(&renderer, width, height);
+    ReturnStatus status = RETURN_SUCCESS;
+    for (u32 frame = 0; frame < frames && status == RETURN_SUCCESS; ++frame) {
+        draw_cubes(&renderer, frame);
+        status = Renderer_render(&renderer);
+    }
+    // Destroying the renderer delivers the frames still in flight
+    Renderer_destroy(&renderer);
+    if (ImageEncoder_finish(&encoder) != RETURN_SUCCESS) return 1;
+    return status == RETURN_SUCCESS ? 0 : 1;
+}
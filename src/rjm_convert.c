@@ -0,0 +1,20 @@
+#include "mesh_cache.h"
+#include "mesh_import.h"
+
+// Offline converter from OBJ/PLY/STL to the .rjm mesh cache:
+//   rjm_convert <input> <output.rjm>
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <input> <output.rjm>\n", argv[0]);
+        return 1;
+    }
+    Mesh mesh = {0};
+    if (Mesh_import(&mesh, argv[1], NULL) != RETURN_SUCCESS) return 1;
+    if (Mesh_write_rjm(&mesh, argv[2]) != RETURN_SUCCESS) return 1;
+
+    // Read the file back so a broken cache never lands in the build
+    RjmFile rjm = {0};
+    if (RjmFile_open(&rjm, argv[2], true) != RETURN_SUCCESS) return 1;
+    RjmFile_close(&rjm);
+    return 0;
+}